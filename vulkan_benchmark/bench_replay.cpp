@@ -0,0 +1,613 @@
+/*
+ *
+ * Andrew Frost
+ * bench_replay.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "bench_replay.hpp"
+
+namespace bench {
+
+using vkb::core::FrameTrace;
+
+//-------------------------------------------------------------------------
+// Aspects of an attachment view
+//
+static vk::ImageAspectFlags aspectOf(vk::Format format)
+{
+    switch (format) {
+    case vk::Format::eD16Unorm:
+    case vk::Format::eX8D24UnormPack32:
+    case vk::Format::eD32Sfloat:
+        return vk::ImageAspectFlagBits::eDepth;
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+        return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+    default:
+        return vk::ImageAspectFlagBits::eColor;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// ReplayScene                                                           //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization, every object of the capture is made here
+//
+void ReplayScene::init(HeadlessContext& context, vkb::core::ShaderLibrary& shaders,
+    vkb::core::PipelineVariants& variants, const FrameTrace& trace, uint32_t loops, uint32_t framesInFlight)
+{
+    assert(!m_context && "ReplayScene already initialized");
+    m_context = &context;
+    m_trace = trace;
+    m_loops = std::max(loops, 1u);
+
+    createResources();
+    createPasses();
+    prepareResources();
+
+    m_commandState.init(context.getDevice(), variants.isExtendedDynamicState());
+    createPipelines(shaders, variants);
+
+    // Device local uploads copy from a slice of the frame's staging buffer,
+    // the contents never change so they are written once
+    vk::DeviceSize stagingSize = 0;
+    m_stagingOffsets.assign(m_trace.commands.size(), 0);
+    for (size_t i = 0; i < m_trace.commands.size(); i++) {
+        const FrameTrace::Command& command = m_trace.commands[i];
+        if (command.op != FrameTrace::Op::eUpload || m_trace.buffers[command.args[0]].hostVisible)
+            continue;
+        m_stagingOffsets[i] = stagingSize;
+        stagingSize += (command.size + 15) & ~vk::DeviceSize(15);
+    }
+
+    if (stagingSize > 0) {
+        m_staging.resize(framesInFlight);
+        for (auto& staging : m_staging) {
+            staging = context.createBuffer(stagingSize, vk::BufferUsageFlagBits::eTransferSrc,
+                vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+            uint8_t* mapped = static_cast<uint8_t*>(staging.mapped);
+            for (size_t i = 0; i < m_trace.commands.size(); i++) {
+                const FrameTrace::Command& command = m_trace.commands[i];
+                if (command.op != FrameTrace::Op::eUpload || m_trace.buffers[command.args[0]].hostVisible)
+                    continue;
+                if (command.args[3])
+                    memcpy(mapped + m_stagingOffsets[i], &m_trace.data[FrameTrace::unpackWide(&command.args[1])],
+                        static_cast<size_t>(command.size));
+                else
+                    memset(mapped + m_stagingOffsets[i], 0, static_cast<size_t>(command.size));
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+// Destroy replay objects, pipelines belong to the variant cache
+//
+void ReplayScene::destroy()
+{
+    if (!m_context)
+        return;
+
+    vk::Device device = m_context->getDevice();
+    device.waitIdle();
+
+    for (auto& pass : m_passes) {
+        device.destroyFramebuffer(pass.framebuffer);
+        device.destroyRenderPass(pass.renderPass);
+    }
+    m_passes.clear();
+
+    for (auto& buffer : m_buffers)
+        m_context->destroyBuffer(buffer);
+    m_buffers.clear();
+    for (auto& buffer : m_staging)
+        m_context->destroyBuffer(buffer);
+    m_staging.clear();
+    for (auto& image : m_images)
+        m_context->destroyImage(image);
+    m_images.clear();
+
+    m_commandState.destroy();
+    m_pipelines.clear();
+    m_programs.clear();
+    m_passNames.clear();
+    m_stagingOffsets.clear();
+    m_trace.clear();
+    m_drawCount = 0;
+    m_triangleCount = 0;
+    m_context = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Buffers and images at their captured size, host visible buffers get
+// their contents right away
+//
+void ReplayScene::createResources()
+{
+    const vk::MemoryPropertyFlags hostVisible = vk::MemoryPropertyFlagBits::eHostVisible
+                                              | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+    for (const auto& entry : m_trace.buffers) {
+        const vk::BufferUsageFlags usage = vk::BufferUsageFlags(entry.usage) | vk::BufferUsageFlagBits::eTransferDst;
+        Buffer buffer = m_context->createBuffer(std::max<vk::DeviceSize>(entry.size, 4), usage,
+            entry.hostVisible ? hostVisible : vk::MemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal));
+
+        if (buffer.mapped) {
+            memset(buffer.mapped, 0, static_cast<size_t>(entry.size));
+            if (entry.dataSize)
+                memcpy(buffer.mapped, &m_trace.data[entry.dataOffset], static_cast<size_t>(entry.dataSize));
+        }
+        m_buffers.push_back(buffer);
+    }
+
+    for (const auto& entry : m_trace.images) {
+        const vk::Format format = static_cast<vk::Format>(entry.format);
+        m_images.push_back(m_context->createImage({ entry.width, entry.height }, format,
+            vk::ImageUsageFlags(entry.usage), aspectOf(format)));
+    }
+}
+
+//-------------------------------------------------------------------------
+// Render pass and framebuffer per captured pass. Attachments stay in
+// their attachment layout, loading passes expect it from the one before
+//
+void ReplayScene::createPasses()
+{
+    vk::Device device = m_context->getDevice();
+
+    for (const auto& entry : m_trace.passes) {
+        const vk::AttachmentLoadOp loadOp = static_cast<vk::AttachmentLoadOp>(entry.loadOp);
+
+        std::vector<vk::AttachmentDescription> attachments;
+        std::vector<vk::AttachmentReference> colorReferences;
+        std::vector<vk::ImageView> views;
+        vk::Extent2D extent(~0u, ~0u);
+
+        Pass pass;
+
+        auto addAttachment = [&](uint32_t index, vk::ImageLayout layout) {
+            const FrameTrace::Image& image = m_trace.images[index];
+
+            vk::AttachmentDescription attachment = {};
+            attachment.format = static_cast<vk::Format>(image.format);
+            attachment.samples = vk::SampleCountFlagBits::e1;
+            attachment.loadOp = loadOp;
+            attachment.storeOp = vk::AttachmentStoreOp::eStore;
+            attachment.stencilLoadOp = loadOp;
+            attachment.stencilStoreOp = vk::AttachmentStoreOp::eStore;
+            attachment.initialLayout = loadOp == vk::AttachmentLoadOp::eLoad ? layout : vk::ImageLayout::eUndefined;
+            attachment.finalLayout = layout;
+            attachments.push_back(attachment);
+
+            views.push_back(m_images[index].view);
+            extent.width = std::min(extent.width, image.width);
+            extent.height = std::min(extent.height, image.height);
+        };
+
+        for (uint32_t i = 0; i < entry.colorCount; i++) {
+            colorReferences.push_back({ static_cast<uint32_t>(attachments.size()), vk::ImageLayout::eColorAttachmentOptimal });
+            addAttachment(entry.colors[i], vk::ImageLayout::eColorAttachmentOptimal);
+            pass.clearValues.push_back(vk::ClearColorValue(std::array<float, 4>{ 0.1f, 0.1f, 0.1f, 1.f }));
+        }
+
+        const vk::AttachmentReference depthReference{ static_cast<uint32_t>(attachments.size()),
+            vk::ImageLayout::eDepthStencilAttachmentOptimal };
+        if (entry.depth != FrameTrace::NONE) {
+            addAttachment(entry.depth, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+            pass.clearValues.push_back(vk::ClearDepthStencilValue(1.f, 0));
+        }
+
+        vk::SubpassDescription subpass = {};
+        subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+        subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+        subpass.pColorAttachments = colorReferences.data();
+        subpass.pDepthStencilAttachment = entry.depth != FrameTrace::NONE ? &depthReference : nullptr;
+
+        // previous pass or frame wrote the same attachments
+        vk::SubpassDependency dependency = {};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstSubpass = 0;
+        dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput
+                                | vk::PipelineStageFlagBits::eLateFragmentTests;
+        dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput
+                                | vk::PipelineStageFlagBits::eEarlyFragmentTests;
+        dependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite
+                                 | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead
+                                 | vk::AccessFlagBits::eColorAttachmentWrite
+                                 | vk::AccessFlagBits::eDepthStencilAttachmentRead
+                                 | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+        vk::RenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &dependency;
+
+        try {
+            pass.renderPass = device.createRenderPass(renderPassInfo);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to create replay render pass!");
+        }
+
+        vk::FramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.renderPass = pass.renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+        framebufferInfo.pAttachments = views.data();
+        framebufferInfo.width = views.empty() ? 1 : extent.width;
+        framebufferInfo.height = views.empty() ? 1 : extent.height;
+        framebufferInfo.layers = 1;
+
+        try {
+            pass.framebuffer = device.createFramebuffer(framebufferInfo);
+        }
+        catch (vk::SystemError err) {
+            device.destroyRenderPass(pass.renderPass);
+            throw std::runtime_error("failed to create replay framebuffer!");
+        }
+
+        m_passes.push_back(pass);
+    }
+}
+
+//-------------------------------------------------------------------------
+// Programs from the captured SPIR-V, then every pipeline in each pass it
+// draws in. A graphics pipeline bound outside of a pass is built for the
+// passes that follow. Draw and triangle counts come out of the same walk.
+//
+void ReplayScene::createPipelines(vkb::core::ShaderLibrary& shaders, vkb::core::PipelineVariants& variants)
+{
+    for (uint32_t p = 0; p < m_trace.programs.size(); p++) {
+        const FrameTrace::Program& entry = m_trace.programs[p];
+
+        std::vector<const vkb::core::Shader*> stages;
+        for (uint32_t s = 0; s < entry.stageCount; s++) {
+            const FrameTrace::Shader& shader = m_trace.shaders[entry.stages[s]];
+            stages.push_back(&shaders.loadFromMemory(reinterpret_cast<const uint32_t*>(&m_trace.data[shader.dataOffset]),
+                static_cast<size_t>(shader.dataSize), "capture" + std::to_string(entry.stages[s])));
+        }
+        m_programs.push_back(&shaders.createProgram(stages));
+    }
+
+    auto build = [&](uint32_t pipeline, uint32_t pass) {
+        const uint64_t key = pipelineKey(pipeline, pass);
+        if (m_pipelines.count(key))
+            return;
+
+        const FrameTrace::Pipeline& entry = m_trace.pipelines[pipeline];
+        const vkb::core::ShaderProgram& program = *m_programs[entry.program];
+        if (entry.compute) {
+            const std::vector<uint32_t> constants(entry.desc.constants, entry.desc.constants + entry.desc.constantCount);
+            m_pipelines[key] = variants.getCompute(program, constants);
+        }
+        else {
+            m_pipelines[key] = variants.getGraphics(program, vkb::core::PipelineStateKey(entry.desc),
+                m_passes[pass].renderPass);
+        }
+    };
+
+    uint32_t pass = FrameTrace::NONE;
+    uint32_t graphics = FrameTrace::NONE;
+
+    for (const auto& command : m_trace.commands) {
+        switch (command.op) {
+        case FrameTrace::Op::eBeginPass:
+            pass = command.args[0];
+            m_passNames.push_back("pass" + std::to_string(m_passNames.size()));
+            if (graphics != FrameTrace::NONE)
+                build(graphics, pass);
+            break;
+        case FrameTrace::Op::eEndPass:
+            pass = FrameTrace::NONE;
+            break;
+        case FrameTrace::Op::eBindPipeline:
+            if (m_trace.pipelines[command.args[0]].compute) {
+                build(command.args[0], FrameTrace::NONE);
+                break;
+            }
+            graphics = command.args[0];
+            if (pass != FrameTrace::NONE)
+                build(graphics, pass);
+            break;
+        case FrameTrace::Op::eDraw:
+            m_drawCount++;
+            m_triangleCount += static_cast<uint64_t>(command.args[0] / 3) * command.args[1];
+            break;
+        case FrameTrace::Op::eDrawIndexed:
+            m_drawCount++;
+            m_triangleCount += static_cast<uint64_t>(command.args[0] / 3) * command.args[1];
+            break;
+        default:
+            break;
+        }
+    }
+
+    // profiler sections are only opened for the first loop
+    m_passNames.resize(std::min<size_t>(m_passNames.size(), 24));
+}
+
+//-------------------------------------------------------------------------
+// Initial contents of device local buffers, waited on right away
+//
+void ReplayScene::prepareResources()
+{
+    vk::Device device = m_context->getDevice();
+
+    vk::DeviceSize stagingSize = 0;
+    for (const auto& entry : m_trace.buffers)
+        if (!entry.hostVisible && entry.dataSize)
+            stagingSize += (entry.dataSize + 15) & ~vk::DeviceSize(15);
+
+    Buffer staging;
+    if (stagingSize > 0)
+        staging = m_context->createBuffer(stagingSize, vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    vk::CommandPool commandPool;
+    vk::CommandBuffer cmdBuffer;
+    vk::Fence fence;
+
+    try {
+        vk::CommandPoolCreateInfo poolInfo = {};
+        poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+        poolInfo.queueFamilyIndex = m_context->getQueueIdx();
+        commandPool = device.createCommandPool(poolInfo);
+        cmdBuffer = device.allocateCommandBuffers({ commandPool, vk::CommandBufferLevel::ePrimary, 1 })[0];
+        fence = device.createFence({});
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create replay upload command objects!");
+    }
+
+    cmdBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+    vk::DeviceSize offset = 0;
+    for (size_t i = 0; i < m_trace.buffers.size(); i++) {
+        const FrameTrace::Buffer& entry = m_trace.buffers[i];
+        if (entry.hostVisible)
+            continue;
+
+        cmdBuffer.fillBuffer(m_buffers[i].buffer, 0, VK_WHOLE_SIZE, 0);
+        if (!entry.dataSize)
+            continue;
+
+        memcpy(static_cast<uint8_t*>(staging.mapped) + offset, &m_trace.data[entry.dataOffset],
+            static_cast<size_t>(entry.dataSize));
+        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferWrite), nullptr, nullptr);
+        cmdBuffer.copyBuffer(staging.buffer, m_buffers[i].buffer, vk::BufferCopy(offset, 0, entry.dataSize));
+        offset += (entry.dataSize + 15) & ~vk::DeviceSize(15);
+    }
+
+    // attachments start out in their attachment layout
+    std::vector<vk::ImageMemoryBarrier> barriers;
+    for (size_t i = 0; i < m_trace.images.size(); i++) {
+        const vk::ImageUsageFlags usage(m_trace.images[i].usage);
+        const vk::Format format = static_cast<vk::Format>(m_trace.images[i].format);
+
+        vk::ImageMemoryBarrier barrier = {};
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = m_images[i].image;
+        barrier.subresourceRange = { aspectOf(format), 0, 1, 0, 1 };
+        barrier.oldLayout = vk::ImageLayout::eUndefined;
+
+        if (usage & vk::ImageUsageFlagBits::eColorAttachment) {
+            barrier.newLayout = vk::ImageLayout::eColorAttachmentOptimal;
+            barrier.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+        }
+        else if (usage & vk::ImageUsageFlagBits::eDepthStencilAttachment) {
+            barrier.newLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+            barrier.dstAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        }
+        else {
+            continue;
+        }
+        barriers.push_back(barrier);
+    }
+    if (!barriers.empty())
+        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eAllCommands, {},
+            nullptr, nullptr, barriers);
+
+    cmdBuffer.end();
+
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmdBuffer;
+
+    try {
+        m_context->getQueue().submit(submitInfo, fence);
+        device.waitForFences(fence, VK_TRUE, UINT64_MAX);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to submit replay uploads!");
+    }
+
+    device.destroyFence(fence);
+    device.destroyCommandPool(commandPool);
+    if (staging.buffer)
+        m_context->destroyBuffer(staging);
+}
+
+//-------------------------------------------------------------------------
+// Host visible uploads, once per frame. They all land before the submit,
+// every loop reads the same contents and frames in flight only see bytes
+// identical to their own
+//
+void ReplayScene::update(uint32_t frameIdx, float time)
+{
+    for (const auto& command : m_trace.commands) {
+        if (command.op != FrameTrace::Op::eUpload || !m_trace.buffers[command.args[0]].hostVisible)
+            continue;
+
+        uint8_t* mapped = static_cast<uint8_t*>(m_buffers[command.args[0]].mapped) + command.offset;
+        if (command.args[3])
+            memcpy(mapped, &m_trace.data[FrameTrace::unpackWide(&command.args[1])], static_cast<size_t>(command.size));
+        else
+            memset(mapped, 0, static_cast<size_t>(command.size));
+    }
+}
+
+//-------------------------------------------------------------------------
+// The captured stream, loops times
+//
+void ReplayScene::record(vk::CommandBuffer cmdBuffer, uint32_t frameIdx, vkb::core::GpuProfiler& profiler)
+{
+    m_commandState.begin(cmdBuffer);
+
+    for (uint32_t loop = 0; loop < m_loops; loop++) {
+        // every loop starts like the captured frame did, with nothing bound
+        uint32_t pass = FrameTrace::NONE;
+        uint32_t graphics = FrameTrace::NONE;
+        bool computeBound = false;
+        const vkb::core::ShaderProgram* program = nullptr;
+        uint32_t passIndex = 0;
+        bool section = false;
+
+        for (size_t i = 0; i < m_trace.commands.size(); i++) {
+            const FrameTrace::Command& command = m_trace.commands[i];
+            const uint32_t* args = command.args;
+
+            switch (command.op) {
+            case FrameTrace::Op::eUpload:
+                if (!m_trace.buffers[args[0]].hostVisible)
+                    cmdBuffer.copyBuffer(m_staging[frameIdx].buffer, m_buffers[args[0]].buffer,
+                        vk::BufferCopy(m_stagingOffsets[i], command.offset, command.size));
+                break;
+
+            case FrameTrace::Op::eBeginPass: {
+                section = loop == 0 && passIndex < m_passNames.size();
+                if (section)
+                    profiler.beginSection(cmdBuffer, m_passNames[passIndex].c_str());
+                passIndex++;
+
+                pass = args[0];
+                vk::RenderPassBeginInfo beginInfo = {};
+                beginInfo.renderPass = m_passes[pass].renderPass;
+                beginInfo.framebuffer = m_passes[pass].framebuffer;
+                beginInfo.renderArea = vk::Rect2D({ static_cast<int32_t>(args[1]), static_cast<int32_t>(args[2]) },
+                    { args[3], args[4] });
+                beginInfo.clearValueCount = static_cast<uint32_t>(m_passes[pass].clearValues.size());
+                beginInfo.pClearValues = m_passes[pass].clearValues.data();
+                cmdBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
+
+                if (graphics != FrameTrace::NONE)
+                    m_commandState.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipelines[pipelineKey(graphics, pass)]);
+                break;
+            }
+
+            case FrameTrace::Op::eEndPass:
+                cmdBuffer.endRenderPass();
+                if (section)
+                    profiler.endSection(cmdBuffer);
+                section = false;
+                pass = FrameTrace::NONE;
+                break;
+
+            case FrameTrace::Op::eBindPipeline: {
+                const FrameTrace::Pipeline& entry = m_trace.pipelines[args[0]];
+                program = m_programs[entry.program];
+                if (entry.compute) {
+                    m_commandState.bindPipeline(vk::PipelineBindPoint::eCompute,
+                        m_pipelines[pipelineKey(args[0], FrameTrace::NONE)]);
+                    computeBound = true;
+                    break;
+                }
+                graphics = args[0];
+                if (pass != FrameTrace::NONE)
+                    m_commandState.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipelines[pipelineKey(graphics, pass)]);
+                break;
+            }
+
+            case FrameTrace::Op::eBindVertexBuffer:
+                cmdBuffer.bindVertexBuffers(args[0], m_buffers[args[1]].buffer, command.offset);
+                break;
+
+            case FrameTrace::Op::eBindIndexBuffer:
+                cmdBuffer.bindIndexBuffer(m_buffers[args[0]].buffer, command.offset, static_cast<vk::IndexType>(args[1]));
+                break;
+
+            case FrameTrace::Op::ePushConstants:
+                // clamped to the range of the rebuilt layout
+                if (program && args[1] < program->pushConstantSize) {
+                    const uint32_t size = std::min(static_cast<uint32_t>(command.size), program->pushConstantSize - args[1]);
+                    cmdBuffer.pushConstants(program->pipelineLayout, program->pushConstantStages, args[1], size,
+                        &m_trace.data[FrameTrace::unpackWide(&args[2])]);
+                }
+                break;
+
+            case FrameTrace::Op::eViewport: {
+                float values[6];
+                memcpy(values, args, sizeof(values));
+                m_commandState.setViewport(vk::Viewport(values[0], values[1], values[2], values[3], values[4], values[5]));
+                break;
+            }
+
+            case FrameTrace::Op::eScissor:
+                m_commandState.setScissor(vk::Rect2D({ static_cast<int32_t>(args[0]), static_cast<int32_t>(args[1]) },
+                    { args[2], args[3] }));
+                break;
+
+            case FrameTrace::Op::eDynamicState:
+                switch (static_cast<FrameTrace::DynamicState>(args[0])) {
+                case FrameTrace::DynamicState::eCullMode:
+                    m_commandState.setCullMode(vk::CullModeFlags(args[1]));
+                    break;
+                case FrameTrace::DynamicState::eFrontFace:
+                    m_commandState.setFrontFace(static_cast<vk::FrontFace>(args[1]));
+                    break;
+                case FrameTrace::DynamicState::eTopology:
+                    m_commandState.setPrimitiveTopology(static_cast<vk::PrimitiveTopology>(args[1]));
+                    break;
+                case FrameTrace::DynamicState::eDepth:
+                    m_commandState.setDepthState(args[1] != 0, args[2] != 0, static_cast<vk::CompareOp>(args[3]));
+                    break;
+                }
+                break;
+
+            case FrameTrace::Op::eDraw:
+                if (pass != FrameTrace::NONE && graphics != FrameTrace::NONE)
+                    cmdBuffer.draw(args[0], args[1], args[2], args[3]);
+                break;
+
+            case FrameTrace::Op::eDrawIndexed:
+                if (pass != FrameTrace::NONE && graphics != FrameTrace::NONE)
+                    cmdBuffer.drawIndexed(args[0], args[1], args[2], static_cast<int32_t>(args[3]), args[4]);
+                break;
+
+            case FrameTrace::Op::eDispatch:
+                if (pass == FrameTrace::NONE && computeBound)
+                    cmdBuffer.dispatch(args[0], args[1], args[2]);
+                break;
+
+            case FrameTrace::Op::eBarrier:
+                if (pass == FrameTrace::NONE)
+                    cmdBuffer.pipelineBarrier(vk::PipelineStageFlags(args[0]), vk::PipelineStageFlags(args[1]), {},
+                        vk::MemoryBarrier(vk::AccessFlags(args[2]), vk::AccessFlags(args[3])), nullptr, nullptr);
+                break;
+            }
+        }
+
+        // a capture cut short inside a pass
+        if (pass != FrameTrace::NONE) {
+            cmdBuffer.endRenderPass();
+            if (section)
+                profiler.endSection(cmdBuffer);
+        }
+    }
+}
+
+} // namespace bench
\ No newline at end of file
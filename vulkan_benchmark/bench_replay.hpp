@@ -0,0 +1,106 @@
+/*
+ *
+ * Andrew Frost
+ * bench_replay.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "bench_scene.hpp"
+#include "headless_context.hpp"
+#include "../vulkan_samples/core/frame_capture.hpp"
+
+namespace bench {
+
+///////////////////////////////////////////////////////////////////////////
+// ReplayScene                                                           //
+///////////////////////////////////////////////////////////////////////////
+// A captured frame rebuilt on the headless context and re-recorded     //
+// every frame                                                           //
+// - buffers start with their captured contents, zero filled without,  //
+//   host visible ones are written by update(), device local uploads    //
+//   copy from a staging buffer filled once                             //
+// - attachments get render passes of their own with the captured load //
+//   op, clears use fixed values                                        //
+// - pipelines are rebuilt from the captured SPIR-V through the shader  //
+//   library and variant cache, one per pass they are used in          //
+// - loops > 1 repeats the whole stream in one frame, for captures too  //
+//   light to load the device. Host visible uploads are written once   //
+//   per frame, not per loop                                            //
+///////////////////////////////////////////////////////////////////////////
+
+class ReplayScene : public Scene
+{
+public:
+    ReplayScene(ReplayScene const&) = delete;
+    ReplayScene& operator=(ReplayScene const&) = delete;
+
+    ReplayScene() = default;
+    ~ReplayScene() { destroy(); }
+
+    void init(HeadlessContext& context, vkb::core::ShaderLibrary& shaders, vkb::core::PipelineVariants& variants,
+        const vkb::core::FrameTrace& trace, uint32_t loops, uint32_t framesInFlight);
+
+    void destroy() override;
+
+    // Host visible uploads of the frame
+    void update(uint32_t frameIdx, float time) override;
+
+    void record(vk::CommandBuffer cmdBuffer, uint32_t frameIdx, vkb::core::GpuProfiler& profiler) override;
+
+    // Getting Methods
+    uint32_t getDrawCount()     const override { return m_drawCount * m_loops; }
+    uint64_t getTriangleCount() const override { return m_triangleCount * m_loops; }
+    float    getFrameMs()       const { return m_trace.frameMs; }
+    const vkb::core::CommandState::Stats& getStateStats() const override { return m_commandState.getStats(); }
+
+private:
+
+    struct Pass
+    {
+        vk::RenderPass              renderPass;
+        vk::Framebuffer             framebuffer;
+        std::vector<vk::ClearValue> clearValues;
+    };
+
+    void createResources();
+
+    void createPasses();
+
+    void createPipelines(vkb::core::ShaderLibrary& shaders, vkb::core::PipelineVariants& variants);
+
+    // One submission: initial device local contents, zero fills and
+    // attachments in the layout every render pass expects
+    void prepareResources();
+
+    static uint64_t pipelineKey(uint32_t pipeline, uint32_t pass) { return (uint64_t(pipeline) << 32) | pass; }
+
+    HeadlessContext*                           m_context{ nullptr };
+    vkb::core::FrameTrace                      m_trace;
+    uint32_t                                   m_loops{ 1 };
+
+    std::vector<Buffer>                        m_buffers;
+    std::vector<Image>                         m_images;
+    std::vector<Pass>                          m_passes;
+    std::vector<Buffer>                        m_staging;        // per frame in flight
+    std::vector<vk::DeviceSize>                m_stagingOffsets; // per upload command
+
+    std::vector<const vkb::core::ShaderProgram*> m_programs;
+    std::unordered_map<uint64_t, vk::Pipeline> m_pipelines;      // pipeline and pass
+    std::vector<std::string>                   m_passNames;      // GPU profiler sections
+
+    vkb::core::CommandState                    m_commandState;
+
+    uint32_t                                   m_drawCount{ 0 };
+    uint64_t                                   m_triangleCount{ 0 };
+
+}; // class ReplayScene
+
+} // namespace bench
\ No newline at end of file
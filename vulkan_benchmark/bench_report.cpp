@@ -0,0 +1,383 @@
+/*
+ *
+ * Andrew Frost
+ * bench_report.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "bench_report.hpp"
+
+namespace bench {
+
+///////////////////////////////////////////////////////////////////////////
+// JSON                                                                  //
+///////////////////////////////////////////////////////////////////////////
+// Just enough of a reader for the files written below                  //
+///////////////////////////////////////////////////////////////////////////
+
+struct JsonValue
+{
+    enum class Type { eNull, eBool, eNumber, eString, eArray, eObject };
+
+    Type                                   type{ Type::eNull };
+    double                                 number{ 0.0 };
+    std::string                            string;
+    std::vector<JsonValue>                 array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    const JsonValue* get(const std::string& key) const
+    {
+        for (const auto& member : object)
+            if (member.first == key)
+                return &member.second;
+        return nullptr;
+    }
+};
+
+class JsonReader
+{
+public:
+    explicit JsonReader(const std::string& text) : m_text(text) {}
+
+    JsonValue parse()
+    {
+        JsonValue value = parseValue();
+        skipSpace();
+        if (m_pos != m_text.size())
+            fail("trailing characters");
+        return value;
+    }
+
+private:
+
+    void fail(const char* what) const
+    {
+        throw std::runtime_error(std::string("json parse error: ") + what + " at offset " + std::to_string(m_pos));
+    }
+
+    void skipSpace()
+    {
+        while (m_pos < m_text.size() && isspace(static_cast<unsigned char>(m_text[m_pos])))
+            m_pos++;
+    }
+
+    void expect(char c)
+    {
+        skipSpace();
+        if (m_pos >= m_text.size() || m_text[m_pos] != c)
+            fail("unexpected character");
+        m_pos++;
+    }
+
+    JsonValue parseValue()
+    {
+        skipSpace();
+        if (m_pos >= m_text.size())
+            fail("unexpected end");
+
+        JsonValue value;
+        const char c = m_text[m_pos];
+
+        if (c == '{') {
+            value.type = JsonValue::Type::eObject;
+            m_pos++;
+            skipSpace();
+            if (m_text[m_pos] == '}') {
+                m_pos++;
+                return value;
+            }
+            do {
+                skipSpace();
+                std::string key = parseString();
+                expect(':');
+                value.object.emplace_back(std::move(key), parseValue());
+                skipSpace();
+            } while (m_pos < m_text.size() && m_text[m_pos++] == ',');
+            if (m_text[m_pos - 1] != '}')
+                fail("expected '}'");
+        }
+        else if (c == '[') {
+            value.type = JsonValue::Type::eArray;
+            m_pos++;
+            skipSpace();
+            if (m_text[m_pos] == ']') {
+                m_pos++;
+                return value;
+            }
+            do {
+                value.array.push_back(parseValue());
+                skipSpace();
+            } while (m_pos < m_text.size() && m_text[m_pos++] == ',');
+            if (m_text[m_pos - 1] != ']')
+                fail("expected ']'");
+        }
+        else if (c == '"') {
+            value.type = JsonValue::Type::eString;
+            value.string = parseString();
+        }
+        else if (m_text.compare(m_pos, 4, "true") == 0 || m_text.compare(m_pos, 5, "false") == 0) {
+            value.type = JsonValue::Type::eBool;
+            value.number = c == 't' ? 1.0 : 0.0;
+            m_pos += c == 't' ? 4 : 5;
+        }
+        else if (m_text.compare(m_pos, 4, "null") == 0) {
+            m_pos += 4;
+        }
+        else {
+            const char* begin = m_text.c_str() + m_pos;
+            char* end = nullptr;
+            value.type = JsonValue::Type::eNumber;
+            value.number = strtod(begin, &end);
+            if (end == begin)
+                fail("invalid value");
+            m_pos += end - begin;
+        }
+
+        return value;
+    }
+
+    std::string parseString()
+    {
+        if (m_pos >= m_text.size() || m_text[m_pos] != '"')
+            fail("expected string");
+        m_pos++;
+
+        std::string result;
+        while (m_pos < m_text.size() && m_text[m_pos] != '"') {
+            char c = m_text[m_pos++];
+            if (c == '\\' && m_pos < m_text.size()) {
+                c = m_text[m_pos++];
+                switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'u': m_pos += 4; c = '?'; break;  // names are ascii
+                default: break;
+                }
+            }
+            result += c;
+        }
+        if (m_pos >= m_text.size())
+            fail("unterminated string");
+        m_pos++;
+
+        return result;
+    }
+
+    const std::string& m_text;
+    size_t             m_pos{ 0 };
+};
+
+//-------------------------------------------------------------------------
+// Escaped and quoted
+//
+static std::string quote(const std::string& text)
+{
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            result += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20)
+            result += c;
+    }
+    return result + "\"";
+}
+
+//-------------------------------------------------------------------------
+// Lower is better, the scene shape is not a metric
+//
+static bool isTiming(const std::string& metric)
+{
+    return metric.size() > 3 && metric.compare(metric.size() - 3, 3, "_ms") == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Report                                                                //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Metric lookup
+//
+const double* SceneResult::find(const std::string& name) const
+{
+    for (const auto& metric : metrics)
+        if (metric.first == name)
+            return &metric.second;
+    return nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Scene lookup
+//
+const SceneResult* Report::find(const std::string& scene) const
+{
+    for (const auto& result : scenes)
+        if (result.desc.name == scene)
+            return &result;
+    return nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Serialize
+//
+std::string toJson(const Report& report)
+{
+    std::ostringstream out;
+    out << std::setprecision(6);
+
+    out << "{\n";
+    out << "  \"device\": " << quote(report.device) << ",\n";
+    out << "  \"api\": " << quote(report.api) << ",\n";
+    out << "  \"driver\": " << report.driver << ",\n";
+    out << "  \"frames\": " << report.frames << ",\n";
+    out << "  \"scenes\": [";
+
+    for (size_t s = 0; s < report.scenes.size(); s++) {
+        const SceneResult& scene = report.scenes[s];
+        out << (s ? "," : "") << "\n    {\n";
+        out << "      \"name\": " << quote(scene.desc.name) << ",\n";
+        out << "      \"instances\": " << scene.desc.instances << ",\n";
+        out << "      \"materials\": " << scene.desc.materials << ",\n";
+        out << "      \"passes\": " << scene.desc.passes << ",\n";
+        out << "      \"metrics\": {";
+        for (size_t m = 0; m < scene.metrics.size(); m++) {
+            out << (m ? "," : "") << "\n        " << quote(scene.metrics[m].first) << ": " << scene.metrics[m].second;
+        }
+        out << "\n      }\n    }";
+    }
+
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+//-------------------------------------------------------------------------
+// Write to disk
+//
+void writeReport(const std::string& path, const Report& report)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open report file: " + path);
+    file << toJson(report);
+}
+
+//-------------------------------------------------------------------------
+// Read a report written by writeReport
+//
+Report loadReport(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open baseline file: " + path);
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+
+    const JsonValue root = JsonReader(text).parse();
+
+    Report report;
+    if (const JsonValue* device = root.get("device")) report.device = device->string;
+    if (const JsonValue* api = root.get("api"))       report.api = api->string;
+    if (const JsonValue* driver = root.get("driver")) report.driver = static_cast<uint32_t>(driver->number);
+    if (const JsonValue* frames = root.get("frames")) report.frames = static_cast<uint32_t>(frames->number);
+
+    const JsonValue* scenes = root.get("scenes");
+    if (!scenes || scenes->type != JsonValue::Type::eArray)
+        throw std::runtime_error("baseline has no scenes: " + path);
+
+    for (const JsonValue& entry : scenes->array) {
+        SceneResult scene;
+        if (const JsonValue* name = entry.get("name"))           scene.desc.name = name->string;
+        if (const JsonValue* instances = entry.get("instances")) scene.desc.instances = static_cast<uint32_t>(instances->number);
+        if (const JsonValue* materials = entry.get("materials")) scene.desc.materials = static_cast<uint32_t>(materials->number);
+        if (const JsonValue* passes = entry.get("passes"))       scene.desc.passes = static_cast<uint32_t>(passes->number);
+
+        if (const JsonValue* metrics = entry.get("metrics")) {
+            for (const auto& metric : metrics->object)
+                if (metric.second.type == JsonValue::Type::eNumber)
+                    scene.add(metric.first, metric.second.number);
+        }
+        report.scenes.push_back(std::move(scene));
+    }
+
+    return report;
+}
+
+//-------------------------------------------------------------------------
+// Compare every metric present in both reports
+//
+std::vector<Regression> compareReports(const Report& baseline, const Report& current,
+    double threshold, double minDeltaMs, std::ostream& log)
+{
+    std::vector<Regression> regressions;
+
+    if (baseline.device != current.device)
+        log << "warning: baseline device '" << baseline.device << "' differs from '" << current.device << "'\n";
+
+    log << std::left << std::setw(20) << "scene" << std::setw(28) << "metric"
+        << std::right << std::setw(14) << "baseline" << std::setw(14) << "current" << std::setw(10) << "change" << "\n";
+
+    for (const SceneResult& scene : current.scenes) {
+        const SceneResult* base = baseline.find(scene.desc.name);
+        if (!base) {
+            log << std::left << std::setw(20) << scene.desc.name << "not in baseline\n";
+            continue;
+        }
+        if (base->desc.instances != scene.desc.instances || base->desc.materials != scene.desc.materials
+            || base->desc.passes != scene.desc.passes) {
+            log << std::left << std::setw(20) << scene.desc.name << "scene shape differs, skipped\n";
+            continue;
+        }
+
+        for (const auto& metric : scene.metrics) {
+            const double* baseValue = base->find(metric.first);
+            if (!baseValue)
+                continue;
+
+            const double delta = metric.second - *baseValue;
+            const double change = *baseValue != 0.0 ? delta / *baseValue : (delta != 0.0 ? 1.0 : 0.0);
+
+            bool regressed = change > threshold;
+            if (isTiming(metric.first))
+                regressed = regressed && delta > minDeltaMs;
+
+            log << std::left << std::setw(20) << scene.desc.name << std::setw(28) << metric.first
+                << std::right << std::setw(14) << *baseValue << std::setw(14) << metric.second
+                << std::setw(9) << std::fixed << std::setprecision(1) << change * 100.0 << "%"
+                << std::defaultfloat << std::setprecision(6) << (regressed ? "  REGRESSION" : "") << "\n";
+
+            if (regressed)
+                regressions.push_back({ scene.desc.name, metric.first, *baseValue, metric.second });
+        }
+    }
+
+    return regressions;
+}
+
+//-------------------------------------------------------------------------
+// Nearest rank percentile
+//
+double percentile(std::vector<double> samples, double fraction)
+{
+    if (samples.empty())
+        return 0.0;
+
+    const size_t rank = std::min(samples.size() - 1,
+        static_cast<size_t>(std::ceil(fraction * samples.size())) - (fraction > 0.0 ? 1 : 0));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+} // namespace bench
\ No newline at end of file
@@ -0,0 +1,73 @@
+/*
+ *
+ * Andrew Frost
+ * bench_report.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench_scene.hpp"
+
+namespace bench {
+
+///////////////////////////////////////////////////////////////////////////
+// Report                                                                //
+///////////////////////////////////////////////////////////////////////////
+// Results as JSON, and the comparison against a stored baseline        //
+// Every metric is lower-is-better:                                      //
+// - *_ms          times, p50/p95/p99 for CPU phases, mean for GPU     //
+// - allocations   device memory allocations made by the scene         //
+// - peak_bytes    peak device memory while the scene ran              //
+///////////////////////////////////////////////////////////////////////////
+
+struct SceneResult
+{
+    SceneDesc                                  desc;
+    std::vector<std::pair<std::string, double>> metrics;
+
+    void add(const std::string& name, double value) { metrics.emplace_back(name, value); }
+    const double* find(const std::string& name) const;
+};
+
+struct Report
+{
+    std::string              device;
+    std::string              api;
+    uint32_t                 driver{ 0 };
+    uint32_t                 frames{ 0 };
+    std::vector<SceneResult> scenes;
+
+    const SceneResult* find(const std::string& scene) const;
+};
+
+struct Regression
+{
+    std::string scene;
+    std::string metric;
+    double      baseline;
+    double      current;
+};
+
+std::string toJson(const Report& report);
+
+void writeReport(const std::string& path, const Report& report);
+
+// Throws when the file can not be read or parsed
+Report loadReport(const std::string& path);
+
+// Metrics worse than baseline by more than threshold (0.1 is 10%), times
+// also need to be worse by more than minDeltaMs to filter out noise
+std::vector<Regression> compareReports(const Report& baseline, const Report& current,
+    double threshold, double minDeltaMs, std::ostream& log);
+
+// Value under which fraction of the samples lie
+double percentile(std::vector<double> samples, double fraction);
+
+} // namespace bench
\ No newline at end of file
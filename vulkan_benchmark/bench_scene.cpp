@@ -0,0 +1,430 @@
+/*
+ *
+ * Andrew Frost
+ * bench_scene.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+
+#include "bench_scene.hpp"
+#include "../vulkan_samples/common/glm_common.h"
+
+namespace bench {
+
+static const vk::Format COLOR_FORMAT = vk::Format::eR8G8B8A8Unorm;
+static const vk::Format DEPTH_FORMAT = vk::Format::eD32Sfloat;
+
+struct CubeVertex
+{
+    float pos[3];
+    float normal[3];
+};
+
+//-------------------------------------------------------------------------
+// Built in scenes
+//
+const std::vector<SceneDesc>& builtinScenes()
+{
+    static const std::vector<SceneDesc> scenes = {
+        { "instances_1k",     1000,   1,  1 },
+        { "instances_100k",   100000, 1,  1 },
+        { "materials_64",     10000,  64, 1 },
+        { "passes_8",         10000,  4,  8 },
+    };
+    return scenes;
+}
+
+//-------------------------------------------------------------------------
+// Scene name or custom:<instances>:<materials>:<passes>
+//
+bool parseScene(const std::string& text, SceneDesc& desc)
+{
+    for (const auto& scene : builtinScenes()) {
+        if (scene.name == text) {
+            desc = scene;
+            return true;
+        }
+    }
+
+    if (text.compare(0, 7, "custom:") != 0)
+        return false;
+
+    std::istringstream stream(text.substr(7));
+    char sep1 = 0, sep2 = 0;
+    SceneDesc custom;
+    if (!(stream >> custom.instances >> sep1 >> custom.materials >> sep2 >> custom.passes)
+        || sep1 != ':' || sep2 != ':' || custom.instances == 0 || custom.materials == 0 || custom.passes == 0)
+        return false;
+
+    custom.name = text;
+    desc = custom;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// BenchScene                                                            //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization, every allocation and pipeline is made here
+//
+void BenchScene::init(HeadlessContext& context, vkb::core::ShaderLibrary& shaders,
+    vkb::core::PipelineVariants& variants, const std::string& shaderDir, const SceneDesc& desc,
+    vk::Extent2D extent, uint32_t framesInFlight)
+{
+    assert(!m_context && "BenchScene already initialized");
+    m_context = &context;
+    m_desc = desc;
+    m_extent = extent;
+
+    createTarget();
+    createGeometry();
+
+    m_commandState.init(context.getDevice(), variants.isExtendedDynamicState());
+
+    // Instance streams, one per frame in flight
+    m_instanceBuffers.resize(framesInFlight);
+    for (auto& buffer : m_instanceBuffers) {
+        buffer = context.createBuffer(sizeof(glm::vec4) * m_desc.instances, vk::BufferUsageFlagBits::eVertexBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    }
+
+    // One variant per material
+    const vkb::core::Shader& vert = shaders.loadFromFile(shaderDir + "/bench.vert.spv");
+    const vkb::core::Shader& frag = shaders.loadFromFile(shaderDir + "/bench.frag.spv");
+    m_program = &shaders.createProgram({ &vert, &frag });
+
+    vkb::core::GraphicsState state;
+    state.renderPass = m_clearPass;
+    state.cullMode = vk::CullModeFlagBits::eBack;
+    state.vertexBindings = {
+        { 0, sizeof(CubeVertex), vk::VertexInputRate::eVertex },
+        { 1, sizeof(glm::vec4), vk::VertexInputRate::eInstance },
+    };
+    state.vertexAttributes = {
+        { 0, 0, vk::Format::eR32G32B32Sfloat, offsetof(CubeVertex, pos) },
+        { 1, 0, vk::Format::eR32G32B32Sfloat, offsetof(CubeVertex, normal) },
+        { 2, 1, vk::Format::eR32G32B32A32Sfloat, 0 },
+    };
+
+    m_pipelines.resize(m_desc.materials);
+    for (uint32_t m = 0; m < m_desc.materials; m++)
+        m_pipelines[m] = variants.getGraphics(*m_program, state, { m });
+
+    for (uint32_t p = 0; p < m_desc.passes; p++)
+        m_passNames.push_back("pass" + std::to_string(p));
+}
+
+//-------------------------------------------------------------------------
+// Destroy scene resources, pipelines belong to the variant cache
+//
+void BenchScene::destroy()
+{
+    if (!m_context)
+        return;
+
+    vk::Device device = m_context->getDevice();
+    device.waitIdle();
+
+    for (auto& buffer : m_instanceBuffers)
+        m_context->destroyBuffer(buffer);
+    m_instanceBuffers.clear();
+    m_context->destroyBuffer(m_vertices);
+    m_context->destroyBuffer(m_indices);
+
+    device.destroyFramebuffer(m_framebuffer);
+    device.destroyRenderPass(m_clearPass);
+    device.destroyRenderPass(m_loadPass);
+    m_context->destroyImage(m_color);
+    m_context->destroyImage(m_depth);
+
+    m_commandState.destroy();
+    m_pipelines.clear();
+    m_passNames.clear();
+    m_program = nullptr;
+    m_capture = nullptr;
+    m_context = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Report the frame to a capture, binds go through the command state
+//
+void BenchScene::setCapture(vkb::core::FrameCapture* capture)
+{
+    m_capture = capture;
+    m_commandState.setCapture(capture);
+}
+
+//-------------------------------------------------------------------------
+// Geometry with its contents, the instance stream is uploaded by update
+//
+void BenchScene::declareResources(uint32_t frameIdx)
+{
+    const vk::ImageUsageFlags colorUsage = vk::ImageUsageFlagBits::eColorAttachment
+                                         | vk::ImageUsageFlagBits::eTransferSrc;
+
+    m_capture->declareImage(m_color.image, m_extent, COLOR_FORMAT, colorUsage);
+    m_capture->declareImage(m_depth.image, m_extent, DEPTH_FORMAT, vk::ImageUsageFlagBits::eDepthStencilAttachment);
+
+    m_capture->declareBuffer(m_vertices.buffer, m_vertices.size, vk::BufferUsageFlagBits::eVertexBuffer, true,
+        m_vertices.mapped);
+    m_capture->declareBuffer(m_indices.buffer, m_indices.size, vk::BufferUsageFlagBits::eIndexBuffer, true,
+        m_indices.mapped);
+    m_capture->declareBuffer(m_instanceBuffers[frameIdx].buffer, m_instanceBuffers[frameIdx].size,
+        vk::BufferUsageFlagBits::eVertexBuffer, true);
+}
+
+//-------------------------------------------------------------------------
+// Offscreen color and depth, a clearing and a loading pass over them
+//
+void BenchScene::createTarget()
+{
+    vk::Device device = m_context->getDevice();
+
+    m_color = m_context->createImage(m_extent, COLOR_FORMAT,
+        vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+        vk::ImageAspectFlagBits::eColor);
+    m_depth = m_context->createImage(m_extent, DEPTH_FORMAT,
+        vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::ImageAspectFlagBits::eDepth);
+
+    for (int load = 0; load < 2; load++) {
+        std::array<vk::AttachmentDescription, 2> attachments = {};
+        attachments[0].format = COLOR_FORMAT;
+        attachments[0].samples = vk::SampleCountFlagBits::e1;
+        attachments[0].loadOp = load ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear;
+        attachments[0].storeOp = vk::AttachmentStoreOp::eStore;
+        attachments[0].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+        attachments[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+        attachments[0].initialLayout = load ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::eUndefined;
+        attachments[0].finalLayout = vk::ImageLayout::eColorAttachmentOptimal;
+
+        attachments[1].format = DEPTH_FORMAT;
+        attachments[1].samples = vk::SampleCountFlagBits::e1;
+        attachments[1].loadOp = load ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear;
+        attachments[1].storeOp = vk::AttachmentStoreOp::eStore;
+        attachments[1].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+        attachments[1].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+        attachments[1].initialLayout = load ? vk::ImageLayout::eDepthStencilAttachmentOptimal : vk::ImageLayout::eUndefined;
+        attachments[1].finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+        const vk::AttachmentReference colorReference{ 0, vk::ImageLayout::eColorAttachmentOptimal };
+        const vk::AttachmentReference depthReference{ 1, vk::ImageLayout::eDepthStencilAttachmentOptimal };
+
+        vk::SubpassDescription subpass = {};
+        subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorReference;
+        subpass.pDepthStencilAttachment = &depthReference;
+
+        // previous pass or frame wrote the same attachments
+        vk::SubpassDependency dependency = {};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstSubpass = 0;
+        dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput
+                                | vk::PipelineStageFlagBits::eLateFragmentTests;
+        dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput
+                                | vk::PipelineStageFlagBits::eEarlyFragmentTests;
+        dependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite
+                                 | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead
+                                 | vk::AccessFlagBits::eColorAttachmentWrite
+                                 | vk::AccessFlagBits::eDepthStencilAttachmentRead
+                                 | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+        vk::RenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &dependency;
+
+        try {
+            (load ? m_loadPass : m_clearPass) = device.createRenderPass(renderPassInfo);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to create render pass!");
+        }
+    }
+
+    const std::array<vk::ImageView, 2> views = { m_color.view, m_depth.view };
+
+    vk::FramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.renderPass = m_clearPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+    framebufferInfo.pAttachments = views.data();
+    framebufferInfo.width = m_extent.width;
+    framebufferInfo.height = m_extent.height;
+    framebufferInfo.layers = 1;
+
+    try {
+        m_framebuffer = device.createFramebuffer(framebufferInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create framebuffer!");
+    }
+}
+
+//-------------------------------------------------------------------------
+// Unit cube, four vertices per face for flat normals
+//
+void BenchScene::createGeometry()
+{
+    std::vector<CubeVertex> vertices;
+    std::vector<uint16_t>   indices;
+
+    for (int axis = 0; axis < 3; axis++) {
+        for (int sign = -1; sign <= 1; sign += 2) {
+            float normal[3] = { 0.f, 0.f, 0.f };
+            normal[axis] = static_cast<float>(sign);
+
+            const int u = (axis + 1) % 3;
+            const int v = (axis + 2) % 3;
+            const uint16_t base = static_cast<uint16_t>(vertices.size());
+
+            for (int corner = 0; corner < 4; corner++) {
+                CubeVertex vertex = {};
+                vertex.pos[axis] = 0.5f * sign;
+                vertex.pos[u] = (corner == 1 || corner == 2) ? 0.5f : -0.5f;
+                vertex.pos[v] = (corner >= 2) ? 0.5f : -0.5f;
+                std::copy(normal, normal + 3, vertex.normal);
+                vertices.push_back(vertex);
+            }
+
+            // counter clockwise seen from outside
+            if (sign > 0)
+                indices.insert(indices.end(), { base, uint16_t(base + 1), uint16_t(base + 2), base, uint16_t(base + 2), uint16_t(base + 3) });
+            else
+                indices.insert(indices.end(), { base, uint16_t(base + 2), uint16_t(base + 1), base, uint16_t(base + 3), uint16_t(base + 2) });
+        }
+    }
+
+    const vk::MemoryPropertyFlags hostVisible = vk::MemoryPropertyFlagBits::eHostVisible
+                                              | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+    m_vertices = m_context->createBuffer(vertices.size() * sizeof(CubeVertex), vk::BufferUsageFlagBits::eVertexBuffer, hostVisible);
+    memcpy(m_vertices.mapped, vertices.data(), vertices.size() * sizeof(CubeVertex));
+
+    m_indices = m_context->createBuffer(indices.size() * sizeof(uint16_t), vk::BufferUsageFlagBits::eIndexBuffer, hostVisible);
+    memcpy(m_indices.mapped, indices.data(), indices.size() * sizeof(uint16_t));
+
+    m_indexCount = static_cast<uint32_t>(indices.size());
+}
+
+//-------------------------------------------------------------------------
+// Instances on a cube grid, bobbing so the stream changes every frame
+//
+void BenchScene::update(uint32_t frameIdx, float time)
+{
+    glm::vec4* instances = static_cast<glm::vec4*>(m_instanceBuffers[frameIdx].mapped);
+
+    const uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<float>(m_desc.instances))));
+    const float spacing = 2.f;
+
+    for (uint32_t i = 0; i < m_desc.instances; i++) {
+        const float x = static_cast<float>(i % side);
+        const float y = static_cast<float>((i / side) % side);
+        const float z = static_cast<float>(i / (side * side));
+        instances[i] = glm::vec4(x * spacing, y * spacing + 0.25f * std::sin(time + 0.1f * i), z * spacing, 1.f);
+    }
+
+    if (m_capture && m_capture->isCapturing()) {
+        declareResources(frameIdx);
+        m_capture->upload(m_instanceBuffers[frameIdx].buffer, 0, sizeof(glm::vec4) * m_desc.instances, instances);
+    }
+}
+
+//-------------------------------------------------------------------------
+// K passes, one draw per material in each
+//
+void BenchScene::record(vk::CommandBuffer cmdBuffer, uint32_t frameIdx, vkb::core::GpuProfiler& profiler)
+{
+    const uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<float>(m_desc.instances))));
+    const float extent = side * 2.f;
+    const glm::vec3 center(0.5f * extent);
+
+    const float aspect = static_cast<float>(m_extent.width) / m_extent.height;
+    glm::mat4 viewProj = glm::perspective(glm::radians(60.f), aspect, 0.1f, 4.f * extent)
+        * glm::lookAt(center + glm::vec3(0.9f, 0.6f, 1.2f) * extent, center, glm::vec3(0.f, 1.f, 0.f));
+    viewProj[1][1] *= -1.f;
+
+    std::array<vk::ClearValue, 2> clearValues;
+    clearValues[0].color = vk::ClearColorValue(std::array<float, 4>{ 0.1f, 0.1f, 0.1f, 1.f });
+    clearValues[1].depthStencil = vk::ClearDepthStencilValue(1.f, 0);
+
+    const vk::Viewport viewport(0.f, 0.f, static_cast<float>(m_extent.width), static_cast<float>(m_extent.height), 0.f, 1.f);
+    const vk::Rect2D scissor({ 0, 0 }, m_extent);
+
+    const std::array<vk::Buffer, 2> vertexBuffers = { m_vertices.buffer, m_instanceBuffers[frameIdx].buffer };
+    const std::array<vk::DeviceSize, 2> offsets = { 0, 0 };
+
+    m_commandState.begin(cmdBuffer);
+
+    vkb::core::FrameCapture* capture = m_capture && m_capture->isCapturing() ? m_capture : nullptr;
+    if (capture)
+        declareResources(frameIdx);
+
+    for (uint32_t p = 0; p < m_desc.passes; p++) {
+        profiler.beginSection(cmdBuffer, m_passNames[p].c_str());
+
+        vk::RenderPassBeginInfo beginInfo = {};
+        beginInfo.renderPass = p == 0 ? m_clearPass : m_loadPass;
+        beginInfo.framebuffer = m_framebuffer;
+        beginInfo.renderArea = scissor;
+        beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        beginInfo.pClearValues = clearValues.data();
+
+        cmdBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
+        if (capture)
+            capture->beginPass({ m_color.image }, m_depth.image,
+                p == 0 ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eLoad, scissor);
+
+        m_commandState.setViewport(viewport);
+        m_commandState.setScissor(scissor);
+        cmdBuffer.bindVertexBuffers(0, vertexBuffers, offsets);
+        cmdBuffer.bindIndexBuffer(m_indices.buffer, 0, vk::IndexType::eUint16);
+        cmdBuffer.pushConstants(m_program->pipelineLayout, m_program->pushConstantStages, 0, sizeof(glm::mat4), &viewProj);
+        if (capture) {
+            for (uint32_t b = 0; b < vertexBuffers.size(); b++)
+                capture->bindVertexBuffer(b, vertexBuffers[b], offsets[b]);
+            capture->bindIndexBuffer(m_indices.buffer, 0, vk::IndexType::eUint16);
+            capture->pushConstants(m_program->pushConstantStages, 0, sizeof(glm::mat4), &viewProj);
+        }
+
+        // instances split evenly across materials
+        for (uint32_t m = 0; m < m_desc.materials; m++) {
+            const uint32_t first = static_cast<uint32_t>(uint64_t(m_desc.instances) * m / m_desc.materials);
+            const uint32_t last = static_cast<uint32_t>(uint64_t(m_desc.instances) * (m + 1) / m_desc.materials);
+            if (first == last)
+                continue;
+
+            m_commandState.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipelines[m]);
+            cmdBuffer.drawIndexed(m_indexCount, last - first, 0, 0, first);
+            if (capture)
+                capture->drawIndexed(m_indexCount, last - first, 0, 0, first);
+        }
+
+        cmdBuffer.endRenderPass();
+        if (capture)
+            capture->endPass();
+        profiler.endSection(cmdBuffer);
+    }
+}
+
+//-------------------------------------------------------------------------
+// Triangles submitted per frame
+//
+uint64_t BenchScene::getTriangleCount() const
+{
+    return static_cast<uint64_t>(m_indexCount / 3) * m_desc.instances * m_desc.passes;
+}
+
+} // namespace bench
\ No newline at end of file
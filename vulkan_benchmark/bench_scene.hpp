@@ -0,0 +1,139 @@
+/*
+ *
+ * Andrew Frost
+ * bench_scene.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "headless_context.hpp"
+#include "../vulkan_samples/core/command_state.hpp"
+#include "../vulkan_samples/core/frame_capture.hpp"
+#include "../vulkan_samples/core/gpu_profiler.hpp"
+#include "../vulkan_samples/core/pipeline_variants.hpp"
+#include "../vulkan_samples/core/shader_library.hpp"
+
+namespace bench {
+
+///////////////////////////////////////////////////////////////////////////
+// SceneDesc                                                             //
+///////////////////////////////////////////////////////////////////////////
+
+struct SceneDesc
+{
+    std::string name;
+    uint32_t    instances{ 1 };
+    uint32_t    materials{ 1 };
+    uint32_t    passes{ 1 };
+    std::string replay;         // frame capture file, replaces the synthetic scene
+};
+
+// Built in scenes, scaling instances, materials and passes separately
+const std::vector<SceneDesc>& builtinScenes();
+
+// "name" of a built in scene or "custom:<instances>:<materials>:<passes>"
+bool parseScene(const std::string& text, SceneDesc& desc);
+
+///////////////////////////////////////////////////////////////////////////
+// Scene                                                                 //
+///////////////////////////////////////////////////////////////////////////
+// What runScene measures, a synthetic scene or a replayed capture      //
+///////////////////////////////////////////////////////////////////////////
+
+class Scene
+{
+public:
+    virtual ~Scene() = default;
+
+    virtual void destroy() = 0;
+
+    // CPU side of the frame, before recording
+    virtual void update(uint32_t frameIdx, float time) = 0;
+
+    virtual void record(vk::CommandBuffer cmdBuffer, uint32_t frameIdx, vkb::core::GpuProfiler& profiler) = 0;
+
+    // Getting Methods
+    virtual uint32_t getDrawCount()     const = 0;
+    virtual uint64_t getTriangleCount() const = 0;
+    virtual const vkb::core::CommandState::Stats& getStateStats() const = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// BenchScene                                                            //
+///////////////////////////////////////////////////////////////////////////
+// Synthetic scene rendered offscreen                                   //
+// - N cube instances on a grid, per instance data is a vertex stream  //
+//   rewritten every frame                                               //
+// - M materials are pipeline variants of one program, selected by a   //
+//   specialization constant, one draw per material                     //
+// - K passes render the scene into the same target, the first clears //
+// - setCapture() reports resources and commands for --capture         //
+///////////////////////////////////////////////////////////////////////////
+
+class BenchScene : public Scene
+{
+public:
+    BenchScene(BenchScene const&) = delete;
+    BenchScene& operator=(BenchScene const&) = delete;
+
+    BenchScene() = default;
+    ~BenchScene() { destroy(); }
+
+    void init(HeadlessContext& context, vkb::core::ShaderLibrary& shaders, vkb::core::PipelineVariants& variants,
+        const std::string& shaderDir, const SceneDesc& desc, vk::Extent2D extent, uint32_t framesInFlight);
+
+    void destroy() override;
+
+    // Pipelines are described through PipelineVariants::setCapture
+    void setCapture(vkb::core::FrameCapture* capture);
+
+    // Animate instances into the frame's instance buffer
+    void update(uint32_t frameIdx, float time) override;
+
+    void record(vk::CommandBuffer cmdBuffer, uint32_t frameIdx, vkb::core::GpuProfiler& profiler) override;
+
+    // Getting Methods
+    const SceneDesc& getDesc()          const { return m_desc; }
+    uint32_t         getDrawCount()     const override { return m_desc.materials * m_desc.passes; }
+    uint64_t         getTriangleCount() const override;
+    const vkb::core::CommandState::Stats& getStateStats() const override { return m_commandState.getStats(); }
+
+private:
+
+    void createTarget();
+
+    void createGeometry();
+
+    // Resources of the frame, the capture keeps the first declaration
+    void declareResources(uint32_t frameIdx);
+
+    HeadlessContext*                m_context{ nullptr };
+    vkb::core::FrameCapture*        m_capture{ nullptr };
+    SceneDesc                       m_desc;
+    vk::Extent2D                    m_extent;
+
+    Image                           m_color;
+    Image                           m_depth;
+    vk::RenderPass                  m_clearPass;
+    vk::RenderPass                  m_loadPass;
+    vk::Framebuffer                 m_framebuffer;
+
+    Buffer                          m_vertices;
+    Buffer                          m_indices;
+    uint32_t                        m_indexCount{ 0 };
+    std::vector<Buffer>             m_instanceBuffers;
+
+    const vkb::core::ShaderProgram* m_program{ nullptr };
+    std::vector<vk::Pipeline>       m_pipelines;    // per material, both passes are compatible
+    std::vector<std::string>        m_passNames;    // GPU profiler sections
+    vkb::core::CommandState         m_commandState; // redundant binds across passes are dropped
+
+}; // class BenchScene
+
+} // namespace bench
\ No newline at end of file
@@ -0,0 +1,308 @@
+/*
+ *
+ * Andrew Frost
+ * headless_context.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "headless_context.hpp"
+#include "../vulkan_samples/core/vk_utils.hpp"
+
+namespace bench {
+
+//-------------------------------------------------------------------------
+// Instance with only what a headless run needs
+//
+static vk::Instance createInstance(bool validation)
+{
+    std::vector<const char*> extensions;
+    std::vector<const char*> layers;
+
+#ifdef _DEBUG
+    // object names are set by the shared core classes, and the validation messenger
+    extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+#else
+    if (validation)
+        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+#endif
+    if (validation)
+        layers.push_back("VK_LAYER_KHRONOS_validation");
+
+    vk::ApplicationInfo appInfo = {};
+    appInfo.pApplicationName = "vulkan_benchmark";
+    appInfo.pEngineName = "No Engine";
+    appInfo.apiVersion = VK_API_VERSION_1_1;
+
+    vk::InstanceCreateInfo createInfo = {};
+    createInfo.pApplicationInfo = &appInfo;
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
+    createInfo.enabledLayerCount = static_cast<uint32_t>(layers.size());
+    createInfo.ppEnabledLayerNames = layers.data();
+
+    try {
+        return vk::createInstance(createInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create instance!");
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// HeadlessContext                                                       //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization
+//
+void HeadlessContext::init(const ContextOptions& options)
+{
+    assert(!m_device && "HeadlessContext already initialized");
+
+    m_instance = createInstance(options.validation);
+
+    // before the device, creation messages go through the sink as well
+    if (options.validation)
+        m_validationSink.init(m_instance);
+
+    std::vector<vk::PhysicalDevice> devices = m_instance.enumeratePhysicalDevices();
+    if (options.deviceIndex >= devices.size())
+        throw std::runtime_error("failed to find GPUs with Vulkan support!");
+
+    m_physicalDevice = devices[options.deviceIndex];
+    m_properties = m_physicalDevice.getProperties();
+    m_deviceName = m_properties.deviceName;
+
+    // Graphics queue
+    const auto queueFamilies = m_physicalDevice.getQueueFamilyProperties();
+    for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+        if (queueFamilies[i].queueCount > 0 && (queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics)) {
+            m_queueIdx = i;
+            break;
+        }
+    }
+    if (m_queueIdx == VK_QUEUE_FAMILY_IGNORED)
+        throw std::runtime_error("failed to find a graphics queue!");
+
+    const float queuePriority = 1.0f;
+    vk::DeviceQueueCreateInfo queueInfo = {};
+    queueInfo.queueFamilyIndex = m_queueIdx;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &queuePriority;
+
+    vk::DeviceCreateInfo deviceInfo = {};
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+
+    try {
+        m_device = m_physicalDevice.createDevice(deviceInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create logical device!");
+    }
+
+    m_queue = m_device.getQueue(m_queueIdx, 0);
+
+    try {
+        m_pipelineCache = m_device.createPipelineCache(vk::PipelineCacheCreateInfo());
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    resetCounters();
+}
+
+//-------------------------------------------------------------------------
+// Call on exit
+//
+void HeadlessContext::destroy()
+{
+    if (!m_device)
+        return;
+
+    m_device.waitIdle();
+    m_device.destroyPipelineCache(m_pipelineCache);
+    m_device.destroy();
+    m_validationSink.destroy();
+    m_instance.destroy();
+
+    m_device = nullptr;
+    m_instance = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Device names in enumeration order
+//
+std::vector<std::string> HeadlessContext::listDevices()
+{
+    vk::Instance instance = createInstance(false);
+
+    std::vector<std::string> names;
+    for (auto device : instance.enumeratePhysicalDevices())
+        names.push_back(device.getProperties().deviceName);
+
+    instance.destroy();
+    return names;
+}
+
+//-------------------------------------------------------------------------
+// Vulkan version of the device as text
+//
+std::string HeadlessContext::getApiVersion() const
+{
+    const uint32_t version = m_properties.apiVersion;
+    return std::to_string(VK_VERSION_MAJOR(version)) + "." + std::to_string(VK_VERSION_MINOR(version))
+        + "." + std::to_string(VK_VERSION_PATCH(version));
+}
+
+//-------------------------------------------------------------------------
+// Tracked allocation
+//
+vk::DeviceMemory HeadlessContext::allocateMemory(const vk::MemoryRequirements& memReqs,
+    vk::MemoryPropertyFlags properties)
+{
+    vk::MemoryAllocateInfo allocInfo = {};
+    allocInfo.allocationSize = memReqs.size;
+    allocInfo.memoryTypeIndex = vkb::core::findMemoryType(m_physicalDevice, memReqs.memoryTypeBits, properties);
+
+    vk::DeviceMemory memory;
+    try {
+        memory = m_device.allocateMemory(allocInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to allocate memory!");
+    }
+
+    m_allocationCount++;
+    m_liveBytes += memReqs.size;
+    m_peakBytes = std::max(m_peakBytes, m_liveBytes);
+
+    return memory;
+}
+
+//-------------------------------------------------------------------------
+// Tracked free
+//
+void HeadlessContext::freeMemory(vk::DeviceMemory memory, vk::DeviceSize size)
+{
+    if (!memory)
+        return;
+
+    m_device.freeMemory(memory);
+    m_liveBytes -= std::min(size, m_liveBytes);
+}
+
+//-------------------------------------------------------------------------
+// Buffer with its own allocation, host visible memory stays mapped
+//
+Buffer HeadlessContext::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage,
+    vk::MemoryPropertyFlags properties)
+{
+    Buffer result;
+
+    vk::BufferCreateInfo bufferInfo = {};
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+    try {
+        result.buffer = m_device.createBuffer(bufferInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create buffer!");
+    }
+
+    const vk::MemoryRequirements memReqs = m_device.getBufferMemoryRequirements(result.buffer);
+    result.memory = allocateMemory(memReqs, properties);
+    result.size = memReqs.size;
+    m_device.bindBufferMemory(result.buffer, result.memory, 0);
+
+    if (properties & vk::MemoryPropertyFlagBits::eHostVisible)
+        result.mapped = m_device.mapMemory(result.memory, 0, VK_WHOLE_SIZE);
+
+    return result;
+}
+
+//-------------------------------------------------------------------------
+// Destroy buffer and free its memory
+//
+void HeadlessContext::destroyBuffer(Buffer& buffer)
+{
+    if (buffer.mapped)
+        m_device.unmapMemory(buffer.memory);
+    m_device.destroyBuffer(buffer.buffer);
+    freeMemory(buffer.memory, buffer.size);
+    buffer = Buffer();
+}
+
+//-------------------------------------------------------------------------
+// Device local 2D image and view
+//
+Image HeadlessContext::createImage(vk::Extent2D extent, vk::Format format, vk::ImageUsageFlags usage,
+    vk::ImageAspectFlags aspect)
+{
+    Image result;
+
+    vk::ImageCreateInfo imageInfo = {};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.extent = vk::Extent3D(extent.width, extent.height, 1);
+    imageInfo.format = format;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.usage = usage;
+
+    try {
+        result.image = m_device.createImage(imageInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create image!");
+    }
+
+    const vk::MemoryRequirements memReqs = m_device.getImageMemoryRequirements(result.image);
+    result.memory = allocateMemory(memReqs, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    result.size = memReqs.size;
+    m_device.bindImageMemory(result.image, result.memory, 0);
+
+    vk::ImageViewCreateInfo viewInfo = {};
+    viewInfo.image = result.image;
+    viewInfo.viewType = vk::ImageViewType::e2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = { aspect, 0, 1, 0, 1 };
+
+    try {
+        result.view = m_device.createImageView(viewInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create image view!");
+    }
+
+    return result;
+}
+
+//-------------------------------------------------------------------------
+// Destroy image, view and memory
+//
+void HeadlessContext::destroyImage(Image& image)
+{
+    m_device.destroyImageView(image.view);
+    m_device.destroyImage(image.image);
+    freeMemory(image.memory, image.size);
+    image = Image();
+}
+
+//-------------------------------------------------------------------------
+// Start counting for the next scene, live bytes carry over
+//
+void HeadlessContext::resetCounters()
+{
+    m_allocationCount = 0;
+    m_peakBytes = m_liveBytes;
+}
+
+} // namespace bench
\ No newline at end of file
@@ -0,0 +1,114 @@
+/*
+ *
+ * Andrew Frost
+ * headless_context.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "../vulkan_samples/core/validation_sink.hpp"
+
+namespace bench {
+
+///////////////////////////////////////////////////////////////////////////
+// HeadlessContext                                                       //
+///////////////////////////////////////////////////////////////////////////
+// Vulkan instance and device without a surface, usable with any ICD    //
+// (select a software one such as lavapipe through VK_ICD_FILENAMES)   //
+// Every device allocation goes through allocateMemory so the number   //
+// of allocations and the peak footprint can be reported               //
+///////////////////////////////////////////////////////////////////////////
+
+struct ContextOptions
+{
+    uint32_t deviceIndex{ 0 };
+    bool     validation{ false };
+};
+
+struct Buffer
+{
+    vk::Buffer       buffer;
+    vk::DeviceMemory memory;
+    vk::DeviceSize   size{ 0 };
+    void*            mapped{ nullptr };
+};
+
+struct Image
+{
+    vk::Image        image;
+    vk::DeviceMemory memory;
+    vk::ImageView    view;
+    vk::DeviceSize   size{ 0 };
+};
+
+class HeadlessContext
+{
+public:
+    HeadlessContext(HeadlessContext const&) = delete;
+    HeadlessContext& operator=(HeadlessContext const&) = delete;
+
+    HeadlessContext() = default;
+    ~HeadlessContext() { destroy(); }
+
+    void init(const ContextOptions& options);
+
+    void destroy();
+
+    // Device names, for --list
+    static std::vector<std::string> listDevices();
+
+    // Tracked allocations
+    vk::DeviceMemory allocateMemory(const vk::MemoryRequirements& memReqs, vk::MemoryPropertyFlags properties);
+    void             freeMemory(vk::DeviceMemory memory, vk::DeviceSize size);
+
+    // Host visible buffers stay mapped
+    Buffer createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties);
+    void   destroyBuffer(Buffer& buffer);
+
+    Image  createImage(vk::Extent2D extent, vk::Format format, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect);
+    void   destroyImage(Image& image);
+
+    void   resetCounters();
+
+    // Getting Methods
+    vk::Instance       getInstance()        const { return m_instance; }
+    vk::PhysicalDevice getPhysicalDevice()  const { return m_physicalDevice; }
+    vk::Device         getDevice()          const { return m_device; }
+    vk::Queue          getQueue()           const { return m_queue; }
+    uint32_t           getQueueIdx()        const { return m_queueIdx; }
+    vk::PipelineCache  getPipelineCache()   const { return m_pipelineCache; }
+    const std::string& getDeviceName()      const { return m_deviceName; }
+    std::string        getApiVersion()      const;
+    uint32_t           getDriverVersion()   const { return m_properties.driverVersion; }
+    uint32_t           getAllocationCount() const { return m_allocationCount; }
+    vk::DeviceSize     getLiveBytes()       const { return m_liveBytes; }
+    vk::DeviceSize     getPeakBytes()       const { return m_peakBytes; }
+
+    const vkb::core::ValidationSink& getValidationSink() const { return m_validationSink; }
+
+private:
+
+    vk::Instance                 m_instance;
+    vk::PhysicalDevice           m_physicalDevice;
+    vk::PhysicalDeviceProperties m_properties;
+    vk::Device                   m_device;
+    vk::Queue                    m_queue;
+    uint32_t                     m_queueIdx{ VK_QUEUE_FAMILY_IGNORED };
+    vk::PipelineCache            m_pipelineCache;
+    std::string                  m_deviceName;
+
+    vkb::core::ValidationSink    m_validationSink;     // only with options.validation
+
+    uint32_t                     m_allocationCount{ 0 };
+    vk::DeviceSize               m_liveBytes{ 0 };
+    vk::DeviceSize               m_peakBytes{ 0 };
+
+}; // class HeadlessContext
+
+} // namespace bench
\ No newline at end of file
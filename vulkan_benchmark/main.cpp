@@ -0,0 +1,476 @@
+/*
+ *
+ * Andrew Frost
+ * main.cpp
+ * 2020
+ *
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+#include "bench_replay.hpp"
+#include "bench_report.hpp"
+#include "bench_scene.hpp"
+#include "headless_context.hpp"
+#include "../vulkan_samples/core/object_registry.hpp"
+#include "../vulkan_samples/helper/profiler.hpp"
+
+static const uint32_t FRAMES_IN_FLIGHT = 2;
+
+// exit code when a metric regressed against the baseline
+static const int EXIT_REGRESSION = 2;
+
+struct Options
+{
+    bool                          list{ false };
+    bench::ContextOptions         context;
+    std::vector<bench::SceneDesc> scenes;
+    uint32_t                      frames{ 300 };
+    uint32_t                      warmup{ 30 };
+    vk::Extent2D                  extent{ 1280, 720 };
+    std::string                   shaderDir;
+    std::string                   output;
+    std::string                   baseline;
+    double                        threshold{ 0.1 };
+    double                        minDeltaMs{ 0.05 };
+    std::string                   captureDir;
+    uint32_t                      loops{ 1 };
+    bool                          paced{ false };
+};
+
+//-------------------------------------------------------------------------
+// Usage
+//
+static void printUsage()
+{
+    std::cout <<
+        "usage: vulkan_benchmark [options]\n"
+        "  --list                 list devices and built in scenes\n"
+        "  --device <index>       physical device to run on (default 0)\n"
+        "  --scene <name>         scene to run, repeatable (default all built in)\n"
+        "                         custom:<instances>:<materials>:<passes>\n"
+        "  --frames <count>       measured frames per scene (default 300)\n"
+        "  --warmup <count>       frames run before measuring (default 30)\n"
+        "  --width <px>           render target width (default 1280)\n"
+        "  --height <px>          render target height (default 720)\n"
+        "  --shaders <dir>        compiled .spv files (default shaders next to the executable)\n"
+        "  --out <file>           write results as JSON\n"
+        "  --baseline <file>      compare against a previous JSON result\n"
+        "  --threshold <ratio>    allowed slowdown before failing (default 0.1)\n"
+        "  --min-delta <ms>       ignore timing changes smaller than this (default 0.05)\n"
+        "  --capture <dir>        write the last frame of each scene to <dir>/<scene>.vkfc\n"
+        "  --replay <file>        replay a frame capture as a scene, repeatable\n"
+        "  --loop <count>         replay the captured frame this many times per frame (default 1)\n"
+        "  --timing <mode>        free runs replays flat out, paced keeps the captured frame interval\n"
+        "  --validation           enable the Khronos validation layer\n";
+}
+
+//-------------------------------------------------------------------------
+// Command line, throws on bad input
+//
+static Options parseOptions(int argc, char* argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error("missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "--list")            options.list = true;
+        else if (arg == "--validation") options.context.validation = true;
+        else if (arg == "--device")     options.context.deviceIndex = std::stoul(value());
+        else if (arg == "--frames")     options.frames = std::stoul(value());
+        else if (arg == "--warmup")     options.warmup = std::stoul(value());
+        else if (arg == "--width")      options.extent.width = std::stoul(value());
+        else if (arg == "--height")     options.extent.height = std::stoul(value());
+        else if (arg == "--shaders")    options.shaderDir = value();
+        else if (arg == "--out")        options.output = value();
+        else if (arg == "--baseline")   options.baseline = value();
+        else if (arg == "--threshold")  options.threshold = std::stod(value());
+        else if (arg == "--min-delta")  options.minDeltaMs = std::stod(value());
+        else if (arg == "--capture")    options.captureDir = value();
+        else if (arg == "--loop")       options.loops = std::stoul(value());
+        else if (arg == "--timing") {
+            const std::string mode = value();
+            if (mode != "free" && mode != "paced")
+                throw std::runtime_error("unknown timing mode: " + mode);
+            options.paced = mode == "paced";
+        }
+        else if (arg == "--replay") {
+            bench::SceneDesc desc;
+            desc.replay = value();
+            const size_t slash = desc.replay.find_last_of("/\\");
+            desc.name = "replay:" + (slash == std::string::npos ? desc.replay : desc.replay.substr(slash + 1));
+            options.scenes.push_back(desc);
+        }
+        else if (arg == "--scene") {
+            const std::string text = value();
+            bench::SceneDesc desc;
+            if (!bench::parseScene(text, desc))
+                throw std::runtime_error("unknown scene: " + text);
+            options.scenes.push_back(desc);
+        }
+        else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            exit(EXIT_SUCCESS);
+        }
+        else {
+            throw std::runtime_error("unknown option: " + arg);
+        }
+    }
+
+    if (options.scenes.empty())
+        options.scenes = bench::builtinScenes();
+    if (options.shaderDir.empty()) {
+        // shaders are compiled into the output directory
+        const std::string exe = argv[0];
+        const size_t slash = exe.find_last_of("/\\");
+        options.shaderDir = (slash == std::string::npos ? std::string(".") : exe.substr(0, slash)) + "/shaders";
+    }
+    if (options.frames == 0)
+        throw std::runtime_error("--frames must be at least 1");
+    if (options.loops == 0)
+        throw std::runtime_error("--loop must be at least 1");
+
+    return options;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Scene Run                                                             //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Arithmetic mean
+//
+static double mean(const std::vector<double>& samples)
+{
+    if (samples.empty())
+        return 0.0;
+
+    double sum = 0.0;
+    for (double sample : samples)
+        sum += sample;
+    return sum / samples.size();
+}
+
+//-------------------------------------------------------------------------
+// Render one scene for warmup + frames and summarize
+//
+static bench::SceneResult runScene(bench::HeadlessContext& context, const Options& options,
+    const bench::SceneDesc& desc)
+{
+    vk::Device device = context.getDevice();
+
+    // outlives the variant cache, which reports pipelines to it until destroyed
+    vkb::core::FrameCapture capture;
+
+    // fresh caches so every scene pays for its own modules and pipelines
+    vkb::core::ShaderLibrary shaders;
+    vkb::core::PipelineVariants variants;
+    vkb::core::GpuProfiler gpuProfiler;
+    tools::CpuProfiler cpuProfiler;
+
+    shaders.init(context.getInstance(), device);
+    variants.init(context.getInstance(), device, context.getPipelineCache());
+    gpuProfiler.init(device, context.getPhysicalDevice(), context.getQueueIdx(), FRAMES_IN_FLIGHT);
+
+    context.resetCounters();
+    const vkb::core::ValidationSink::Stats validationStart = context.getValidationSink().getStats();
+
+    // pipelines are described as they are created, before the scene makes any
+    variants.setCapture(&capture);
+
+    bench::BenchScene benchScene;
+    bench::ReplayScene replayScene;
+    bench::Scene* scene = nullptr;
+    float pacedMs = 0.f;
+
+    if (desc.replay.empty()) {
+        benchScene.init(context, shaders, variants, options.shaderDir, desc, options.extent, FRAMES_IN_FLIGHT);
+        benchScene.setCapture(&capture);
+        scene = &benchScene;
+    }
+    else {
+        vkb::core::FrameTrace trace;
+        trace.load(desc.replay);
+        replayScene.init(context, shaders, variants, trace, options.loops, FRAMES_IN_FLIGHT);
+        pacedMs = options.paced ? replayScene.getFrameMs() : 0.f;
+        scene = &replayScene;
+    }
+
+    // Frame resources
+    vk::CommandPool commandPool;
+    std::vector<vk::CommandBuffer> commandBuffers;
+    std::vector<vk::Fence> fences;
+
+    try {
+        vk::CommandPoolCreateInfo poolInfo = {};
+        poolInfo.queueFamilyIndex = context.getQueueIdx();
+        poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+        commandPool = device.createCommandPool(poolInfo);
+
+        vk::CommandBufferAllocateInfo allocInfo = {};
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = vk::CommandBufferLevel::ePrimary;
+        allocInfo.commandBufferCount = FRAMES_IN_FLIGHT;
+        commandBuffers = device.allocateCommandBuffers(allocInfo);
+
+        for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+            fences.push_back(device.createFence({ vk::FenceCreateFlagBits::eSignaled }));
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create frame resources!");
+    }
+
+    // Samples, phases and GPU sections are only known after the first frame
+    std::vector<double> frameSamples;
+    std::vector<double> gpuFrameSamples;
+    std::map<std::string, std::vector<double>> phaseSamples;
+    std::map<std::string, std::vector<double>> gpuSamples;
+    std::vector<std::string> phaseOrder;
+    std::vector<std::string> gpuOrder;
+
+    auto sampleCpu = [&]() {
+        frameSamples.push_back(cpuProfiler.getFrameMs());
+        for (const auto& phase : cpuProfiler.getPhases()) {
+            auto& samples = phaseSamples[phase.name];
+            if (samples.empty())
+                phaseOrder.push_back(phase.name);
+            samples.push_back(phase.ms);
+        }
+    };
+
+    auto sampleGpu = [&]() {
+        gpuFrameSamples.push_back(gpuProfiler.getFrameMs());
+        for (const auto& section : gpuProfiler.getSections()) {
+            auto& samples = gpuSamples[section.name];
+            if (samples.empty())
+                gpuOrder.push_back(section.name);
+            samples.push_back(section.ms);
+        }
+    };
+
+    auto submit = [&](vk::CommandBuffer cmdBuffer, vk::Fence fence) {
+        vk::SubmitInfo submitInfo = {};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &cmdBuffer;
+
+        try {
+            context.getQueue().submit(submitInfo, fence);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to submit benchmark frame!");
+        }
+    };
+
+    const uint32_t totalFrames = options.warmup + options.frames;
+    auto frameStart = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t frame = 0; frame < totalFrames; frame++) {
+        const uint32_t frameIdx = frame % FRAMES_IN_FLIGHT;
+
+        // phases of the previous frame
+        cpuProfiler.beginFrame();
+        if (frame > options.warmup)
+            sampleCpu();
+
+        // replays at the interval the frame was captured at
+        if (pacedMs > 0.f) {
+            tools::CpuProfiler::Scope phase(cpuProfiler, "pace");
+            frameStart += std::chrono::microseconds(static_cast<int64_t>(pacedMs * 1000.f));
+            std::this_thread::sleep_until(frameStart);
+        }
+
+        // the last measured frame of a synthetic scene is written out
+        if (!options.captureDir.empty() && desc.replay.empty() && frame == totalFrames - 1) {
+            std::string file = desc.name;
+            for (auto& c : file)
+                if (c == ':')
+                    c = '_';
+            capture.request(options.captureDir + "/" + file + ".vkfc");
+        }
+        capture.beginFrame();
+
+        {
+            tools::CpuProfiler::Scope phase(cpuProfiler, "wait");
+            device.waitForFences(fences[frameIdx], VK_TRUE, UINT64_MAX);
+            device.resetFences(fences[frameIdx]);
+        }
+
+        {
+            tools::CpuProfiler::Scope phase(cpuProfiler, "update");
+            scene->update(frameIdx, frame / 60.f);
+        }
+
+        vk::CommandBuffer cmdBuffer = commandBuffers[frameIdx];
+        {
+            tools::CpuProfiler::Scope phase(cpuProfiler, "record");
+            cmdBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+            // reads back the frame that last used this slot
+            gpuProfiler.beginFrame(cmdBuffer, frameIdx);
+            if (frame >= options.warmup + FRAMES_IN_FLIGHT)
+                sampleGpu();
+
+            scene->record(cmdBuffer, frameIdx, gpuProfiler);
+            cmdBuffer.end();
+        }
+
+        {
+            tools::CpuProfiler::Scope phase(cpuProfiler, "submit");
+            submit(cmdBuffer, fences[frameIdx]);
+        }
+
+        if (capture.endFrame())
+            std::cout << "captured " << capture.getLastPath() << " (" << capture.getStats().commands
+                << " commands, " << capture.getStats().bytes << " bytes)" << std::endl;
+    }
+
+    // close the last measured frame
+    cpuProfiler.beginFrame();
+    sampleCpu();
+
+    // GPU results of the frames still in flight
+    for (uint32_t frame = totalFrames; frame < totalFrames + FRAMES_IN_FLIGHT; frame++) {
+        const uint32_t frameIdx = frame % FRAMES_IN_FLIGHT;
+
+        device.waitForFences(fences[frameIdx], VK_TRUE, UINT64_MAX);
+        device.resetFences(fences[frameIdx]);
+
+        vk::CommandBuffer cmdBuffer = commandBuffers[frameIdx];
+        cmdBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+        gpuProfiler.beginFrame(cmdBuffer, frameIdx);
+        if (frame >= options.warmup + FRAMES_IN_FLIGHT)
+            sampleGpu();
+        cmdBuffer.end();
+
+        submit(cmdBuffer, fences[frameIdx]);
+    }
+
+    device.waitIdle();
+
+    // Summary
+    bench::SceneResult result;
+    result.desc = desc;
+
+    result.add("cpu_frame_p50_ms", bench::percentile(frameSamples, 0.50));
+    result.add("cpu_frame_p95_ms", bench::percentile(frameSamples, 0.95));
+    result.add("cpu_frame_p99_ms", bench::percentile(frameSamples, 0.99));
+    for (const auto& name : phaseOrder) {
+        result.add("cpu_" + name + "_p50_ms", bench::percentile(phaseSamples[name], 0.50));
+        result.add("cpu_" + name + "_p99_ms", bench::percentile(phaseSamples[name], 0.99));
+    }
+
+    if (gpuProfiler.isSupported()) {
+        result.add("gpu_frame_ms", mean(gpuFrameSamples));
+        for (const auto& name : gpuOrder)
+            result.add("gpu_" + name + "_ms", mean(gpuSamples[name]));
+    }
+
+    result.add("pipeline_compile_ms", variants.getStats().totalCompileMs);
+    result.add("pipelines", variants.getVariantCount());
+    result.add("state_calls_issued", static_cast<double>(scene->getStateStats().issued) / totalFrames);
+    result.add("state_calls_skipped", static_cast<double>(scene->getStateStats().skipped) / totalFrames);
+    result.add("allocations", context.getAllocationCount());
+    result.add("peak_bytes", static_cast<double>(context.getPeakBytes()));
+
+    // tracked objects alive at the end of the scene, growth between scenes is a leak
+    result.add("live_objects", VkObjects.getLiveCount());
+    result.add("live_object_bytes", static_cast<double>(VkObjects.getLiveBytes()));
+
+    // message counts of this scene, performance warnings are metrics rather than log lines
+    if (context.getValidationSink().isActive()) {
+        const vkb::core::ValidationSink::Stats validation = context.getValidationSink().getStats();
+        result.add("validation_messages", static_cast<double>(validation.received - validationStart.received));
+        result.add("validation_performance", static_cast<double>(validation.performance - validationStart.performance));
+        result.add("validation_dropped", static_cast<double>(validation.dropped - validationStart.dropped));
+    }
+
+    std::cout << std::left << std::setw(16) << desc.name << std::right << std::fixed << std::setprecision(3)
+        << " cpu p50 " << std::setw(8) << *result.find("cpu_frame_p50_ms")
+        << " p99 " << std::setw(8) << *result.find("cpu_frame_p99_ms")
+        << " gpu " << std::setw(8) << mean(gpuFrameSamples) << " ms"
+        << "  draws " << scene->getDrawCount() << " triangles " << scene->getTriangleCount()
+        << std::defaultfloat << std::endl;
+
+    // Cleanup
+    for (auto fence : fences)
+        device.destroyFence(fence);
+    device.destroyCommandPool(commandPool);
+
+    scene->destroy();
+    gpuProfiler.destroy();
+    variants.destroy();
+    shaders.destroy();
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Main / Entry Point                                                    //
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    try {
+        const Options options = parseOptions(argc, argv);
+
+        if (options.list) {
+            const auto devices = bench::HeadlessContext::listDevices();
+            for (uint32_t i = 0; i < devices.size(); i++)
+                std::cout << "device " << i << ": " << devices[i] << "\n";
+            for (const auto& scene : bench::builtinScenes())
+                std::cout << "scene " << scene.name << ": " << scene.instances << " instances, "
+                    << scene.materials << " materials, " << scene.passes << " passes\n";
+            return EXIT_SUCCESS;
+        }
+
+        bench::HeadlessContext context;
+        context.init(options.context);
+
+        bench::Report report;
+        report.device = context.getDeviceName();
+        report.api = context.getApiVersion();
+        report.driver = context.getDriverVersion();
+        report.frames = options.frames;
+
+        std::cout << "device " << report.device << ", vulkan " << report.api << ", "
+            << options.frames << " frames at " << options.extent.width << "x" << options.extent.height << std::endl;
+
+        for (const auto& desc : options.scenes)
+            report.scenes.push_back(runScene(context, options, desc));
+
+        context.destroy();
+
+        if (!options.output.empty())
+            bench::writeReport(options.output, report);
+
+        if (!options.baseline.empty()) {
+            const bench::Report baseline = bench::loadReport(options.baseline);
+            const auto regressions = bench::compareReports(baseline, report,
+                options.threshold, options.minDeltaMs, std::cout);
+
+            if (!regressions.empty()) {
+                std::cerr << regressions.size() << " metric(s) regressed against " << options.baseline << std::endl;
+                return EXIT_REGRESSION;
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
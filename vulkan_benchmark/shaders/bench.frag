@@ -0,0 +1,16 @@
+#version 450
+
+// Synthetic scene fragment shader, the material is a specialization constant
+
+layout(constant_id = 0) const uint MATERIAL = 0u;
+
+layout(location = 0) in vec3 inNormal;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    vec3 base = vec3(MATERIAL % 3u, (MATERIAL / 3u) % 3u, (MATERIAL / 9u) % 3u) * 0.4 + 0.2;
+    float ndotl = max(dot(normalize(inNormal), normalize(vec3(0.3, 1.0, 0.5))), 0.1);
+    outColor = vec4(base * ndotl, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#version 450
+
+// Synthetic scene vertex shader, one cube per instance
+
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec4 inInstance;   // xyz position, w scale
+
+layout(push_constant) uniform PushConstants
+{
+    mat4 viewProj;
+} pc;
+
+layout(location = 0) out vec3 outNormal;
+
+void main()
+{
+    outNormal = inNormal;
+    gl_Position = pc.viewProj * vec4(inPos * inInstance.w + inInstance.xyz, 1.0);
+}
\ No newline at end of file
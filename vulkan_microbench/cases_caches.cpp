@@ -0,0 +1,165 @@
+/*
+ *
+ * Andrew Frost
+ * cases_caches.cpp
+ * 2020
+ *
+ */
+
+#include <unordered_map>
+
+#include "micro_harness.hpp"
+#include "../vulkan_samples/core/pipeline_variants.hpp"
+#include "../vulkan_samples/core/shader_library.hpp"
+#include "../vulkan_samples/core/vk_utils.hpp"
+
+//-------------------------------------------------------------------------
+// Vertex/fragment program and the state of a typical mesh pass, no
+// device objects are needed to build keys
+//
+struct PipelineFixture
+{
+    vkb::core::Shader        vertex;
+    vkb::core::Shader        fragment;
+    vkb::core::ShaderProgram program;
+    vkb::core::GraphicsState state;
+    std::vector<uint32_t>    constants{ 1, 0 };
+
+    PipelineFixture()
+    {
+        vertex.hash = 0x243f6a8885a308d3ull;
+        fragment.hash = 0x13198a2e03707344ull;
+        program.hash = 0xa4093822299f31d0ull;
+        program.stages = { &vertex, &fragment };
+
+        state.vertexBindings = {
+            { 0, 32, vk::VertexInputRate::eVertex },
+            { 1, 16, vk::VertexInputRate::eInstance } };
+        state.vertexAttributes = {
+            { 0, 0, vk::Format::eR32G32B32Sfloat, 0 },
+            { 1, 0, vk::Format::eR32G32B32Sfloat, 12 },
+            { 2, 0, vk::Format::eR32G32Sfloat, 24 },
+            { 3, 1, vk::Format::eR32G32B32A32Sfloat, 0 } };
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////
+// vkb::core::PipelineVariants                                           //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Key serialization and hash, the cost of every getGraphics hit
+//
+MICRO_CASE(caches, pipeline_key)
+{
+    PipelineFixture fixture;
+    std::vector<uint32_t> key;
+
+    while (state.run()) {
+        fixture.constants[1]++;
+        vkb::core::PipelineVariants::buildGraphicsKey(fixture.program, fixture.state, fixture.constants, key);
+        micro::doNotOptimize(vkb::core::hashBytes(key.data(), key.size() * sizeof(uint32_t)));
+    }
+}
+
+//-------------------------------------------------------------------------
+// Full hit path against a warm cache of 512 variants, same container
+// and full key compare as PipelineVariants::find
+//
+MICRO_CASE(caches, pipeline_lookup_512)
+{
+    PipelineFixture fixture;
+    std::vector<uint32_t> key;
+
+    std::unordered_map<uint64_t, std::vector<uint32_t>> variants;
+    for (uint32_t i = 0; i < 512; i++) {
+        fixture.constants[1] = i;
+        vkb::core::PipelineVariants::buildGraphicsKey(fixture.program, fixture.state, fixture.constants, key);
+        variants[vkb::core::hashBytes(key.data(), key.size() * sizeof(uint32_t))] = key;
+    }
+
+    uint32_t variant = 0;
+    while (state.run()) {
+        fixture.constants[1] = variant++ & 511;
+        vkb::core::PipelineVariants::buildGraphicsKey(fixture.program, fixture.state, fixture.constants, key);
+
+        auto it = variants.find(vkb::core::hashBytes(key.data(), key.size() * sizeof(uint32_t)));
+        micro::doNotOptimize(it != variants.end() && it->second == key);
+    }
+}
+
+//-------------------------------------------------------------------------
+// Same 512 variants through precomputed PipelineStateKey hashes, the
+// lookup hash and compare of the keyed PipelineVariants::getGraphics
+//
+MICRO_CASE(caches, pipeline_lookup_keyed_512)
+{
+    PipelineFixture fixture;
+    const vk::RenderPass renderPass;
+
+    constexpr vkb::core::PipelineStateDesc mesh = vkb::core::PipelineStateDesc()
+        .vertexBinding(0, 32)
+        .vertexBinding(1, 16, vk::VertexInputRate::eInstance)
+        .vertexAttribute(0, 0, vk::Format::eR32G32B32Sfloat, 0)
+        .vertexAttribute(1, 0, vk::Format::eR32G32B32Sfloat, 12)
+        .vertexAttribute(2, 0, vk::Format::eR32G32Sfloat, 24)
+        .vertexAttribute(3, 1, vk::Format::eR32G32B32A32Sfloat, 0)
+        .constant(1);
+
+    auto lookupHash = [&](const vkb::core::PipelineStateKey& key) {
+        return vkb::core::PipelineVariants::hashGraphicsKey(fixture.program, key, renderPass);
+    };
+
+    // keys are built once, as they would be at startup or by the compiler
+    std::vector<vkb::core::PipelineStateKey> keys;
+    std::unordered_map<uint64_t, vkb::core::PipelineStateDesc> variants;
+    for (uint32_t i = 0; i < 512; i++) {
+        keys.emplace_back(mesh.constant(i));
+        variants[lookupHash(keys.back())] = keys.back().desc;
+    }
+
+    uint32_t variant = 0;
+    while (state.run()) {
+        const vkb::core::PipelineStateKey& key = keys[variant++ & 511];
+        auto it = variants.find(lookupHash(key));
+        micro::doNotOptimize(it != variants.end() && it->second == key.desc);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// vkb::core::ShaderLibrary                                              //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Set layout key of a material set: uniforms, textures and a bindless array
+//
+MICRO_CASE(caches, set_layout_hash)
+{
+    const vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+    std::vector<vk::DescriptorSetLayoutBinding> bindings = {
+        { 0, vk::DescriptorType::eUniformBuffer, 1, stages },
+        { 1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex },
+        { 2, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment },
+        { 3, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment },
+        { 4, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment },
+        { 5, vk::DescriptorType::eCombinedImageSampler, 1024, vk::ShaderStageFlagBits::eFragment } };
+    std::vector<vk::DescriptorBindingFlagsEXT> bindingFlags(bindings.size());
+    bindingFlags.back() = vk::DescriptorBindingFlagBitsEXT::ePartiallyBound;
+
+    while (state.run())
+        micro::doNotOptimize(vkb::core::ShaderLibrary::hashBindings(bindings, bindingFlags));
+}
+
+//-------------------------------------------------------------------------
+// SPIR-V dedup hash of a 16 KB module, items are bytes
+//
+MICRO_CASE(caches, spirv_hash_16k)
+{
+    std::vector<uint32_t> code(4096);
+    for (uint32_t i = 0; i < code.size(); i++)
+        code[i] = i * 2654435761u;
+
+    state.setItemsPerIteration(code.size() * sizeof(uint32_t));
+    while (state.run())
+        micro::doNotOptimize(vkb::core::ShaderLibrary::hashCode(code.data(), code.size()));
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+/*
+ *
+ * Andrew Frost
+ * cases_camera.cpp
+ * 2020
+ *
+ */
+
+#include <vector>
+
+#include "micro_harness.hpp"
+#include "../vulkan_samples/helper/camera.hpp"
+
+///////////////////////////////////////////////////////////////////////////
+// tools::Camera                                                         //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// View matrix and frustum planes, once per frame while the camera moves
+//
+MICRO_CASE(camera, set_look_at)
+{
+    tools::Camera camera;
+    camera.setWindowSize(1280, 720);
+
+    float angle = 0.f;
+    while (state.run()) {
+        angle += 0.01f;
+        camera.setLookAt(glm::vec3(10.f * cosf(angle), 5.f, 10.f * sinf(angle)), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+        micro::doNotOptimize(camera.getMatrix());
+    }
+}
+
+//-------------------------------------------------------------------------
+// Projection and frustum planes, on resize and fov changes
+//
+MICRO_CASE(camera, set_window_size)
+{
+    tools::Camera camera;
+
+    uint32_t width = 800;
+    while (state.run()) {
+        width = width == 800 ? 1280 : 800;
+        camera.setWindowSize(width, 720);
+        micro::doNotOptimize(camera.getProjectionMatrix());
+    }
+}
+
+//-------------------------------------------------------------------------
+// Frustum plane copy, every culling pass starts with it
+//
+MICRO_CASE(camera, get_frustum_planes)
+{
+    tools::Camera camera;
+    camera.setWindowSize(1280, 720);
+
+    glm::vec4 planes[6];
+    while (state.run()) {
+        camera.getFrustumPlanes(planes);
+        micro::doNotOptimize(planes);
+    }
+}
+
+//-------------------------------------------------------------------------
+// Projected sphere size, per instance for LOD and texture streaming
+//
+MICRO_CASE(camera, projected_size_1k)
+{
+    const uint32_t count = 1024;
+
+    tools::Camera camera;
+    camera.setWindowSize(1280, 720);
+    camera.setLookAt(glm::vec3(0.f, 2.f, -20.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+
+    std::vector<glm::vec4> spheres(count);
+    for (uint32_t i = 0; i < count; i++)
+        spheres[i] = glm::vec4((i % 32) * 2.f - 32.f, 0.f, (i / 32) * 2.f, 0.5f + (i % 7) * 0.1f);
+
+    state.setItemsPerIteration(count);
+    while (state.run()) {
+        float total = 0.f;
+        for (const auto& sphere : spheres)
+            total += camera.getProjectedSize(glm::vec3(sphere), sphere.w);
+        micro::doNotOptimize(total);
+    }
+}
\ No newline at end of file
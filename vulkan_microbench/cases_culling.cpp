@@ -0,0 +1,94 @@
+/*
+ *
+ * Andrew Frost
+ * cases_culling.cpp
+ * 2020
+ *
+ */
+
+#include <cmath>
+
+#include "micro_harness.hpp"
+#include "../vulkan_samples/helper/mesh_lod.hpp"
+
+//-------------------------------------------------------------------------
+// UV sphere, enough triangles for a few LOD levels
+//
+static tools::Mesh createSphere(uint32_t rings, uint32_t segments)
+{
+    tools::Mesh mesh;
+
+    for (uint32_t r = 0; r <= rings; r++) {
+        const float theta = glm::pi<float>() * r / rings;
+        for (uint32_t s = 0; s <= segments; s++) {
+            const float phi = glm::two_pi<float>() * s / segments;
+            const glm::vec3 normal(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+
+            tools::Vertex vertex;
+            vertex.pos = normal;
+            vertex.normal = normal;
+            vertex.uv = glm::vec2(static_cast<float>(s) / segments, static_cast<float>(r) / rings);
+            mesh.vertices.push_back(vertex);
+        }
+    }
+
+    for (uint32_t r = 0; r < rings; r++) {
+        for (uint32_t s = 0; s < segments; s++) {
+            const uint32_t a = r * (segments + 1) + s;
+            const uint32_t b = a + segments + 1;
+            mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+
+    return mesh;
+}
+
+//-------------------------------------------------------------------------
+// Grid of instances around a camera looking across it, about half the
+// instances are outside the frustum
+//
+static void runLodSelect(micro::State& state, uint32_t instanceCount)
+{
+    static tools::Mesh s_mesh;
+    if (s_mesh.lods.empty()) {
+        s_mesh = createSphere(32, 64);
+        tools::generateLodChain(s_mesh);
+    }
+
+    tools::LodSelector selector;
+    const uint32_t meshID = selector.addMesh(s_mesh, 0, 0);
+
+    const uint32_t side = static_cast<uint32_t>(sqrtf(static_cast<float>(instanceCount)));
+    for (uint32_t i = 0; i < instanceCount; i++)
+        selector.addInstance(meshID, glm::vec3((i % side) * 3.f - side * 1.5f, 0.f, (i / side) * 3.f), 1.f);
+
+    tools::Camera camera;
+    camera.setWindowSize(1280, 720);
+    camera.setClipPlanes(0.1f, side * 3.f);
+    camera.setLookAt(glm::vec3(0.f, 10.f, -10.f), glm::vec3(0.f, 0.f, side * 1.5f), glm::vec3(0.f, 1.f, 0.f));
+
+    state.setItemsPerIteration(instanceCount);
+    while (state.run()) {
+        selector.select(camera);
+        micro::doNotOptimize(selector.getDraws());
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// tools::LodSelector                                                    //
+///////////////////////////////////////////////////////////////////////////
+
+MICRO_CASE(culling, lod_select_1k)
+{
+    runLodSelect(state, 1000);
+}
+
+MICRO_CASE(culling, lod_select_10k)
+{
+    runLodSelect(state, 10000);
+}
+
+MICRO_CASE(culling, lod_select_100k)
+{
+    runLodSelect(state, 100000);
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+/*
+ *
+ * Andrew Frost
+ * cases_memory.cpp
+ * 2020
+ *
+ */
+
+#include <vector>
+
+#include "micro_harness.hpp"
+#include "../vulkan_samples/core/device_allocator.hpp"
+
+//-------------------------------------------------------------------------
+// Block holding count ranges of 4KB to 4MB, as streamed mip chains are
+//
+static void runRangeChurn(micro::State& state, uint32_t count)
+{
+    std::vector<vk::DeviceSize> sizes(count);
+    std::vector<vk::DeviceSize> offsets(count);
+
+    uint32_t seed = 0x9e3779b9u;
+    vk::DeviceSize total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        sizes[i] = vk::DeviceSize(4096) << ((seed >> 16) % 11);
+        total += sizes[i] + 256;
+    }
+
+    // twice the size, refills always find room even when holes shift
+    vkb::core::RangeAllocator ranges;
+    ranges.init(total * 2);
+    for (uint32_t i = 0; i < count; i++)
+        ranges.allocate(sizes[i], 256, offsets[i]);
+
+    // free every other range then fill the holes again
+    state.setItemsPerIteration(count);
+    while (state.run()) {
+        for (uint32_t i = 0; i < count; i += 2)
+            ranges.free(offsets[i], sizes[i]);
+        for (uint32_t i = 0; i < count; i += 2)
+            ranges.allocate(sizes[i], 256, offsets[i]);
+        micro::doNotOptimize(offsets);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// vkb::core::RangeAllocator                                             //
+///////////////////////////////////////////////////////////////////////////
+
+MICRO_CASE(memory, range_churn_256)
+{
+    runRangeChurn(state, 256);
+}
+
+MICRO_CASE(memory, range_churn_4k)
+{
+    runRangeChurn(state, 4096);
+}
\ No newline at end of file
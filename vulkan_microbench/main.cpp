@@ -0,0 +1,84 @@
+/*
+ *
+ * Andrew Frost
+ * main.cpp
+ * 2020
+ *
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include "micro_harness.hpp"
+
+//-------------------------------------------------------------------------
+// Usage
+//
+static void printUsage()
+{
+    std::cout <<
+        "usage: vulkan_microbench [options]\n"
+        "  --list                 list the registered cases\n"
+        "  --filter <text>        only run cases whose name contains text\n"
+        "  --reps <count>         measured repetitions per case (default 10)\n"
+        "  --warmup <count>       discarded repetitions per case (default 2)\n"
+        "  --min-time <ms>        minimum time of one repetition (default 20)\n"
+        "  --csv <file>           write results as CSV\n";
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Main / Entry Point                                                    //
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    try {
+        micro::Options options;
+        std::string csv;
+        bool list = false;
+
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::runtime_error("missing value for " + arg);
+                return argv[++i];
+            };
+
+            if (arg == "--list")          list = true;
+            else if (arg == "--filter")   options.filter = value();
+            else if (arg == "--reps")     options.repetitions = std::stoul(value());
+            else if (arg == "--warmup")   options.warmup = std::stoul(value());
+            else if (arg == "--min-time") options.minTimeMs = std::stod(value());
+            else if (arg == "--csv")      csv = value();
+            else if (arg == "--help" || arg == "-h") {
+                printUsage();
+                return EXIT_SUCCESS;
+            }
+            else {
+                throw std::runtime_error("unknown option: " + arg);
+            }
+        }
+
+        if (list) {
+            for (const auto& benchCase : micro::registry())
+                std::cout << benchCase.name << "\n";
+            return EXIT_SUCCESS;
+        }
+
+        const auto results = micro::runAll(options, std::cout);
+        if (results.empty())
+            throw std::runtime_error("no case matches filter: " + options.filter);
+
+        if (!csv.empty())
+            micro::writeCsv(csv, results);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
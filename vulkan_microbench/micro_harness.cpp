@@ -0,0 +1,159 @@
+/*
+ *
+ * Andrew Frost
+ * micro_harness.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "micro_harness.hpp"
+
+namespace micro {
+
+const volatile void* g_escape = nullptr;
+
+//-------------------------------------------------------------------------
+// Registered cases, function local so registration order does not matter
+//
+std::vector<Case>& registry()
+{
+    static std::vector<Case> cases;
+    return cases;
+}
+
+//-------------------------------------------------------------------------
+// One repetition, returns ns per iteration
+//
+static double measure(const Case& benchCase, uint64_t iterations, uint64_t& items)
+{
+    State state(iterations);
+    benchCase.body(state);
+    items = state.getItemsPerIteration();
+    return state.getElapsedNs() / iterations;
+}
+
+//-------------------------------------------------------------------------
+// Calibrate, warm up and measure
+//
+Result runCase(const Case& benchCase, const Options& options)
+{
+    Result result;
+    result.name = benchCase.name;
+
+    uint64_t items = 0;
+
+    // Calibration, grow until a repetition takes minTimeMs
+    const double minTimeNs = options.minTimeMs * 1e6;
+    uint64_t iterations = 1;
+    for (;;) {
+        const double ns = measure(benchCase, iterations, items) * iterations;
+        if (ns >= minTimeNs || iterations >= (1ull << 40))
+            break;
+
+        // aim 20% past the target, at most 10x per step
+        const double scale = ns > 0.0 ? std::min(10.0, 1.2 * minTimeNs / ns) : 10.0;
+        iterations = std::max(iterations + 1, static_cast<uint64_t>(iterations * scale));
+    }
+    result.iterations = iterations;
+
+    for (uint32_t i = 0; i < options.warmup; i++)
+        measure(benchCase, iterations, items);
+
+    std::vector<double> samples;
+    for (uint32_t i = 0; i < std::max(options.repetitions, 1u); i++)
+        samples.push_back(measure(benchCase, iterations, items));
+
+    // Statistics
+    std::sort(samples.begin(), samples.end());
+    const size_t count = samples.size();
+
+    double sum = 0.0;
+    for (double sample : samples)
+        sum += sample;
+
+    result.minNs = samples.front();
+    result.medianNs = count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+    result.meanNs = sum / count;
+
+    double variance = 0.0;
+    for (double sample : samples)
+        variance += (sample - result.meanNs) * (sample - result.meanNs);
+    result.deviation = count > 1 ? std::sqrt(variance / (count - 1)) / result.meanNs : 0.0;
+
+    if (items && result.medianNs > 0.0)
+        result.itemsPerSecond = items * 1e9 / result.medianNs;
+
+    return result;
+}
+
+//-------------------------------------------------------------------------
+// Human readable time
+//
+static std::string formatNs(double ns)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(ns < 10.0 ? 2 : 1);
+    if (ns < 1e3)      out << ns << " ns";
+    else if (ns < 1e6) out << ns / 1e3 << " us";
+    else               out << ns / 1e6 << " ms";
+    return out.str();
+}
+
+//-------------------------------------------------------------------------
+// Run matching cases in name order
+//
+std::vector<Result> runAll(const Options& options, std::ostream& log)
+{
+    std::vector<Case> cases = registry();
+    std::sort(cases.begin(), cases.end(), [](const Case& a, const Case& b) { return a.name < b.name; });
+
+    log << std::left << std::setw(36) << "case" << std::right << std::setw(12) << "median"
+        << std::setw(12) << "min" << std::setw(10) << "dev" << std::setw(14) << "items/s"
+        << std::setw(12) << "iterations" << "\n";
+
+    std::vector<Result> results;
+    for (const Case& benchCase : cases) {
+        if (!options.filter.empty() && benchCase.name.find(options.filter) == std::string::npos)
+            continue;
+
+        const Result result = runCase(benchCase, options);
+
+        log << std::left << std::setw(36) << result.name << std::right
+            << std::setw(12) << formatNs(result.medianNs) << std::setw(12) << formatNs(result.minNs)
+            << std::setw(9) << std::fixed << std::setprecision(1) << result.deviation * 100.0 << "%";
+        if (result.itemsPerSecond > 0.0)
+            log << std::setw(14) << std::scientific << std::setprecision(2) << result.itemsPerSecond;
+        else
+            log << std::setw(14) << "-";
+        log << std::setw(12) << result.iterations << std::defaultfloat << std::endl;
+
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+//-------------------------------------------------------------------------
+// One row per case, for spreadsheets and CI artifacts
+//
+void writeCsv(const std::string& path, const std::vector<Result>& results)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open csv file: " + path);
+
+    file << "case,iterations,median_ns,min_ns,mean_ns,deviation,items_per_second\n";
+    for (const Result& result : results) {
+        file << result.name << "," << result.iterations << "," << result.medianNs << "," << result.minNs
+            << "," << result.meanNs << "," << result.deviation << "," << result.itemsPerSecond << "\n";
+    }
+}
+
+} // namespace micro
\ No newline at end of file
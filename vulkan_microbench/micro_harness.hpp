@@ -0,0 +1,143 @@
+/*
+ *
+ * Andrew Frost
+ * micro_harness.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace micro {
+
+///////////////////////////////////////////////////////////////////////////
+// State                                                                 //
+///////////////////////////////////////////////////////////////////////////
+// Passed to a case body. Setup before the loop is not timed:           //
+//                                                                       //
+//   MICRO_CASE(camera, update) {                                        //
+//       tools::Camera camera;                                           //
+//       while (state.run())                                             //
+//           camera.update();                                            //
+//   }                                                                   //
+//                                                                       //
+// The clock starts on the first run() and stops when it returns false //
+///////////////////////////////////////////////////////////////////////////
+
+class State
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit State(uint64_t iterations) : m_remaining(iterations), m_iterations(iterations) {}
+
+    bool run()
+    {
+        if (m_remaining == m_iterations)
+            m_start = Clock::now();
+        if (m_remaining-- == 0) {
+            m_elapsed = Clock::now() - m_start;
+            return false;
+        }
+        return true;
+    }
+
+    // Work per iteration, reported as items per second
+    void setItemsPerIteration(uint64_t items) { m_items = items; }
+
+    // Getting Methods
+    uint64_t getIterations()        const { return m_iterations; }
+    uint64_t getItemsPerIteration() const { return m_items; }
+    double   getElapsedNs()         const { return std::chrono::duration<double, std::nano>(m_elapsed).count(); }
+
+private:
+    uint64_t          m_remaining;
+    uint64_t          m_iterations;
+    uint64_t          m_items{ 0 };
+    Clock::time_point m_start;
+    Clock::duration   m_elapsed{ 0 };
+};
+
+//-------------------------------------------------------------------------
+// Keep a result alive so the compiler can not drop the work producing it,
+// memory is treated as clobbered so inputs are re-read every iteration
+//
+extern const volatile void* g_escape;
+
+template <class T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(_MSC_VER)
+    g_escape = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r"(&value) : "memory");
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Harness                                                               //
+///////////////////////////////////////////////////////////////////////////
+// - iterations per repetition are calibrated to run at least minTimeMs //
+// - warmup repetitions are discarded                                   //
+// - reported: min, median, mean and relative deviation of ns per      //
+//   iteration over the measured repetitions                            //
+///////////////////////////////////////////////////////////////////////////
+
+struct Case
+{
+    std::string                 name;    // "group/name"
+    std::function<void(State&)> body;
+};
+
+struct Options
+{
+    std::string filter;          // substring of the case name
+    uint32_t    repetitions{ 10 };
+    uint32_t    warmup{ 2 };
+    double      minTimeMs{ 20.0 };
+};
+
+struct Result
+{
+    std::string name;
+    uint64_t    iterations{ 0 };
+    double      minNs{ 0.0 };
+    double      medianNs{ 0.0 };
+    double      meanNs{ 0.0 };
+    double      deviation{ 0.0 };      // standard deviation / mean
+    double      itemsPerSecond{ 0.0 };
+};
+
+// Every case registered through MICRO_CASE
+std::vector<Case>& registry();
+
+struct Registrar
+{
+    Registrar(const char* name, void (*body)(State&)) { registry().push_back({ name, body }); }
+};
+
+Result runCase(const Case& benchCase, const Options& options);
+
+// Runs every matching case, prints a table as results come in
+std::vector<Result> runAll(const Options& options, std::ostream& log);
+
+void writeCsv(const std::string& path, const std::vector<Result>& results);
+
+// Defines and registers a case, the body receives micro::State& state
+#define MICRO_CASE(group, name)                                                                 \
+    static void micro_##group##_##name(micro::State& state);                                    \
+    static micro::Registrar s_micro_##group##_##name(#group "/" #name, micro_##group##_##name); \
+    static void micro_##group##_##name(micro::State& state)
+
+} // namespace micro
\ No newline at end of file
@@ -0,0 +1,300 @@
+/*
+ *
+ * Andrew Frost
+ * gpu_structs.h
+ * 2020
+ *
+ */
+
+// Shared by C++ and GLSL, shaders declare the buffer blocks with
+// layout(scalar) (VK_EXT_scalar_block_layout). Scalar layout aligns every
+// member to its component size, which is how glm lays out its types, so
+// the offsets below hold on both sides with no std140 padding. Arrays use
+// sizeof() as stride.
+
+#ifndef GPU_STRUCTS_H
+#define GPU_STRUCTS_H
+
+#ifdef __cplusplus
+#include <cstddef>
+
+#include "glm_common.h"
+
+namespace gpu {
+
+using vec2 = glm::vec2;
+using vec3 = glm::vec3;
+using vec4 = glm::vec4;
+using mat4 = glm::mat4;
+using uint = uint32_t;
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+// GpuCamera                                                             //
+///////////////////////////////////////////////////////////////////////////
+
+struct GpuCamera
+{
+    mat4  view;
+    mat4  proj;
+    mat4  viewProj;
+    vec4  frustumPlanes[6];    // xyz normal pointing inside, w distance
+    vec3  position;
+    float nearPlane;
+    vec2  viewportSize;
+    float farPlane;
+    uint  frameIndex;
+    uint  lightCount;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// GpuInstance                                                           //
+///////////////////////////////////////////////////////////////////////////
+
+struct GpuInstance
+{
+    vec3  position;
+    float scale;
+    vec4  rotation;            // quaternion, xyz imaginary
+    vec3  boundsCenter;        // world space
+    float boundsRadius;
+    uint  meshIndex;
+    uint  materialIndex;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// GpuMaterial                                                           //
+///////////////////////////////////////////////////////////////////////////
+
+const uint GPU_NO_TEXTURE = 0xffffffffu;
+
+struct GpuMaterial
+{
+    vec4  baseColor;
+    vec3  emissive;
+    float roughness;
+    float metallic;
+    uint  baseColorTexture;    // index into the texture array, or GPU_NO_TEXTURE
+    uint  normalTexture;
+    uint  flags;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// GpuLight                                                              //
+///////////////////////////////////////////////////////////////////////////
+
+const uint GPU_LIGHT_POINT       = 0u;
+const uint GPU_LIGHT_SPOT        = 1u;
+const uint GPU_LIGHT_DIRECTIONAL = 2u;
+
+struct GpuLight
+{
+    vec3  position;
+    float range;
+    vec3  color;
+    float intensity;
+    vec3  direction;           // spot and directional lights
+    float spotCos;             // cosine of the cone half angle
+    uint  type;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// GpuCluster                                                            //
+///////////////////////////////////////////////////////////////////////////
+// View space froxels, GPU_CLUSTER_X x GPU_CLUSTER_Y screen tiles split //
+// into GPU_CLUSTER_Z slices spaced exponentially between the clip     //
+// planes. Index x + X * (y + Y * z)                                    //
+///////////////////////////////////////////////////////////////////////////
+
+const uint GPU_CLUSTER_X          = 16u;
+const uint GPU_CLUSTER_Y          = 9u;
+const uint GPU_CLUSTER_Z          = 24u;
+const uint GPU_CLUSTER_COUNT      = GPU_CLUSTER_X * GPU_CLUSTER_Y * GPU_CLUSTER_Z;
+const uint GPU_CLUSTER_MAX_LIGHTS = 128u;   // per cluster, higher light indices are dropped
+const uint GPU_CLUSTER_AVG_LIGHTS = 32u;    // light index list capacity per cluster
+
+struct GpuCluster
+{
+    uint  offset;              // first entry in the light index list
+    uint  count;
+};
+
+struct GpuClusterParams
+{
+    mat4  view;
+    vec4  projScale;           // proj[0][0], proj[1][1], proj[2][0], proj[2][1]
+    vec2  viewportSize;
+    float nearPlane;
+    float farPlane;
+    uint  lightCount;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Occlusion Culling                                                     //
+///////////////////////////////////////////////////////////////////////////
+// Hi-Z pyramid of max depth, level 0 is the viewport rounded down to a //
+// power of two and at most 4096 texels wide                           //
+///////////////////////////////////////////////////////////////////////////
+
+const uint GPU_HIZ_MAX_LEVELS = 13u;
+
+struct GpuHiZParams
+{
+    uint  depthWidth;          // viewport area of the depth buffer
+    uint  depthHeight;
+    uint  hizWidth;            // level 0
+    uint  hizHeight;
+    uint  levelCount;
+    uint  groupCount;          // the last group to finish builds the small levels
+};
+
+// An instance the LOD selector found in the frustum, with its draw
+struct GpuCullCandidate
+{
+    vec3  center;              // world space bounding sphere
+    float radius;
+    uint  instanceIndex;
+    uint  drawIndex;
+};
+
+// VkDrawIndexedIndirectCommand
+struct GpuDrawCommand
+{
+    uint  indexCount;
+    uint  instanceCount;
+    uint  firstIndex;
+    int   vertexOffset;
+    uint  firstInstance;
+};
+
+struct GpuCullParams
+{
+    mat4  viewProj;            // of the pyramid being tested against
+    vec2  hizSize;
+    uint  levelCount;
+    uint  candidateCount;
+    uint  drawCount;           // per phase, late draws follow the early ones
+    uint  phase;               // 0 early, 1 late
+    uint  historyValid;        // early phase without a pyramid passes everything
+};
+
+///////////////////////////////////////////////////////////////////////////
+// GpuPostParams                                                         //
+///////////////////////////////////////////////////////////////////////////
+
+struct GpuPostParams
+{
+    vec3  tint;                // color grade, multiplies the exposed color
+    float exposure;
+    float contrast;            // around mid grey, 1 leaves it unchanged
+    float saturation;          // 0 is greyscale
+    float sharpen;             // unsharp mask strength, 0 disables it
+};
+
+#ifdef __cplusplus
+///////////////////////////////////////////////////////////////////////////
+// Layout Verification                                                   //
+///////////////////////////////////////////////////////////////////////////
+// Offsets are the ones glslang assigns under layout(scalar). A change  //
+// on either side without the other fails to compile here               //
+///////////////////////////////////////////////////////////////////////////
+
+static_assert(alignof(vec4) == 4 && alignof(mat4) == 4, "scalar layout expects glm types without SIMD alignment");
+
+#define GPU_CHECK_OFFSET(type, member, offset) \
+    static_assert(offsetof(type, member) == offset, #type "::" #member " does not match the scalar layout")
+
+GPU_CHECK_OFFSET(GpuCamera, view,          0);
+GPU_CHECK_OFFSET(GpuCamera, proj,          64);
+GPU_CHECK_OFFSET(GpuCamera, viewProj,      128);
+GPU_CHECK_OFFSET(GpuCamera, frustumPlanes, 192);
+GPU_CHECK_OFFSET(GpuCamera, position,      288);
+GPU_CHECK_OFFSET(GpuCamera, nearPlane,     300);
+GPU_CHECK_OFFSET(GpuCamera, viewportSize,  304);
+GPU_CHECK_OFFSET(GpuCamera, farPlane,      312);
+GPU_CHECK_OFFSET(GpuCamera, frameIndex,    316);
+GPU_CHECK_OFFSET(GpuCamera, lightCount,    320);
+static_assert(sizeof(GpuCamera) == 324, "GpuCamera does not match the scalar layout");
+
+GPU_CHECK_OFFSET(GpuInstance, position,      0);
+GPU_CHECK_OFFSET(GpuInstance, scale,         12);
+GPU_CHECK_OFFSET(GpuInstance, rotation,      16);
+GPU_CHECK_OFFSET(GpuInstance, boundsCenter,  32);
+GPU_CHECK_OFFSET(GpuInstance, boundsRadius,  44);
+GPU_CHECK_OFFSET(GpuInstance, meshIndex,     48);
+GPU_CHECK_OFFSET(GpuInstance, materialIndex, 52);
+static_assert(sizeof(GpuInstance) == 56, "GpuInstance does not match the scalar layout");
+
+GPU_CHECK_OFFSET(GpuMaterial, baseColor,        0);
+GPU_CHECK_OFFSET(GpuMaterial, emissive,         16);
+GPU_CHECK_OFFSET(GpuMaterial, roughness,        28);
+GPU_CHECK_OFFSET(GpuMaterial, metallic,         32);
+GPU_CHECK_OFFSET(GpuMaterial, baseColorTexture, 36);
+GPU_CHECK_OFFSET(GpuMaterial, normalTexture,    40);
+GPU_CHECK_OFFSET(GpuMaterial, flags,            44);
+static_assert(sizeof(GpuMaterial) == 48, "GpuMaterial does not match the scalar layout");
+
+GPU_CHECK_OFFSET(GpuLight, position,  0);
+GPU_CHECK_OFFSET(GpuLight, range,     12);
+GPU_CHECK_OFFSET(GpuLight, color,     16);
+GPU_CHECK_OFFSET(GpuLight, intensity, 28);
+GPU_CHECK_OFFSET(GpuLight, direction, 32);
+GPU_CHECK_OFFSET(GpuLight, spotCos,   44);
+GPU_CHECK_OFFSET(GpuLight, type,      48);
+static_assert(sizeof(GpuLight) == 52, "GpuLight does not match the scalar layout");
+
+GPU_CHECK_OFFSET(GpuCluster, offset, 0);
+GPU_CHECK_OFFSET(GpuCluster, count,  4);
+static_assert(sizeof(GpuCluster) == 8, "GpuCluster does not match the scalar layout");
+
+GPU_CHECK_OFFSET(GpuClusterParams, view,         0);
+GPU_CHECK_OFFSET(GpuClusterParams, projScale,    64);
+GPU_CHECK_OFFSET(GpuClusterParams, viewportSize, 80);
+GPU_CHECK_OFFSET(GpuClusterParams, nearPlane,    88);
+GPU_CHECK_OFFSET(GpuClusterParams, farPlane,     92);
+GPU_CHECK_OFFSET(GpuClusterParams, lightCount,   96);
+static_assert(sizeof(GpuClusterParams) == 100, "GpuClusterParams does not match the scalar layout");
+
+GPU_CHECK_OFFSET(GpuHiZParams, depthWidth,  0);
+GPU_CHECK_OFFSET(GpuHiZParams, depthHeight, 4);
+GPU_CHECK_OFFSET(GpuHiZParams, hizWidth,    8);
+GPU_CHECK_OFFSET(GpuHiZParams, hizHeight,   12);
+GPU_CHECK_OFFSET(GpuHiZParams, levelCount,  16);
+GPU_CHECK_OFFSET(GpuHiZParams, groupCount,  20);
+static_assert(sizeof(GpuHiZParams) == 24, "GpuHiZParams does not match the scalar layout");
+
+GPU_CHECK_OFFSET(GpuCullCandidate, center,        0);
+GPU_CHECK_OFFSET(GpuCullCandidate, radius,        12);
+GPU_CHECK_OFFSET(GpuCullCandidate, instanceIndex, 16);
+GPU_CHECK_OFFSET(GpuCullCandidate, drawIndex,     20);
+static_assert(sizeof(GpuCullCandidate) == 24, "GpuCullCandidate does not match the scalar layout");
+
+GPU_CHECK_OFFSET(GpuDrawCommand, indexCount,    0);
+GPU_CHECK_OFFSET(GpuDrawCommand, instanceCount, 4);
+GPU_CHECK_OFFSET(GpuDrawCommand, firstIndex,    8);
+GPU_CHECK_OFFSET(GpuDrawCommand, vertexOffset,  12);
+GPU_CHECK_OFFSET(GpuDrawCommand, firstInstance, 16);
+static_assert(sizeof(GpuDrawCommand) == 20, "GpuDrawCommand does not match VkDrawIndexedIndirectCommand");
+
+GPU_CHECK_OFFSET(GpuCullParams, viewProj,       0);
+GPU_CHECK_OFFSET(GpuCullParams, hizSize,        64);
+GPU_CHECK_OFFSET(GpuCullParams, levelCount,     72);
+GPU_CHECK_OFFSET(GpuCullParams, candidateCount, 76);
+GPU_CHECK_OFFSET(GpuCullParams, drawCount,      80);
+GPU_CHECK_OFFSET(GpuCullParams, phase,          84);
+GPU_CHECK_OFFSET(GpuCullParams, historyValid,   88);
+static_assert(sizeof(GpuCullParams) == 92, "GpuCullParams does not match the scalar layout");
+
+GPU_CHECK_OFFSET(GpuPostParams, tint,       0);
+GPU_CHECK_OFFSET(GpuPostParams, exposure,   12);
+GPU_CHECK_OFFSET(GpuPostParams, contrast,   16);
+GPU_CHECK_OFFSET(GpuPostParams, saturation, 20);
+GPU_CHECK_OFFSET(GpuPostParams, sharpen,    24);
+static_assert(sizeof(GpuPostParams) == 28, "GpuPostParams does not match the scalar layout");
+
+#undef GPU_CHECK_OFFSET
+
+} // namespace gpu
+#endif
+
+#endif // GPU_STRUCTS_H
\ No newline at end of file
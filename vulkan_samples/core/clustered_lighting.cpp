@@ -0,0 +1,231 @@
+/*
+ *
+ * Andrew Frost
+ * clustered_lighting.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+
+#include "clustered_lighting.hpp"
+#include "object_registry.hpp"
+#include "vk_utils.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// ClusteredLighting                                                     //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization, every buffer is sized for maxLights up front
+//
+void ClusteredLighting::init(vk::Device device, vk::PhysicalDevice physicalDevice, ShaderLibrary& shaders,
+    PipelineVariants& variants, uint32_t frameCount, uint32_t maxLights)
+{
+    assert(!m_device && "ClusteredLighting already initialized");
+    m_device = device;
+    m_physicalDevice = physicalDevice;
+    m_maxLights = maxLights;
+
+    m_program = &shaders.createProgram({ &shaders.loadFromFile("shaders/light_cluster.comp.spv") });
+    m_pipeline = variants.getCompute(*m_program);
+
+    // Lights, written by the host every frame
+    const vk::DeviceSize lightBytes = vk::DeviceSize(m_maxLights) * sizeof(gpu::GpuLight);
+
+    m_frames.resize(frameCount);
+    for (auto& frame : m_frames) {
+        createBuffer(m_device, m_physicalDevice, lightBytes, vk::BufferUsageFlagBits::eStorageBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            frame.buffer, frame.memory);
+        VkObjects.onCreate(frame.buffer, lightBytes, "ClusteredLighting");
+        VkObjects.onCreate(frame.memory, lightBytes, "ClusteredLighting");
+
+        frame.mapped = static_cast<gpu::GpuLight*>(m_device.mapMemory(frame.memory, 0, VK_WHOLE_SIZE));
+    }
+
+    // Cluster ranges and the light index list, only touched by the device
+    const vk::DeviceSize clusterBytes = vk::DeviceSize(gpu::GPU_CLUSTER_COUNT) * sizeof(gpu::GpuCluster);
+    const vk::DeviceSize indexBytes = sizeof(uint32_t)
+        + vk::DeviceSize(gpu::GPU_CLUSTER_COUNT) * gpu::GPU_CLUSTER_AVG_LIGHTS * sizeof(uint32_t);
+
+    createBuffer(m_device, m_physicalDevice, clusterBytes, vk::BufferUsageFlagBits::eStorageBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal, m_clusterBuffer, m_clusterMemory);
+    VkObjects.onCreate(m_clusterBuffer, clusterBytes, "ClusteredLighting");
+    VkObjects.onCreate(m_clusterMemory, clusterBytes, "ClusteredLighting");
+
+    createBuffer(m_device, m_physicalDevice, indexBytes,
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal, m_indexBuffer, m_indexMemory);
+    VkObjects.onCreate(m_indexBuffer, indexBytes, "ClusteredLighting");
+    VkObjects.onCreate(m_indexMemory, indexBytes, "ClusteredLighting");
+
+    createDescriptorSets();
+}
+
+//-------------------------------------------------------------------------
+// Call on exit
+//
+void ClusteredLighting::destroy()
+{
+    if (!m_device)
+        return;
+
+    VkObjects.onDestroy(m_descriptorPool);
+    m_device.destroyDescriptorPool(m_descriptorPool);
+    m_descriptorPool = nullptr;
+
+    for (auto& frame : m_frames) {
+        VkObjects.onDestroy(frame.buffer);
+        VkObjects.onDestroy(frame.memory);
+        m_device.unmapMemory(frame.memory);
+        m_device.destroyBuffer(frame.buffer);
+        m_device.freeMemory(frame.memory);
+    }
+    m_frames.clear();
+
+    VkObjects.onDestroy(m_clusterBuffer);
+    VkObjects.onDestroy(m_clusterMemory);
+    VkObjects.onDestroy(m_indexBuffer);
+    VkObjects.onDestroy(m_indexMemory);
+    m_device.destroyBuffer(m_clusterBuffer);
+    m_device.freeMemory(m_clusterMemory);
+    m_device.destroyBuffer(m_indexBuffer);
+    m_device.freeMemory(m_indexMemory);
+    m_clusterBuffer = nullptr;
+    m_clusterMemory = nullptr;
+    m_indexBuffer = nullptr;
+    m_indexMemory = nullptr;
+
+    // program and pipeline belong to the library and variant cache
+    m_program = nullptr;
+    m_pipeline = nullptr;
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// One set per frame, only the light buffer differs
+//
+void ClusteredLighting::createDescriptorSets()
+{
+    const uint32_t frameCount = static_cast<uint32_t>(m_frames.size());
+    const vk::DescriptorPoolSize poolSize = { vk::DescriptorType::eStorageBuffer, 3 * frameCount };
+
+    vk::DescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.maxSets = frameCount;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    try {
+        m_descriptorPool = m_device.createDescriptorPool(poolInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create clustered lighting descriptor pool!");
+    }
+    VkObjects.onCreate(m_descriptorPool, 0, "ClusteredLighting");
+
+    const std::vector<vk::DescriptorSetLayout> layouts(frameCount, m_program->setLayouts[0]);
+
+    vk::DescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = frameCount;
+    allocInfo.pSetLayouts = layouts.data();
+
+    std::vector<vk::DescriptorSet> sets;
+    try {
+        sets = m_device.allocateDescriptorSets(allocInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to allocate clustered lighting descriptor sets!");
+    }
+
+    for (uint32_t i = 0; i < frameCount; i++) {
+        m_frames[i].descriptorSet = sets[i];
+
+        const std::array<vk::DescriptorBufferInfo, 3> bufferInfos = { {
+            { m_frames[i].buffer, 0, VK_WHOLE_SIZE },
+            { m_clusterBuffer, 0, VK_WHOLE_SIZE },
+            { m_indexBuffer, 0, VK_WHOLE_SIZE },
+        } };
+
+        std::array<vk::WriteDescriptorSet, 3> writes = {};
+        for (uint32_t binding = 0; binding < writes.size(); binding++) {
+            writes[binding].dstSet = sets[i];
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorCount = 1;
+            writes[binding].descriptorType = vk::DescriptorType::eStorageBuffer;
+            writes[binding].pBufferInfo = &bufferInfos[binding];
+        }
+
+        m_device.updateDescriptorSets(writes, nullptr);
+    }
+}
+
+//-------------------------------------------------------------------------
+// Copy the lights and take the cluster parameters from the camera
+//
+void ClusteredLighting::update(uint32_t frame, const tools::Camera& camera, const std::vector<gpu::GpuLight>& lights)
+{
+    Frame& current = m_frames[frame];
+
+    const uint32_t count = std::min(static_cast<uint32_t>(lights.size()), m_maxLights);
+    m_dropped = static_cast<uint32_t>(lights.size()) - count;
+    if (count > 0)
+        memcpy(current.mapped, lights.data(), count * sizeof(gpu::GpuLight));
+
+    gpu::GpuCamera gpuCamera;
+    camera.getGpuCamera(gpuCamera);
+
+    // the projection terms clusters are unprojected with, no inverse needed
+    current.params.view = gpuCamera.view;
+    current.params.projScale = gpu::vec4(gpuCamera.proj[0][0], gpuCamera.proj[1][1],
+        gpuCamera.proj[2][0], gpuCamera.proj[2][1]);
+    current.params.viewportSize = gpuCamera.viewportSize;
+    current.params.nearPlane = gpuCamera.nearPlane;
+    current.params.farPlane = gpuCamera.farPlane;
+    current.params.lightCount = count;
+}
+
+//-------------------------------------------------------------------------
+// Clear the list count, bin, lists visible to the fragment shaders
+//
+void ClusteredLighting::record(vk::CommandBuffer cmdBuffer, uint32_t frame)
+{
+    const Frame& current = m_frames[frame];
+
+    // the last frame's fragment shaders may still read the lists
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader,
+        vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, {},
+        nullptr, nullptr, nullptr);
+
+    cmdBuffer.fillBuffer(m_indexBuffer, 0, sizeof(uint32_t), 0);
+
+    vk::MemoryBarrier cleared = {};
+    cleared.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    cleared.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {},
+        cleared, nullptr, nullptr);
+
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_pipeline);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_program->pipelineLayout, 0,
+        current.descriptorSet, nullptr);
+    cmdBuffer.pushConstants(m_program->pipelineLayout, m_program->pushConstantStages, 0,
+        sizeof(gpu::GpuClusterParams), &current.params);
+    // one invocation per cluster, groups of 64 as in light_cluster.comp
+    cmdBuffer.dispatch((gpu::GPU_CLUSTER_COUNT + 63) / 64, 1, 1);
+
+    vk::MemoryBarrier binned = {};
+    binned.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    binned.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader, {},
+        binned, nullptr, nullptr);
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,95 @@
+/*
+ *
+ * Andrew Frost
+ * clustered_lighting.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "../helper/camera.hpp"
+#include "pipeline_variants.hpp"
+#include "shader_library.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// ClusteredLighting                                                     //
+///////////////////////////////////////////////////////////////////////////
+// Point and spot lights binned into the view space froxels of the      //
+// camera projection by a compute pass, forward shading only walks the //
+// list of its fragment's cluster                                       //
+// - lights are written per frame in flight to host visible memory     //
+// - record() clears the list, bins and makes the lists visible to     //
+//   fragment shaders, before the passes reading them                  //
+// - cluster and light index buffers are shared by the frames, the     //
+//   next clear waits for the fragment shaders of the last one         //
+// - directional lights are in every cluster                           //
+///////////////////////////////////////////////////////////////////////////
+
+class ClusteredLighting
+{
+public:
+    ClusteredLighting(ClusteredLighting const&) = delete;
+    ClusteredLighting& operator=(ClusteredLighting const&) = delete;
+
+    ClusteredLighting() = default;
+    ~ClusteredLighting() { destroy(); }
+
+    void init(vk::Device device, vk::PhysicalDevice physicalDevice, ShaderLibrary& shaders, PipelineVariants& variants,
+        uint32_t frameCount, uint32_t maxLights = 4096);
+
+    // Device must be idle
+    void destroy();
+
+    // Lights of the frame, its fence has signaled. Past maxLights they are dropped
+    void update(uint32_t frame, const tools::Camera& camera, const std::vector<gpu::GpuLight>& lights);
+
+    // Binning pass of the frame, outside any render pass
+    void record(vk::CommandBuffer cmdBuffer, uint32_t frame);
+
+    // Getting Methods, binding 4, 5 and 6 of the scene shaders
+    vk::Buffer getLightBuffer(uint32_t frame) const { return m_frames[frame].buffer; }
+    vk::Buffer getClusterBuffer()             const { return m_clusterBuffer; }
+    vk::Buffer getLightIndexBuffer()          const { return m_indexBuffer; }
+    uint32_t   getLightCount(uint32_t frame)  const { return m_frames[frame].params.lightCount; }
+    uint32_t   getDroppedCount()              const { return m_dropped; }
+    uint32_t   getMaxLights()                 const { return m_maxLights; }
+
+private:
+
+    struct Frame
+    {
+        vk::Buffer             buffer;
+        vk::DeviceMemory       memory;
+        gpu::GpuLight*         mapped{ nullptr };
+        vk::DescriptorSet      descriptorSet;
+        gpu::GpuClusterParams  params{};
+    };
+
+    void createDescriptorSets();
+
+    vk::Device                 m_device;
+    vk::PhysicalDevice         m_physicalDevice;
+    uint32_t                   m_maxLights{ 0 };
+    uint32_t                   m_dropped{ 0 };      // last update
+
+    const ShaderProgram*       m_program{ nullptr };
+    vk::Pipeline               m_pipeline;
+    vk::DescriptorPool         m_descriptorPool;
+
+    std::vector<Frame>         m_frames;
+    vk::Buffer                 m_clusterBuffer;
+    vk::DeviceMemory           m_clusterMemory;
+    vk::Buffer                 m_indexBuffer;       // count, then the compact lists
+    vk::DeviceMemory           m_indexMemory;
+
+}; // class ClusteredLighting
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,269 @@
+/*
+ *
+ * Andrew Frost
+ * command_pools.cpp
+ * 2020
+ *
+ */
+
+#include <cassert>
+
+#include "command_pools.hpp"
+#include "object_registry.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// FrameCommandPools                                                     //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization, buffers are allocated on first use
+//
+void FrameCommandPools::init(vk::Device device, uint32_t queueIdx, uint32_t frameCount)
+{
+    assert(!m_device && "FrameCommandPools already initialized");
+    m_device = device;
+    m_frames.resize(frameCount);
+
+    // no eResetCommandBuffer, buffers are only reset with their pool
+    vk::CommandPoolCreateInfo poolInfo = {};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+    poolInfo.queueFamilyIndex = queueIdx;
+
+    try {
+        for (auto& frame : m_frames)
+            frame.pool = m_device.createCommandPool(poolInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create frame command pools!");
+    }
+
+    for (auto& frame : m_frames)
+        VkObjects.onCreate(frame.pool, 0, "FrameCommandPools");
+}
+
+//-------------------------------------------------------------------------
+// Call on exit, buffers go with their pool
+//
+void FrameCommandPools::destroy()
+{
+    if (!m_device)
+        return;
+
+    for (auto& frame : m_frames) {
+        VkObjects.onDestroy(frame.pool);
+        m_device.destroyCommandPool(frame.pool);
+    }
+    m_frames.clear();
+
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Every buffer of the frame at once
+//
+void FrameCommandPools::reset(uint32_t frame)
+{
+    Frame& entry = m_frames[frame];
+    m_device.resetCommandPool(entry.pool, {});
+    entry.usedPrimaries = 0;
+    entry.usedSecondaries = 0;
+}
+
+//-------------------------------------------------------------------------
+// Reuse before allocating
+//
+vk::CommandBuffer FrameCommandPools::allocate(uint32_t frame, vk::CommandBufferLevel level)
+{
+    Frame& entry = m_frames[frame];
+    const bool primary = level == vk::CommandBufferLevel::ePrimary;
+    std::vector<vk::CommandBuffer>& buffers = primary ? entry.primaries : entry.secondaries;
+    uint32_t& used = primary ? entry.usedPrimaries : entry.usedSecondaries;
+
+    if (used == buffers.size()) {
+        try {
+            buffers.push_back(m_device.allocateCommandBuffers({ entry.pool, level, 1 })[0]);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to allocate frame command buffer!");
+        }
+    }
+
+    return buffers[used++];
+}
+
+///////////////////////////////////////////////////////////////////////////
+// OneShotSubmitter                                                      //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization
+//
+void OneShotSubmitter::init(vk::Device device, vk::Queue queue, uint32_t queueIdx)
+{
+    assert(!m_device && "OneShotSubmitter already initialized");
+    m_device = device;
+    m_queue = queue;
+    m_queueIdx = queueIdx;
+    m_nextTicket = 1;
+    m_completed = 0;
+    m_submitCount = 0;
+    m_recordCount = 0;
+}
+
+//-------------------------------------------------------------------------
+// Call on exit, pending work is submitted and waited for
+//
+void OneShotSubmitter::destroy()
+{
+    if (!m_device)
+        return;
+
+    flush();
+    retire(m_nextTicket, true);
+
+    for (auto& batch : m_free) {
+        VkObjects.onDestroy(batch.fence);
+        m_device.destroyFence(batch.fence);
+        VkObjects.onDestroy(batch.pool);
+        m_device.destroyCommandPool(batch.pool);
+    }
+    m_free.clear();
+
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Recycled batch, or a new pool, buffer and fence
+//
+OneShotSubmitter::Batch OneShotSubmitter::acquireBatch()
+{
+    if (!m_free.empty()) {
+        Batch batch = m_free.back();
+        m_free.pop_back();
+        return batch;
+    }
+
+    vk::CommandPoolCreateInfo poolInfo = {};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+    poolInfo.queueFamilyIndex = m_queueIdx;
+
+    Batch batch;
+    try {
+        batch.pool = m_device.createCommandPool(poolInfo);
+        batch.cmdBuffer = m_device.allocateCommandBuffers({ batch.pool, vk::CommandBufferLevel::ePrimary, 1 })[0];
+        batch.fence = m_device.createFence({});
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create one shot command objects!");
+    }
+
+    VkObjects.onCreate(batch.pool, 0, "OneShotSubmitter");
+    VkObjects.onCreate(batch.fence, 0, "OneShotSubmitter");
+    return batch;
+}
+
+//-------------------------------------------------------------------------
+// Record into the open batch, opened on demand
+//
+OneShotSubmitter::Ticket OneShotSubmitter::submitOneShot(const RecordFn& record, bool wait)
+{
+    if (!m_recording) {
+        m_open = acquireBatch();
+        m_open.ticket = m_nextTicket;
+        m_open.cmdBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+        m_recording = true;
+    }
+
+    record(m_open.cmdBuffer);
+    m_recordCount++;
+
+    const Ticket ticket = m_open.ticket;
+    if (wait)
+        this->wait(ticket);
+    return ticket;
+}
+
+//-------------------------------------------------------------------------
+// One submit for everything recorded since the last flush
+//
+void OneShotSubmitter::flush()
+{
+    if (!m_recording)
+        return;
+
+    m_open.cmdBuffer.end();
+
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_open.cmdBuffer;
+
+    try {
+        m_queue.submit(submitInfo, m_open.fence);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to submit one shot command buffer!");
+    }
+
+    m_inFlight.push_back(m_open);
+    m_open = {};
+    m_recording = false;
+    m_nextTicket++;
+    m_submitCount++;
+}
+
+//-------------------------------------------------------------------------
+// Block on the fence of the ticket's batch
+//
+void OneShotSubmitter::wait(Ticket ticket)
+{
+    if (m_recording && ticket == m_open.ticket)
+        flush();
+    retire(ticket, true);
+}
+
+//-------------------------------------------------------------------------
+// Tickets complete in submission order
+//
+bool OneShotSubmitter::isComplete(Ticket ticket)
+{
+    retire(ticket, false);
+    return ticket <= m_completed;
+}
+
+//-------------------------------------------------------------------------
+// Completed batches go back to the free list
+//
+void OneShotSubmitter::update()
+{
+    retire(m_nextTicket, false);
+}
+
+//-------------------------------------------------------------------------
+// Reset pool and fence of each completed batch, oldest first
+//
+void OneShotSubmitter::retire(Ticket ticket, bool wait)
+{
+    while (!m_inFlight.empty() && m_inFlight.front().ticket <= ticket) {
+        Batch& batch = m_inFlight.front();
+
+        if (wait) {
+            while (m_device.waitForFences(batch.fence, VK_TRUE, 10000) == vk::Result::eTimeout) {}
+        }
+        else if (m_device.getFenceStatus(batch.fence) != vk::Result::eSuccess) {
+            return;
+        }
+
+        m_device.resetFences(batch.fence);
+        m_device.resetCommandPool(batch.pool, {});
+        m_completed = batch.ticket;
+
+        m_free.push_back(batch);
+        m_inFlight.pop_front();
+    }
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,146 @@
+/*
+ *
+ * Andrew Frost
+ * command_pools.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// FrameCommandPools                                                     //
+///////////////////////////////////////////////////////////////////////////
+// One transient command pool per frame in flight, reset wholesale with //
+// vkResetCommandPool once the frame's fence signaled, instead of one   //
+// reset per command buffer                                             //
+// - buffers stay allocated and are handed out again after a reset,    //
+//   allocate() returns them in the same order every frame             //
+///////////////////////////////////////////////////////////////////////////
+
+class FrameCommandPools
+{
+public:
+    FrameCommandPools(FrameCommandPools const&) = delete;
+    FrameCommandPools& operator=(FrameCommandPools const&) = delete;
+
+    FrameCommandPools() = default;
+    ~FrameCommandPools() { destroy(); }
+
+    void init(vk::Device device, uint32_t queueIdx, uint32_t frameCount);
+
+    void destroy();
+
+    // GPU work of the frame must be complete, its buffers return to the initial state
+    void reset(uint32_t frame);
+
+    // Next buffer of the frame, only allocated the first time
+    vk::CommandBuffer allocate(uint32_t frame, vk::CommandBufferLevel level = vk::CommandBufferLevel::ePrimary);
+
+    // Getting Methods
+    uint32_t getFrameCount() const { return static_cast<uint32_t>(m_frames.size()); }
+
+private:
+
+    struct Frame
+    {
+        vk::CommandPool                pool;
+        std::vector<vk::CommandBuffer> primaries;
+        std::vector<vk::CommandBuffer> secondaries;
+        uint32_t                       usedPrimaries{ 0 };
+        uint32_t                       usedSecondaries{ 0 };
+    };
+
+    vk::Device         m_device;
+    std::vector<Frame> m_frames;
+
+}; // class FrameCommandPools
+
+///////////////////////////////////////////////////////////////////////////
+// OneShotSubmitter                                                      //
+///////////////////////////////////////////////////////////////////////////
+// Setup work (layout transitions, small uploads) recorded into a shared //
+// batch, the batch goes out as one submit with a recycled fence        //
+// - submitOneShot() records, flush() submits, wait() blocks on a ticket //
+// - batches keep their pool and fence, update() recycles completed   //
+//   ones, nothing is created or destroyed in steady state              //
+///////////////////////////////////////////////////////////////////////////
+
+class OneShotSubmitter
+{
+public:
+    using Ticket = uint64_t;
+    using RecordFn = std::function<void(vk::CommandBuffer)>;
+
+    OneShotSubmitter(OneShotSubmitter const&) = delete;
+    OneShotSubmitter& operator=(OneShotSubmitter const&) = delete;
+
+    OneShotSubmitter() = default;
+    ~OneShotSubmitter() { destroy(); }
+
+    void init(vk::Device device, vk::Queue queue, uint32_t queueIdx);
+
+    // Waits for every batch
+    void destroy();
+
+    // Recorded into the open batch, wait flushes it and blocks until it completed
+    Ticket submitOneShot(const RecordFn& record, bool wait = false);
+
+    // Submit the open batch, if any
+    void flush();
+
+    // Flushes when the ticket is still in the open batch
+    void wait(Ticket ticket);
+
+    bool isComplete(Ticket ticket);
+
+    // Recycle completed batches, once per frame
+    void update();
+
+    // Getting Methods
+    uint32_t getSubmitCount()   const { return m_submitCount; }
+    uint32_t getRecordCount()   const { return m_recordCount; }
+    uint32_t getInFlightCount() const { return static_cast<uint32_t>(m_inFlight.size()); }
+
+private:
+
+    struct Batch
+    {
+        vk::CommandPool   pool;
+        vk::CommandBuffer cmdBuffer;
+        vk::Fence         fence;
+        Ticket            ticket{ 0 };
+    };
+
+    Batch acquireBatch();
+
+    // Retire in-flight batches up to ticket, blocking when wait is set
+    void retire(Ticket ticket, bool wait);
+
+    vk::Device         m_device;
+    vk::Queue          m_queue;
+    uint32_t           m_queueIdx{ 0 };
+
+    Batch              m_open;
+    bool               m_recording{ false };
+    std::deque<Batch>  m_inFlight;       // submission order
+    std::vector<Batch> m_free;
+
+    Ticket             m_nextTicket{ 1 };
+    Ticket             m_completed{ 0 };
+
+    uint32_t           m_submitCount{ 0 };
+    uint32_t           m_recordCount{ 0 };
+
+}; // class OneShotSubmitter
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,207 @@
+/*
+ *
+ * Andrew Frost
+ * command_state.cpp
+ * 2020
+ *
+ */
+
+#include <cassert>
+
+#include "command_state.hpp"
+#include "frame_capture.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// CommandState                                                          //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization, the extended entry points are only loaded when the
+// feature is enabled on the device and known to the headers
+//
+void CommandState::init(vk::Device device, bool extendedDynamicState)
+{
+    assert(!m_device && "CommandState already initialized");
+    m_device = device;
+    m_extendedDynamicState = false;
+
+#ifdef VK_EXT_extended_dynamic_state
+    if (extendedDynamicState) {
+        m_cmdSetCullMode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(device, "vkCmdSetCullModeEXT");
+        m_cmdSetFrontFace = (PFN_vkCmdSetFrontFaceEXT)vkGetDeviceProcAddr(device, "vkCmdSetFrontFaceEXT");
+        m_cmdSetPrimitiveTopology = (PFN_vkCmdSetPrimitiveTopologyEXT)vkGetDeviceProcAddr(
+            device, "vkCmdSetPrimitiveTopologyEXT");
+        m_cmdSetDepthTestEnable = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(
+            device, "vkCmdSetDepthTestEnableEXT");
+        m_cmdSetDepthWriteEnable = (PFN_vkCmdSetDepthWriteEnableEXT)vkGetDeviceProcAddr(
+            device, "vkCmdSetDepthWriteEnableEXT");
+        m_cmdSetDepthCompareOp = (PFN_vkCmdSetDepthCompareOpEXT)vkGetDeviceProcAddr(
+            device, "vkCmdSetDepthCompareOpEXT");
+
+        m_extendedDynamicState = m_cmdSetCullMode && m_cmdSetFrontFace && m_cmdSetPrimitiveTopology
+            && m_cmdSetDepthTestEnable && m_cmdSetDepthWriteEnable && m_cmdSetDepthCompareOp;
+    }
+#endif
+}
+
+//-------------------------------------------------------------------------
+// Call on exit
+//
+void CommandState::destroy()
+{
+    if (!m_device)
+        return;
+
+#ifdef VK_EXT_extended_dynamic_state
+    m_cmdSetCullMode = nullptr;
+    m_cmdSetFrontFace = nullptr;
+    m_cmdSetPrimitiveTopology = nullptr;
+    m_cmdSetDepthTestEnable = nullptr;
+    m_cmdSetDepthWriteEnable = nullptr;
+    m_cmdSetDepthCompareOp = nullptr;
+#endif
+    m_extendedDynamicState = false;
+
+    m_cmdBuffer = nullptr;
+    m_valid = 0;
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Start tracking a command buffer, after vk::CommandBuffer::begin
+//
+void CommandState::begin(vk::CommandBuffer cmdBuffer)
+{
+    m_cmdBuffer = cmdBuffer;
+    m_valid = 0;
+}
+
+//-------------------------------------------------------------------------
+// State changed behind the tracker
+//
+void CommandState::invalidate()
+{
+    m_valid = 0;
+}
+
+//-------------------------------------------------------------------------
+// Pipelines
+//
+void CommandState::bindPipeline(vk::PipelineBindPoint bindPoint, vk::Pipeline pipeline)
+{
+    if (capturing())
+        m_capture->bindPipeline(pipeline);
+
+    const bool compute = bindPoint == vk::PipelineBindPoint::eCompute;
+    if (update(compute ? eComputePipeline : eGraphicsPipeline, compute ? m_computePipeline : m_graphicsPipeline,
+        pipeline))
+        m_cmdBuffer.bindPipeline(bindPoint, pipeline);
+}
+
+//-------------------------------------------------------------------------
+// Viewport and scissor, dynamic in every PipelineVariants pipeline
+//
+void CommandState::setViewport(const vk::Viewport& viewport)
+{
+    if (capturing())
+        m_capture->setViewport(viewport);
+
+    if (update(eViewport, m_viewport, viewport))
+        m_cmdBuffer.setViewport(0, viewport);
+}
+
+void CommandState::setScissor(const vk::Rect2D& scissor)
+{
+    if (capturing())
+        m_capture->setScissor(scissor);
+
+    if (update(eScissor, m_scissor, scissor))
+        m_cmdBuffer.setScissor(0, scissor);
+}
+
+//-------------------------------------------------------------------------
+// Extended dynamic state, nothing to do when the pipeline bakes it
+//
+void CommandState::setCullMode(vk::CullModeFlags cullMode)
+{
+    if (capturing())
+        m_capture->setDynamicState(FrameTrace::DynamicState::eCullMode, static_cast<uint32_t>(cullMode));
+
+#ifdef VK_EXT_extended_dynamic_state
+    if (m_extendedDynamicState && update(eCullMode, m_cullMode, cullMode))
+        m_cmdSetCullMode(m_cmdBuffer, static_cast<VkCullModeFlags>(cullMode));
+#endif
+}
+
+void CommandState::setFrontFace(vk::FrontFace frontFace)
+{
+    if (capturing())
+        m_capture->setDynamicState(FrameTrace::DynamicState::eFrontFace, static_cast<uint32_t>(frontFace));
+
+#ifdef VK_EXT_extended_dynamic_state
+    if (m_extendedDynamicState && update(eFrontFace, m_frontFace, frontFace))
+        m_cmdSetFrontFace(m_cmdBuffer, static_cast<VkFrontFace>(frontFace));
+#endif
+}
+
+void CommandState::setPrimitiveTopology(vk::PrimitiveTopology topology)
+{
+    if (capturing())
+        m_capture->setDynamicState(FrameTrace::DynamicState::eTopology, static_cast<uint32_t>(topology));
+
+#ifdef VK_EXT_extended_dynamic_state
+    if (m_extendedDynamicState && update(eTopology, m_topology, topology))
+        m_cmdSetPrimitiveTopology(m_cmdBuffer, static_cast<VkPrimitiveTopology>(topology));
+#endif
+}
+
+void CommandState::setDepthState(bool test, bool write, vk::CompareOp compare)
+{
+    if (capturing())
+        m_capture->setDynamicState(FrameTrace::DynamicState::eDepth, test, write, static_cast<uint32_t>(compare));
+
+#ifdef VK_EXT_extended_dynamic_state
+    if (!m_extendedDynamicState)
+        return;
+
+    if (update(eDepthTest, m_depthTest, test))
+        m_cmdSetDepthTestEnable(m_cmdBuffer, test);
+    if (update(eDepthWrite, m_depthWrite, write))
+        m_cmdSetDepthWriteEnable(m_cmdBuffer, write);
+    if (update(eDepthCompare, m_depthCompare, compare))
+        m_cmdSetDepthCompareOp(m_cmdBuffer, static_cast<VkCompareOp>(compare));
+#endif
+}
+
+//-------------------------------------------------------------------------
+// Dynamic fields of a pipeline state
+//
+void CommandState::setFixedFunction(const GraphicsState& state)
+{
+    setCullMode(state.cullMode);
+    setFrontFace(state.frontFace);
+    setPrimitiveTopology(state.topology);
+    setDepthState(state.depthTest, state.depthWrite, state.depthCompare);
+}
+
+void CommandState::setFixedFunction(const PipelineStateDesc& desc)
+{
+    setCullMode(desc.cullMode);
+    setFrontFace(desc.frontFace);
+    setPrimitiveTopology(desc.topology);
+    setDepthState(desc.depthTest, desc.depthWrite, desc.depthCompare);
+}
+
+//-------------------------------------------------------------------------
+// One branch per call while no frame is captured
+//
+bool CommandState::capturing() const
+{
+    return m_capture && m_capture->isCapturing();
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,154 @@
+/*
+ *
+ * Andrew Frost
+ * command_state.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include "pipeline_variants.hpp"
+
+namespace vkb {
+namespace core {
+
+class FrameCapture;
+
+///////////////////////////////////////////////////////////////////////////
+// CommandState                                                          //
+///////////////////////////////////////////////////////////////////////////
+// Last bound pipelines and dynamic state of the command buffer being   //
+// recorded, calls that would not change anything are dropped           //
+// - begin() per command buffer, state is undefined at its start        //
+// - extended setters only issue with VK_EXT_extended_dynamic_state,   //
+//   without it the values are baked into the PipelineVariants pipeline //
+//   (also when the headers predate the extension, 1.2.145)            //
+// - pipelines bound outside the tracker, or built without the extended //
+//   dynamic states, must be followed by invalidate()                   //
+// - begin(nullptr) only tracks, nothing is recorded                    //
+// - with setCapture() every call is reported, redundant ones too, so   //
+//   a replay through a tracker skips the same calls                    //
+///////////////////////////////////////////////////////////////////////////
+
+class CommandState
+{
+public:
+    CommandState(CommandState const&) = delete;
+    CommandState& operator=(CommandState const&) = delete;
+
+    CommandState() = default;
+    ~CommandState() { destroy(); }
+
+    void init(vk::Device device, bool extendedDynamicState);
+
+    void destroy();
+
+    void setCapture(FrameCapture* capture) { m_capture = capture; }
+
+    void begin(vk::CommandBuffer cmdBuffer);
+
+    // Forget everything, the next call of each kind issues
+    void invalidate();
+
+    void bindPipeline(vk::PipelineBindPoint bindPoint, vk::Pipeline pipeline);
+
+    void setViewport(const vk::Viewport& viewport);
+
+    void setScissor(const vk::Rect2D& scissor);
+
+    // Extended Dynamic State
+    void setCullMode(vk::CullModeFlags cullMode);
+
+    void setFrontFace(vk::FrontFace frontFace);
+
+    void setPrimitiveTopology(vk::PrimitiveTopology topology);
+
+    void setDepthState(bool test, bool write, vk::CompareOp compare);
+
+    // Every extended field of a state, next to binding its pipeline
+    void setFixedFunction(const GraphicsState& state);
+
+    void setFixedFunction(const PipelineStateDesc& desc);
+
+    struct Stats
+    {
+        uint32_t issued{ 0 };
+        uint32_t skipped{ 0 };
+    };
+
+    void resetStats() { m_stats = {}; }
+
+    // Getting Methods
+    const Stats& getStats()               const { return m_stats; }
+    bool         isExtendedDynamicState() const { return m_extendedDynamicState; }
+
+private:
+
+    enum Valid : uint32_t
+    {
+        eGraphicsPipeline = 1 << 0,
+        eComputePipeline  = 1 << 1,
+        eViewport         = 1 << 2,
+        eScissor          = 1 << 3,
+        eCullMode         = 1 << 4,
+        eFrontFace        = 1 << 5,
+        eTopology         = 1 << 6,
+        eDepthTest        = 1 << 7,
+        eDepthWrite       = 1 << 8,
+        eDepthCompare     = 1 << 9,
+    };
+
+    // Capture attached and in a captured frame
+    bool capturing() const;
+
+    // True when the call must be recorded, value is then stored
+    template <typename T>
+    bool update(Valid bit, T& current, const T& value)
+    {
+        if ((m_valid & bit) && current == value) {
+            m_stats.skipped++;
+            return false;
+        }
+
+        current = value;
+        m_valid |= bit;
+        m_stats.issued++;
+        return static_cast<bool>(m_cmdBuffer);
+    }
+
+    vk::Device                        m_device;
+    vk::CommandBuffer                 m_cmdBuffer;
+    bool                              m_extendedDynamicState{ false };
+    FrameCapture*                     m_capture{ nullptr };
+
+    // VK_EXT_extended_dynamic_state, not exported by the loader
+#ifdef VK_EXT_extended_dynamic_state
+    PFN_vkCmdSetCullModeEXT           m_cmdSetCullMode{ nullptr };
+    PFN_vkCmdSetFrontFaceEXT          m_cmdSetFrontFace{ nullptr };
+    PFN_vkCmdSetPrimitiveTopologyEXT  m_cmdSetPrimitiveTopology{ nullptr };
+    PFN_vkCmdSetDepthTestEnableEXT    m_cmdSetDepthTestEnable{ nullptr };
+    PFN_vkCmdSetDepthWriteEnableEXT   m_cmdSetDepthWriteEnable{ nullptr };
+    PFN_vkCmdSetDepthCompareOpEXT     m_cmdSetDepthCompareOp{ nullptr };
+#endif
+
+    uint32_t                          m_valid{ 0 };
+    vk::Pipeline                      m_graphicsPipeline;
+    vk::Pipeline                      m_computePipeline;
+    vk::Viewport                      m_viewport;
+    vk::Rect2D                        m_scissor;
+    vk::CullModeFlags                 m_cullMode;
+    vk::FrontFace                     m_frontFace{ vk::FrontFace::eCounterClockwise };
+    vk::PrimitiveTopology             m_topology{ vk::PrimitiveTopology::eTriangleList };
+    bool                              m_depthTest{ false };
+    bool                              m_depthWrite{ false };
+    vk::CompareOp                     m_depthCompare{ vk::CompareOp::eNever };
+
+    Stats                             m_stats;
+
+}; // class CommandState
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
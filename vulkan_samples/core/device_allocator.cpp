@@ -0,0 +1,833 @@
+/*
+ *
+ * Andrew Frost
+ * device_allocator.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include "device_allocator.hpp"
+#include "memory_governor.hpp"
+#include "object_registry.hpp"
+#include "vk_utils.hpp"
+
+namespace vkb {
+namespace core {
+
+//-------------------------------------------------------------------------
+// Aspect covering every plane of format
+//
+static vk::ImageAspectFlags getAspectMask(vk::Format format)
+{
+    switch (format) {
+    case vk::Format::eD16Unorm:
+    case vk::Format::eX8D24UnormPack32:
+    case vk::Format::eD32Sfloat:
+        return vk::ImageAspectFlagBits::eDepth;
+    case vk::Format::eS8Uint:
+        return vk::ImageAspectFlagBits::eStencil;
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+        return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+    default:
+        return vk::ImageAspectFlagBits::eColor;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// RangeAllocator                                                        //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Whole block free
+//
+void RangeAllocator::init(vk::DeviceSize size)
+{
+    m_free.clear();
+    m_free[0] = size;
+    m_size = size;
+    m_used = 0;
+}
+
+//-------------------------------------------------------------------------
+// First fit, padding in front of the aligned offset stays free
+//
+bool RangeAllocator::allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset)
+{
+    alignment = std::max(alignment, vk::DeviceSize(1));
+
+    for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+        const vk::DeviceSize start = it->first;
+        const vk::DeviceSize end = it->first + it->second;
+        const vk::DeviceSize aligned = (start + alignment - 1) / alignment * alignment;
+        if (aligned + size > end)
+            continue;
+
+        m_free.erase(it);
+        if (aligned > start)
+            m_free[start] = aligned - start;
+        if (aligned + size < end)
+            m_free[aligned + size] = end - aligned - size;
+
+        m_used += size;
+        offset = aligned;
+        return true;
+    }
+
+    return false;
+}
+
+//-------------------------------------------------------------------------
+// Merge with the free ranges on either side
+//
+void RangeAllocator::free(vk::DeviceSize offset, vk::DeviceSize size)
+{
+    assert(m_used >= size && "freeing more than allocated");
+    m_used -= size;
+
+    auto next = m_free.lower_bound(offset);
+    if (next != m_free.end() && offset + size == next->first) {
+        size += next->second;
+        next = m_free.erase(next);
+    }
+
+    if (next != m_free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+
+    m_free[offset] = size;
+}
+
+vk::DeviceSize RangeAllocator::getLargestFree() const
+{
+    vk::DeviceSize largest = 0;
+    for (const auto& range : m_free)
+        largest = std::max(largest, range.second);
+    return largest;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// DeviceAllocator                                                       //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization of the pools and the defragmentation command objects
+//
+void DeviceAllocator::init(vk::Device device, vk::PhysicalDevice physicalDevice, vk::Queue queue,
+    uint32_t queueIdx, uint32_t framesInFlight, vk::DeviceSize blockSize)
+{
+    assert(!m_device && "DeviceAllocator already initialized");
+    m_device = device;
+    m_physicalDevice = physicalDevice;
+    m_queue = queue;
+    m_framesInFlight = framesInFlight;
+    m_blockSize = blockSize;
+
+    m_pools.resize(VK_MAX_MEMORY_TYPES * 2);
+
+    vk::CommandPoolCreateInfo poolInfo = {};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer
+        | vk::CommandPoolCreateFlagBits::eTransient;
+    poolInfo.queueFamilyIndex = queueIdx;
+
+    try {
+        m_commandPool = m_device.createCommandPool(poolInfo);
+        m_commandBuffer = m_device.allocateCommandBuffers(
+            { m_commandPool, vk::CommandBufferLevel::ePrimary, 1 })[0];
+        m_fence = m_device.createFence({});
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create defragmentation command objects!");
+    }
+    VkObjects.onCreate(m_commandPool, 0, "DeviceAllocator");
+    VkObjects.onCreate(m_fence, 0, "DeviceAllocator");
+}
+
+//-------------------------------------------------------------------------
+// Call on exit, after every owner has destroyed its resources
+//
+void DeviceAllocator::destroy()
+{
+    if (!m_device)
+        return;
+
+    // owners are gone, copies in flight are dropped
+    if (m_batchInFlight) {
+        while (m_device.waitForFences(m_fence, VK_TRUE, 10000) == vk::Result::eTimeout) {}
+        for (const auto& move : m_moves) {
+            VkObjects.onDestroy(move.image);
+            m_device.destroyImage(move.image);
+            VkObjects.onDestroy(move.buffer);
+            m_device.destroyBuffer(move.buffer);
+        }
+        m_moves.clear();
+        m_batchInFlight = false;
+    }
+    releaseRetired(true);
+
+    for (auto& allocation : m_allocations) {
+        if (!allocation.live)
+            continue;
+        VkObjects.onDestroy(allocation.image);
+        m_device.destroyImage(allocation.image);
+        VkObjects.onDestroy(allocation.buffer);
+        m_device.destroyBuffer(allocation.buffer);
+    }
+    m_allocations.clear();
+    m_freeIDs.clear();
+
+    for (auto& pool : m_pools) {
+        for (auto& block : pool.blocks) {
+            VkObjects.onDestroy(block.memory);
+            m_device.freeMemory(block.memory);
+        }
+    }
+    m_pools.clear();
+
+    VkObjects.onDestroy(m_fence);
+    m_device.destroyFence(m_fence);
+    m_device.freeCommandBuffers(m_commandPool, m_commandBuffer);
+    VkObjects.onDestroy(m_commandPool);
+    m_device.destroyCommandPool(m_commandPool);
+
+    m_sourcePool = ~0u;
+    m_sourceBlock = ~0u;
+    m_passActive = false;
+    m_reportPending = false;
+    m_dirty = false;
+    m_report = {};
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Image bound to a range of a block of the optimal pool
+//
+DeviceAllocator::AllocationID DeviceAllocator::createImage(const vk::ImageCreateInfo& info,
+    vk::MemoryPropertyFlags properties, vk::ImageLayout layout, vk::Image& image)
+{
+    assert(!info.pNext && info.sharingMode == vk::SharingMode::eExclusive && "image can not be recreated");
+
+    vk::ImageCreateInfo imageInfo = info;
+    imageInfo.usage |= vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;
+
+    try {
+        image = m_device.createImage(imageInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create image!");
+    }
+
+    const vk::MemoryRequirements memReqs = m_device.getImageMemoryRequirements(image);
+    VkObjects.onCreate(image, memReqs.size);
+    const uint32_t memoryType = findMemoryType(m_physicalDevice, memReqs.memoryTypeBits, properties);
+    const uint32_t pool = memoryType * 2 + (imageInfo.tiling == vk::ImageTiling::eOptimal ? 1 : 0);
+
+    AllocationID id;
+    try {
+        id = addAllocation(pool, memReqs);
+    }
+    catch (const std::runtime_error&) {
+        VkObjects.onDestroy(image);
+        m_device.destroyImage(image);
+        image = nullptr;
+        throw;
+    }
+
+    Allocation& allocation = m_allocations[id];
+    allocation.image = image;
+    allocation.imageInfo = imageInfo;
+    allocation.layout = layout;
+
+    m_device.bindImageMemory(image, m_pools[pool].blocks[allocation.block].memory, allocation.offset);
+
+    return id;
+}
+
+//-------------------------------------------------------------------------
+// Buffer bound to a range of a block of the linear pool
+//
+DeviceAllocator::AllocationID DeviceAllocator::createBuffer(const vk::BufferCreateInfo& info,
+    vk::MemoryPropertyFlags properties, vk::Buffer& buffer)
+{
+    assert(!info.pNext && info.sharingMode == vk::SharingMode::eExclusive && "buffer can not be recreated");
+
+    vk::BufferCreateInfo bufferInfo = info;
+    bufferInfo.usage |= vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+
+    try {
+        buffer = m_device.createBuffer(bufferInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create buffer!");
+    }
+
+    const vk::MemoryRequirements memReqs = m_device.getBufferMemoryRequirements(buffer);
+    VkObjects.onCreate(buffer, memReqs.size);
+    const uint32_t memoryType = findMemoryType(m_physicalDevice, memReqs.memoryTypeBits, properties);
+    const uint32_t pool = memoryType * 2;
+
+    AllocationID id;
+    try {
+        id = addAllocation(pool, memReqs);
+    }
+    catch (const std::runtime_error&) {
+        VkObjects.onDestroy(buffer);
+        m_device.destroyBuffer(buffer);
+        buffer = nullptr;
+        throw;
+    }
+
+    Allocation& allocation = m_allocations[id];
+    allocation.buffer = buffer;
+    allocation.bufferInfo = bufferInfo;
+
+    m_device.bindBufferMemory(buffer, m_pools[pool].blocks[allocation.block].memory, allocation.offset);
+
+    return id;
+}
+
+//-------------------------------------------------------------------------
+// Range for a new resource, pinned until the owner sets a move callback
+//
+DeviceAllocator::AllocationID DeviceAllocator::addAllocation(uint32_t pool, const vk::MemoryRequirements& memReqs)
+{
+    // stay out of the block being emptied
+    uint32_t block;
+    vk::DeviceSize offset;
+    allocateRange(pool, memReqs, pool == m_sourcePool ? m_sourceBlock : ~0u, true, block, offset);
+
+    AllocationID id;
+    if (!m_freeIDs.empty()) {
+        id = m_freeIDs.back();
+        m_freeIDs.pop_back();
+    }
+    else {
+        id = static_cast<AllocationID>(m_allocations.size());
+        m_allocations.emplace_back();
+    }
+
+    Allocation& allocation = m_allocations[id];
+    allocation = {};
+    allocation.pool = pool;
+    allocation.block = block;
+    allocation.offset = offset;
+    allocation.size = memReqs.size;
+    allocation.live = true;
+
+    Block& target = m_pools[pool].blocks[block];
+    target.allocationCount++;
+    target.pinnedCount++;
+
+    m_dirty = true;
+
+    return id;
+}
+
+//-------------------------------------------------------------------------
+// Owner is done with it. A resource being moved is released with its
+// copy once the batch has completed
+//
+void DeviceAllocator::destroyResource(AllocationID id)
+{
+    Allocation& allocation = m_allocations[id];
+    assert(allocation.live && !allocation.destroyed && "allocation already destroyed");
+
+    if (allocation.moving) {
+        allocation.destroyed = true;
+        return;
+    }
+
+    Block& block = m_pools[allocation.pool].blocks[allocation.block];
+    block.allocationCount--;
+    if (!allocation.onMove)
+        block.pinnedCount--;
+
+    VkObjects.onDestroy(allocation.image);
+    m_device.destroyImage(allocation.image);
+    VkObjects.onDestroy(allocation.buffer);
+    m_device.destroyBuffer(allocation.buffer);
+    freeRange(allocation.pool, allocation.block, allocation.offset, allocation.size);
+
+    allocation = {};
+    m_freeIDs.push_back(id);
+    m_dirty = true;
+}
+
+//-------------------------------------------------------------------------
+// Movable allocations are not counted as pinned in their block
+//
+void DeviceAllocator::setMoveCallback(AllocationID id, MoveFn onMove)
+{
+    Allocation& allocation = m_allocations[id];
+    Block& block = m_pools[allocation.pool].blocks[allocation.block];
+
+    if (allocation.onMove && !onMove)
+        block.pinnedCount++;
+    else if (!allocation.onMove && onMove)
+        block.pinnedCount--;
+
+    allocation.onMove = std::move(onMove);
+    m_dirty = true;
+}
+
+vk::DeviceMemory DeviceAllocator::getMemory(AllocationID id) const
+{
+    const Allocation& allocation = m_allocations[id];
+    return m_pools[allocation.pool].blocks[allocation.block].memory;
+}
+
+//-------------------------------------------------------------------------
+// Lowest offset in the first block with room. Defragmentation never
+// grows a pool, it only fills what is already there
+//
+bool DeviceAllocator::allocateRange(uint32_t pool, const vk::MemoryRequirements& memReqs, uint32_t exclude,
+    bool allowNewBlock, uint32_t& block, vk::DeviceSize& offset)
+{
+    std::vector<Block>& blocks = m_pools[pool].blocks;
+
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        if (i == exclude || !blocks[i].memory)
+            continue;
+        if (blocks[i].ranges.allocate(memReqs.size, memReqs.alignment, offset)) {
+            block = i;
+            return true;
+        }
+    }
+
+    if (!allowNewBlock)
+        return false;
+
+    // Reuse a freed slot so block indices stay stable
+    block = static_cast<uint32_t>(blocks.size());
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        if (!blocks[i].memory) {
+            block = i;
+            break;
+        }
+    }
+    if (block == blocks.size())
+        blocks.emplace_back();
+
+    vk::MemoryAllocateInfo memAllocInfo = {};
+    memAllocInfo.allocationSize = std::max(m_blockSize, memReqs.size);
+    memAllocInfo.memoryTypeIndex = pool / 2;
+
+    // Over budget the governor evicts first, the allocation may still fit
+    if (m_governor)
+        m_governor->reserve(memAllocInfo.memoryTypeIndex, memAllocInfo.allocationSize);
+
+    try {
+        blocks[block].memory = m_device.allocateMemory(memAllocInfo);
+    }
+    catch (vk::SystemError err) {
+        // Out of memory below the budget, evict the block size and retry
+        if (!m_governor || !m_governor->release(memAllocInfo.memoryTypeIndex, memAllocInfo.allocationSize))
+            throw std::runtime_error("failed to allocate device memory block!");
+
+        try {
+            blocks[block].memory = m_device.allocateMemory(memAllocInfo);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to allocate device memory block!");
+        }
+    }
+    VkObjects.onCreate(blocks[block].memory, memAllocInfo.allocationSize, "DeviceAllocator block");
+
+    blocks[block].ranges.init(memAllocInfo.allocationSize);
+    blocks[block].ranges.allocate(memReqs.size, memReqs.alignment, offset);
+
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// Empty blocks are given back, except the last default sized one of
+// a pool to avoid reallocating it on the next resource
+//
+void DeviceAllocator::freeRange(uint32_t pool, uint32_t block, vk::DeviceSize offset, vk::DeviceSize size)
+{
+    std::vector<Block>& blocks = m_pools[pool].blocks;
+    Block& target = blocks[block];
+
+    target.ranges.free(offset, size);
+    if (!target.ranges.isEmpty() || target.retiredCount)
+        return;
+
+    const bool last = std::count_if(blocks.begin(), blocks.end(), [](const Block& b) { return !!b.memory; }) == 1;
+    if (last && target.ranges.getSize() == m_blockSize)
+        return;
+
+    VkObjects.onDestroy(target.memory);
+    m_device.freeMemory(target.memory);
+    target = {};
+
+    if (pool == m_sourcePool && block == m_sourceBlock) {
+        m_sourcePool = ~0u;
+        m_sourceBlock = ~0u;
+    }
+}
+
+//-------------------------------------------------------------------------
+// Whole pool statistics
+//
+DeviceAllocator::Stats DeviceAllocator::getStats() const
+{
+    Stats stats;
+    vk::DeviceSize freeBytes = 0;
+
+    for (const auto& pool : m_pools) {
+        for (const auto& block : pool.blocks) {
+            if (!block.memory)
+                continue;
+            stats.blockCount++;
+            stats.reservedBytes += block.ranges.getSize();
+            stats.usedBytes += block.ranges.getUsed();
+            stats.largestFreeRange = std::max(stats.largestFreeRange, block.ranges.getLargestFree());
+            stats.freeRangeCount += block.ranges.getFreeRangeCount();
+            freeBytes += block.ranges.getFree();
+        }
+    }
+
+    if (freeBytes)
+        stats.fragmentation = 1.f - static_cast<float>(stats.largestFreeRange) / freeBytes;
+
+    return stats;
+}
+
+//-------------------------------------------------------------------------
+// Per frame
+// - completed moves are handed to their owners
+// - ranges of old resources are freed after the frames in flight
+// - the next moves are recorded and submitted
+//
+void DeviceAllocator::update()
+{
+    m_frame++;
+
+    if (m_batchInFlight) {
+        if (m_device.getFenceStatus(m_fence) != vk::Result::eSuccess) {
+            releaseRetired(false);
+            return;
+        }
+        finishMoves();
+    }
+
+    releaseRetired(false);
+
+    if (m_reportPending && m_retired.empty()) {
+        m_report.after = getStats();
+        m_reportPending = false;
+    }
+
+    if (m_defragBudget && !m_reportPending && (m_passActive || m_dirty))
+        defragment();
+}
+
+//-------------------------------------------------------------------------
+// Block to empty, the least used one whose allocations can all move and
+// whose contents fit in the free space of the rest of its pool
+//
+bool DeviceAllocator::pickSource()
+{
+    // keep going with the current block until it is empty
+    if (m_sourceBlock != ~0u) {
+        const Block& block = m_pools[m_sourcePool].blocks[m_sourceBlock];
+        if (block.memory && block.allocationCount && !block.pinnedCount)
+            return true;
+    }
+
+    m_sourcePool = ~0u;
+    m_sourceBlock = ~0u;
+    vk::DeviceSize lowest = ~0ull;
+
+    for (uint32_t p = 0; p < m_pools.size(); p++) {
+        const std::vector<Block>& blocks = m_pools[p].blocks;
+
+        vk::DeviceSize poolFree = 0;
+        for (const auto& block : blocks)
+            poolFree += block.memory ? block.ranges.getFree() : 0;
+
+        for (uint32_t b = 0; b < blocks.size(); b++) {
+            const Block& block = blocks[b];
+            if (!block.memory || !block.allocationCount || block.pinnedCount || block.retiredCount)
+                continue;
+
+            const vk::DeviceSize used = block.ranges.getUsed();
+            if (used < lowest && used <= poolFree - block.ranges.getFree()) {
+                lowest = used;
+                m_sourcePool = p;
+                m_sourceBlock = b;
+            }
+        }
+    }
+
+    return m_sourceBlock != ~0u;
+}
+
+//-------------------------------------------------------------------------
+// Record moves out of the source block, bounded by the defrag budget.
+// A pass ends when no block can be emptied, its after statistics are
+// taken once the retired ranges are gone
+//
+void DeviceAllocator::defragment()
+{
+    if (!pickSource()) {
+        if (m_passActive) {
+            m_passActive = false;
+            m_reportPending = true;
+        }
+        m_dirty = false;
+        return;
+    }
+
+    if (!m_passActive) {
+        const uint32_t passCount = m_report.passCount;
+        m_report = {};
+        m_report.before = getStats();
+        m_report.passCount = passCount + 1;
+        m_passActive = true;
+    }
+
+    vk::DeviceSize recorded = 0;
+    for (AllocationID id = 0; id < m_allocations.size() && recorded < m_defragBudget; id++) {
+        const Allocation& allocation = m_allocations[id];
+        if (!allocation.live || allocation.moving
+            || allocation.pool != m_sourcePool || allocation.block != m_sourceBlock)
+            continue;
+
+        if (!recordMove(id))
+            break;
+        recorded += allocation.size;
+    }
+
+    // nothing fits elsewhere, give up on this block
+    if (m_moves.empty()) {
+        m_sourcePool = ~0u;
+        m_sourceBlock = ~0u;
+        m_passActive = false;
+        m_reportPending = true;
+        m_dirty = false;
+        return;
+    }
+
+    m_commandBuffer.end();
+
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_commandBuffer;
+
+    try {
+        m_queue.submit(submitInfo, m_fence);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to submit defragmentation command buffer!");
+    }
+
+    m_batchInFlight = true;
+}
+
+//-------------------------------------------------------------------------
+// Same resource in another block and a copy of its contents. The source
+// stays readable by frames in flight, it is only transitioned inside
+// this command buffer
+//
+bool DeviceAllocator::recordMove(AllocationID id)
+{
+    Allocation& allocation = m_allocations[id];
+
+    Move move = {};
+    move.id = id;
+
+    vk::MemoryRequirements memReqs;
+    try {
+        if (allocation.image) {
+            move.image = m_device.createImage(allocation.imageInfo);
+            memReqs = m_device.getImageMemoryRequirements(move.image);
+        }
+        else {
+            move.buffer = m_device.createBuffer(allocation.bufferInfo);
+            memReqs = m_device.getBufferMemoryRequirements(move.buffer);
+        }
+    }
+    catch (vk::SystemError err) {
+        return false;
+    }
+    VkObjects.onCreate(move.image, memReqs.size);
+    VkObjects.onCreate(move.buffer, memReqs.size);
+
+    if (!allocateRange(allocation.pool, memReqs, m_sourceBlock, false, move.block, move.offset)) {
+        VkObjects.onDestroy(move.image);
+        m_device.destroyImage(move.image);
+        VkObjects.onDestroy(move.buffer);
+        m_device.destroyBuffer(move.buffer);
+        return false;
+    }
+    move.size = memReqs.size;
+
+    const vk::DeviceMemory memory = m_pools[allocation.pool].blocks[move.block].memory;
+    if (move.image)
+        m_device.bindImageMemory(move.image, memory, move.offset);
+    else
+        m_device.bindBufferMemory(move.buffer, memory, move.offset);
+
+    if (m_moves.empty())
+        m_commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+    if (move.image) {
+        const vk::ImageCreateInfo& info = allocation.imageInfo;
+        const vk::ImageAspectFlags aspect = getAspectMask(info.format);
+        const vk::ImageSubresourceRange range = { aspect, 0, info.mipLevels, 0, info.arrayLayers };
+
+        std::array<vk::ImageMemoryBarrier, 2> barriers;
+        barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].image = allocation.image;
+        barriers[0].subresourceRange = range;
+        barriers[0].oldLayout = allocation.layout;
+        barriers[0].newLayout = vk::ImageLayout::eTransferSrcOptimal;
+        barriers[0].srcAccessMask = vk::AccessFlagBits::eMemoryWrite;
+        barriers[0].dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
+        barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[1].image = move.image;
+        barriers[1].subresourceRange = range;
+        barriers[1].oldLayout = vk::ImageLayout::eUndefined;
+        barriers[1].newLayout = vk::ImageLayout::eTransferDstOptimal;
+        barriers[1].dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+        m_commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+            vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, barriers);
+
+        std::vector<vk::ImageCopy> regions(info.mipLevels);
+        for (uint32_t mip = 0; mip < info.mipLevels; mip++) {
+            regions[mip].srcSubresource = { aspect, mip, 0, info.arrayLayers };
+            regions[mip].dstSubresource = { aspect, mip, 0, info.arrayLayers };
+            regions[mip].extent = vk::Extent3D(std::max(info.extent.width >> mip, 1u),
+                std::max(info.extent.height >> mip, 1u), std::max(info.extent.depth >> mip, 1u));
+        }
+        m_commandBuffer.copyImage(allocation.image, vk::ImageLayout::eTransferSrcOptimal,
+            move.image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+        // both back to the layout users expect
+        barriers[0].oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+        barriers[0].newLayout = allocation.layout;
+        barriers[0].srcAccessMask = vk::AccessFlagBits::eTransferRead;
+        barriers[0].dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+
+        barriers[1].oldLayout = vk::ImageLayout::eTransferDstOptimal;
+        barriers[1].newLayout = allocation.layout;
+        barriers[1].srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barriers[1].dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+
+        m_commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eAllCommands, {}, nullptr, nullptr, barriers);
+    }
+    else {
+        vk::MemoryBarrier barrier = {};
+        barrier.srcAccessMask = vk::AccessFlagBits::eMemoryWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+        m_commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+            vk::PipelineStageFlagBits::eTransfer, {}, barrier, nullptr, nullptr);
+
+        m_commandBuffer.copyBuffer(allocation.buffer, move.buffer, vk::BufferCopy(0, 0, allocation.bufferInfo.size));
+
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+        m_commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eAllCommands, {}, barrier, nullptr, nullptr);
+    }
+
+    m_pools[allocation.pool].blocks[move.block].allocationCount++;
+    allocation.moving = true;
+    m_moves.push_back(move);
+
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// Batch has completed, swap in the new resources and tell their owners
+//
+void DeviceAllocator::finishMoves()
+{
+    for (const auto& move : m_moves) {
+        Allocation& allocation = m_allocations[move.id];
+        Block& oldBlock = m_pools[allocation.pool].blocks[allocation.block];
+        Block& newBlock = m_pools[allocation.pool].blocks[move.block];
+
+        // old resource may still be in use by frames in flight
+        m_retired.push_back({ allocation.image, allocation.buffer, allocation.pool, allocation.block,
+            allocation.offset, allocation.size, m_frame });
+        oldBlock.allocationCount--;
+        oldBlock.retiredCount++;
+
+        // pinned by its owner while the copy was in flight
+        if (!allocation.onMove) {
+            oldBlock.pinnedCount--;
+            newBlock.pinnedCount++;
+        }
+
+        allocation.image = move.image;
+        allocation.buffer = move.buffer;
+        allocation.block = move.block;
+        allocation.offset = move.offset;
+        allocation.size = move.size;
+        allocation.moving = false;
+
+        m_report.moveCount++;
+        m_report.movedBytes += move.size;
+
+        if (allocation.destroyed) {
+            m_retired.push_back({ allocation.image, allocation.buffer, allocation.pool, allocation.block,
+                allocation.offset, allocation.size, m_frame });
+            newBlock.allocationCount--;
+            newBlock.retiredCount++;
+            if (!allocation.onMove)
+                newBlock.pinnedCount--;
+
+            allocation = {};
+            m_freeIDs.push_back(move.id);
+            continue;
+        }
+
+        if (allocation.onMove)
+            allocation.onMove(move.id);
+    }
+
+    m_moves.clear();
+    m_batchInFlight = false;
+    m_device.resetFences(m_fence);
+}
+
+//-------------------------------------------------------------------------
+// Destroy old resources no longer referenced by frames in flight
+//
+void DeviceAllocator::releaseRetired(bool all)
+{
+    auto it = m_retired.begin();
+    while (it != m_retired.end()) {
+        if (all || it->frame + m_framesInFlight < m_frame) {
+            VkObjects.onDestroy(it->image);
+            m_device.destroyImage(it->image);
+            VkObjects.onDestroy(it->buffer);
+            m_device.destroyBuffer(it->buffer);
+            m_pools[it->pool].blocks[it->block].retiredCount--;
+            freeRange(it->pool, it->block, it->offset, it->size);
+            it = m_retired.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,246 @@
+/*
+ *
+ * Andrew Frost
+ * device_allocator.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace vkb {
+namespace core {
+
+class MemoryGovernor;
+
+///////////////////////////////////////////////////////////////////////////
+// RangeAllocator                                                        //
+///////////////////////////////////////////////////////////////////////////
+// Offsets inside one memory block. Free ranges are kept by offset and  //
+// merged with their neighbours, allocations take the lowest offset    //
+// that fits so live data stays packed at the start of a block         //
+///////////////////////////////////////////////////////////////////////////
+
+class RangeAllocator
+{
+public:
+
+    void init(vk::DeviceSize size);
+
+    // False when no free range fits size at alignment
+    bool allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset);
+
+    void free(vk::DeviceSize offset, vk::DeviceSize size);
+
+    // Getting Methods
+    vk::DeviceSize getSize()           const { return m_size; }
+    vk::DeviceSize getUsed()           const { return m_used; }
+    vk::DeviceSize getFree()           const { return m_size - m_used; }
+    vk::DeviceSize getLargestFree()    const;
+    uint32_t       getFreeRangeCount() const { return static_cast<uint32_t>(m_free.size()); }
+    bool           isEmpty()           const { return m_used == 0; }
+
+private:
+
+    std::map<vk::DeviceSize, vk::DeviceSize> m_free;      // offset to size, never adjacent
+    vk::DeviceSize                           m_size{ 0 };
+    vk::DeviceSize                           m_used{ 0 };  // allocated sizes, padding stays in m_free
+
+}; // class RangeAllocator
+
+///////////////////////////////////////////////////////////////////////////
+// DeviceAllocator                                                       //
+///////////////////////////////////////////////////////////////////////////
+// Device local buffers and images sub-allocated from large blocks,     //
+// one set of blocks per memory type and per linear/optimal kind so    //
+// bufferImageGranularity never applies                                 //
+// Resources with a move callback may be relocated by the incremental  //
+// defragmenter                                                         //
+// - the least used block is emptied into the others, at most          //
+//   the defrag budget in bytes per frame                               //
+// - copies are recorded on the given queue, the old resource is kept   //
+//   for the frames in flight after the owner has been told            //
+// - a block is freed once nothing in it is live or retired            //
+// - with setMemoryGovernor() new blocks reserve their size first and  //
+//   a failed block allocation is retried once after eviction          //
+///////////////////////////////////////////////////////////////////////////
+
+class DeviceAllocator
+{
+public:
+    using AllocationID = uint32_t;
+
+    // Called once the copy has completed, getImage/getBuffer return the new
+    // handle. Views and descriptors of the old one stay valid for the frames
+    // in flight
+    using MoveFn = std::function<void(AllocationID id)>;
+
+    struct Stats
+    {
+        uint32_t       blockCount{ 0 };
+        vk::DeviceSize reservedBytes{ 0 };        // sum of block sizes
+        vk::DeviceSize usedBytes{ 0 };
+        vk::DeviceSize largestFreeRange{ 0 };
+        uint32_t       freeRangeCount{ 0 };
+        float          fragmentation{ 0.f };       // 1 - largest free range / free bytes
+    };
+
+    struct DefragReport
+    {
+        Stats          before;                     // when the last pass started
+        Stats          after;                      // once its retired ranges were freed
+        uint32_t       moveCount{ 0 };
+        vk::DeviceSize movedBytes{ 0 };
+        uint32_t       passCount{ 0 };
+    };
+
+    DeviceAllocator(DeviceAllocator const&) = delete;
+    DeviceAllocator& operator=(DeviceAllocator const&) = delete;
+
+    DeviceAllocator() = default;
+    ~DeviceAllocator() { destroy(); }
+
+    void init(vk::Device device, vk::PhysicalDevice physicalDevice, vk::Queue queue, uint32_t queueIdx,
+        uint32_t framesInFlight, vk::DeviceSize blockSize = 64ull << 20);
+
+    void destroy();
+
+    // Create and bind, transfer usage is added so the resource can be moved.
+    // Images are expected in layout whenever they are not being written
+    AllocationID createImage(const vk::ImageCreateInfo& info, vk::MemoryPropertyFlags properties,
+        vk::ImageLayout layout, vk::Image& image);
+    AllocationID createBuffer(const vk::BufferCreateInfo& info, vk::MemoryPropertyFlags properties,
+        vk::Buffer& buffer);
+
+    // Destroy the resource and free its range, the GPU must be done with it
+    void destroyResource(AllocationID id);
+
+    // Allow moves once the contents are final, nullptr pins the allocation again
+    void setMoveCallback(AllocationID id, MoveFn onMove);
+
+    // Finish completed moves and record new ones, once per frame
+    void update();
+
+    // Swapchain rebuilt with another image count, frees are deferred by it
+    void setFramesInFlight(uint32_t framesInFlight) { m_framesInFlight = framesInFlight; }
+
+    // Bytes copied per frame, 0 disables defragmentation
+    void setDefragBudget(vk::DeviceSize bytes) { m_defragBudget = bytes; }
+
+    // Evicts through the governor before new blocks, nullptr disables it
+    void setMemoryGovernor(MemoryGovernor* governor) { m_governor = governor; }
+
+    Stats getStats() const;
+
+    // Getting Methods
+    vk::Image           getImage(AllocationID id)  const { return m_allocations[id].image; }
+    vk::Buffer          getBuffer(AllocationID id) const { return m_allocations[id].buffer; }
+    vk::DeviceMemory    getMemory(AllocationID id) const;
+    vk::DeviceSize      getOffset(AllocationID id) const { return m_allocations[id].offset; }
+    vk::DeviceSize      getSize(AllocationID id)   const { return m_allocations[id].size; }
+    bool                isMoving(AllocationID id)  const { return m_allocations[id].moving; }
+    const DefragReport& getDefragReport()          const { return m_report; }
+
+private:
+
+    struct Allocation
+    {
+        vk::Image            image;
+        vk::Buffer           buffer;
+        vk::ImageCreateInfo  imageInfo;
+        vk::BufferCreateInfo bufferInfo;
+        vk::ImageLayout      layout{ vk::ImageLayout::eUndefined };
+        uint32_t             pool{ 0 };
+        uint32_t             block{ 0 };
+        vk::DeviceSize       offset{ 0 };
+        vk::DeviceSize       size{ 0 };
+        MoveFn               onMove;
+        bool                 live{ false };
+        bool                 moving{ false };
+        bool                 destroyed{ false };     // while moving, released when the copy is done
+    };
+
+    struct Block
+    {
+        vk::DeviceMemory     memory;
+        RangeAllocator       ranges;
+        uint32_t             allocationCount{ 0 };
+        uint32_t             pinnedCount{ 0 };       // allocations without a move callback
+        uint32_t             retiredCount{ 0 };
+    };
+
+    struct Pool
+    {
+        std::vector<Block>   blocks;                 // freed blocks have no memory
+    };
+
+    struct Move
+    {
+        AllocationID         id;
+        vk::Image            image;
+        vk::Buffer           buffer;
+        uint32_t             block;
+        vk::DeviceSize       offset;
+        vk::DeviceSize       size;
+    };
+
+    struct Retired
+    {
+        vk::Image            image;
+        vk::Buffer           buffer;
+        uint32_t             pool;
+        uint32_t             block;
+        vk::DeviceSize       offset;
+        vk::DeviceSize       size;
+        uint64_t             frame;
+    };
+
+    AllocationID addAllocation(uint32_t pool, const vk::MemoryRequirements& memReqs);
+
+    // Range in any block of pool but exclude, a new block only if allowed
+    bool allocateRange(uint32_t pool, const vk::MemoryRequirements& memReqs, uint32_t exclude, bool allowNewBlock,
+        uint32_t& block, vk::DeviceSize& offset);
+    void freeRange(uint32_t pool, uint32_t block, vk::DeviceSize offset, vk::DeviceSize size);
+
+    bool pickSource();
+    void defragment();
+    bool recordMove(AllocationID id);
+    void finishMoves();
+    void releaseRetired(bool all);
+
+    vk::Device                m_device;
+    vk::PhysicalDevice        m_physicalDevice;
+    vk::Queue                 m_queue;
+    uint32_t                  m_framesInFlight{ 2 };
+    vk::DeviceSize            m_blockSize{ 64ull << 20 };
+    MemoryGovernor*           m_governor{ nullptr };
+
+    std::vector<Pool>         m_pools;               // memory type * 2 + optimal
+    std::vector<Allocation>   m_allocations;
+    std::vector<AllocationID> m_freeIDs;
+
+    // Defragmentation
+    vk::CommandPool           m_commandPool;
+    vk::CommandBuffer         m_commandBuffer;
+    vk::Fence                 m_fence;
+    std::vector<Move>         m_moves;               // recorded in the batch in flight
+    std::vector<Retired>      m_retired;
+    vk::DeviceSize            m_defragBudget{ 16ull << 20 };
+    uint32_t                  m_sourcePool{ ~0u };
+    uint32_t                  m_sourceBlock{ ~0u };
+    bool                      m_batchInFlight{ false };
+    bool                      m_passActive{ false };
+    bool                      m_reportPending{ false };
+    bool                      m_dirty{ false };      // allocations changed since the last pass
+    DefragReport              m_report;
+    uint64_t                  m_frame{ 0 };
+
+}; // class DeviceAllocator
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
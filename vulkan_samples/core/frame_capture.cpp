@@ -0,0 +1,747 @@
+/*
+ *
+ * Andrew Frost
+ * frame_capture.cpp
+ * 2020
+ *
+ */
+
+#include <cstring>
+#include <fstream>
+
+#include "frame_capture.hpp"
+
+namespace vkb {
+namespace core {
+
+struct CaptureHeader
+{
+    uint32_t magic{ FrameTrace::MAGIC };
+    uint32_t version{ FrameTrace::VERSION };
+    float    frameMs{ 0.f };
+    uint32_t bufferCount{ 0 };
+    uint32_t imageCount{ 0 };
+    uint32_t shaderCount{ 0 };
+    uint32_t programCount{ 0 };
+    uint32_t pipelineCount{ 0 };
+    uint32_t passCount{ 0 };
+    uint32_t commandCount{ 0 };
+    uint64_t dataSize{ 0 };
+};
+
+template <typename T>
+static void writeArray(std::ofstream& file, const std::vector<T>& values)
+{
+    if (!values.empty())
+        file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template <typename T>
+static void readArray(std::ifstream& file, std::vector<T>& values, uint64_t count)
+{
+    values.resize(static_cast<size_t>(count));
+    if (!values.empty())
+        file.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(T));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// FrameTrace                                                            //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Header, then every table in declaration order
+//
+void FrameTrace::save(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open frame capture: " + path);
+
+    CaptureHeader header;
+    header.frameMs = frameMs;
+    header.bufferCount = static_cast<uint32_t>(buffers.size());
+    header.imageCount = static_cast<uint32_t>(images.size());
+    header.shaderCount = static_cast<uint32_t>(shaders.size());
+    header.programCount = static_cast<uint32_t>(programs.size());
+    header.pipelineCount = static_cast<uint32_t>(pipelines.size());
+    header.passCount = static_cast<uint32_t>(passes.size());
+    header.commandCount = static_cast<uint32_t>(commands.size());
+    header.dataSize = data.size();
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(file, buffers);
+    writeArray(file, images);
+    writeArray(file, shaders);
+    writeArray(file, programs);
+    writeArray(file, pipelines);
+    writeArray(file, passes);
+    writeArray(file, commands);
+    writeArray(file, data);
+
+    if (!file.good())
+        throw std::runtime_error("failed to write frame capture: " + path);
+}
+
+//-------------------------------------------------------------------------
+// Read back what save wrote
+//
+void FrameTrace::load(const std::string& path)
+{
+    clear();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open frame capture: " + path);
+
+    CaptureHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file.good() || header.magic != MAGIC)
+        throw std::runtime_error("not a frame capture: " + path);
+    if (header.version != VERSION)
+        throw std::runtime_error("frame capture of another version: " + path);
+
+    frameMs = header.frameMs;
+    readArray(file, buffers, header.bufferCount);
+    readArray(file, images, header.imageCount);
+    readArray(file, shaders, header.shaderCount);
+    readArray(file, programs, header.programCount);
+    readArray(file, pipelines, header.pipelineCount);
+    readArray(file, passes, header.passCount);
+    readArray(file, commands, header.commandCount);
+    readArray(file, data, header.dataSize);
+
+    if (!file.good() || !validate()) {
+        clear();
+        throw std::runtime_error("damaged frame capture: " + path);
+    }
+}
+
+//-------------------------------------------------------------------------
+// Release everything
+//
+void FrameTrace::clear()
+{
+    frameMs = 0.f;
+    buffers.clear();
+    images.clear();
+    shaders.clear();
+    programs.clear();
+    pipelines.clear();
+    passes.clear();
+    commands.clear();
+    data.clear();
+}
+
+//-------------------------------------------------------------------------
+// Table indices and data ranges in bounds
+//
+bool FrameTrace::validate() const
+{
+    auto inData = [this](uint64_t offset, uint64_t size) {
+        return offset <= data.size() && size <= data.size() - offset;
+    };
+
+    for (const auto& buffer : buffers)
+        if (!inData(buffer.dataOffset, buffer.dataSize) || buffer.dataSize > buffer.size)
+            return false;
+
+    for (const auto& shader : shaders)
+        if (!inData(shader.dataOffset, shader.dataSize) || shader.dataSize % sizeof(uint32_t) != 0)
+            return false;
+
+    for (const auto& program : programs) {
+        if (program.stageCount == 0 || program.stageCount > MaxStages)
+            return false;
+        for (uint32_t i = 0; i < program.stageCount; i++)
+            if (program.stages[i] >= shaders.size())
+                return false;
+    }
+
+    for (const auto& pipeline : pipelines)
+        if (pipeline.program >= programs.size() || pipeline.desc.bindingCount > PipelineStateDesc::MaxBindings
+            || pipeline.desc.attributeCount > PipelineStateDesc::MaxAttributes
+            || pipeline.desc.constantCount > PipelineStateDesc::MaxConstants)
+            return false;
+
+    for (const auto& pass : passes) {
+        if (pass.colorCount > MaxColorAttachments || (pass.depth != NONE && pass.depth >= images.size()))
+            return false;
+        for (uint32_t i = 0; i < pass.colorCount; i++)
+            if (pass.colors[i] >= images.size())
+                return false;
+    }
+
+    for (const auto& command : commands) {
+        switch (command.op) {
+        case Op::eUpload:
+            if (command.args[0] >= buffers.size() || command.offset > buffers[command.args[0]].size
+                || command.size > buffers[command.args[0]].size - command.offset
+                || (command.args[3] && !inData(unpackWide(&command.args[1]), command.size)))
+                return false;
+            break;
+        case Op::eBeginPass:
+            if (command.args[0] >= passes.size())
+                return false;
+            break;
+        case Op::eBindPipeline:
+            if (command.args[0] >= pipelines.size())
+                return false;
+            break;
+        case Op::eBindVertexBuffer:
+            if (command.args[1] >= buffers.size())
+                return false;
+            break;
+        case Op::eBindIndexBuffer:
+            if (command.args[0] >= buffers.size())
+                return false;
+            break;
+        case Op::ePushConstants:
+            if (!inData(unpackWide(&command.args[2]), command.size))
+                return false;
+            break;
+        case Op::eEndPass:
+        case Op::eViewport:
+        case Op::eScissor:
+        case Op::eDynamicState:
+        case Op::eDraw:
+        case Op::eDrawIndexed:
+        case Op::eDispatch:
+        case Op::eBarrier:
+            break;
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// FrameCapture                                                          //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Arm the next frame
+//
+void FrameCapture::request(const std::string& path)
+{
+    m_path = path;
+}
+
+//-------------------------------------------------------------------------
+// Every frame, the interval is kept so paced replays match the capture
+//
+void FrameCapture::beginFrame()
+{
+    const auto now = std::chrono::high_resolution_clock::now();
+    if (m_lastFrame.time_since_epoch().count() != 0)
+        m_frameMs = std::chrono::duration<float, std::milli>(now - m_lastFrame).count();
+    m_lastFrame = now;
+
+    if (m_path.empty() || m_capturing)
+        return;
+
+    m_trace.clear();
+    m_trace.frameMs = m_frameMs;
+    m_buffers.clear();
+    m_images.clear();
+    m_pipelines.clear();
+    m_shaders.clear();
+    m_programs.clear();
+
+    m_capturing = true;
+    m_inPass = false;
+    m_passSkipped = false;
+    m_pipelineBound = false;
+    m_stats.skipped = 0;
+}
+
+//-------------------------------------------------------------------------
+// Write the captured frame and release it
+//
+bool FrameCapture::endFrame()
+{
+    if (!m_capturing)
+        return false;
+
+    m_capturing = false;
+    m_lastPath = m_path;
+    m_path.clear();
+
+    m_stats.frames++;
+    m_stats.commands = static_cast<uint32_t>(m_trace.commands.size());
+    m_stats.bytes = sizeof(CaptureHeader) + m_trace.buffers.size() * sizeof(FrameTrace::Buffer)
+        + m_trace.images.size() * sizeof(FrameTrace::Image) + m_trace.shaders.size() * sizeof(FrameTrace::Shader)
+        + m_trace.programs.size() * sizeof(FrameTrace::Program)
+        + m_trace.pipelines.size() * sizeof(FrameTrace::Pipeline) + m_trace.passes.size() * sizeof(FrameTrace::Pass)
+        + m_trace.commands.size() * sizeof(FrameTrace::Command) + m_trace.data.size();
+
+    FrameTrace trace;
+    std::swap(trace, m_trace);
+    trace.save(m_lastPath);
+
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// Fixed function state as a PipelineStateDesc, a state that does not fit
+// is left undescribed and its binds are skipped
+//
+void FrameCapture::describeGraphics(vk::Pipeline pipeline, const ShaderProgram& program, const GraphicsState& state,
+    const std::vector<uint32_t>& constants)
+{
+    if (state.vertexBindings.size() > PipelineStateDesc::MaxBindings
+        || state.vertexAttributes.size() > PipelineStateDesc::MaxAttributes
+        || constants.size() > PipelineStateDesc::MaxConstants) {
+        m_descriptions.erase(handleOf(pipeline));
+        return;
+    }
+
+    Description& description = m_descriptions[handleOf(pipeline)];
+    description.programHash = program.hash;
+    description.compute = false;
+
+    PipelineStateDesc& desc = description.desc;
+    desc = PipelineStateDesc();
+    desc.colorAttachmentCount = state.colorAttachmentCount;
+    desc.samples = state.samples;
+    desc.topology = state.topology;
+    desc.polygonMode = state.polygonMode;
+    desc.cullMode = static_cast<vk::CullModeFlagBits>(static_cast<uint32_t>(state.cullMode));
+    desc.frontFace = state.frontFace;
+    desc.depthTest = state.depthTest;
+    desc.depthWrite = state.depthWrite;
+    desc.depthCompare = state.depthCompare;
+    desc.blend = state.blend;
+
+    for (const auto& binding : state.vertexBindings)
+        desc.bindings[desc.bindingCount++] = { binding.binding, binding.stride, binding.inputRate };
+    for (const auto& attribute : state.vertexAttributes)
+        desc.attributes[desc.attributeCount++] = { attribute.location, attribute.binding, attribute.format,
+            attribute.offset };
+    for (uint32_t constant : constants)
+        desc.constants[desc.constantCount++] = constant;
+}
+
+void FrameCapture::describeCompute(vk::Pipeline pipeline, const ShaderProgram& program,
+    const std::vector<uint32_t>& constants)
+{
+    if (constants.size() > PipelineStateDesc::MaxConstants) {
+        m_descriptions.erase(handleOf(pipeline));
+        return;
+    }
+
+    Description& description = m_descriptions[handleOf(pipeline)];
+    description.programHash = program.hash;
+    description.compute = true;
+    description.desc = PipelineStateDesc();
+    for (uint32_t constant : constants)
+        description.desc.constants[description.desc.constantCount++] = constant;
+}
+
+void FrameCapture::forget(vk::Pipeline pipeline)
+{
+    m_descriptions.erase(handleOf(pipeline));
+}
+
+//-------------------------------------------------------------------------
+// Resources
+//
+void FrameCapture::declareBuffer(vk::Buffer buffer, vk::DeviceSize size, vk::BufferUsageFlags usage,
+    bool hostVisible, const void* contents)
+{
+    if (!m_capturing || !buffer || m_buffers.count(handleOf(buffer)))
+        return;
+
+    FrameTrace::Buffer entry;
+    entry.size = size;
+    entry.usage = static_cast<uint32_t>(usage);
+    entry.hostVisible = hostVisible;
+    if (contents && m_storeData) {
+        entry.dataOffset = storeData(contents, size);
+        entry.dataSize = size;
+    }
+
+    m_buffers[handleOf(buffer)] = static_cast<uint32_t>(m_trace.buffers.size());
+    m_trace.buffers.push_back(entry);
+}
+
+void FrameCapture::declareImage(vk::Image image, vk::Extent2D extent, vk::Format format, vk::ImageUsageFlags usage)
+{
+    if (!m_capturing || !image || m_images.count(handleOf(image)))
+        return;
+
+    FrameTrace::Image entry;
+    entry.width = extent.width;
+    entry.height = extent.height;
+    entry.format = static_cast<uint32_t>(format);
+    entry.usage = static_cast<uint32_t>(usage);
+
+    m_images[handleOf(image)] = static_cast<uint32_t>(m_trace.images.size());
+    m_trace.images.push_back(entry);
+}
+
+//-------------------------------------------------------------------------
+// Upload, the contents only when stored
+//
+void FrameCapture::upload(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size, const void* data)
+{
+    if (!recording())
+        return;
+
+    const uint32_t index = findBuffer(buffer);
+    if (index == FrameTrace::NONE || m_inPass || offset + size > m_trace.buffers[index].size) {
+        m_stats.skipped++;
+        return;
+    }
+
+    const bool stored = data && m_storeData;
+    const uint64_t dataOffset = stored ? storeData(data, size) : 0;
+
+    FrameTrace::Command& command = push(FrameTrace::Op::eUpload);
+    command.args[0] = index;
+    FrameTrace::packWide(&command.args[1], dataOffset);
+    command.args[3] = stored;
+    command.offset = offset;
+    command.size = size;
+}
+
+//-------------------------------------------------------------------------
+// Passes, identical attachments and load op share one entry
+//
+void FrameCapture::beginPass(const std::vector<vk::Image>& colors, vk::Image depth, vk::AttachmentLoadOp loadOp,
+    const vk::Rect2D& area)
+{
+    if (!m_capturing)
+        return;
+
+    m_inPass = true;
+    m_passSkipped = true;
+
+    FrameTrace::Pass pass;
+    if (colors.size() > FrameTrace::MaxColorAttachments) {
+        m_stats.skipped++;
+        return;
+    }
+    for (vk::Image color : colors) {
+        pass.colors[pass.colorCount] = findImage(color);
+        if (pass.colors[pass.colorCount++] == FrameTrace::NONE) {
+            m_stats.skipped++;
+            return;
+        }
+    }
+    if (depth) {
+        pass.depth = findImage(depth);
+        if (pass.depth == FrameTrace::NONE) {
+            m_stats.skipped++;
+            return;
+        }
+    }
+    pass.loadOp = static_cast<uint32_t>(loadOp);
+
+    uint32_t index = 0;
+    for (; index < m_trace.passes.size(); index++)
+        if (memcmp(&m_trace.passes[index], &pass, sizeof(pass)) == 0)
+            break;
+    if (index == m_trace.passes.size())
+        m_trace.passes.push_back(pass);
+
+    m_passSkipped = false;
+
+    FrameTrace::Command& command = push(FrameTrace::Op::eBeginPass);
+    command.args[0] = index;
+    command.args[1] = static_cast<uint32_t>(area.offset.x);
+    command.args[2] = static_cast<uint32_t>(area.offset.y);
+    command.args[3] = area.extent.width;
+    command.args[4] = area.extent.height;
+}
+
+void FrameCapture::endPass()
+{
+    if (!m_capturing)
+        return;
+
+    if (!m_passSkipped)
+        push(FrameTrace::Op::eEndPass);
+
+    m_inPass = false;
+    m_passSkipped = false;
+}
+
+//-------------------------------------------------------------------------
+// Binds, draws after a pipeline that could not be captured are dropped
+//
+void FrameCapture::bindPipeline(vk::Pipeline pipeline)
+{
+    if (!recording())
+        return;
+
+    const uint32_t index = findPipeline(pipeline);
+    m_pipelineBound = index != FrameTrace::NONE;
+    if (!m_pipelineBound) {
+        m_stats.skipped++;
+        return;
+    }
+
+    push(FrameTrace::Op::eBindPipeline).args[0] = index;
+}
+
+void FrameCapture::bindVertexBuffer(uint32_t binding, vk::Buffer buffer, vk::DeviceSize offset)
+{
+    if (!recording())
+        return;
+
+    const uint32_t index = findBuffer(buffer);
+    if (index == FrameTrace::NONE) {
+        m_stats.skipped++;
+        return;
+    }
+
+    FrameTrace::Command& command = push(FrameTrace::Op::eBindVertexBuffer);
+    command.args[0] = binding;
+    command.args[1] = index;
+    command.offset = offset;
+}
+
+void FrameCapture::bindIndexBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::IndexType indexType)
+{
+    if (!recording())
+        return;
+
+    const uint32_t index = findBuffer(buffer);
+    if (index == FrameTrace::NONE) {
+        m_stats.skipped++;
+        return;
+    }
+
+    FrameTrace::Command& command = push(FrameTrace::Op::eBindIndexBuffer);
+    command.args[0] = index;
+    command.args[1] = static_cast<uint32_t>(indexType);
+    command.offset = offset;
+}
+
+void FrameCapture::pushConstants(vk::ShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data)
+{
+    if (!recording())
+        return;
+
+    // small and needed to place anything on screen, always stored
+    const uint64_t dataOffset = storeData(data, size);
+
+    FrameTrace::Command& command = push(FrameTrace::Op::ePushConstants);
+    command.args[0] = static_cast<uint32_t>(stages);
+    command.args[1] = offset;
+    FrameTrace::packWide(&command.args[2], dataOffset);
+    command.size = size;
+}
+
+//-------------------------------------------------------------------------
+// Dynamic state, floats are stored by their bits
+//
+void FrameCapture::setViewport(const vk::Viewport& viewport)
+{
+    if (!recording())
+        return;
+
+    const float values[6] = { viewport.x, viewport.y, viewport.width, viewport.height,
+        viewport.minDepth, viewport.maxDepth };
+    memcpy(push(FrameTrace::Op::eViewport).args, values, sizeof(values));
+}
+
+void FrameCapture::setScissor(const vk::Rect2D& scissor)
+{
+    if (!recording())
+        return;
+
+    FrameTrace::Command& command = push(FrameTrace::Op::eScissor);
+    command.args[0] = static_cast<uint32_t>(scissor.offset.x);
+    command.args[1] = static_cast<uint32_t>(scissor.offset.y);
+    command.args[2] = scissor.extent.width;
+    command.args[3] = scissor.extent.height;
+}
+
+void FrameCapture::setDynamicState(FrameTrace::DynamicState state, uint32_t value0, uint32_t value1,
+    uint32_t value2)
+{
+    if (!recording())
+        return;
+
+    FrameTrace::Command& command = push(FrameTrace::Op::eDynamicState);
+    command.args[0] = static_cast<uint32_t>(state);
+    command.args[1] = value0;
+    command.args[2] = value1;
+    command.args[3] = value2;
+}
+
+//-------------------------------------------------------------------------
+// Work
+//
+void FrameCapture::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+    if (!recording())
+        return;
+    if (!m_pipelineBound || !m_inPass) {
+        m_stats.skipped++;
+        return;
+    }
+
+    FrameTrace::Command& command = push(FrameTrace::Op::eDraw);
+    command.args[0] = vertexCount;
+    command.args[1] = instanceCount;
+    command.args[2] = firstVertex;
+    command.args[3] = firstInstance;
+}
+
+void FrameCapture::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex,
+    int32_t vertexOffset, uint32_t firstInstance)
+{
+    if (!recording())
+        return;
+    if (!m_pipelineBound || !m_inPass) {
+        m_stats.skipped++;
+        return;
+    }
+
+    FrameTrace::Command& command = push(FrameTrace::Op::eDrawIndexed);
+    command.args[0] = indexCount;
+    command.args[1] = instanceCount;
+    command.args[2] = firstIndex;
+    command.args[3] = static_cast<uint32_t>(vertexOffset);
+    command.args[4] = firstInstance;
+}
+
+void FrameCapture::dispatch(uint32_t x, uint32_t y, uint32_t z)
+{
+    if (!recording())
+        return;
+    if (!m_pipelineBound || m_inPass) {
+        m_stats.skipped++;
+        return;
+    }
+
+    FrameTrace::Command& command = push(FrameTrace::Op::eDispatch);
+    command.args[0] = x;
+    command.args[1] = y;
+    command.args[2] = z;
+}
+
+void FrameCapture::barrier(vk::PipelineStageFlags srcStages, vk::PipelineStageFlags dstStages,
+    vk::AccessFlags srcAccess, vk::AccessFlags dstAccess)
+{
+    if (!recording())
+        return;
+    if (m_inPass) {
+        m_stats.skipped++;
+        return;
+    }
+
+    FrameTrace::Command& command = push(FrameTrace::Op::eBarrier);
+    command.args[0] = static_cast<uint32_t>(srcStages);
+    command.args[1] = static_cast<uint32_t>(dstStages);
+    command.args[2] = static_cast<uint32_t>(srcAccess);
+    command.args[3] = static_cast<uint32_t>(dstAccess);
+}
+
+//-------------------------------------------------------------------------
+// Append a command
+//
+FrameTrace::Command& FrameCapture::push(FrameTrace::Op op)
+{
+    m_trace.commands.emplace_back();
+    m_trace.commands.back().op = op;
+    return m_trace.commands.back();
+}
+
+//-------------------------------------------------------------------------
+// Bytes into the data table, 8 byte aligned so SPIR-V can be read in place
+//
+uint64_t FrameCapture::storeData(const void* data, uint64_t size)
+{
+    const uint64_t offset = (m_trace.data.size() + 7) & ~7ull;
+    m_trace.data.resize(static_cast<size_t>(offset + size));
+    if (size)
+        memcpy(m_trace.data.data() + offset, data, static_cast<size_t>(size));
+    return offset;
+}
+
+//-------------------------------------------------------------------------
+// Table indices of live handles, NONE when not declared
+//
+uint32_t FrameCapture::findBuffer(vk::Buffer buffer)
+{
+    auto it = m_buffers.find(handleOf(buffer));
+    return it != m_buffers.end() ? it->second : FrameTrace::NONE;
+}
+
+uint32_t FrameCapture::findImage(vk::Image image)
+{
+    auto it = m_images.find(handleOf(image));
+    return it != m_images.end() ? it->second : FrameTrace::NONE;
+}
+
+//-------------------------------------------------------------------------
+// Pipeline entry from its description, added with its program on first
+// bind in the frame
+//
+uint32_t FrameCapture::findPipeline(vk::Pipeline pipeline)
+{
+    auto it = m_pipelines.find(handleOf(pipeline));
+    if (it != m_pipelines.end())
+        return it->second;
+
+    auto description = m_descriptions.find(handleOf(pipeline));
+    if (description == m_descriptions.end())
+        return FrameTrace::NONE;
+
+    const uint32_t program = findProgram(description->second.programHash);
+    if (program == FrameTrace::NONE)
+        return FrameTrace::NONE;
+
+    FrameTrace::Pipeline entry;
+    entry.program = program;
+    entry.compute = description->second.compute;
+    entry.desc = description->second.desc;
+
+    const uint32_t index = static_cast<uint32_t>(m_trace.pipelines.size());
+    m_trace.pipelines.push_back(entry);
+    m_pipelines[handleOf(pipeline)] = index;
+    return index;
+}
+
+//-------------------------------------------------------------------------
+// Program entry and its shaders, a program the library no longer has is
+// skipped with the pipelines using it
+//
+uint32_t FrameCapture::findProgram(uint64_t programHash)
+{
+    auto it = m_programs.find(programHash);
+    if (it != m_programs.end())
+        return it->second;
+
+    const ShaderProgram* program = m_library ? m_library->findProgram(programHash) : nullptr;
+    if (!program || program->stages.empty() || program->stages.size() > FrameTrace::MaxStages)
+        return FrameTrace::NONE;
+
+    FrameTrace::Program entry;
+    for (const Shader* shader : program->stages) {
+        auto stored = m_shaders.find(shader->hash);
+        if (stored == m_shaders.end()) {
+            FrameTrace::Shader code;
+            code.hash = shader->hash;
+            code.dataSize = shader->code.size() * sizeof(uint32_t);
+            code.dataOffset = storeData(shader->code.data(), code.dataSize);
+
+            stored = m_shaders.emplace(shader->hash, static_cast<uint32_t>(m_trace.shaders.size())).first;
+            m_trace.shaders.push_back(code);
+        }
+        entry.stages[entry.stageCount++] = stored->second;
+    }
+
+    const uint32_t index = static_cast<uint32_t>(m_trace.programs.size());
+    m_trace.programs.push_back(entry);
+    m_programs[programHash] = index;
+    return index;
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
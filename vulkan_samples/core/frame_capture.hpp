@@ -0,0 +1,295 @@
+/*
+ *
+ * Andrew Frost
+ * frame_capture.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "pipeline_state.hpp"
+#include "pipeline_variants.hpp"
+#include "shader_library.hpp"
+#include "vk_utils.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// FrameTrace                                                            //
+///////////////////////////////////////////////////////////////////////////
+// One frame of backend operations as written to a capture file         //
+// - resources, shaders, programs, pipelines and passes are tables the  //
+//   commands index into, SPIR-V and upload contents live in data       //
+// - records are fixed size and written as is, a file is read back by   //
+//   a build of the same version on a little endian host                //
+///////////////////////////////////////////////////////////////////////////
+
+struct FrameTrace
+{
+    static const uint32_t MAGIC = 0x43464b56;   // "VKFC"
+    static const uint32_t VERSION = 1;
+    static const uint32_t NONE = ~0u;
+
+    static const uint32_t MaxStages = 5;
+    static const uint32_t MaxColorAttachments = 4;
+
+    enum class Op : uint32_t
+    {
+        eUpload,            // buffer, data offset (wide), has data | offset, size
+        eBeginPass,         // pass, area x, y, width, height
+        eEndPass,
+        eBindPipeline,      // pipeline
+        eBindVertexBuffer,  // binding, buffer | offset
+        eBindIndexBuffer,   // buffer, index type | offset
+        ePushConstants,     // stages, range offset, data offset (wide) | size
+        eViewport,          // x, y, width, height, min, max depth as float bits
+        eScissor,           // x, y, width, height
+        eDynamicState,      // DynamicState, values
+        eDraw,              // vertex count, instances, first vertex, first instance
+        eDrawIndexed,       // index count, instances, first index, vertex offset, first instance
+        eDispatch,          // x, y, z
+        eBarrier,           // src stages, dst stages, src access, dst access
+    };
+
+    enum class DynamicState : uint32_t
+    {
+        eCullMode,          // cull mode
+        eFrontFace,         // front face
+        eTopology,          // topology
+        eDepth,             // test, write, compare
+    };
+
+    struct Command
+    {
+        Op       op{ Op::eEndPass };
+        uint32_t args[7]{};
+        uint64_t offset{ 0 };
+        uint64_t size{ 0 };
+    };
+
+    struct Buffer
+    {
+        uint64_t size{ 0 };
+        uint32_t usage{ 0 };
+        uint32_t hostVisible{ 0 };
+        uint64_t dataOffset{ 0 };
+        uint64_t dataSize{ 0 };     // initial contents, 0 is zero filled
+    };
+
+    struct Image
+    {
+        uint32_t width{ 0 };
+        uint32_t height{ 0 };
+        uint32_t format{ 0 };
+        uint32_t usage{ 0 };
+    };
+
+    struct Shader
+    {
+        uint64_t hash{ 0 };
+        uint64_t dataOffset{ 0 };   // SPIR-V
+        uint64_t dataSize{ 0 };
+    };
+
+    struct Program
+    {
+        uint32_t stageCount{ 0 };
+        uint32_t stages[MaxStages]{};  // shader indices
+    };
+
+    struct Pipeline
+    {
+        uint32_t          program{ 0 };
+        uint32_t          compute{ 0 };
+        PipelineStateDesc desc;         // only the constants of compute pipelines
+    };
+
+    struct Pass
+    {
+        uint32_t colorCount{ 0 };
+        uint32_t colors[MaxColorAttachments]{};  // image indices
+        uint32_t depth{ NONE };
+        uint32_t loadOp{ 0 };                    // vk::AttachmentLoadOp of every attachment
+    };
+
+    float                 frameMs{ 0.f };   // interval to the previous frame at capture
+    std::vector<Buffer>   buffers;
+    std::vector<Image>    images;
+    std::vector<Shader>   shaders;
+    std::vector<Program>  programs;
+    std::vector<Pipeline> pipelines;
+    std::vector<Pass>     passes;
+    std::vector<Command>  commands;
+    std::vector<uint8_t>  data;
+
+    // 64 bit data offsets take two args
+    static void packWide(uint32_t* args, uint64_t value)
+    {
+        args[0] = static_cast<uint32_t>(value);
+        args[1] = static_cast<uint32_t>(value >> 32);
+    }
+
+    static uint64_t unpackWide(const uint32_t* args) { return args[0] | (static_cast<uint64_t>(args[1]) << 32); }
+
+    // Both throw on io errors and on files of another version, load also
+    // checks every index so a damaged file can not be replayed
+    void save(const std::string& path) const;
+    void load(const std::string& path);
+
+    void clear();
+
+private:
+
+    bool validate() const;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// FrameCapture                                                          //
+///////////////////////////////////////////////////////////////////////////
+// Records what a frame asks of the backend next to the real commands,  //
+// for replay without the application or its assets                     //
+// - request() arms the next beginFrame(), endFrame() writes the file;  //
+//   in between every call below is appended, outside it returns early  //
+// - PipelineVariants and CommandState report pipelines, binds and      //
+//   dynamic state once set up with setCapture(), draws, passes,        //
+//   barriers and uploads are reported by the code recording them       //
+// - resources are declared before their first use in the frame, with   //
+//   their current contents when known, anything used undeclared is     //
+//   dropped and counted as skipped                                     //
+// - descriptor sets are not captured, replayed pipelines only get      //
+//   push constants                                                     //
+// - descriptions keep the program hash, its stages are looked up in   //
+//   the library set with setShaderLibrary() when a frame binds it     //
+///////////////////////////////////////////////////////////////////////////
+
+class FrameCapture
+{
+public:
+    FrameCapture(FrameCapture const&) = delete;
+    FrameCapture& operator=(FrameCapture const&) = delete;
+
+    FrameCapture() = default;
+    ~FrameCapture() = default;
+
+    // Write the next frame to path
+    void request(const std::string& path);
+
+    // Off keeps sizes only, contents may belong to a customer
+    void setStoreData(bool store) { m_storeData = store; }
+
+    // Programs of described pipelines, before the first frame
+    void setShaderLibrary(const ShaderLibrary* library) { m_library = library; }
+
+    void beginFrame();
+
+    // True when a frame was written, throws when the file can not be
+    bool endFrame();
+
+    // Pipeline descriptions, kept from creation on so a frame captured
+    // later can still rebuild them
+    void describeGraphics(vk::Pipeline pipeline, const ShaderProgram& program, const GraphicsState& state,
+        const std::vector<uint32_t>& constants);
+    void describeCompute(vk::Pipeline pipeline, const ShaderProgram& program, const std::vector<uint32_t>& constants);
+    void forget(vk::Pipeline pipeline);
+
+    // Resources, declaring one twice in a frame is a no-op
+    void declareBuffer(vk::Buffer buffer, vk::DeviceSize size, vk::BufferUsageFlags usage, bool hostVisible,
+        const void* contents = nullptr);
+    void declareImage(vk::Image image, vk::Extent2D extent, vk::Format format, vk::ImageUsageFlags usage);
+
+    // Host writes or staged copies, outside of passes
+    void upload(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size, const void* data);
+
+    void beginPass(const std::vector<vk::Image>& colors, vk::Image depth, vk::AttachmentLoadOp loadOp,
+        const vk::Rect2D& area);
+    void endPass();
+
+    void bindPipeline(vk::Pipeline pipeline);
+    void bindVertexBuffer(uint32_t binding, vk::Buffer buffer, vk::DeviceSize offset);
+    void bindIndexBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::IndexType indexType);
+    void pushConstants(vk::ShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data);
+
+    void setViewport(const vk::Viewport& viewport);
+    void setScissor(const vk::Rect2D& scissor);
+    void setDynamicState(FrameTrace::DynamicState state, uint32_t value0, uint32_t value1 = 0, uint32_t value2 = 0);
+
+    void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+    void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset,
+        uint32_t firstInstance);
+    void dispatch(uint32_t x, uint32_t y, uint32_t z);
+
+    // Global memory barrier outside of passes, image layouts are the
+    // replayer's business
+    void barrier(vk::PipelineStageFlags srcStages, vk::PipelineStageFlags dstStages,
+        vk::AccessFlags srcAccess, vk::AccessFlags dstAccess);
+
+    struct Stats
+    {
+        uint32_t frames{ 0 };      // written
+        uint32_t commands{ 0 };    // of the last frame
+        uint32_t skipped{ 0 };     // undeclared resources or pipelines
+        uint64_t bytes{ 0 };       // file size of the last frame
+    };
+
+    // Getting Methods
+    bool               isCapturing() const { return m_capturing; }
+    bool               isRequested() const { return !m_path.empty() && !m_capturing; }
+    const std::string& getLastPath() const { return m_lastPath; }
+    const Stats&       getStats()    const { return m_stats; }
+
+private:
+
+    struct Description
+    {
+        uint64_t             programHash{ 0 };   // ShaderProgram::hash
+        bool                 compute{ false };
+        PipelineStateDesc    desc;
+    };
+
+    // Ops are dropped outside a frame and inside a pass that was not captured
+    bool recording() const { return m_capturing && !m_passSkipped; }
+
+    FrameTrace::Command& push(FrameTrace::Op op);
+
+    uint64_t storeData(const void* data, uint64_t size);
+
+    uint32_t findBuffer(vk::Buffer buffer);
+    uint32_t findImage(vk::Image image);
+    uint32_t findPipeline(vk::Pipeline pipeline);
+    uint32_t findProgram(uint64_t programHash);
+
+    const ShaderLibrary*                      m_library{ nullptr };
+    std::unordered_map<uint64_t, Description> m_descriptions;
+
+    std::string                               m_path;
+    std::string                               m_lastPath;
+    bool                                      m_capturing{ false };
+    bool                                      m_storeData{ true };
+    bool                                      m_inPass{ false };
+    bool                                      m_passSkipped{ false };
+    bool                                      m_pipelineBound{ false };
+
+    FrameTrace                                m_trace;
+    std::unordered_map<uint64_t, uint32_t>    m_buffers;
+    std::unordered_map<uint64_t, uint32_t>    m_images;
+    std::unordered_map<uint64_t, uint32_t>    m_pipelines;
+    std::unordered_map<uint64_t, uint32_t>    m_shaders;     // by SPIR-V hash
+    std::unordered_map<uint64_t, uint32_t>    m_programs;    // by program hash
+
+    std::chrono::high_resolution_clock::time_point m_lastFrame;
+    float                                     m_frameMs{ 0.f };
+
+    Stats                                     m_stats;
+
+}; // class FrameCapture
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,486 @@
+/*
+ *
+ * Andrew Frost
+ * frame_readback.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include "frame_readback.hpp"
+#include "object_registry.hpp"
+#include "vk_utils.hpp"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#define PIPE_WRITE "wb"
+#else
+#define PIPE_WRITE "w"
+#endif
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// FrameReadback                                                         //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization, buffers are made on first use at the frame's size
+//
+void FrameReadback::init(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t bufferCount)
+{
+    assert(!m_device && "FrameReadback already initialized");
+    m_device = device;
+    m_physicalDevice = physicalDevice;
+    m_slots.resize(std::max(bufferCount, 1u));
+    m_next = 0;
+    m_frameIndex = 0;
+    m_quit = false;
+    m_stats = {};
+
+    m_worker = std::thread(&FrameReadback::workerLoop, this);
+}
+
+//-------------------------------------------------------------------------
+// Every recorded copy is complete once the device is idle, the worker
+// drains them before it stops
+//
+void FrameReadback::destroy()
+{
+    if (!m_device)
+        return;
+
+    m_device.waitIdle();
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_condition.notify_all();
+    if (m_worker.joinable())
+        m_worker.join();
+
+    // nobody is left to rethrow to
+    if (m_sinkError) {
+        try {
+            std::rethrow_exception(m_sinkError);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "frame readback: " << e.what() << std::endl;
+        }
+        catch (...) {
+        }
+        m_sinkError = nullptr;
+    }
+
+    for (auto& slot : m_slots)
+        release(slot);
+    m_slots.clear();
+    m_queue.clear();
+    m_sink = nullptr;
+    m_recording = false;
+
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Sink of the frames recorded from now on
+//
+void FrameReadback::setSink(Sink sink)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sink = std::move(sink);
+    m_generation++;
+    m_recording = static_cast<bool>(m_sink);
+}
+
+//-------------------------------------------------------------------------
+// Image to the next free buffer, after everything recorded before and
+// back in its layout for whatever follows (present)
+//
+bool FrameReadback::record(vk::CommandBuffer cmdBuffer, uint32_t frameSlot, vk::Image image, vk::ImageLayout layout,
+    vk::Extent2D extent, vk::Format format)
+{
+    if (!m_recording)
+        return false;
+
+    const uint32_t texel = texelSize(format);
+    if (texel == 0)
+        throw std::runtime_error("failed to read back frame, unsupported format " + vk::to_string(format) + "!");
+
+    Slot* slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const uint64_t index = m_frameIndex++;
+
+        // the oldest buffer is still in flight or in the sink
+        if (m_slots[m_next].state != State::eFree) {
+            m_stats.dropped++;
+            return false;
+        }
+
+        slot = &m_slots[m_next];
+        m_next = (m_next + 1) % static_cast<uint32_t>(m_slots.size());
+
+        slot->frame.index = index;
+        slot->sink = m_sink;
+        slot->generation = m_generation;
+        m_stats.recorded++;
+    }
+
+    // free slots belong to this thread
+    const vk::DeviceSize size = vk::DeviceSize(extent.width) * extent.height * texel;
+    reserve(*slot, size);
+
+    slot->frame.data = slot->mapped;
+    slot->frame.width = extent.width;
+    slot->frame.height = extent.height;
+    slot->frame.rowPitch = extent.width * texel;
+    slot->frame.format = format;
+    slot->frameSlot = frameSlot;
+
+    vk::ImageMemoryBarrier toTransfer = {};
+    toTransfer.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+    toTransfer.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+    toTransfer.oldLayout = layout;
+    toTransfer.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = image;
+    toTransfer.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+        vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, toTransfer);
+
+    vk::BufferImageCopy region = {};
+    region.imageSubresource = { vk::ImageAspectFlagBits::eColor, 0, 0, 1 };
+    region.imageExtent = vk::Extent3D(extent.width, extent.height, 1);
+    cmdBuffer.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, slot->buffer, region);
+
+    // image back for present, buffer visible to the host once the fence signals
+    vk::ImageMemoryBarrier toLayout = toTransfer;
+    toLayout.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+    toLayout.dstAccessMask = {};
+    toLayout.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+    toLayout.newLayout = layout;
+
+    vk::BufferMemoryBarrier toHost = {};
+    toHost.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    toHost.dstAccessMask = vk::AccessFlagBits::eHostRead;
+    toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.buffer = slot->buffer;
+    toHost.offset = 0;
+    toHost.size = VK_WHOLE_SIZE;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eBottomOfPipe | vk::PipelineStageFlagBits::eHost, {},
+        nullptr, toHost, toLayout);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    slot->state = State::eRecorded;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// Copies of the slot are complete, queue them in recording order. A sink
+// that failed on the worker throws here, on the render thread
+//
+void FrameReadback::frameComplete(uint32_t frameSlot)
+{
+    std::vector<uint32_t> complete;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_sinkError) {
+            std::exception_ptr error = m_sinkError;
+            m_sinkError = nullptr;
+            if (m_failedGeneration == m_generation)
+                m_sink = nullptr;
+            std::rethrow_exception(error);
+        }
+
+        for (uint32_t i = 0; i < m_slots.size(); i++)
+            if (m_slots[i].state == State::eRecorded && m_slots[i].frameSlot == frameSlot)
+                complete.push_back(i);
+        if (complete.empty())
+            return;
+
+        std::sort(complete.begin(), complete.end(), [this](uint32_t a, uint32_t b) {
+            return m_slots[a].frame.index < m_slots[b].frame.index; });
+        for (uint32_t i : complete) {
+            m_slots[i].state = State::eQueued;
+            m_queue.push_back(i);
+        }
+    }
+    m_condition.notify_one();
+}
+
+//-------------------------------------------------------------------------
+// Queue every recorded copy in recording order
+//
+void FrameReadback::flush()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::vector<uint32_t> complete;
+        for (uint32_t i = 0; i < m_slots.size(); i++)
+            if (m_slots[i].state == State::eRecorded)
+                complete.push_back(i);
+
+        std::sort(complete.begin(), complete.end(), [this](uint32_t a, uint32_t b) {
+            return m_slots[a].frame.index < m_slots[b].frame.index; });
+        for (uint32_t i : complete) {
+            m_slots[i].state = State::eQueued;
+            m_queue.push_back(i);
+        }
+    }
+    m_condition.notify_one();
+}
+
+//-------------------------------------------------------------------------
+// Counters, copied under the worker's lock
+//
+FrameReadback::Stats FrameReadback::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+//-------------------------------------------------------------------------
+// Packed texel sizes of color formats, block compressed and depth
+// formats can not be a frame
+//
+uint32_t FrameReadback::texelSize(vk::Format format)
+{
+    switch (format) {
+    case vk::Format::eR8G8B8A8Unorm:
+    case vk::Format::eR8G8B8A8Srgb:
+    case vk::Format::eB8G8R8A8Unorm:
+    case vk::Format::eB8G8R8A8Srgb:
+    case vk::Format::eA2B10G10R10UnormPack32:
+    case vk::Format::eA2R10G10B10UnormPack32:
+        return 4;
+    case vk::Format::eR16G16B16A16Sfloat:
+        return 8;
+    case vk::Format::eR32G32B32A32Sfloat:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+//-------------------------------------------------------------------------
+// Grow a free slot's buffer, persistently mapped. Host cached memory is
+// preferred, coherent memory is the fallback every device has
+//
+void FrameReadback::reserve(Slot& slot, vk::DeviceSize size)
+{
+    if (slot.buffer && slot.size >= size)
+        return;
+
+    release(slot);
+
+    vk::BufferCreateInfo bufferInfo = {};
+    bufferInfo.size = size;
+    bufferInfo.usage = vk::BufferUsageFlagBits::eTransferDst;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+    try {
+        slot.buffer = m_device.createBuffer(bufferInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create readback buffer!");
+    }
+
+    const vk::MemoryRequirements memReqs = m_device.getBufferMemoryRequirements(slot.buffer);
+
+    vk::MemoryAllocateInfo memAllocInfo = {};
+    memAllocInfo.allocationSize = memReqs.size;
+    try {
+        memAllocInfo.memoryTypeIndex = findMemoryType(m_physicalDevice, memReqs.memoryTypeBits,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached);
+    }
+    catch (const std::runtime_error&) {
+        memAllocInfo.memoryTypeIndex = findMemoryType(m_physicalDevice, memReqs.memoryTypeBits,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    }
+
+    const vk::PhysicalDeviceMemoryProperties memProperties = m_physicalDevice.getMemoryProperties();
+    slot.coherent = static_cast<bool>(memProperties.memoryTypes[memAllocInfo.memoryTypeIndex].propertyFlags
+        & vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    try {
+        slot.memory = m_device.allocateMemory(memAllocInfo);
+    }
+    catch (vk::SystemError err) {
+        m_device.destroyBuffer(slot.buffer);
+        slot.buffer = nullptr;
+        throw std::runtime_error("failed to allocate readback memory!");
+    }
+
+    m_device.bindBufferMemory(slot.buffer, slot.memory, 0);
+    slot.mapped = static_cast<uint8_t*>(m_device.mapMemory(slot.memory, 0, VK_WHOLE_SIZE));
+    slot.size = size;
+
+    VkObjects.onCreate(slot.buffer, size, "FrameReadback");
+    VkObjects.onCreate(slot.memory, memReqs.size, "FrameReadback");
+}
+
+void FrameReadback::release(Slot& slot)
+{
+    if (!slot.buffer)
+        return;
+
+    m_device.unmapMemory(slot.memory);
+    VkObjects.onDestroy(slot.buffer);
+    VkObjects.onDestroy(slot.memory);
+    m_device.destroyBuffer(slot.buffer);
+    m_device.freeMemory(slot.memory);
+
+    slot.buffer = nullptr;
+    slot.memory = nullptr;
+    slot.mapped = nullptr;
+    slot.size = 0;
+}
+
+//-------------------------------------------------------------------------
+// Hand queued frames to their sink, a failure stops the recording and
+// skips whatever is still queued for the same sink
+//
+void FrameReadback::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_condition.wait(lock, [this] { return !m_queue.empty() || m_quit; });
+        if (m_queue.empty())
+            return;
+
+        Slot& slot = m_slots[m_queue.front()];
+        m_queue.pop_front();
+        const bool failed = slot.generation == m_failedGeneration;
+        lock.unlock();
+
+        std::exception_ptr error;
+        if (!failed && slot.sink) {
+            try {
+                if (!slot.coherent)
+                    m_device.invalidateMappedMemoryRanges(vk::MappedMemoryRange(slot.memory, 0, VK_WHOLE_SIZE));
+                slot.sink(slot.frame);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        lock.lock();
+        if (error) {
+            if (!m_sinkError)
+                m_sinkError = error;
+            m_failedGeneration = slot.generation;
+            if (slot.generation == m_generation)
+                m_recording = false;
+        }
+        else if (!failed && slot.sink) {
+            m_stats.written++;
+            m_stats.bytes += vk::DeviceSize(slot.frame.rowPitch) * slot.frame.height;
+        }
+        slot.sink = nullptr;
+        slot.state = State::eFree;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Readback Sinks                                                        //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Frames back to back, a frame of another size or format would leave the
+// file unreadable so it stops the recording instead
+//
+FrameReadback::Sink rawFileSink(const std::string& path, vk::Extent2D extent, vk::Format format)
+{
+    auto file = std::make_shared<std::ofstream>(path, std::ios::binary);
+    if (!file->is_open())
+        throw std::runtime_error("failed to open " + path + "!");
+
+    return [file, path, extent, format](const FrameReadback::Frame& frame) {
+        if (frame.width != extent.width || frame.height != extent.height || frame.format != format)
+            throw std::runtime_error("failed to write " + path + ", frame size or format changed!");
+
+        file->write(reinterpret_cast<const char*>(frame.data), std::streamsize(frame.rowPitch) * frame.height);
+        if (!*file)
+            throw std::runtime_error("failed to write " + path + "!");
+    };
+}
+
+//-------------------------------------------------------------------------
+// One binary PPM per frame, 8 bit RGBA and BGRA only
+//
+FrameReadback::Sink ppmSink(const std::string& prefix)
+{
+    return [prefix](const FrameReadback::Frame& frame) {
+        bool bgra = false;
+        switch (frame.format) {
+        case vk::Format::eB8G8R8A8Unorm:
+        case vk::Format::eB8G8R8A8Srgb:
+            bgra = true;
+            break;
+        case vk::Format::eR8G8B8A8Unorm:
+        case vk::Format::eR8G8B8A8Srgb:
+            break;
+        default:
+            throw std::runtime_error("failed to write ppm, unsupported format " + vk::to_string(frame.format) + "!");
+        }
+
+        std::ostringstream name;
+        name << prefix << std::setw(6) << std::setfill('0') << frame.index << ".ppm";
+
+        std::vector<uint8_t> rgb(size_t(frame.width) * frame.height * 3);
+        for (uint32_t y = 0; y < frame.height; y++) {
+            const uint8_t* src = frame.data + size_t(y) * frame.rowPitch;
+            uint8_t* dst = &rgb[size_t(y) * frame.width * 3];
+            for (uint32_t x = 0; x < frame.width; x++, src += 4, dst += 3) {
+                dst[0] = src[bgra ? 2 : 0];
+                dst[1] = src[1];
+                dst[2] = src[bgra ? 0 : 2];
+            }
+        }
+
+        std::ofstream file(name.str(), std::ios::binary);
+        file << "P6\n" << frame.width << " " << frame.height << "\n255\n";
+        file.write(reinterpret_cast<const char*>(rgb.data()), std::streamsize(rgb.size()));
+        if (!file)
+            throw std::runtime_error("failed to write " + name.str() + "!");
+    };
+}
+
+//-------------------------------------------------------------------------
+// Raw frames to a child process, closed with the last copy of the sink
+//
+FrameReadback::Sink pipeSink(const std::string& command)
+{
+    std::shared_ptr<FILE> pipe(popen(command.c_str(), PIPE_WRITE), [](FILE* file) { if (file) pclose(file); });
+    if (!pipe)
+        throw std::runtime_error("failed to start " + command + "!");
+
+    return [pipe, command](const FrameReadback::Frame& frame) {
+        const size_t size = size_t(frame.rowPitch) * frame.height;
+        if (fwrite(frame.data, 1, size, pipe.get()) != size)
+            throw std::runtime_error("failed to write to " + command + "!");
+    };
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
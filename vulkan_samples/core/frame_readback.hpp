@@ -0,0 +1,168 @@
+/*
+ *
+ * Andrew Frost
+ * frame_readback.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// FrameReadback                                                         //
+///////////////////////////////////////////////////////////////////////////
+// Rendered frames copied into a ring of host visible buffers and handed //
+// to a sink on a worker thread, the render loop never waits for them   //
+// - record() adds the copy to the end of the frame's command buffer,   //
+//   the image needs eTransferSrc usage and goes back to its layout     //
+// - frameComplete() is called once the frame slot's fence was waited  //
+//   on anyway, copies recorded in that slot go to the worker           //
+// - with every buffer in use the frame is dropped and counted, a slow  //
+//   sink costs frames of the recording, never frame time               //
+// - buffers are host cached where available, read back memory is slow //
+//   to read uncached                                                    //
+///////////////////////////////////////////////////////////////////////////
+
+class FrameReadback
+{
+public:
+    struct Frame
+    {
+        const uint8_t* data{ nullptr };
+        uint32_t       width{ 0 };
+        uint32_t       height{ 0 };
+        uint32_t       rowPitch{ 0 };     // bytes, rows are tightly packed
+        vk::Format     format{ vk::Format::eUndefined };
+        uint64_t       index{ 0 };        // frames recorded before this one, dropped included
+    };
+
+    // Called on the worker thread in recording order, throwing stops the
+    // recording and the exception is rethrown by the next frameComplete()
+    using Sink = std::function<void(const Frame&)>;
+
+    FrameReadback(FrameReadback const&) = delete;
+    FrameReadback& operator=(FrameReadback const&) = delete;
+
+    FrameReadback() = default;
+    ~FrameReadback() { destroy(); }
+
+    // bufferCount buffers are frames in flight plus the worker's backlog
+    void init(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t bufferCount = 4);
+
+    // Waits for the device, frames already recorded still reach the sink
+    void destroy();
+
+    // Frames are only recorded while a sink is set, nullptr stops after
+    // the frames already recorded
+    void setSink(Sink sink);
+
+    // Copy of image after everything recorded so far, false when dropped
+    bool record(vk::CommandBuffer cmdBuffer, uint32_t frameSlot, vk::Image image, vk::ImageLayout layout,
+        vk::Extent2D extent, vk::Format format);
+
+    // Fence of frameSlot has signaled
+    void frameComplete(uint32_t frameSlot);
+
+    // Device is idle, every recorded copy is complete. For frame slots
+    // that may not come back, e.g. after the swapchain was rebuilt
+    void flush();
+
+    struct Stats
+    {
+        uint64_t recorded{ 0 };
+        uint64_t written{ 0 };     // handed to the sink
+        uint64_t dropped{ 0 };     // no free buffer
+        uint64_t bytes{ 0 };       // handed to the sink
+    };
+
+    // Getting Methods
+    bool  isRecording() const { return m_recording; }
+    Stats getStats()    const;
+
+    // Bytes per texel of the uncompressed color formats a frame may have,
+    // 0 for anything else
+    static uint32_t texelSize(vk::Format format);
+
+private:
+
+    enum class State
+    {
+        eFree,
+        eRecorded,    // copy in a command buffer not known to be complete
+        eQueued,      // waiting for or in the sink
+    };
+
+    struct Slot
+    {
+        vk::Buffer       buffer;
+        vk::DeviceMemory memory;
+        vk::DeviceSize   size{ 0 };
+        uint8_t*         mapped{ nullptr };
+        bool             coherent{ true };
+        State            state{ State::eFree };
+        uint32_t         frameSlot{ 0 };
+        Frame            frame;
+        Sink             sink;           // the one set when recorded
+        uint32_t         generation{ 0 };
+    };
+
+    // Buffer of at least size, only called on free slots
+    void reserve(Slot& slot, vk::DeviceSize size);
+    void release(Slot& slot);
+
+    void workerLoop();
+
+    vk::Device                  m_device;
+    vk::PhysicalDevice          m_physicalDevice;
+
+    std::vector<Slot>           m_slots;
+    uint32_t                    m_next{ 0 };
+    uint64_t                    m_frameIndex{ 0 };
+    std::atomic<bool>           m_recording{ false };
+    Sink                        m_sink;
+    uint32_t                    m_generation{ 0 };          // setSink calls
+    uint32_t                    m_failedGeneration{ ~0u };  // sink that threw
+
+    // Worker, slots queued in recording order
+    std::thread                 m_worker;
+    mutable std::mutex          m_mutex;
+    std::condition_variable     m_condition;
+    std::deque<uint32_t>        m_queue;
+    bool                        m_quit{ false };
+    std::exception_ptr          m_sinkError;
+    Stats                       m_stats;
+
+}; // class FrameReadback
+
+///////////////////////////////////////////////////////////////////////////
+// Readback Sinks                                                        //
+///////////////////////////////////////////////////////////////////////////
+// - raw appends the packed rows of every frame to one file, to be read //
+//   as rawvideo with the size and format it was created for           //
+// - ppm writes <prefix><index>.ppm per frame as 8 bit RGB              //
+// - pipe writes raw frames to the stdin of command, e.g. an encoder    //
+// All keep their file open until the last copy of the sink is gone     //
+///////////////////////////////////////////////////////////////////////////
+
+FrameReadback::Sink rawFileSink(const std::string& path, vk::Extent2D extent, vk::Format format);
+
+FrameReadback::Sink ppmSink(const std::string& prefix);
+
+FrameReadback::Sink pipeSink(const std::string& command);
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
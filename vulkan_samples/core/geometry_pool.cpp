@@ -0,0 +1,243 @@
+/*
+ *
+ * Andrew Frost
+ * geometry_pool.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "geometry_pool.hpp"
+#include "object_registry.hpp"
+#include "vk_utils.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// GeometryPool                                                          //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization of the shared buffers and the upload objects
+//
+void GeometryPool::init(DeviceAllocator& allocator, vk::Device device, vk::PhysicalDevice physicalDevice,
+    vk::Queue queue, uint32_t queueIdx, uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+    assert(!m_device && "GeometryPool already initialized");
+    m_allocator = &allocator;
+    m_device = device;
+    m_queue = queue;
+    m_vertexCapacity = vertexCapacity;
+    m_indexCapacity = indexCapacity;
+
+    // Shared buffers, storage usage lets compute passes read the geometry
+    vk::BufferCreateInfo bufferInfo = {};
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+    bufferInfo.size = vk::DeviceSize(vertexCapacity) * sizeof(tools::Vertex);
+    bufferInfo.usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer
+        | vk::BufferUsageFlagBits::eTransferDst;
+    m_vertexAllocation = m_allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eDeviceLocal,
+        m_vertexBuffer);
+
+    bufferInfo.size = vk::DeviceSize(indexCapacity) * sizeof(uint32_t);
+    bufferInfo.usage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eStorageBuffer
+        | vk::BufferUsageFlagBits::eTransferDst;
+    m_indexAllocation = m_allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eDeviceLocal,
+        m_indexBuffer);
+
+    m_vertexRanges.init(vertexCapacity);
+    m_indexRanges.init(indexCapacity);
+
+    // Staging buffer, persistently mapped
+    createBuffer(m_device, physicalDevice, m_stagingSize, vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+        m_stagingBuffer, m_stagingMemory);
+    VkObjects.onCreate(m_stagingBuffer, m_stagingSize, "GeometryPool staging");
+    VkObjects.onCreate(m_stagingMemory, m_stagingSize, "GeometryPool staging");
+    m_stagingData = static_cast<uint8_t*>(m_device.mapMemory(m_stagingMemory, 0, m_stagingSize));
+
+    // Command Buffer
+    vk::CommandPoolCreateInfo poolInfo = {};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer
+        | vk::CommandPoolCreateFlagBits::eTransient;
+    poolInfo.queueFamilyIndex = queueIdx;
+
+    try {
+        m_commandPool = m_device.createCommandPool(poolInfo);
+        m_commandBuffer = m_device.allocateCommandBuffers(
+            { m_commandPool, vk::CommandBufferLevel::ePrimary, 1 })[0];
+        m_fence = m_device.createFence({});
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create geometry upload command objects!");
+    }
+    VkObjects.onCreate(m_commandPool, 0, "GeometryPool");
+    VkObjects.onCreate(m_fence, 0, "GeometryPool");
+}
+
+//-------------------------------------------------------------------------
+// Call on exit, before the device allocator
+//
+void GeometryPool::destroy()
+{
+    if (!m_device)
+        return;
+
+    flush();
+
+    VkObjects.onDestroy(m_fence);
+    m_device.destroyFence(m_fence);
+    m_device.freeCommandBuffers(m_commandPool, m_commandBuffer);
+    VkObjects.onDestroy(m_commandPool);
+    m_device.destroyCommandPool(m_commandPool);
+
+    m_device.unmapMemory(m_stagingMemory);
+    VkObjects.onDestroy(m_stagingBuffer);
+    m_device.destroyBuffer(m_stagingBuffer);
+    VkObjects.onDestroy(m_stagingMemory);
+    m_device.freeMemory(m_stagingMemory);
+
+    m_allocator->destroyResource(m_vertexAllocation);
+    m_allocator->destroyResource(m_indexAllocation);
+
+    m_meshes.clear();
+    m_freeIDs.clear();
+    m_stagingData = nullptr;
+    m_stagingOffset = 0;
+    m_allocator = nullptr;
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Ranges for the vertices and every LOD, uploads are recorded and go out
+// with the next flush()
+//
+GeometryPool::MeshID GeometryPool::addMesh(const tools::Mesh& mesh)
+{
+    const uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    const uint32_t indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+    vk::DeviceSize vertexOffset = 0;
+    vk::DeviceSize firstIndex = 0;
+    if (!m_vertexRanges.allocate(vertexCount, 1, vertexOffset))
+        throw std::runtime_error("geometry pool is out of vertex space!");
+    if (!m_indexRanges.allocate(indexCount, 1, firstIndex)) {
+        m_vertexRanges.free(vertexOffset, vertexCount);
+        throw std::runtime_error("geometry pool is out of index space!");
+    }
+
+    upload(m_vertexBuffer, vertexOffset * sizeof(tools::Vertex), mesh.vertices.data(),
+        vk::DeviceSize(vertexCount) * sizeof(tools::Vertex));
+    upload(m_indexBuffer, firstIndex * sizeof(uint32_t), mesh.indices.data(),
+        vk::DeviceSize(indexCount) * sizeof(uint32_t));
+
+    Range range;
+    range.firstIndex = static_cast<uint32_t>(firstIndex);
+    range.vertexOffset = static_cast<int32_t>(vertexOffset);
+    range.indexCount = indexCount;
+    range.vertexCount = vertexCount;
+
+    if (!m_freeIDs.empty()) {
+        const MeshID id = m_freeIDs.back();
+        m_freeIDs.pop_back();
+        m_meshes[id] = range;
+        return id;
+    }
+
+    m_meshes.push_back(range);
+    return static_cast<MeshID>(m_meshes.size() - 1);
+}
+
+//-------------------------------------------------------------------------
+// Ranges go back to the free lists, neighbours are merged
+//
+void GeometryPool::removeMesh(MeshID id)
+{
+    Range& range = m_meshes[id];
+    m_vertexRanges.free(static_cast<vk::DeviceSize>(range.vertexOffset), range.vertexCount);
+    m_indexRanges.free(range.firstIndex, range.indexCount);
+
+    range = {};
+    m_freeIDs.push_back(id);
+}
+
+//-------------------------------------------------------------------------
+// Staging copy, split when larger than what is left of the staging buffer
+//
+void GeometryPool::upload(vk::Buffer dst, vk::DeviceSize offset, const void* data, vk::DeviceSize size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    while (size) {
+        if (m_stagingOffset == m_stagingSize)
+            flush();
+
+        const vk::DeviceSize chunk = std::min(size, m_stagingSize - m_stagingOffset);
+        memcpy(m_stagingData + m_stagingOffset, bytes, chunk);
+
+        if (!m_recording) {
+            m_commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+            m_recording = true;
+        }
+        m_commandBuffer.copyBuffer(m_stagingBuffer, dst, vk::BufferCopy(m_stagingOffset, offset, chunk));
+
+        // keep copies 16 byte aligned in staging
+        m_stagingOffset = std::min(m_stagingSize, (m_stagingOffset + chunk + 15) & ~vk::DeviceSize(15));
+        offset += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+}
+
+//-------------------------------------------------------------------------
+// Uploads are visible to vertex input and shaders once this returns
+//
+void GeometryPool::flush()
+{
+    if (!m_recording)
+        return;
+
+    vk::MemoryBarrier barrier = {};
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead
+        | vk::AccessFlagBits::eShaderRead;
+    m_commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader
+        | vk::PipelineStageFlagBits::eComputeShader, {}, barrier, nullptr, nullptr);
+
+    m_commandBuffer.end();
+
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_commandBuffer;
+
+    try {
+        m_queue.submit(submitInfo, m_fence);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to submit geometry upload command buffer!");
+    }
+
+    while (m_device.waitForFences(m_fence, VK_TRUE, 10000) == vk::Result::eTimeout) {}
+    m_device.resetFences(m_fence);
+
+    m_recording = false;
+    m_stagingOffset = 0;
+}
+
+//-------------------------------------------------------------------------
+// One bind for every mesh of the pool
+//
+void GeometryPool::bind(vk::CommandBuffer cmdBuffer) const
+{
+    cmdBuffer.bindVertexBuffers(0, m_vertexBuffer, vk::DeviceSize(0));
+    cmdBuffer.bindIndexBuffer(m_indexBuffer, 0, vk::IndexType::eUint32);
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
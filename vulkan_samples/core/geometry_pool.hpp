@@ -0,0 +1,111 @@
+/*
+ *
+ * Andrew Frost
+ * geometry_pool.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "../helper/mesh.hpp"
+#include "device_allocator.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// GeometryPool                                                          //
+///////////////////////////////////////////////////////////////////////////
+// One device local vertex buffer and one index buffer shared by every  //
+// mesh, ranges are handed out by a RangeAllocator in elements          //
+// - meshes are addressed with firstIndex / vertexOffset, one bind      //
+//   covers every draw and they merge into indirect draws              //
+// - uploads go through a staging buffer, flush() submits them         //
+///////////////////////////////////////////////////////////////////////////
+
+class GeometryPool
+{
+public:
+    using MeshID = uint32_t;
+
+    struct Range
+    {
+        uint32_t firstIndex{ 0 };
+        int32_t  vertexOffset{ 0 };
+        uint32_t indexCount{ 0 };
+        uint32_t vertexCount{ 0 };
+    };
+
+    GeometryPool(GeometryPool const&) = delete;
+    GeometryPool& operator=(GeometryPool const&) = delete;
+
+    GeometryPool() = default;
+    ~GeometryPool() { destroy(); }
+
+    void init(DeviceAllocator& allocator, vk::Device device, vk::PhysicalDevice physicalDevice, vk::Queue queue,
+        uint32_t queueIdx, uint32_t vertexCapacity = 1u << 20, uint32_t indexCapacity = 4u << 20);
+
+    void destroy();
+
+    // Every LOD of mesh.indices is uploaded, LOD offsets stay relative to firstIndex
+    MeshID addMesh(const tools::Mesh& mesh);
+
+    // Free the ranges, the GPU must be done with them
+    void removeMesh(MeshID id);
+
+    // Submit pending uploads and wait for them
+    void flush();
+
+    // Vertex binding 0 and the uint32 index buffer
+    void bind(vk::CommandBuffer cmdBuffer) const;
+
+    // Getting Methods
+    const Range& getRange(MeshID id) const { return m_meshes[id]; }
+    vk::Buffer   getVertexBuffer()   const { return m_vertexBuffer; }
+    vk::Buffer   getIndexBuffer()    const { return m_indexBuffer; }
+    uint32_t     getVertexCapacity() const { return m_vertexCapacity; }
+    uint32_t     getIndexCapacity()  const { return m_indexCapacity; }
+    uint32_t     getVertexCount()    const { return static_cast<uint32_t>(m_vertexRanges.getUsed()); }
+    uint32_t     getIndexCount()     const { return static_cast<uint32_t>(m_indexRanges.getUsed()); }
+
+private:
+
+    // Copy size bytes to dst at offset, flushes when staging is full
+    void upload(vk::Buffer dst, vk::DeviceSize offset, const void* data, vk::DeviceSize size);
+
+    DeviceAllocator*                   m_allocator{ nullptr };
+    vk::Device                         m_device;
+    vk::Queue                          m_queue;
+
+    vk::Buffer                         m_vertexBuffer;
+    vk::Buffer                         m_indexBuffer;
+    DeviceAllocator::AllocationID      m_vertexAllocation{ ~0u };
+    DeviceAllocator::AllocationID      m_indexAllocation{ ~0u };
+    uint32_t                           m_vertexCapacity{ 0 };
+    uint32_t                           m_indexCapacity{ 0 };
+    RangeAllocator                     m_vertexRanges;     // in vertices
+    RangeAllocator                     m_indexRanges;      // in indices
+
+    std::vector<Range>                 m_meshes;
+    std::vector<MeshID>                m_freeIDs;
+
+    // Staging
+    vk::Buffer                         m_stagingBuffer;
+    vk::DeviceMemory                   m_stagingMemory;
+    uint8_t*                           m_stagingData{ nullptr };
+    vk::DeviceSize                     m_stagingSize{ 8ull << 20 };
+    vk::DeviceSize                     m_stagingOffset{ 0 };
+
+    vk::CommandPool                    m_commandPool;
+    vk::CommandBuffer                  m_commandBuffer;
+    vk::Fence                          m_fence;
+    bool                               m_recording{ false };
+
+}; // class GeometryPool
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
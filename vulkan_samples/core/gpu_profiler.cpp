@@ -0,0 +1,179 @@
+/*
+ *
+ * Andrew Frost
+ * gpu_profiler.cpp
+ * 2020
+ *
+ */
+
+#include <cassert>
+
+#include "gpu_profiler.hpp"
+
+namespace vkb {
+namespace core {
+
+static const float AVERAGE_WEIGHT = 0.05f;
+
+///////////////////////////////////////////////////////////////////////////
+// GpuProfiler                                                           //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization, profiling is disabled when the queue has no timestamps
+//
+void GpuProfiler::init(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t queueFamilyIdx,
+    uint32_t framesInFlight, uint32_t maxSections)
+{
+    assert(!m_device && "GpuProfiler already initialized");
+    m_device = device;
+    m_maxSections = maxSections;
+
+    const vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+    const uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIdx].timestampValidBits;
+
+    m_supported = validBits > 0 && properties.limits.timestampPeriod > 0.f;
+    m_period = properties.limits.timestampPeriod;
+    m_validMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+    if (!m_supported)
+        return;
+
+    vk::QueryPoolCreateInfo poolInfo = {};
+    poolInfo.queryType = vk::QueryType::eTimestamp;
+    poolInfo.queryCount = 2 * maxSections;
+
+    m_frames.resize(framesInFlight);
+    for (auto& frame : m_frames) {
+        try {
+            frame.pool = m_device.createQueryPool(poolInfo);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+        frame.names.reserve(maxSections);
+        frame.depths.reserve(maxSections);
+    }
+
+    m_results.resize(2 * maxSections);
+}
+
+//-------------------------------------------------------------------------
+// Destroy query pools
+//
+void GpuProfiler::destroy()
+{
+    if (!m_device)
+        return;
+
+    for (auto& frame : m_frames)
+        m_device.destroyQueryPool(frame.pool);
+    m_frames.clear();
+    m_sections.clear();
+
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Read back the results of frameIdx's last use and reset its queries,
+// the caller has waited on the frame's fence
+//
+void GpuProfiler::beginFrame(vk::CommandBuffer cmdBuffer, uint32_t frameIdx)
+{
+    if (!m_supported)
+        return;
+
+    assert(m_open.empty() && "section still open at frame start");
+
+    m_current = frameIdx;
+    Frame& frame = m_frames[frameIdx];
+
+    collect(frame);
+
+    frame.names.clear();
+    frame.depths.clear();
+    frame.used = 0;
+
+    cmdBuffer.resetQueryPool(frame.pool, 0, 2 * m_maxSections);
+}
+
+//-------------------------------------------------------------------------
+// Open a section, sections nest
+//
+void GpuProfiler::beginSection(vk::CommandBuffer cmdBuffer, const char* name)
+{
+    if (!m_supported)
+        return;
+
+    Frame& frame = m_frames[m_current];
+    if (frame.used == m_maxSections) {
+        m_open.push_back(~0u);
+        return;
+    }
+
+    const uint32_t index = frame.used++;
+    frame.names.push_back(name);
+    frame.depths.push_back(static_cast<uint32_t>(m_open.size()));
+    m_open.push_back(index);
+
+    cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, frame.pool, 2 * index);
+}
+
+//-------------------------------------------------------------------------
+// Close the innermost section
+//
+void GpuProfiler::endSection(vk::CommandBuffer cmdBuffer)
+{
+    if (!m_supported)
+        return;
+
+    assert(!m_open.empty() && "endSection without beginSection");
+
+    const uint32_t index = m_open.back();
+    m_open.pop_back();
+
+    if (index != ~0u)
+        cmdBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_frames[m_current].pool, 2 * index + 1);
+}
+
+//-------------------------------------------------------------------------
+// Convert the frame's timestamps into section times
+//
+void GpuProfiler::collect(Frame& frame)
+{
+    if (frame.used == 0)
+        return;
+
+    const vk::Result result = m_device.getQueryPoolResults(frame.pool, 0, 2 * frame.used,
+        2 * frame.used * sizeof(uint64_t), m_results.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess)
+        return;
+
+    float frameMs = 0.f;
+    for (uint32_t i = 0; i < frame.used; i++) {
+        const uint64_t ticks = ((m_results[2 * i + 1] & m_validMask) - (m_results[2 * i] & m_validMask)) & m_validMask;
+        const float ms = static_cast<float>(ticks * m_period * 1e-6);
+
+        uint32_t s = 0;
+        while (s < m_sections.size() && m_sections[s].name != frame.names[i])
+            s++;
+        if (s == m_sections.size()) {
+            Section section;
+            section.name = frame.names[i];
+            section.avgMs = ms;
+            m_sections.push_back(section);
+        }
+
+        Section& section = m_sections[s];
+        section.ms = ms;
+        section.avgMs += (ms - section.avgMs) * AVERAGE_WEIGHT;
+        section.depth = frame.depths[i];
+
+        if (section.depth == 0)
+            frameMs += ms;
+    }
+    m_frameMs = frameMs;
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,88 @@
+/*
+ *
+ * Andrew Frost
+ * gpu_profiler.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// GpuProfiler                                                           //
+///////////////////////////////////////////////////////////////////////////
+// Timestamp queries around named sections of a frame                   //
+// - one query pool per frame in flight, read back after its fence has  //
+//   been waited on so the results never stall                          //
+// - section names are string literals, compared by pointer             //
+///////////////////////////////////////////////////////////////////////////
+
+class GpuProfiler
+{
+public:
+    GpuProfiler(GpuProfiler const&) = delete;
+    GpuProfiler& operator=(GpuProfiler const&) = delete;
+
+    GpuProfiler() = default;
+    ~GpuProfiler() { destroy(); }
+
+    struct Section
+    {
+        const char* name{ nullptr };
+        float       ms{ 0.f };
+        float       avgMs{ 0.f };
+        uint32_t    depth{ 0 };
+    };
+
+    void init(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t queueFamilyIdx,
+        uint32_t framesInFlight, uint32_t maxSections = 32);
+
+    void destroy();
+
+    // Read back the results of frameIdx's last use and reset its queries
+    void beginFrame(vk::CommandBuffer cmdBuffer, uint32_t frameIdx);
+
+    void beginSection(vk::CommandBuffer cmdBuffer, const char* name);
+    void endSection(vk::CommandBuffer cmdBuffer);
+
+    // Getting Methods
+    bool                        isSupported() const { return m_supported; }
+    const std::vector<Section>& getSections() const { return m_sections; }
+    float                       getFrameMs()  const { return m_frameMs; }
+
+private:
+
+    struct Frame
+    {
+        vk::QueryPool            pool;
+        std::vector<const char*> names;
+        std::vector<uint32_t>    depths;
+        uint32_t                 used{ 0 };
+    };
+
+    void collect(Frame& frame);
+
+    vk::Device                 m_device;
+    std::vector<Frame>         m_frames;
+    uint32_t                   m_current{ 0 };
+    std::vector<uint32_t>      m_open;
+
+    std::vector<Section>       m_sections;
+    std::vector<uint64_t>      m_results;
+    float                      m_frameMs{ 0.f };
+
+    uint32_t                   m_maxSections{ 0 };
+    float                      m_period{ 1.f };    // nanoseconds per tick
+    uint64_t                   m_validMask{ ~0ull };
+    bool                       m_supported{ false };
+
+}; // class GpuProfiler
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
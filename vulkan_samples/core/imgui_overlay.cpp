@@ -0,0 +1,499 @@
+/*
+ *
+ * Andrew Frost
+ * imgui_overlay.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "imgui_overlay.hpp"
+#include "vk_utils.hpp"
+
+#include "../external/imgui/imgui.h"
+#include "../external/imgui/imgui_impl_glfw.h"
+#include "../external/imgui/imgui_impl_vulkan.h"
+
+#ifdef _DEBUG
+#include "../helper/debug.hpp"
+static vkb::debug::DebugUtil s_debug;
+#endif // _DEBUG
+
+namespace vkb {
+namespace core {
+
+//-------------------------------------------------------------------------
+// ImGui Vulkan back-end error callback
+//
+static void checkVkResult(VkResult err)
+{
+    if (err < 0)
+        throw std::runtime_error("imgui vulkan back-end error!");
+}
+
+///////////////////////////////////////////////////////////////////////////
+// ImGuiOverlay                                                          //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization
+//
+void ImGuiOverlay::init(GLFWwindow* window, vk::Instance instance, vk::PhysicalDevice physicalDevice,
+    vk::Device device, vk::Queue queue, uint32_t queueIdx, vk::PipelineCache pipelineCache, const SwapChain& swapchain,
+    OneShotSubmitter& oneShot)
+{
+    assert(!m_device && "ImGuiOverlay already initialized");
+    m_instance = instance;
+    m_physicalDevice = physicalDevice;
+    m_device = device;
+    m_queue = queue;
+    m_queueIdx = queueIdx;
+    m_pipelineCache = pipelineCache;
+
+#if _DEBUG
+    s_debug.setup(device, instance);
+#endif
+
+    // Font texture is the only descriptor
+    vk::DescriptorPoolSize poolSize = { vk::DescriptorType::eCombinedImageSampler, 1 };
+
+    vk::DescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    try {
+        m_descriptorPool = m_device.createDescriptorPool(poolInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create imgui descriptor pool!");
+    }
+
+    createRenderPass(swapchain.getFormat());
+    createFramebuffers(swapchain);
+
+    // ImGui context and back-ends
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui::StyleColorsDark();
+    ImGui::GetIO().IniFilename = nullptr;
+
+    ImGui_ImplGlfw_InitForVulkan(window, true);
+
+    initBackend(swapchain.getImageCount());
+
+    uploadFonts(oneShot);
+
+    createWorker(queueIdx, m_ringSize);
+}
+
+//-------------------------------------------------------------------------
+// ImGui Vulkan back-end, one more vertex/index buffer set than images.
+// A cached overlay keeps referencing its set while the next one is
+// written
+//
+void ImGuiOverlay::initBackend(uint32_t imageCount)
+{
+    m_ringSize = std::max(2u, imageCount) + 1;
+
+    ImGui_ImplVulkan_InitInfo initInfo = {};
+    initInfo.Instance = m_instance;
+    initInfo.PhysicalDevice = m_physicalDevice;
+    initInfo.Device = m_device;
+    initInfo.QueueFamily = m_queueIdx;
+    initInfo.Queue = m_queue;
+    initInfo.PipelineCache = m_pipelineCache;
+    initInfo.DescriptorPool = m_descriptorPool;
+    initInfo.MinImageCount = std::max(2u, imageCount);
+    initInfo.ImageCount = m_ringSize;
+    initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+    initInfo.Allocator = nullptr;
+    initInfo.CheckVkResultFn = checkVkResult;
+
+    ImGui_ImplVulkan_Init(&initInfo, m_renderPass);
+}
+
+//-------------------------------------------------------------------------
+// Resize both rings. ImGui_ImplVulkan_SetMinImageCount() only drops the
+// back-end's buffer sets, their count is taken at init, so the back-end
+// is shut down and initialized again. Its font descriptor set is not
+// freed by the shutdown, the pool is reset instead
+//
+void ImGuiOverlay::setImageCount(uint32_t imageCount, OneShotSubmitter& oneShot)
+{
+    if (!m_device || std::max(2u, imageCount) + 1 == m_ringSize)
+        return;
+
+    // a pending recording writes the current rings
+    waitForWorker();
+    destroyWorker();
+
+    ImGui_ImplVulkan_SetMinImageCount(std::max(2u, imageCount));
+    ImGui_ImplVulkan_Shutdown();
+    m_device.resetDescriptorPool(m_descriptorPool);
+
+    initBackend(imageCount);
+    uploadFonts(oneShot);
+
+    createWorker(m_queueIdx, m_ringSize);
+}
+
+//-------------------------------------------------------------------------
+// Destroy ImGui and the overlay pass
+//
+void ImGuiOverlay::destroy()
+{
+    if (!m_device)
+        return;
+
+    destroyWorker();
+
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+
+    for (auto framebuffer : m_framebuffers)
+        m_device.destroyFramebuffer(framebuffer);
+    m_framebuffers.clear();
+
+    m_device.destroyRenderPass(m_renderPass);
+    m_device.destroyDescriptorPool(m_descriptorPool);
+
+    m_inFrame = false;
+    m_frameReady = false;
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Color only pass, keeps what the scene pass presented
+//
+void ImGuiOverlay::createRenderPass(vk::Format colorFormat)
+{
+    vk::AttachmentDescription attachment = {};
+    attachment.format = colorFormat;
+    attachment.samples = vk::SampleCountFlagBits::e1;
+    attachment.loadOp = vk::AttachmentLoadOp::eLoad;
+    attachment.storeOp = vk::AttachmentStoreOp::eStore;
+    attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    attachment.initialLayout = vk::ImageLayout::ePresentSrcKHR;
+    attachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+
+    const vk::AttachmentReference colorReference{ 0, vk::ImageLayout::eColorAttachmentOptimal };
+
+    vk::SubpassDescription subpass = {};
+    subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorReference;
+
+    vk::SubpassDependency dependency = {};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    dependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+    dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead
+                             | vk::AccessFlagBits::eColorAttachmentWrite;
+    dependency.dependencyFlags = vk::DependencyFlagBits::eByRegion;
+
+    vk::RenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &attachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.pDependencies = &dependency;
+
+    try {
+        m_renderPass = m_device.createRenderPass(renderPassInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create imgui render pass!");
+    }
+
+#if _DEBUG
+    s_debug.setObjectName(m_renderPass, "ImGuiOverlay::m_renderPass");
+#endif
+}
+
+//-------------------------------------------------------------------------
+// One framebuffer per swapchain image
+//
+void ImGuiOverlay::createFramebuffers(const SwapChain& swapchain)
+{
+    for (auto framebuffer : m_framebuffers)
+        m_device.destroyFramebuffer(framebuffer);
+    m_framebuffers.resize(swapchain.getImageCount());
+
+    m_extent = vk::Extent2D(swapchain.getWidth(), swapchain.getHeight());
+
+    vk::ImageView attachment;
+
+    vk::FramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.renderPass = m_renderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &attachment;
+    framebufferInfo.width = m_extent.width;
+    framebufferInfo.height = m_extent.height;
+    framebufferInfo.layers = 1;
+
+    for (uint32_t i = 0; i < swapchain.getImageCount(); i++) {
+        attachment = swapchain.getImageView(i);
+
+        try {
+            m_framebuffers[i] = m_device.createFramebuffer(framebufferInfo);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to create imgui framebuffer!");
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+// Upload the font atlas with the pending setup work and wait for its
+// batch, the staging buffer is freed right after
+//
+void ImGuiOverlay::uploadFonts(OneShotSubmitter& oneShot)
+{
+    oneShot.submitOneShot([](vk::CommandBuffer cmdBuffer) {
+        ImGui_ImplVulkan_CreateFontsTexture(cmdBuffer);
+    }, true);
+
+    ImGui_ImplVulkan_DestroyFontUploadObjects();
+}
+
+//-------------------------------------------------------------------------
+// Worker thread and its command pool, secondaries only inherit the
+// render pass so they stay valid for every framebuffer
+//
+void ImGuiOverlay::createWorker(uint32_t queueIdx, uint32_t count)
+{
+    vk::CommandPoolCreateInfo poolInfo = {};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+    poolInfo.queueFamilyIndex = queueIdx;
+
+    try {
+        m_workerPool = m_device.createCommandPool(poolInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create command pool!");
+    }
+
+    vk::CommandBufferAllocateInfo allocInfo = {};
+    allocInfo.commandPool = m_workerPool;
+    allocInfo.level = vk::CommandBufferLevel::eSecondary;
+    allocInfo.commandBufferCount = count;
+
+    try {
+        m_secondaries = m_device.allocateCommandBuffers(allocInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to allocate command buffers!");
+    }
+
+#if _DEBUG
+    for (size_t i = 0; i < m_secondaries.size(); i++) {
+        const std::string name = "ImGuiOverlay::m_secondaries" + std::to_string(i);
+        s_debug.setObjectName(m_secondaries[i], name.c_str());
+    }
+#endif
+
+    m_current = ~0u;
+    m_next = 0;
+    m_recordedHash = 0;
+    m_quit = false;
+    m_worker = std::thread(&ImGuiOverlay::workerLoop, this);
+}
+
+//-------------------------------------------------------------------------
+// Stop the worker and free its pool
+//
+void ImGuiOverlay::destroyWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_condition.notify_all();
+    if (m_worker.joinable())
+        m_worker.join();
+
+    m_device.freeCommandBuffers(m_workerPool, m_secondaries);
+    m_device.destroyCommandPool(m_workerPool);
+    m_secondaries.clear();
+}
+
+//-------------------------------------------------------------------------
+// Record the pending draw data into the next secondary of the ring
+//
+void ImGuiOverlay::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_condition.wait(lock, [this] { return m_jobPending || m_quit; });
+        if (m_quit)
+            return;
+
+        ImDrawData* drawData = m_jobData;
+        const uint32_t target = m_next;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            vk::CommandBufferInheritanceInfo inheritance = {};
+            inheritance.renderPass = m_renderPass;
+            inheritance.subpass = 0;
+
+            vk::CommandBufferBeginInfo beginInfo = {};
+            beginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue
+                            | vk::CommandBufferUsageFlagBits::eSimultaneousUse;
+            beginInfo.pInheritanceInfo = &inheritance;
+
+            vk::CommandBuffer cmdBuffer = m_secondaries[target];
+            cmdBuffer.begin(beginInfo);
+            ImGui_ImplVulkan_RenderDrawData(drawData, cmdBuffer);
+            cmdBuffer.end();
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        if (!error) {
+            m_current = target;
+            m_next = (target + 1) % static_cast<uint32_t>(m_secondaries.size());
+            m_recordedHash = m_jobHash;
+            m_recordCount++;
+        }
+        m_jobError = error;
+        m_jobPending = false;
+        m_condition.notify_all();
+    }
+}
+
+//-------------------------------------------------------------------------
+// Block until the pending recording, if any, is done
+//
+void ImGuiOverlay::waitForWorker()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return !m_jobPending; });
+
+    if (m_jobError) {
+        std::exception_ptr error = m_jobError;
+        m_jobError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+//-------------------------------------------------------------------------
+// Hash of everything that ends up in the overlay command buffer
+//
+uint64_t ImGuiOverlay::hashDrawData(const ImDrawData* drawData)
+{
+    const float frame[6] = { drawData->DisplayPos.x, drawData->DisplayPos.y,
+        drawData->DisplaySize.x, drawData->DisplaySize.y,
+        drawData->FramebufferScale.x, drawData->FramebufferScale.y };
+    uint64_t hash = hashBytes(frame, sizeof(frame));
+
+    for (int n = 0; n < drawData->CmdListsCount; n++) {
+        const ImDrawList* cmdList = drawData->CmdLists[n];
+        hash = hashBytes(cmdList->VtxBuffer.Data, cmdList->VtxBuffer.Size * sizeof(ImDrawVert), hash);
+        hash = hashBytes(cmdList->IdxBuffer.Data, cmdList->IdxBuffer.Size * sizeof(ImDrawIdx), hash);
+
+        for (int i = 0; i < cmdList->CmdBuffer.Size; i++) {
+            const ImDrawCmd& cmd = cmdList->CmdBuffer[i];
+            hash = hashBytes(&cmd.ClipRect, sizeof(cmd.ClipRect), hash);
+            hash = hashBytes(&cmd.TextureId, sizeof(cmd.TextureId), hash);
+            hash = hashBytes(&cmd.ElemCount, sizeof(cmd.ElemCount), hash);
+            hash = hashBytes(&cmd.VtxOffset, sizeof(cmd.VtxOffset), hash);
+            hash = hashBytes(&cmd.IdxOffset, sizeof(cmd.IdxOffset), hash);
+        }
+    }
+
+    return hash;
+}
+
+//-------------------------------------------------------------------------
+// Start an ImGui frame
+//
+void ImGuiOverlay::newFrame()
+{
+    // draw data of the last frame is in use until recorded
+    waitForWorker();
+
+    // previous frame was never rendered, e.g. the swapchain was out of date
+    if (m_inFrame)
+        ImGui::EndFrame();
+
+    ImGui_ImplVulkan_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+    m_inFrame = true;
+    m_frameReady = false;
+}
+
+//-------------------------------------------------------------------------
+// Finish the ImGui frame, the overlay is recorded while the scene is
+//
+void ImGuiOverlay::endFrame()
+{
+    if (!m_inFrame)
+        return;
+
+    ImGui::Render();
+    m_inFrame = false;
+    m_frameReady = true;
+
+    ImDrawData* drawData = ImGui::GetDrawData();
+
+    // user callbacks may draw differently for the same data
+    bool hasCallback = false;
+    for (int n = 0; n < drawData->CmdListsCount && !hasCallback; n++) {
+        for (int i = 0; i < drawData->CmdLists[n]->CmdBuffer.Size && !hasCallback; i++)
+            hasCallback = drawData->CmdLists[n]->CmdBuffer[i].UserCallback != nullptr;
+    }
+
+    const uint64_t hash = hashDrawData(drawData);
+    if (hash == m_recordedHash && m_current != ~0u && !hasCallback)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobData = drawData;
+        m_jobHash = hash;
+        m_jobPending = true;
+    }
+    m_condition.notify_all();
+}
+
+//-------------------------------------------------------------------------
+// Execute the cached overlay
+//
+void ImGuiOverlay::render(vk::CommandBuffer cmdBuffer, uint32_t imageIndex)
+{
+    if (!m_frameReady)
+        return;
+    m_frameReady = false;
+
+    waitForWorker();
+
+    if (m_current == ~0u)
+        return;
+
+    vk::RenderPassBeginInfo beginInfo = {};
+    beginInfo.renderPass = m_renderPass;
+    beginInfo.framebuffer = m_framebuffers[imageIndex];
+    beginInfo.renderArea = vk::Rect2D({ 0, 0 }, m_extent);
+
+    cmdBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+    cmdBuffer.executeCommands(m_secondaries[m_current]);
+    cmdBuffer.endRenderPass();
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
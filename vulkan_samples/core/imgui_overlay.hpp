@@ -0,0 +1,133 @@
+/*
+ *
+ * Andrew Frost
+ * imgui_overlay.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "GLFW/glfw3.h"
+
+#include "command_pools.hpp"
+#include "swapchain.hpp"
+
+struct ImDrawData;
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// ImGuiOverlay                                                          //
+///////////////////////////////////////////////////////////////////////////
+// ImGui drawn in its own render pass on top of the presented image     //
+// - loads the swapchain image as left by the scene pass               //
+// - nothing is recorded, and no ImGui frame is started, while hidden   //
+// - ImDrawData is hashed every frame, the overlay is re-recorded into  //
+//   a secondary command buffer on a worker thread only when it changed //
+//   and the cached one is executed otherwise                           //
+// - the secondaries and ImGui's vertex/index buffers are rings of one  //
+//   more than the swapchain images, setImageCount() resizes both      //
+///////////////////////////////////////////////////////////////////////////
+
+class ImGuiOverlay
+{
+public:
+    ImGuiOverlay(ImGuiOverlay const&) = delete;
+    ImGuiOverlay& operator=(ImGuiOverlay const&) = delete;
+
+    ImGuiOverlay() = default;
+    ~ImGuiOverlay() { destroy(); }
+
+    void init(GLFWwindow* window, vk::Instance instance, vk::PhysicalDevice physicalDevice, vk::Device device,
+        vk::Queue queue, uint32_t queueIdx, vk::PipelineCache pipelineCache, const SwapChain& swapchain,
+        OneShotSubmitter& oneShot);
+
+    void destroy();
+
+    // Rebuild framebuffers after the swapchain changed
+    void createFramebuffers(const SwapChain& swapchain);
+
+    // Swapchain rebuilt with another image count, the device must be idle.
+    // Restarts the worker and the ImGui back-end, the fonts are uploaded again
+    void setImageCount(uint32_t imageCount, OneShotSubmitter& oneShot);
+
+    // Start an ImGui frame, widgets may be submitted afterwards
+    void newFrame();
+
+    // Finish the ImGui frame, starts re-recording when the draw data changed
+    void endFrame();
+
+    // Record the overlay pass, waits for the worker
+    void render(vk::CommandBuffer cmdBuffer, uint32_t imageIndex);
+
+    // Getting Methods
+    vk::RenderPass getRenderPass()  const { return m_renderPass; }
+    bool           isInFrame()      const { return m_inFrame; }
+    bool           isFrameReady()   const { return m_frameReady; }
+    uint32_t       getRecordCount() const { return m_recordCount; }
+
+private:
+
+    void createRenderPass(vk::Format colorFormat);
+
+    void initBackend(uint32_t imageCount);
+
+    void uploadFonts(OneShotSubmitter& oneShot);
+
+    void createWorker(uint32_t queueIdx, uint32_t count);
+
+    void destroyWorker();
+
+    void workerLoop();
+
+    void waitForWorker();
+
+    static uint64_t hashDrawData(const ImDrawData* drawData);
+
+    vk::Instance                   m_instance;
+    vk::PhysicalDevice             m_physicalDevice;
+    vk::Device                     m_device;
+    vk::Queue                      m_queue;
+    uint32_t                       m_queueIdx{ 0 };
+    vk::PipelineCache              m_pipelineCache;
+
+    vk::DescriptorPool             m_descriptorPool;
+    vk::RenderPass                 m_renderPass;
+    std::vector<vk::Framebuffer>   m_framebuffers;
+    vk::Extent2D                   m_extent{ 0, 0 };
+
+    bool                           m_inFrame{ false };
+    bool                           m_frameReady{ false };
+
+    // Cached overlay, ring of secondaries so none is re-recorded in flight
+    vk::CommandPool                m_workerPool;
+    std::vector<vk::CommandBuffer> m_secondaries;
+    uint32_t                       m_ringSize{ 0 };      // ImGui's buffer sets too
+    uint32_t                       m_current{ ~0u };
+    uint32_t                       m_next{ 0 };
+    uint64_t                       m_recordedHash{ 0 };
+    uint32_t                       m_recordCount{ 0 };
+
+    // Worker, records one job at a time
+    std::thread                    m_worker;
+    std::mutex                     m_mutex;
+    std::condition_variable        m_condition;
+    ImDrawData*                    m_jobData{ nullptr };
+    uint64_t                       m_jobHash{ 0 };
+    bool                           m_jobPending{ false };
+    bool                           m_quit{ false };
+    std::exception_ptr             m_jobError;
+
+}; // class ImGuiOverlay
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
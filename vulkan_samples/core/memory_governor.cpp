@@ -0,0 +1,234 @@
+/*
+ *
+ * Andrew Frost
+ * memory_governor.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "memory_governor.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// MemoryGovernor                                                        //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization
+//
+void MemoryGovernor::init(vk::Instance instance, vk::PhysicalDevice physicalDevice, bool budgetExtension,
+    uint32_t framesInFlight)
+{
+    assert(!m_physicalDevice && "MemoryGovernor already initialized");
+
+    m_physicalDevice = physicalDevice;
+    m_framesInFlight = std::max(framesInFlight, 1u);
+    m_memProperties = physicalDevice.getMemoryProperties();
+
+    // extension entry point, the static loader does not export it
+    if (budgetExtension) {
+        m_getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(
+            instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+    }
+    m_budgetSupported = m_getMemoryProperties2 != nullptr;
+
+    m_heaps.resize(m_memProperties.memoryHeapCount);
+    m_cooldown.assign(m_memProperties.memoryHeapCount, 0);
+
+    m_deviceLocalHeap = 0;
+    for (uint32_t i = 0; i < m_memProperties.memoryHeapCount; i++) {
+        m_heaps[i].size = m_memProperties.memoryHeaps[i].size;
+        m_heaps[i].deviceLocal = !!(m_memProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+    }
+    for (uint32_t i = 0; i < m_memProperties.memoryHeapCount; i++) {
+        if (m_heaps[i].deviceLocal) {
+            m_deviceLocalHeap = i;
+            break;
+        }
+    }
+
+    poll();
+}
+
+//-------------------------------------------------------------------------
+// Call on exit
+//
+void MemoryGovernor::destroy()
+{
+    if (!m_physicalDevice)
+        return;
+
+    m_clients.clear();
+    m_order.clear();
+    m_heaps.clear();
+    m_cooldown.clear();
+    m_getMemoryProperties2 = nullptr;
+    m_evictionCount = 0;
+
+    m_physicalDevice = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Register memory that can be given back, usage is also what the heap
+// reports when the driver has no budget extension
+//
+MemoryGovernor::ClientID MemoryGovernor::addClient(const std::string& name, uint32_t heapIndex, int priority,
+    UsageFn usage, EvictFn evict)
+{
+    assert(heapIndex < m_heaps.size() && "heap index out of range");
+
+    const ClientID id = static_cast<ClientID>(m_clients.size());
+
+    Client client;
+    client.name = name;
+    client.heapIndex = heapIndex;
+    client.priority = priority;
+    client.usage = std::move(usage);
+    client.evict = std::move(evict);
+    m_clients.push_back(std::move(client));
+
+    m_order.push_back(id);
+    std::stable_sort(m_order.begin(), m_order.end(), [this](ClientID a, ClientID b) {
+        return m_clients[a].priority < m_clients[b].priority;
+    });
+
+    return id;
+}
+
+//-------------------------------------------------------------------------
+// IDs stay valid, the slot keeps its name and statistics
+//
+void MemoryGovernor::removeClient(ClientID id)
+{
+    m_clients[id].usage = nullptr;
+    m_clients[id].evict = nullptr;
+    m_order.erase(std::remove(m_order.begin(), m_order.end(), id), m_order.end());
+}
+
+//-------------------------------------------------------------------------
+// Per heap budget and usage
+//
+void MemoryGovernor::poll()
+{
+    if (m_budgetSupported) {
+        vk::PhysicalDeviceMemoryBudgetPropertiesEXT budget = {};
+        vk::PhysicalDeviceMemoryProperties2 properties = {};
+        properties.pNext = &budget;
+
+        m_getMemoryProperties2(m_physicalDevice, reinterpret_cast<VkPhysicalDeviceMemoryProperties2*>(&properties));
+
+        for (uint32_t i = 0; i < m_heaps.size(); i++) {
+            // some drivers report 0 or more than the heap before the first allocation
+            m_heaps[i].budget = budget.heapBudget[i] ? std::min(budget.heapBudget[i], m_heaps[i].size) : m_heaps[i].size;
+            m_heaps[i].usage = budget.heapUsage[i];
+        }
+        return;
+    }
+
+    for (auto& heap : m_heaps) {
+        heap.budget = static_cast<vk::DeviceSize>(heap.size * m_fallbackShare);
+        heap.usage = 0;
+    }
+    for (ClientID id : m_order) {
+        const Client& client = m_clients[id];
+        if (client.usage)
+            m_heaps[client.heapIndex].usage += client.usage();
+    }
+}
+
+//-------------------------------------------------------------------------
+// Lowest priority first until enough is released
+//
+vk::DeviceSize MemoryGovernor::evict(uint32_t heapIndex, vk::DeviceSize bytes)
+{
+    vk::DeviceSize released = 0;
+
+    for (ClientID id : m_order) {
+        if (released >= bytes)
+            break;
+
+        Client& client = m_clients[id];
+        if (client.heapIndex != heapIndex || !client.evict)
+            continue;
+
+        const vk::DeviceSize freed = client.evict(bytes - released);
+        client.evictedBytes += freed;
+        released += freed;
+    }
+
+    if (released)
+        m_evictionCount++;
+
+    return released;
+}
+
+//-------------------------------------------------------------------------
+// Once per frame. Clients release memory once the frames using it have
+// finished, so a heap is not checked again until then
+//
+void MemoryGovernor::update()
+{
+    poll();
+
+    for (uint32_t i = 0; i < m_heaps.size(); i++) {
+        Heap& heap = m_heaps[i];
+        heap.pressure = heap.usage > static_cast<vk::DeviceSize>(heap.budget * m_highWater);
+
+        if (m_cooldown[i]) {
+            m_cooldown[i]--;
+            continue;
+        }
+        if (!heap.pressure)
+            continue;
+
+        const vk::DeviceSize target = static_cast<vk::DeviceSize>(heap.budget * m_lowWater);
+        if (evict(i, heap.usage - target))
+            m_cooldown[i] = m_framesInFlight + 1;
+    }
+}
+
+//-------------------------------------------------------------------------
+// Evict ahead of a large allocation instead of letting it fail or page
+//
+bool MemoryGovernor::reserve(uint32_t memoryTypeIndex, vk::DeviceSize size)
+{
+    assert(memoryTypeIndex < m_memProperties.memoryTypeCount && "memory type out of range");
+
+    const uint32_t heapIndex = m_memProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    const Heap& heap = m_heaps[heapIndex];
+
+    if (heap.usage + size <= heap.budget)
+        return true;
+
+    const vk::DeviceSize target = static_cast<vk::DeviceSize>(heap.budget * m_lowWater);
+    const vk::DeviceSize needed = heap.usage + size - std::min(target, heap.usage + size);
+    const vk::DeviceSize released = evict(heapIndex, needed);
+    if (released)
+        m_cooldown[heapIndex] = m_framesInFlight + 1;
+
+    return heap.usage + size <= heap.budget + released;
+}
+
+//-------------------------------------------------------------------------
+// The driver ran out of memory before the budget did, the reported usage
+// cannot be trusted so size bytes are asked for as they are
+//
+vk::DeviceSize MemoryGovernor::release(uint32_t memoryTypeIndex, vk::DeviceSize size)
+{
+    assert(memoryTypeIndex < m_memProperties.memoryTypeCount && "memory type out of range");
+
+    const uint32_t heapIndex = m_memProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    const vk::DeviceSize released = evict(heapIndex, size);
+    if (released)
+        m_cooldown[heapIndex] = m_framesInFlight + 1;
+
+    return released;
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,127 @@
+/*
+ *
+ * Andrew Frost
+ * memory_governor.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// MemoryGovernor                                                        //
+///////////////////////////////////////////////////////////////////////////
+// Per heap budget and usage, polled once per frame                     //
+// - with VK_EXT_memory_budget both come from the driver and include   //
+//   other processes                                                    //
+// - without it the budget is a fixed share of the heap and usage is   //
+//   the sum of what the registered clients report                      //
+// Clients own memory they can give back (streamed mips, mesh caches,  //
+// transient pools). When usage passes the high watermark they are     //
+// asked, lowest priority first, to free down to the low watermark     //
+///////////////////////////////////////////////////////////////////////////
+
+class MemoryGovernor
+{
+public:
+    using ClientID = uint32_t;
+
+    // Bytes currently held by a client
+    using UsageFn = std::function<vk::DeviceSize()>;
+    // Free about the requested bytes, returns what will be released
+    using EvictFn = std::function<vk::DeviceSize(vk::DeviceSize bytes)>;
+
+    struct Heap
+    {
+        vk::DeviceSize size{ 0 };
+        vk::DeviceSize budget{ 0 };
+        vk::DeviceSize usage{ 0 };
+        bool           deviceLocal{ false };
+        bool           pressure{ false };   // over the high watermark this frame
+    };
+
+    struct Client
+    {
+        std::string    name;
+        uint32_t       heapIndex{ 0 };
+        int            priority{ 0 };       // lower gives memory back first
+        UsageFn        usage;
+        EvictFn        evict;
+        vk::DeviceSize evictedBytes{ 0 };
+    };
+
+    MemoryGovernor(MemoryGovernor const&) = delete;
+    MemoryGovernor& operator=(MemoryGovernor const&) = delete;
+
+    MemoryGovernor() = default;
+    ~MemoryGovernor() { destroy(); }
+
+    // budgetExtension: VK_EXT_memory_budget was enabled on the device
+    void init(vk::Instance instance, vk::PhysicalDevice physicalDevice, bool budgetExtension,
+        uint32_t framesInFlight);
+
+    void destroy();
+
+    ClientID addClient(const std::string& name, uint32_t heapIndex, int priority, UsageFn usage, EvictFn evict);
+    void     removeClient(ClientID id);
+
+    // Poll budgets and ask clients for memory when over the high watermark
+    void update();
+
+    // Swapchain rebuilt with another image count, evictions cool down for it
+    void setFramesInFlight(uint32_t framesInFlight) { m_framesInFlight = std::max(framesInFlight, 1u); }
+
+    // Make room ahead of an allocation, false when it still does not fit
+    bool reserve(uint32_t memoryTypeIndex, vk::DeviceSize size);
+
+    // An allocation failed below the budget, evict size bytes regardless
+    vk::DeviceSize release(uint32_t memoryTypeIndex, vk::DeviceSize size);
+
+    // Fractions of the budget, evicts from high down to low
+    void setWatermarks(float high, float low) { m_highWater = high; m_lowWater = low; }
+
+    // Getting Methods
+    const std::vector<Heap>&   getHeaps()           const { return m_heaps; }
+    const std::vector<Client>& getClients()         const { return m_clients; }
+    uint32_t                   getDeviceLocalHeap() const { return m_deviceLocalHeap; }
+    uint32_t                   getEvictionCount()   const { return m_evictionCount; }
+    bool                       isBudgetSupported()  const { return m_budgetSupported; }
+
+private:
+
+    void poll();
+
+    // Ask clients of heapIndex for bytes, returns what they release
+    vk::DeviceSize evict(uint32_t heapIndex, vk::DeviceSize bytes);
+
+    vk::PhysicalDevice                          m_physicalDevice;
+    vk::PhysicalDeviceMemoryProperties          m_memProperties;
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR m_getMemoryProperties2{ nullptr };
+    bool                                        m_budgetSupported{ false };
+
+    std::vector<Heap>                           m_heaps;
+    std::vector<uint32_t>                       m_cooldown;        // frames until a heap is checked again
+    uint32_t                                    m_deviceLocalHeap{ 0 };
+    uint32_t                                    m_framesInFlight{ 1 };
+
+    std::vector<Client>                         m_clients;         // removed clients have no evict function
+    std::vector<ClientID>                       m_order;           // by priority
+
+    float                                       m_highWater{ 0.9f };
+    float                                       m_lowWater{ 0.8f };
+    float                                       m_fallbackShare{ 0.8f };  // of the heap without the extension
+    uint32_t                                    m_evictionCount{ 0 };
+
+}; // class MemoryGovernor
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
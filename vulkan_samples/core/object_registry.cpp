@@ -0,0 +1,206 @@
+/*
+ *
+ * Andrew Frost
+ * object_registry.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+
+#include "object_registry.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// ObjectRegistry                                                        //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// New handle of a type, a reused handle value replaces the old record
+//
+void ObjectRegistry::add(vk::ObjectType type, uint64_t handle, vk::DeviceSize size, const char* name)
+{
+    if (!m_enabled)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    TypeEntry& entry = m_types[type];
+
+    Record& record = entry.live[handle];
+    entry.bytes -= record.size;
+
+    record.size = size;
+    record.frame = m_frame;
+    record.name = name ? name : "";
+
+    entry.created++;
+    entry.bytes += size;
+    entry.peakBytes = std::max(entry.peakBytes, entry.bytes);
+}
+
+//-------------------------------------------------------------------------
+// Handle destroyed, unknown ones were created before tracking or by
+// code that is not instrumented
+//
+void ObjectRegistry::remove(vk::ObjectType type, uint64_t handle)
+{
+    if (!m_enabled)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto typeIt = m_types.find(type);
+    if (typeIt == m_types.end())
+        return;
+
+    TypeEntry& entry = typeIt->second;
+    auto it = entry.live.find(handle);
+    if (it == entry.live.end())
+        return;
+
+    entry.bytes -= it->second.size;
+    entry.destroyed++;
+    entry.live.erase(it);
+}
+
+//-------------------------------------------------------------------------
+// Name of a live handle, in every build unlike the debug utils names
+//
+void ObjectRegistry::rename(vk::ObjectType type, uint64_t handle, const char* name)
+{
+    if (!m_enabled)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto typeIt = m_types.find(type);
+    if (typeIt == m_types.end())
+        return;
+
+    auto it = typeIt->second.live.find(handle);
+    if (it != typeIt->second.live.end())
+        it->second.name = name ? name : "";
+}
+
+//-------------------------------------------------------------------------
+// Counters per type, in ObjectType order
+//
+std::vector<ObjectRegistry::TypeStats> ObjectRegistry::getTypeStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<TypeStats> stats;
+    stats.reserve(m_types.size());
+    for (const auto& type : m_types) {
+        TypeStats entry;
+        entry.type = type.first;
+        entry.live = static_cast<uint32_t>(type.second.live.size());
+        entry.created = type.second.created;
+        entry.destroyed = type.second.destroyed;
+        entry.bytes = type.second.bytes;
+        entry.peakBytes = type.second.peakBytes;
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+//-------------------------------------------------------------------------
+// Totals, bytes are those of device memory objects
+//
+uint32_t ObjectRegistry::getLiveCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t count = 0;
+    for (const auto& type : m_types)
+        count += static_cast<uint32_t>(type.second.live.size());
+    return count;
+}
+
+vk::DeviceSize ObjectRegistry::getLiveBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_types.find(vk::ObjectType::eDeviceMemory);
+    return it != m_types.end() ? it->second.bytes : 0;
+}
+
+//-------------------------------------------------------------------------
+// One line per live object, nothing when every object was destroyed
+//
+uint32_t ObjectRegistry::reportLeaks(std::ostream& out, uint32_t maxPerType) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t leaks = 0;
+    for (const auto& type : m_types)
+        leaks += static_cast<uint32_t>(type.second.live.size());
+    if (leaks == 0)
+        return 0;
+
+    out << "object registry: " << leaks << " object(s) alive at shutdown\n";
+
+    for (const auto& type : m_types) {
+        const TypeEntry& entry = type.second;
+        if (entry.live.empty())
+            continue;
+
+        out << "  " << vk::to_string(type.first) << ": " << entry.live.size() << " live, "
+            << entry.bytes << " bytes, " << entry.created << " created, " << entry.destroyed << " destroyed\n";
+
+        // oldest first, long lived leaks are the interesting ones
+        std::vector<std::pair<uint64_t, const Record*>> records;
+        records.reserve(entry.live.size());
+        for (const auto& record : entry.live)
+            records.push_back({ record.first, &record.second });
+        std::sort(records.begin(), records.end(), [](const std::pair<uint64_t, const Record*>& a,
+            const std::pair<uint64_t, const Record*>& b) { return a.second->frame < b.second->frame; });
+
+        const size_t listed = std::min<size_t>(records.size(), maxPerType);
+        for (size_t i = 0; i < listed; i++) {
+            char line[64];
+            snprintf(line, sizeof(line), "    0x%016llx", static_cast<unsigned long long>(records[i].first));
+            out << line << " frame " << records[i].second->frame << ", " << records[i].second->size << " bytes";
+            if (!records[i].second->name.empty())
+                out << " \"" << records[i].second->name << "\"";
+            out << "\n";
+        }
+        if (records.size() > listed)
+            out << "    ... " << records.size() - listed << " more\n";
+    }
+
+    out.flush();
+    return leaks;
+}
+
+//-------------------------------------------------------------------------
+// Literal names, nothing is allocated while the HUD shows
+//
+const char* ObjectRegistry::typeName(vk::ObjectType type)
+{
+    switch (type) {
+    case vk::ObjectType::eBuffer:               return "buffer";
+    case vk::ObjectType::eImage:                return "image";
+    case vk::ObjectType::eImageView:            return "image view";
+    case vk::ObjectType::eDeviceMemory:         return "memory";
+    case vk::ObjectType::eSampler:              return "sampler";
+    case vk::ObjectType::eFence:                return "fence";
+    case vk::ObjectType::eSemaphore:            return "semaphore";
+    case vk::ObjectType::eEvent:                return "event";
+    case vk::ObjectType::eQueryPool:            return "query pool";
+    case vk::ObjectType::eCommandPool:          return "command pool";
+    case vk::ObjectType::eFramebuffer:          return "framebuffer";
+    case vk::ObjectType::eRenderPass:           return "render pass";
+    case vk::ObjectType::ePipeline:             return "pipeline";
+    case vk::ObjectType::ePipelineLayout:       return "pipeline layout";
+    case vk::ObjectType::ePipelineCache:        return "pipeline cache";
+    case vk::ObjectType::eShaderModule:         return "shader module";
+    case vk::ObjectType::eDescriptorPool:       return "descriptor pool";
+    case vk::ObjectType::eDescriptorSetLayout:  return "set layout";
+    default:                                    return "other";
+    }
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
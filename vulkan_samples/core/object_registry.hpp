@@ -0,0 +1,162 @@
+/*
+ *
+ * Andrew Frost
+ * object_registry.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "vk_utils.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// ObjectTraits                                                          //
+///////////////////////////////////////////////////////////////////////////
+
+template <typename T> struct ObjectTraits;
+
+template <> struct ObjectTraits<vk::Buffer>              { static vk::ObjectType type() { return vk::ObjectType::eBuffer; } };
+template <> struct ObjectTraits<vk::Image>               { static vk::ObjectType type() { return vk::ObjectType::eImage; } };
+template <> struct ObjectTraits<vk::ImageView>           { static vk::ObjectType type() { return vk::ObjectType::eImageView; } };
+template <> struct ObjectTraits<vk::DeviceMemory>        { static vk::ObjectType type() { return vk::ObjectType::eDeviceMemory; } };
+template <> struct ObjectTraits<vk::Sampler>             { static vk::ObjectType type() { return vk::ObjectType::eSampler; } };
+template <> struct ObjectTraits<vk::Fence>               { static vk::ObjectType type() { return vk::ObjectType::eFence; } };
+template <> struct ObjectTraits<vk::Semaphore>           { static vk::ObjectType type() { return vk::ObjectType::eSemaphore; } };
+template <> struct ObjectTraits<vk::Event>               { static vk::ObjectType type() { return vk::ObjectType::eEvent; } };
+template <> struct ObjectTraits<vk::QueryPool>           { static vk::ObjectType type() { return vk::ObjectType::eQueryPool; } };
+template <> struct ObjectTraits<vk::CommandPool>         { static vk::ObjectType type() { return vk::ObjectType::eCommandPool; } };
+template <> struct ObjectTraits<vk::Framebuffer>         { static vk::ObjectType type() { return vk::ObjectType::eFramebuffer; } };
+template <> struct ObjectTraits<vk::RenderPass>          { static vk::ObjectType type() { return vk::ObjectType::eRenderPass; } };
+template <> struct ObjectTraits<vk::Pipeline>            { static vk::ObjectType type() { return vk::ObjectType::ePipeline; } };
+template <> struct ObjectTraits<vk::PipelineLayout>      { static vk::ObjectType type() { return vk::ObjectType::ePipelineLayout; } };
+template <> struct ObjectTraits<vk::PipelineCache>       { static vk::ObjectType type() { return vk::ObjectType::ePipelineCache; } };
+template <> struct ObjectTraits<vk::ShaderModule>        { static vk::ObjectType type() { return vk::ObjectType::eShaderModule; } };
+template <> struct ObjectTraits<vk::DescriptorPool>      { static vk::ObjectType type() { return vk::ObjectType::eDescriptorPool; } };
+template <> struct ObjectTraits<vk::DescriptorSetLayout> { static vk::ObjectType type() { return vk::ObjectType::eDescriptorSetLayout; } };
+
+///////////////////////////////////////////////////////////////////////////
+// ObjectRegistry                                                        //
+///////////////////////////////////////////////////////////////////////////
+// Every tracked handle from creation to destruction, in release builds  //
+// as well, so growth in long sessions can be attributed to a type     //
+// - onCreate() records size, name and the frame of creation,          //
+//   onDestroy() removes it, null handles are ignored                  //
+// - size is the allocation of device memory and the memory requirement //
+//   of images and buffers, each under its own type; getLiveBytes()     //
+//   only sums device memory so bound resources are not counted twice  //
+// - reportLeaks() lists what is still alive, VkBackend calls it        //
+//   before destroying the device                                      //
+// - only objects created through instrumented code are tracked,       //
+//   destroying an unknown handle is a no-op                           //
+///////////////////////////////////////////////////////////////////////////
+
+class ObjectRegistry
+{
+public:
+    static ObjectRegistry& Singleton()
+    {
+        static ObjectRegistry registry;
+        return registry;
+    }
+
+    ObjectRegistry(ObjectRegistry const&) = delete;
+    ObjectRegistry& operator=(ObjectRegistry const&) = delete;
+
+    template <typename T>
+    void onCreate(const T& object, vk::DeviceSize size = 0, const char* name = nullptr)
+    {
+        if (object)
+            add(ObjectTraits<T>::type(), handleOf(object), size, name);
+    }
+
+    template <typename T>
+    void onDestroy(const T& object)
+    {
+        if (object)
+            remove(ObjectTraits<T>::type(), handleOf(object));
+    }
+
+    template <typename T>
+    void setName(const T& object, const char* name)
+    {
+        if (object)
+            rename(ObjectTraits<T>::type(), handleOf(object), name);
+    }
+
+    // Creation frame of the objects that follow, once per frame
+    void nextFrame() { m_frame++; }
+
+    // Disabled, calls return right away and nothing new is recorded
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+
+    struct TypeStats
+    {
+        vk::ObjectType type{ vk::ObjectType::eUnknown };
+        uint32_t       live{ 0 };
+        uint64_t       created{ 0 };
+        uint64_t       destroyed{ 0 };
+        vk::DeviceSize bytes{ 0 };
+        vk::DeviceSize peakBytes{ 0 };
+    };
+
+    // Live objects and bytes per type, for metrics and the HUD
+    std::vector<TypeStats> getTypeStats() const;
+
+    uint32_t       getLiveCount() const;
+    vk::DeviceSize getLiveBytes() const;     // device memory
+    uint64_t       getFrame()     const { return m_frame; }
+
+    // Objects still alive, oldest first per type, returns the count
+    uint32_t reportLeaks(std::ostream& out, uint32_t maxPerType = 16) const;
+
+    // Short static name of a tracked type, for the HUD and metrics
+    static const char* typeName(vk::ObjectType type);
+
+private:
+
+    ObjectRegistry() = default;
+
+    struct Record
+    {
+        vk::DeviceSize size{ 0 };
+        uint64_t       frame{ 0 };
+        std::string    name;
+    };
+
+    struct TypeEntry
+    {
+        std::unordered_map<uint64_t, Record> live;
+        uint64_t                             created{ 0 };
+        uint64_t                             destroyed{ 0 };
+        vk::DeviceSize                       bytes{ 0 };
+        vk::DeviceSize                       peakBytes{ 0 };
+    };
+
+    void add(vk::ObjectType type, uint64_t handle, vk::DeviceSize size, const char* name);
+    void remove(vk::ObjectType type, uint64_t handle);
+    void rename(vk::ObjectType type, uint64_t handle, const char* name);
+
+    mutable std::mutex                  m_mutex;
+    std::map<vk::ObjectType, TypeEntry> m_types;
+    std::atomic<uint64_t>               m_frame{ 0 };
+    std::atomic<bool>                   m_enabled{ true };
+
+}; // class ObjectRegistry
+
+} // namespace core
+} // namespace vkb
+
+#define VkObjects vkb::core::ObjectRegistry::Singleton()
\ No newline at end of file
@@ -0,0 +1,573 @@
+/*
+ *
+ * Andrew Frost
+ * occlusion_culler.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include "object_registry.hpp"
+#include "occlusion_culler.hpp"
+#include "vk_utils.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// OcclusionCuller                                                       //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization, buffers are sized for the capacity up front. The
+// pyramid follows with createTargets()
+//
+void OcclusionCuller::init(vk::Device device, vk::PhysicalDevice physicalDevice, DeviceAllocator& allocator,
+    ShaderLibrary& shaders, PipelineVariants& variants, uint32_t frameCount, uint32_t maxCandidates, uint32_t maxDraws)
+{
+    assert(!m_device && "OcclusionCuller already initialized");
+    m_device = device;
+    m_physicalDevice = physicalDevice;
+    m_allocator = &allocator;
+    m_maxCandidates = maxCandidates;
+    m_maxDraws = maxDraws;
+
+    m_buildProgram = &shaders.createProgram({ &shaders.loadFromFile("shaders/hiz_build.comp.spv") });
+    m_cullProgram = &shaders.createProgram({ &shaders.loadFromFile("shaders/occlusion_cull.comp.spv") });
+    m_buildPipeline = variants.getCompute(*m_buildProgram);
+    m_cullPipeline = variants.getCompute(*m_cullProgram);
+
+    // texelFetch of the depth and textureLod of one pyramid level
+    vk::SamplerCreateInfo samplerInfo = {};
+    samplerInfo.magFilter = vk::Filter::eNearest;
+    samplerInfo.minFilter = vk::Filter::eNearest;
+    samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+    samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    try {
+        m_sampler = m_device.createSampler(samplerInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create occlusion culling sampler!");
+    }
+    VkObjects.onCreate(m_sampler, 0, "OcclusionCuller");
+
+    // Candidates and draw templates, written by the host every frame
+    const vk::DeviceSize candidateBytes = vk::DeviceSize(m_maxCandidates) * sizeof(gpu::GpuCullCandidate);
+    const vk::DeviceSize drawBytes = 2 * vk::DeviceSize(m_maxDraws) * sizeof(gpu::GpuDrawCommand);
+    const vk::MemoryPropertyFlags hostMemory =
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+    m_frames.resize(frameCount);
+    for (auto& frame : m_frames) {
+        createBuffer(m_device, m_physicalDevice, candidateBytes, vk::BufferUsageFlagBits::eStorageBuffer,
+            hostMemory, frame.candidateBuffer, frame.candidateMemory);
+        VkObjects.onCreate(frame.candidateBuffer, candidateBytes, "OcclusionCuller");
+        VkObjects.onCreate(frame.candidateMemory, candidateBytes, "OcclusionCuller");
+
+        createBuffer(m_device, m_physicalDevice, drawBytes, vk::BufferUsageFlagBits::eTransferSrc,
+            hostMemory, frame.templateBuffer, frame.templateMemory);
+        VkObjects.onCreate(frame.templateBuffer, drawBytes, "OcclusionCuller");
+        VkObjects.onCreate(frame.templateMemory, drawBytes, "OcclusionCuller");
+
+        frame.candidates = static_cast<gpu::GpuCullCandidate*>(
+            m_device.mapMemory(frame.candidateMemory, 0, VK_WHOLE_SIZE));
+        frame.templates = static_cast<gpu::GpuDrawCommand*>(
+            m_device.mapMemory(frame.templateMemory, 0, VK_WHOLE_SIZE));
+    }
+
+    // Draws, instance lists and the build counter, only touched by the device
+    const vk::DeviceSize instanceBytes = 2 * vk::DeviceSize(m_maxCandidates) * sizeof(uint32_t);
+    const vk::DeviceSize retestBytes = vk::DeviceSize(m_maxCandidates) * sizeof(uint32_t);
+
+    createBuffer(m_device, m_physicalDevice, drawBytes, vk::BufferUsageFlagBits::eStorageBuffer
+        | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal, m_drawBuffer, m_drawMemory);
+    VkObjects.onCreate(m_drawBuffer, drawBytes, "OcclusionCuller");
+    VkObjects.onCreate(m_drawMemory, drawBytes, "OcclusionCuller");
+
+    createBuffer(m_device, m_physicalDevice, instanceBytes, vk::BufferUsageFlagBits::eStorageBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal, m_instanceBuffer, m_instanceMemory);
+    VkObjects.onCreate(m_instanceBuffer, instanceBytes, "OcclusionCuller");
+    VkObjects.onCreate(m_instanceMemory, instanceBytes, "OcclusionCuller");
+
+    createBuffer(m_device, m_physicalDevice, retestBytes, vk::BufferUsageFlagBits::eStorageBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal, m_retestBuffer, m_retestMemory);
+    VkObjects.onCreate(m_retestBuffer, retestBytes, "OcclusionCuller");
+    VkObjects.onCreate(m_retestMemory, retestBytes, "OcclusionCuller");
+
+    createBuffer(m_device, m_physicalDevice, sizeof(uint32_t),
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal, m_counterBuffer, m_counterMemory);
+    VkObjects.onCreate(m_counterBuffer, sizeof(uint32_t), "OcclusionCuller");
+    VkObjects.onCreate(m_counterMemory, sizeof(uint32_t), "OcclusionCuller");
+}
+
+//-------------------------------------------------------------------------
+// Call on exit
+//
+void OcclusionCuller::destroy()
+{
+    if (!m_device)
+        return;
+
+    destroyTargets();
+
+    for (auto& frame : m_frames) {
+        VkObjects.onDestroy(frame.candidateBuffer);
+        VkObjects.onDestroy(frame.candidateMemory);
+        VkObjects.onDestroy(frame.templateBuffer);
+        VkObjects.onDestroy(frame.templateMemory);
+        m_device.unmapMemory(frame.candidateMemory);
+        m_device.unmapMemory(frame.templateMemory);
+        m_device.destroyBuffer(frame.candidateBuffer);
+        m_device.freeMemory(frame.candidateMemory);
+        m_device.destroyBuffer(frame.templateBuffer);
+        m_device.freeMemory(frame.templateMemory);
+    }
+    m_frames.clear();
+
+    const std::array<std::pair<vk::Buffer*, vk::DeviceMemory*>, 4> buffers = { {
+        { &m_drawBuffer, &m_drawMemory },
+        { &m_instanceBuffer, &m_instanceMemory },
+        { &m_retestBuffer, &m_retestMemory },
+        { &m_counterBuffer, &m_counterMemory },
+    } };
+    for (const auto& buffer : buffers) {
+        VkObjects.onDestroy(*buffer.first);
+        VkObjects.onDestroy(*buffer.second);
+        m_device.destroyBuffer(*buffer.first);
+        m_device.freeMemory(*buffer.second);
+        *buffer.first = nullptr;
+        *buffer.second = nullptr;
+    }
+
+    VkObjects.onDestroy(m_sampler);
+    m_device.destroySampler(m_sampler);
+    m_sampler = nullptr;
+
+    // programs and pipelines belong to the library and variant cache
+    m_buildProgram = nullptr;
+    m_cullProgram = nullptr;
+    m_buildPipeline = nullptr;
+    m_cullPipeline = nullptr;
+    m_allocator = nullptr;
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Pyramid at the viewport rounded down to a power of two, so every level
+// halves exactly, with a view per level and the descriptor sets reading
+// them. The previous pyramid was of another depth buffer, no history
+//
+void OcclusionCuller::createTargets(vk::Image depthImage, vk::Format depthFormat, vk::Extent2D viewport)
+{
+    destroyTargets();
+
+    m_depthImage = depthImage;
+    m_historyValid = false;
+
+    const uint32_t maxSize = 1u << (gpu::GPU_HIZ_MAX_LEVELS - 1);
+    auto floorPow2 = [maxSize](uint32_t value) {
+        uint32_t result = 1;
+        while (result * 2 <= value && result < maxSize)
+            result *= 2;
+        return result;
+    };
+    m_hizExtent = vk::Extent2D(floorPow2(viewport.width), floorPow2(viewport.height));
+
+    uint32_t levelCount = 1;
+    while ((std::max(m_hizExtent.width, m_hizExtent.height) >> levelCount) > 0)
+        levelCount++;
+
+    // one group per 64x64 tile of level 0, as in hiz_build.comp
+    const uint32_t groupCount = ((m_hizExtent.width + 63) / 64) * ((m_hizExtent.height + 63) / 64);
+    m_buildParams = { viewport.width, viewport.height, m_hizExtent.width, m_hizExtent.height, levelCount, groupCount };
+
+    // Depth aspect of the depth buffer
+    vk::ImageViewCreateInfo depthViewInfo = {};
+    depthViewInfo.image = m_depthImage;
+    depthViewInfo.viewType = vk::ImageViewType::e2D;
+    depthViewInfo.format = depthFormat;
+    depthViewInfo.subresourceRange = { vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1 };
+
+    try {
+        m_depthView = m_device.createImageView(depthViewInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create occlusion culling depth view!");
+    }
+    VkObjects.onCreate(m_depthView, 0, "OcclusionCuller");
+
+    // Pyramid, general layout for both the build and the tests
+    vk::ImageCreateInfo imageInfo = {};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.extent = vk::Extent3D(m_hizExtent.width, m_hizExtent.height, 1);
+    imageInfo.format = vk::Format::eR32Sfloat;
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+    // pinned, no move callback
+    m_hizAllocation = m_allocator->createImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal,
+        vk::ImageLayout::eGeneral, m_hizImage);
+
+    vk::ImageViewCreateInfo viewInfo = {};
+    viewInfo.image = m_hizImage;
+    viewInfo.viewType = vk::ImageViewType::e2D;
+    viewInfo.format = vk::Format::eR32Sfloat;
+    viewInfo.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, 1 };
+
+    try {
+        m_hizView = m_device.createImageView(viewInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create occlusion culling pyramid view!");
+    }
+    VkObjects.onCreate(m_hizView, 0, "OcclusionCuller");
+
+    m_hizLevelViews.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        viewInfo.subresourceRange = { vk::ImageAspectFlagBits::eColor, level, 1, 0, 1 };
+
+        try {
+            m_hizLevelViews[level] = m_device.createImageView(viewInfo);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to create occlusion culling pyramid view!");
+        }
+        VkObjects.onCreate(m_hizLevelViews[level], 0, "OcclusionCuller");
+    }
+
+    // One build set, one cull set per frame
+    const uint32_t frameCount = static_cast<uint32_t>(m_frames.size());
+    const std::array<vk::DescriptorPoolSize, 3> poolSizes = { {
+        { vk::DescriptorType::eCombinedImageSampler, 1 + frameCount },
+        { vk::DescriptorType::eStorageImage, gpu::GPU_HIZ_MAX_LEVELS },
+        { vk::DescriptorType::eStorageBuffer, 1 + 4 * frameCount },
+    } };
+
+    vk::DescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.maxSets = 1 + frameCount;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    try {
+        m_descriptorPool = m_device.createDescriptorPool(poolInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create occlusion culling descriptor pool!");
+    }
+    VkObjects.onCreate(m_descriptorPool, 0, "OcclusionCuller");
+
+    std::vector<vk::DescriptorSetLayout> layouts(1 + frameCount, m_cullProgram->setLayouts[0]);
+    layouts[0] = m_buildProgram->setLayouts[0];
+
+    vk::DescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+    allocInfo.pSetLayouts = layouts.data();
+
+    std::vector<vk::DescriptorSet> sets;
+    try {
+        sets = m_device.allocateDescriptorSets(allocInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to allocate occlusion culling descriptor sets!");
+    }
+
+    // Build, every array element is written, levels past the last repeat it
+    m_buildSet = sets[0];
+    {
+        const vk::DescriptorImageInfo depthInfo{ m_sampler, m_depthView, vk::ImageLayout::eDepthStencilReadOnlyOptimal };
+        const vk::DescriptorBufferInfo counterInfo{ m_counterBuffer, 0, VK_WHOLE_SIZE };
+
+        std::array<vk::DescriptorImageInfo, gpu::GPU_HIZ_MAX_LEVELS> levelInfos;
+        for (uint32_t level = 0; level < gpu::GPU_HIZ_MAX_LEVELS; level++)
+            levelInfos[level] = { nullptr, m_hizLevelViews[std::min(level, levelCount - 1)], vk::ImageLayout::eGeneral };
+
+        std::array<vk::WriteDescriptorSet, 3> writes = {};
+        writes[0].dstSet = m_buildSet;
+        writes[0].dstBinding = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        writes[0].pImageInfo = &depthInfo;
+        writes[1].dstSet = m_buildSet;
+        writes[1].dstBinding = 1;
+        writes[1].descriptorCount = static_cast<uint32_t>(levelInfos.size());
+        writes[1].descriptorType = vk::DescriptorType::eStorageImage;
+        writes[1].pImageInfo = levelInfos.data();
+        writes[2].dstSet = m_buildSet;
+        writes[2].dstBinding = 2;
+        writes[2].descriptorCount = 1;
+        writes[2].descriptorType = vk::DescriptorType::eStorageBuffer;
+        writes[2].pBufferInfo = &counterInfo;
+
+        m_device.updateDescriptorSets(writes, nullptr);
+    }
+
+    // Cull, only the candidates differ per frame
+    const vk::DescriptorImageInfo hizInfo{ m_sampler, m_hizView, vk::ImageLayout::eGeneral };
+
+    for (uint32_t i = 0; i < frameCount; i++) {
+        m_frames[i].descriptorSet = sets[1 + i];
+
+        const std::array<vk::DescriptorBufferInfo, 4> bufferInfos = { {
+            { m_frames[i].candidateBuffer, 0, VK_WHOLE_SIZE },
+            { m_drawBuffer, 0, VK_WHOLE_SIZE },
+            { m_instanceBuffer, 0, VK_WHOLE_SIZE },
+            { m_retestBuffer, 0, VK_WHOLE_SIZE },
+        } };
+
+        std::array<vk::WriteDescriptorSet, 5> writes = {};
+        for (uint32_t binding = 0; binding < bufferInfos.size(); binding++) {
+            writes[binding].dstSet = m_frames[i].descriptorSet;
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorCount = 1;
+            writes[binding].descriptorType = vk::DescriptorType::eStorageBuffer;
+            writes[binding].pBufferInfo = &bufferInfos[binding];
+        }
+        writes[4].dstSet = m_frames[i].descriptorSet;
+        writes[4].dstBinding = 4;
+        writes[4].descriptorCount = 1;
+        writes[4].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        writes[4].pImageInfo = &hizInfo;
+
+        m_device.updateDescriptorSets(writes, nullptr);
+    }
+}
+
+//-------------------------------------------------------------------------
+// Device is idle, from destroy() or a swapchain rebuild
+//
+void OcclusionCuller::destroyTargets()
+{
+    VkObjects.onDestroy(m_descriptorPool);
+    m_device.destroyDescriptorPool(m_descriptorPool);
+    m_descriptorPool = nullptr;
+    m_buildSet = nullptr;
+
+    for (auto view : m_hizLevelViews) {
+        VkObjects.onDestroy(view);
+        m_device.destroyImageView(view);
+    }
+    m_hizLevelViews.clear();
+
+    VkObjects.onDestroy(m_hizView);
+    VkObjects.onDestroy(m_depthView);
+    m_device.destroyImageView(m_hizView);
+    m_device.destroyImageView(m_depthView);
+    m_hizView = nullptr;
+    m_depthView = nullptr;
+
+    if (m_hizAllocation)
+        m_allocator->destroyResource(m_hizAllocation);
+    m_hizAllocation = 0;
+    m_hizImage = nullptr;
+    m_depthImage = nullptr;
+    m_historyValid = false;
+}
+
+//-------------------------------------------------------------------------
+// Candidates in the order of the selector's instance list, so a draw's
+// early and late lists can not outgrow its range. Templates carry the
+// selector's draws with no instances
+//
+bool OcclusionCuller::update(uint32_t frame, const tools::Camera& camera, const tools::LodSelector& selector)
+{
+    Frame& current = m_frames[frame];
+
+    const std::vector<tools::DrawIndexedIndirect>& draws = selector.getDraws();
+    const std::vector<uint32_t>& instances = selector.getInstanceIndices();
+
+    if (draws.size() > m_maxDraws || instances.size() > m_maxCandidates) {
+        current.params.candidateCount = 0;
+        current.params.drawCount = 0;
+        return false;
+    }
+
+    const uint32_t drawCount = static_cast<uint32_t>(draws.size());
+    const uint32_t candidateCount = static_cast<uint32_t>(instances.size());
+
+    for (uint32_t d = 0; d < drawCount; d++) {
+        const tools::DrawIndexedIndirect& draw = draws[d];
+
+        current.templates[d] = { draw.indexCount, 0, draw.firstIndex, draw.vertexOffset, draw.firstInstance };
+        current.templates[drawCount + d] = current.templates[d];
+        current.templates[drawCount + d].firstInstance += candidateCount;
+
+        for (uint32_t i = draw.firstInstance; i < draw.firstInstance + draw.instanceCount; i++) {
+            const glm::vec4 bounds = selector.getInstanceBounds(instances[i]);
+            current.candidates[i] = { gpu::vec3(bounds), bounds.w, instances[i], d };
+        }
+    }
+
+    gpu::GpuCamera gpuCamera;
+    camera.getGpuCamera(gpuCamera);
+
+    current.params.viewProj = gpuCamera.viewProj;
+    current.params.hizSize = gpu::vec2(static_cast<float>(m_hizExtent.width), static_cast<float>(m_hizExtent.height));
+    current.params.levelCount = m_buildParams.levelCount;
+    current.params.candidateCount = candidateCount;
+    current.params.drawCount = drawCount;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// Reset the draws from the templates and test against the history
+//
+void OcclusionCuller::recordEarly(vk::CommandBuffer cmdBuffer, uint32_t frame)
+{
+    const Frame& current = m_frames[frame];
+
+    // last frame's draws still read the lists, its late phase wrote the pyramid
+    vk::MemoryBarrier previous = {};
+    previous.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    previous.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+        | vk::AccessFlagBits::eTransferWrite;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader
+        | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer
+        | vk::PipelineStageFlagBits::eComputeShader, {}, previous, nullptr, nullptr);
+
+    if (current.params.drawCount > 0) {
+        const vk::BufferCopy region{ 0, 0, 2 * vk::DeviceSize(current.params.drawCount) * sizeof(gpu::GpuDrawCommand) };
+        cmdBuffer.copyBuffer(current.templateBuffer, m_drawBuffer, region);
+    }
+
+    vk::MemoryBarrier reset = {};
+    reset.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    reset.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {},
+        reset, nullptr, nullptr);
+
+    dispatchCull(cmdBuffer, current, 0, m_historyViewProj);
+
+    // early draws, and the flags and counts of the late phase
+    vk::MemoryBarrier culled = {};
+    culled.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    culled.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead
+        | vk::AccessFlagBits::eShaderWrite;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect
+        | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eComputeShader, {},
+        culled, nullptr, nullptr);
+}
+
+//-------------------------------------------------------------------------
+// Build the pyramid from the early depth and retest the rejections. The
+// whole pyramid is rewritten, its old contents are discarded
+//
+void OcclusionCuller::recordLate(vk::CommandBuffer cmdBuffer, uint32_t frame)
+{
+    const Frame& current = m_frames[frame];
+
+    cmdBuffer.fillBuffer(m_counterBuffer, 0, sizeof(uint32_t), 0);
+
+    vk::MemoryBarrier cleared = {};
+    cleared.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    cleared.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+
+    std::array<vk::ImageMemoryBarrier, 2> barriers = {};
+    barriers[0].srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    barriers[0].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    barriers[0].oldLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+    barriers[0].newLayout = vk::ImageLayout::eDepthStencilReadOnlyOptimal;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = m_depthImage;
+    barriers[0].subresourceRange = { vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil, 0, 1, 0, 1 };
+
+    // the early phase sampled the history
+    barriers[1].srcAccessMask = {};
+    barriers[1].dstAccessMask = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eShaderRead;
+    barriers[1].oldLayout = vk::ImageLayout::eUndefined;
+    barriers[1].newLayout = vk::ImageLayout::eGeneral;
+    barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].image = m_hizImage;
+    barriers[1].subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, 1 };
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eTransfer
+        | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {},
+        cleared, nullptr, barriers);
+
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_buildPipeline);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_buildProgram->pipelineLayout, 0,
+        m_buildSet, nullptr);
+    cmdBuffer.pushConstants(m_buildProgram->pipelineLayout, m_buildProgram->pushConstantStages, 0,
+        sizeof(gpu::GpuHiZParams), &m_buildParams);
+    cmdBuffer.dispatch(m_buildParams.groupCount, 1, 1);
+
+    // pyramid to the late phase, depth back to the second scene pass
+    barriers[0].srcAccessMask = vk::AccessFlagBits::eShaderRead;
+    barriers[0].dstAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentRead
+        | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    barriers[0].oldLayout = vk::ImageLayout::eDepthStencilReadOnlyOptimal;
+    barriers[0].newLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+    barriers[1].srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    barriers[1].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    barriers[1].oldLayout = vk::ImageLayout::eGeneral;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader
+        | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests, {},
+        nullptr, nullptr, barriers);
+
+    dispatchCull(cmdBuffer, current, 1, current.params.viewProj);
+
+    vk::MemoryBarrier culled = {};
+    culled.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    culled.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead;
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect
+        | vk::PipelineStageFlagBits::eVertexShader, {}, culled, nullptr, nullptr);
+
+    m_historyViewProj = current.params.viewProj;
+    m_historyValid = true;
+}
+
+//-------------------------------------------------------------------------
+// One invocation per candidate, viewProj is that of the tested pyramid
+//
+void OcclusionCuller::dispatchCull(vk::CommandBuffer cmdBuffer, const Frame& frame, uint32_t phase,
+    const gpu::mat4& viewProj)
+{
+    gpu::GpuCullParams params = frame.params;
+    params.viewProj = viewProj;
+    params.phase = phase;
+    params.historyValid = m_historyValid ? 1 : 0;
+
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_cullPipeline);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_cullProgram->pipelineLayout, 0,
+        frame.descriptorSet, nullptr);
+    cmdBuffer.pushConstants(m_cullProgram->pipelineLayout, m_cullProgram->pushConstantStages, 0,
+        sizeof(gpu::GpuCullParams), &params);
+    // groups of 64 as in occlusion_cull.comp
+    cmdBuffer.dispatch((params.candidateCount + 63) / 64, 1, 1);
+}
+
+//-------------------------------------------------------------------------
+// Depth created sampled, pyramid levels indexed by a uniform variable
+// and R32 storage images
+//
+bool OcclusionCuller::isSupported(vk::PhysicalDevice physicalDevice, vk::ImageUsageFlags depthUsage)
+{
+    if (!(depthUsage & vk::ImageUsageFlagBits::eSampled))
+        return false;
+
+    if (!physicalDevice.getFeatures().shaderStorageImageArrayDynamicIndexing)
+        return false;
+
+    const vk::FormatProperties properties = physicalDevice.getFormatProperties(vk::Format::eR32Sfloat);
+    return static_cast<bool>(properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eStorageImage);
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,142 @@
+/*
+ *
+ * Andrew Frost
+ * occlusion_culler.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "../helper/camera.hpp"
+#include "../helper/mesh_lod.hpp"
+#include "device_allocator.hpp"
+#include "pipeline_variants.hpp"
+#include "shader_library.hpp"
+#include "../common/gpu_structs.h"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// OcclusionCuller                                                       //
+///////////////////////////////////////////////////////////////////////////
+// Two phase occlusion culling of the LOD selector's visible instances  //
+// against a Hi-Z pyramid of the depth buffer                           //
+// - early: candidates are tested against last frame's pyramid and its //
+//   view projection, survivors are drawn by the first scene pass      //
+// - late: the pyramid is rebuilt from the early depth in one dispatch //
+//   and the rejected candidates are tested again, survivors are drawn //
+//   by a second pass loading the first one's attachments              //
+// - the pyramid of the early depth is next frame's history, it lacks  //
+//   the late draws and only occludes less than it could               //
+// - draws are the selector's, instance counts and the instance index  //
+//   lists are written by the device. Late lists follow the early ones //
+// - without history, after createTargets(), everything is drawn early //
+///////////////////////////////////////////////////////////////////////////
+
+class OcclusionCuller
+{
+public:
+    OcclusionCuller(OcclusionCuller const&) = delete;
+    OcclusionCuller& operator=(OcclusionCuller const&) = delete;
+
+    OcclusionCuller() = default;
+    ~OcclusionCuller() { destroy(); }
+
+    void init(vk::Device device, vk::PhysicalDevice physicalDevice, DeviceAllocator& allocator, ShaderLibrary& shaders,
+        PipelineVariants& variants, uint32_t frameCount, uint32_t maxCandidates = 65536, uint32_t maxDraws = 1024);
+
+    // Device must be idle
+    void destroy();
+
+    // Pyramid and descriptors for the depth buffer, after init and after
+    // every rebuild. viewport is the rendered area of a larger depth image
+    void createTargets(vk::Image depthImage, vk::Format depthFormat, vk::Extent2D viewport);
+
+    // Candidates of the frame's LOD selection, its fence has signaled.
+    // False past the capacity, the selector's draws go unculled
+    bool update(uint32_t frame, const tools::Camera& camera, const tools::LodSelector& selector);
+
+    // Early phase, ahead of the first scene pass
+    void recordEarly(vk::CommandBuffer cmdBuffer, uint32_t frame);
+
+    // Pyramid and late phase, between the scene passes. Depth is left in
+    // eDepthStencilAttachmentOptimal as found
+    void recordLate(vk::CommandBuffer cmdBuffer, uint32_t frame);
+
+    // Depth image sampled, storage image arrays indexed in the build
+    static bool isSupported(vk::PhysicalDevice physicalDevice, vk::ImageUsageFlags depthUsage);
+
+    // Getting Methods, indirect draws of a phase and the instance indices of the scene shaders
+    vk::Buffer     getDrawBuffer()                                const { return m_drawBuffer; }
+    vk::DeviceSize getDrawOffset(uint32_t frame, uint32_t phase) const { return vk::DeviceSize(phase) * m_frames[frame].params.drawCount * sizeof(gpu::GpuDrawCommand); }
+    uint32_t       getDrawCount(uint32_t frame)                   const { return m_frames[frame].params.drawCount; }
+    uint32_t       getCandidateCount(uint32_t frame)              const { return m_frames[frame].params.candidateCount; }
+    vk::Buffer     getInstanceIndexBuffer()                       const { return m_instanceBuffer; }
+    vk::Extent2D   getPyramidSize()                               const { return m_hizExtent; }
+    bool           hasHistory()                                   const { return m_historyValid; }
+
+private:
+
+    struct Frame
+    {
+        vk::Buffer             candidateBuffer;
+        vk::DeviceMemory       candidateMemory;
+        gpu::GpuCullCandidate* candidates{ nullptr };
+        vk::Buffer             templateBuffer;      // draws with no instances, early then late
+        vk::DeviceMemory       templateMemory;
+        gpu::GpuDrawCommand*   templates{ nullptr };
+        vk::DescriptorSet      descriptorSet;
+        gpu::GpuCullParams     params{};            // viewProj of the frame's camera
+    };
+
+    void destroyTargets();
+
+    void dispatchCull(vk::CommandBuffer cmdBuffer, const Frame& frame, uint32_t phase, const gpu::mat4& viewProj);
+
+    vk::Device                     m_device;
+    vk::PhysicalDevice             m_physicalDevice;
+    DeviceAllocator*               m_allocator{ nullptr };
+    uint32_t                       m_maxCandidates{ 0 };
+    uint32_t                       m_maxDraws{ 0 };
+
+    const ShaderProgram*           m_buildProgram{ nullptr };
+    const ShaderProgram*           m_cullProgram{ nullptr };
+    vk::Pipeline                   m_buildPipeline;
+    vk::Pipeline                   m_cullPipeline;
+    vk::Sampler                    m_sampler;            // nearest, every level
+
+    std::vector<Frame>             m_frames;
+    vk::Buffer                     m_drawBuffer;         // early then late draws
+    vk::DeviceMemory               m_drawMemory;
+    vk::Buffer                     m_instanceBuffer;     // two lists of maxCandidates
+    vk::DeviceMemory               m_instanceMemory;
+    vk::Buffer                     m_retestBuffer;       // early rejections
+    vk::DeviceMemory               m_retestMemory;
+    vk::Buffer                     m_counterBuffer;      // finished build groups
+    vk::DeviceMemory               m_counterMemory;
+
+    // Targets
+    vk::Image                      m_depthImage;
+    vk::ImageView                  m_depthView;          // depth aspect only
+    vk::Image                      m_hizImage;
+    vk::ImageView                  m_hizView;            // every level, sampled
+    std::vector<vk::ImageView>     m_hizLevelViews;      // one per level, storage
+    DeviceAllocator::AllocationID  m_hizAllocation{ 0 };
+    vk::DescriptorPool             m_descriptorPool;
+    vk::DescriptorSet              m_buildSet;
+    gpu::GpuHiZParams              m_buildParams{};
+    vk::Extent2D                   m_hizExtent{ 0, 0 };
+
+    // History, the pyramid the last late phase built from its early depth
+    gpu::mat4                      m_historyViewProj{ 1.f };
+    bool                           m_historyValid{ false };
+
+}; // class OcclusionCuller
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,240 @@
+/*
+ *
+ * Andrew Frost
+ * pipeline_state.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// PipelineStateDesc                                                     //
+///////////////////////////////////////////////////////////////////////////
+// Literal type version of GraphicsState, fixed size arrays instead of  //
+// vectors so a description and its hash can be constexpr              //
+// - builders return a modified copy and chain:                         //
+//   constexpr auto opaque = PipelineStateDesc().cull(eBack).depth(...) //
+// - render pass and subpass are runtime handles, they are not part of  //
+//   the description and are passed at lookup                           //
+///////////////////////////////////////////////////////////////////////////
+
+struct PipelineStateDesc
+{
+    static constexpr uint32_t MaxBindings   = 4;
+    static constexpr uint32_t MaxAttributes = 8;
+    static constexpr uint32_t MaxConstants  = 4;
+
+    struct Binding
+    {
+        uint32_t            binding{ 0 };
+        uint32_t            stride{ 0 };
+        vk::VertexInputRate inputRate{ vk::VertexInputRate::eVertex };
+    };
+
+    struct Attribute
+    {
+        uint32_t   location{ 0 };
+        uint32_t   binding{ 0 };
+        vk::Format format{ vk::Format::eUndefined };
+        uint32_t   offset{ 0 };
+    };
+
+    uint32_t                colorAttachmentCount{ 1 };
+    vk::SampleCountFlagBits samples{ vk::SampleCountFlagBits::e1 };
+
+    vk::PrimitiveTopology   topology{ vk::PrimitiveTopology::eTriangleList };
+    vk::PolygonMode         polygonMode{ vk::PolygonMode::eFill };
+    vk::CullModeFlagBits    cullMode{ vk::CullModeFlagBits::eBack };
+    vk::FrontFace           frontFace{ vk::FrontFace::eCounterClockwise };
+
+    bool                    depthTest{ true };
+    bool                    depthWrite{ true };
+    vk::CompareOp           depthCompare{ vk::CompareOp::eLessOrEqual };
+
+    bool                    blend{ false };
+
+    Binding                 bindings[MaxBindings]{};
+    Attribute               attributes[MaxAttributes]{};
+    uint32_t                constants[MaxConstants]{};
+    uint32_t                bindingCount{ 0 };
+    uint32_t                attributeCount{ 0 };
+    uint32_t                constantCount{ 0 };
+
+    // Builders
+    constexpr PipelineStateDesc colorAttachments(uint32_t count) const
+    {
+        PipelineStateDesc desc = *this;
+        desc.colorAttachmentCount = count;
+        return desc;
+    }
+
+    constexpr PipelineStateDesc multisample(vk::SampleCountFlagBits count) const
+    {
+        PipelineStateDesc desc = *this;
+        desc.samples = count;
+        return desc;
+    }
+
+    constexpr PipelineStateDesc primitive(vk::PrimitiveTopology value) const
+    {
+        PipelineStateDesc desc = *this;
+        desc.topology = value;
+        return desc;
+    }
+
+    constexpr PipelineStateDesc raster(vk::PolygonMode mode, vk::CullModeFlagBits cull,
+        vk::FrontFace front = vk::FrontFace::eCounterClockwise) const
+    {
+        PipelineStateDesc desc = *this;
+        desc.polygonMode = mode;
+        desc.cullMode = cull;
+        desc.frontFace = front;
+        return desc;
+    }
+
+    constexpr PipelineStateDesc depth(bool test, bool write,
+        vk::CompareOp compare = vk::CompareOp::eLessOrEqual) const
+    {
+        PipelineStateDesc desc = *this;
+        desc.depthTest = test;
+        desc.depthWrite = write;
+        desc.depthCompare = compare;
+        return desc;
+    }
+
+    constexpr PipelineStateDesc alphaBlend(bool enable) const
+    {
+        PipelineStateDesc desc = *this;
+        desc.blend = enable;
+        return desc;
+    }
+
+    // Out of room is a compile error in a constant expression
+    constexpr PipelineStateDesc vertexBinding(uint32_t binding, uint32_t stride,
+        vk::VertexInputRate inputRate = vk::VertexInputRate::eVertex) const
+    {
+        PipelineStateDesc desc = *this;
+        desc.bindings[desc.bindingCount++] = { binding, stride, inputRate };
+        return desc;
+    }
+
+    constexpr PipelineStateDesc vertexAttribute(uint32_t location, uint32_t binding, vk::Format format,
+        uint32_t offset) const
+    {
+        PipelineStateDesc desc = *this;
+        desc.attributes[desc.attributeCount++] = { location, binding, format, offset };
+        return desc;
+    }
+
+    // Bound to the next constant_id, in call order
+    constexpr PipelineStateDesc constant(uint32_t value) const
+    {
+        PipelineStateDesc desc = *this;
+        desc.constants[desc.constantCount++] = value;
+        return desc;
+    }
+
+    //-------------------------------------------------------------------------
+    // FNV-1a over every field, evaluated by the compiler when the
+    // description is constexpr. Unused array slots are skipped so the
+    // hash only depends on what was set.
+    //
+    constexpr uint64_t hash() const
+    {
+        uint64_t seed = hashWord(14695981039346656037ull, colorAttachmentCount);
+        seed = hashWord(seed, static_cast<uint32_t>(samples));
+        seed = hashWord(seed, static_cast<uint32_t>(topology));
+        seed = hashWord(seed, static_cast<uint32_t>(polygonMode));
+        seed = hashWord(seed, static_cast<uint32_t>(cullMode));
+        seed = hashWord(seed, static_cast<uint32_t>(frontFace));
+        seed = hashWord(seed, depthTest | (depthWrite << 1) | (blend << 2));
+        seed = hashWord(seed, static_cast<uint32_t>(depthCompare));
+
+        seed = hashWord(seed, bindingCount);
+        for (uint32_t i = 0; i < bindingCount; i++) {
+            seed = hashWord(seed, bindings[i].binding);
+            seed = hashWord(seed, bindings[i].stride);
+            seed = hashWord(seed, static_cast<uint32_t>(bindings[i].inputRate));
+        }
+        seed = hashWord(seed, attributeCount);
+        for (uint32_t i = 0; i < attributeCount; i++) {
+            seed = hashWord(seed, attributes[i].location);
+            seed = hashWord(seed, attributes[i].binding);
+            seed = hashWord(seed, static_cast<uint32_t>(attributes[i].format));
+            seed = hashWord(seed, attributes[i].offset);
+        }
+        seed = hashWord(seed, constantCount);
+        for (uint32_t i = 0; i < constantCount; i++)
+            seed = hashWord(seed, constants[i]);
+
+        return seed;
+    }
+
+    // Field by field, used to reject hash collisions
+    constexpr bool operator==(const PipelineStateDesc& other) const
+    {
+        if (colorAttachmentCount != other.colorAttachmentCount || samples != other.samples
+            || topology != other.topology || polygonMode != other.polygonMode || cullMode != other.cullMode
+            || frontFace != other.frontFace || depthTest != other.depthTest || depthWrite != other.depthWrite
+            || depthCompare != other.depthCompare || blend != other.blend
+            || bindingCount != other.bindingCount || attributeCount != other.attributeCount
+            || constantCount != other.constantCount)
+            return false;
+
+        for (uint32_t i = 0; i < bindingCount; i++)
+            if (bindings[i].binding != other.bindings[i].binding || bindings[i].stride != other.bindings[i].stride
+                || bindings[i].inputRate != other.bindings[i].inputRate)
+                return false;
+        for (uint32_t i = 0; i < attributeCount; i++)
+            if (attributes[i].location != other.attributes[i].location
+                || attributes[i].binding != other.attributes[i].binding
+                || attributes[i].format != other.attributes[i].format
+                || attributes[i].offset != other.attributes[i].offset)
+                return false;
+        for (uint32_t i = 0; i < constantCount; i++)
+            if (constants[i] != other.constants[i])
+                return false;
+
+        return true;
+    }
+
+    constexpr bool operator!=(const PipelineStateDesc& other) const { return !(*this == other); }
+
+    // Little endian bytes of word, same result as hashBytes over a uint32_t
+    static constexpr uint64_t hashWord(uint64_t seed, uint32_t word)
+    {
+        for (uint32_t i = 0; i < 4; i++) {
+            seed ^= (word >> (i * 8)) & 0xffu;
+            seed *= 1099511628211ull;
+        }
+        return seed;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////
+// PipelineStateKey                                                      //
+///////////////////////////////////////////////////////////////////////////
+// A description with its hash, computed once where the key is built.   //
+// Declared constexpr the hash is a constant in the binary and a lookup //
+// only mixes in the program and render pass handles                    //
+///////////////////////////////////////////////////////////////////////////
+
+struct PipelineStateKey
+{
+    PipelineStateDesc desc;
+    uint64_t          hash;
+
+    constexpr PipelineStateKey(const PipelineStateDesc& desc)
+        : desc(desc), hash(desc.hash())
+    {}
+};
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
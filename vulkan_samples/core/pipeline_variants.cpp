@@ -0,0 +1,480 @@
+/*
+ *
+ * Andrew Frost
+ * pipeline_variants.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+#include "pipeline_variants.hpp"
+#include "frame_capture.hpp"
+#include "object_registry.hpp"
+#include "vk_utils.hpp"
+
+#ifdef _DEBUG
+#include "../helper/debug.hpp"
+static vkb::debug::DebugUtil s_debug;
+#endif // _DEBUG
+
+namespace vkb {
+namespace core {
+
+//-------------------------------------------------------------------------
+// Key serialization, variants compare the whole key so a hash collision
+// can never return the wrong pipeline
+//
+static void pushHandle(std::vector<uint32_t>& key, uint64_t handle)
+{
+    key.push_back(static_cast<uint32_t>(handle));
+    key.push_back(static_cast<uint32_t>(handle >> 32));
+}
+
+static void pushProgram(std::vector<uint32_t>& key, const ShaderProgram& program)
+{
+    pushHandle(key, reinterpret_cast<uint64_t>(static_cast<VkPipelineLayout>(program.pipelineLayout)));
+    key.push_back(static_cast<uint32_t>(program.stages.size()));
+    for (const Shader* shader : program.stages)
+        pushHandle(key, shader->hash);
+}
+
+static void pushConstants(std::vector<uint32_t>& key, const std::vector<uint32_t>& constants)
+{
+    key.push_back(static_cast<uint32_t>(constants.size()));
+    key.insert(key.end(), constants.begin(), constants.end());
+}
+
+//-------------------------------------------------------------------------
+// Map constants[i] to constant_id i
+//
+static vk::SpecializationInfo specializationInfo(const std::vector<uint32_t>& constants,
+    std::vector<vk::SpecializationMapEntry>& entries)
+{
+    entries.resize(constants.size());
+    for (uint32_t i = 0; i < constants.size(); i++) {
+        entries[i].constantID = i;
+        entries[i].offset = i * sizeof(uint32_t);
+        entries[i].size = sizeof(uint32_t);
+    }
+
+    vk::SpecializationInfo info = {};
+    info.mapEntryCount = static_cast<uint32_t>(entries.size());
+    info.pMapEntries = entries.data();
+    info.dataSize = constants.size() * sizeof(uint32_t);
+    info.pData = constants.data();
+    return info;
+}
+
+//-------------------------------------------------------------------------
+// Dynamic topology must stay in the class the pipeline was built with,
+// one representative per class
+//
+static vk::PrimitiveTopology topologyClass(vk::PrimitiveTopology topology)
+{
+    switch (topology) {
+    case vk::PrimitiveTopology::ePointList:
+        return vk::PrimitiveTopology::ePointList;
+    case vk::PrimitiveTopology::eLineList:
+    case vk::PrimitiveTopology::eLineStrip:
+    case vk::PrimitiveTopology::eLineListWithAdjacency:
+    case vk::PrimitiveTopology::eLineStripWithAdjacency:
+        return vk::PrimitiveTopology::eLineList;
+    case vk::PrimitiveTopology::ePatchList:
+        return vk::PrimitiveTopology::ePatchList;
+    default:
+        return vk::PrimitiveTopology::eTriangleList;
+    }
+}
+
+//-------------------------------------------------------------------------
+// One multiply per handle, the description hash is already well mixed
+//
+static uint64_t mixHandle(uint64_t seed, uint64_t handle)
+{
+    seed ^= handle + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    return seed * 0xff51afd7ed558ccdull;
+}
+
+//-------------------------------------------------------------------------
+// GraphicsState of a description, only built when a keyed lookup misses
+//
+static GraphicsState graphicsState(const PipelineStateDesc& desc, vk::RenderPass renderPass, uint32_t subpass)
+{
+    GraphicsState state;
+    state.renderPass = renderPass;
+    state.subpass = subpass;
+    state.colorAttachmentCount = desc.colorAttachmentCount;
+    state.samples = desc.samples;
+    state.topology = desc.topology;
+    state.polygonMode = desc.polygonMode;
+    state.cullMode = desc.cullMode;
+    state.frontFace = desc.frontFace;
+    state.depthTest = desc.depthTest;
+    state.depthWrite = desc.depthWrite;
+    state.depthCompare = desc.depthCompare;
+    state.blend = desc.blend;
+
+    for (uint32_t i = 0; i < desc.bindingCount; i++)
+        state.vertexBindings.push_back({ desc.bindings[i].binding, desc.bindings[i].stride,
+            desc.bindings[i].inputRate });
+    for (uint32_t i = 0; i < desc.attributeCount; i++)
+        state.vertexAttributes.push_back({ desc.attributes[i].location, desc.attributes[i].binding,
+            desc.attributes[i].format, desc.attributes[i].offset });
+    return state;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// PipelineVariants                                                      //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization
+//
+void PipelineVariants::init(vk::Instance instance, vk::Device device, vk::PipelineCache pipelineCache,
+    bool extendedDynamicState)
+{
+    assert(!m_device && "PipelineVariants already initialized");
+    m_device = device;
+    m_pipelineCache = pipelineCache;
+    m_stats = {};
+
+    // headers without VK_EXT_extended_dynamic_state bake every state
+#ifdef VK_EXT_extended_dynamic_state
+    m_extendedDynamicState = extendedDynamicState;
+#else
+    m_extendedDynamicState = false;
+#endif
+
+#if _DEBUG
+    s_debug.setup(device, instance);
+#endif
+}
+
+//-------------------------------------------------------------------------
+// Destroy every variant
+//
+void PipelineVariants::destroy()
+{
+    if (!m_device)
+        return;
+
+    for (auto& variant : m_variants) {
+        if (m_capture)
+            m_capture->forget(variant.second.pipeline);
+        VkObjects.onDestroy(variant.second.pipeline);
+        m_device.destroyPipeline(variant.second.pipeline);
+    }
+    m_variants.clear();
+    m_keyedVariants.clear();
+    m_stats = {};
+
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Serialized graphics variant key, what every getGraphics call pays
+// before the lookup. Dynamic fields are not part of it, states that only
+// differ there share one pipeline.
+//
+void PipelineVariants::buildGraphicsKey(const ShaderProgram& program, const GraphicsState& state,
+    const std::vector<uint32_t>& constants, std::vector<uint32_t>& key, bool extendedDynamicState)
+{
+    key.clear();
+    key.reserve(32 + constants.size() + 4 * (state.vertexBindings.size() + state.vertexAttributes.size()));
+
+    key.push_back(static_cast<uint32_t>(vk::PipelineBindPoint::eGraphics));
+    pushProgram(key, program);
+    pushHandle(key, reinterpret_cast<uint64_t>(static_cast<VkRenderPass>(state.renderPass)));
+    key.push_back(state.subpass);
+    key.push_back(state.colorAttachmentCount);
+    key.push_back(static_cast<uint32_t>(state.samples));
+    key.push_back(static_cast<uint32_t>(state.polygonMode));
+    key.push_back(extendedDynamicState);
+    if (extendedDynamicState) {
+        key.push_back(static_cast<uint32_t>(topologyClass(state.topology)));
+        key.push_back(state.blend);
+    }
+    else {
+        key.push_back(static_cast<uint32_t>(state.topology));
+        key.push_back(static_cast<uint32_t>(state.cullMode));
+        key.push_back(static_cast<uint32_t>(state.frontFace));
+        key.push_back(state.depthTest | (state.depthWrite << 1) | (state.blend << 2));
+        key.push_back(static_cast<uint32_t>(state.depthCompare));
+    }
+
+    key.push_back(static_cast<uint32_t>(state.vertexBindings.size()));
+    for (const auto& binding : state.vertexBindings) {
+        key.push_back(binding.binding);
+        key.push_back(binding.stride);
+        key.push_back(static_cast<uint32_t>(binding.inputRate));
+    }
+    key.push_back(static_cast<uint32_t>(state.vertexAttributes.size()));
+    for (const auto& attribute : state.vertexAttributes) {
+        key.push_back(attribute.location);
+        key.push_back(attribute.binding);
+        key.push_back(static_cast<uint32_t>(attribute.format));
+        key.push_back(attribute.offset);
+    }
+    pushConstants(key, constants);
+}
+
+//-------------------------------------------------------------------------
+// Graphics variant, built on first use
+//
+vk::Pipeline PipelineVariants::getGraphics(const ShaderProgram& program, const GraphicsState& state,
+    const std::vector<uint32_t>& constants)
+{
+    std::vector<uint32_t> key;
+    buildGraphicsKey(program, state, constants, key, m_extendedDynamicState);
+
+    const uint64_t hash = hashBytes(key.data(), key.size() * sizeof(uint32_t));
+    if (vk::Pipeline pipeline = find(key, hash))
+        return pipeline;
+
+    // Shader Stages
+    std::vector<vk::SpecializationMapEntry> entries;
+    const vk::SpecializationInfo specialization = specializationInfo(constants, entries);
+
+    std::vector<vk::PipelineShaderStageCreateInfo> stages;
+    for (const Shader* shader : program.stages)
+        stages.push_back(shader->getStageInfo(constants.empty() ? nullptr : &specialization));
+
+    // Vertex Input
+    vk::PipelineVertexInputStateCreateInfo vertexInput = {};
+    vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(state.vertexBindings.size());
+    vertexInput.pVertexBindingDescriptions = state.vertexBindings.data();
+    vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(state.vertexAttributes.size());
+    vertexInput.pVertexAttributeDescriptions = state.vertexAttributes.data();
+
+    // Input Assembly
+    vk::PipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.topology = m_extendedDynamicState ? topologyClass(state.topology) : state.topology;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // Viewport, dynamic
+    vk::PipelineViewportStateCreateInfo viewportState = {};
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    // Rasterizer
+    vk::PipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.polygonMode = state.polygonMode;
+    rasterizer.cullMode = state.cullMode;
+    rasterizer.frontFace = state.frontFace;
+    rasterizer.lineWidth = 1.0f;
+
+    // Multisampling
+    vk::PipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.rasterizationSamples = state.samples;
+
+    // Depth Stencil
+    vk::PipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.depthTestEnable = state.depthTest;
+    depthStencil.depthWriteEnable = state.depthWrite;
+    depthStencil.depthCompareOp = state.depthCompare;
+
+    // Color Blending
+    vk::PipelineColorBlendAttachmentState blendAttachment = {};
+    blendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
+        | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+    blendAttachment.blendEnable = state.blend;
+    blendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+    blendAttachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+    blendAttachment.colorBlendOp = vk::BlendOp::eAdd;
+    blendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+    blendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+    blendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
+
+    std::vector<vk::PipelineColorBlendAttachmentState> blendAttachments(state.colorAttachmentCount, blendAttachment);
+
+    vk::PipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.attachmentCount = static_cast<uint32_t>(blendAttachments.size());
+    colorBlending.pAttachments = blendAttachments.data();
+
+    // Dynamic State, the baked values above are ignored for the extended ones
+    const vk::DynamicState dynamicStates[] = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor,
+#ifdef VK_EXT_extended_dynamic_state
+        vk::DynamicState::eCullModeEXT,
+        vk::DynamicState::eFrontFaceEXT,
+        vk::DynamicState::ePrimitiveTopologyEXT,
+        vk::DynamicState::eDepthTestEnableEXT,
+        vk::DynamicState::eDepthWriteEnableEXT,
+        vk::DynamicState::eDepthCompareOpEXT,
+#endif
+    };
+    vk::PipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.dynamicStateCount = m_extendedDynamicState ? 8 : 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    vk::GraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.stageCount = static_cast<uint32_t>(stages.size());
+    pipelineInfo.pStages = stages.data();
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = program.pipelineLayout;
+    pipelineInfo.renderPass = state.renderPass;
+    pipelineInfo.subpass = state.subpass;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    vk::Pipeline pipeline;
+    try {
+        pipeline = m_device.createGraphicsPipeline(m_pipelineCache, pipelineInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create graphics pipeline variant!");
+    }
+    VkObjects.onCreate(pipeline);
+
+    const double compileMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+
+    if (m_capture)
+        m_capture->describeGraphics(pipeline, program, state, constants);
+
+    return insert(std::move(key), hash, pipeline, compileMs);
+}
+
+//-------------------------------------------------------------------------
+// Three handle mixes over the precomputed description hash
+//
+uint64_t PipelineVariants::hashGraphicsKey(const ShaderProgram& program, const PipelineStateKey& key,
+    vk::RenderPass renderPass, uint32_t subpass)
+{
+    uint64_t hash = mixHandle(key.hash, program.hash);
+    hash = mixHandle(hash, reinterpret_cast<uint64_t>(static_cast<VkRenderPass>(renderPass)));
+    return mixHandle(hash, subpass);
+}
+
+//-------------------------------------------------------------------------
+// Keyed graphics variant, a hit costs three handle mixes and one map
+// lookup. The full compare only runs on the entry found.
+//
+vk::Pipeline PipelineVariants::getGraphics(const ShaderProgram& program, const PipelineStateKey& key,
+    vk::RenderPass renderPass, uint32_t subpass)
+{
+    const uint64_t hash = hashGraphicsKey(program, key, renderPass, subpass);
+
+    auto it = m_keyedVariants.find(hash);
+    const bool collision = it != m_keyedVariants.end()
+        && (it->second.programHash != program.hash || it->second.renderPass != renderPass
+            || it->second.subpass != subpass || it->second.desc != key.desc);
+
+    if (it != m_keyedVariants.end() && !collision) {
+        m_stats.hits++;
+        return it->second.pipeline;
+    }
+
+    // the serialized path builds or finds the pipeline and counts the miss,
+    // on a collision it compares the full key and the entry stays as it is
+    const std::vector<uint32_t> constants(key.desc.constants, key.desc.constants + key.desc.constantCount);
+
+    const vk::Pipeline pipeline = getGraphics(program, graphicsState(key.desc, renderPass, subpass), constants);
+    if (collision)
+        return pipeline;
+
+    KeyedVariant& variant = m_keyedVariants[hash];
+    variant.programHash = program.hash;
+    variant.renderPass = renderPass;
+    variant.subpass = subpass;
+    variant.desc = key.desc;
+    variant.pipeline = pipeline;
+    return pipeline;
+}
+
+//-------------------------------------------------------------------------
+// Compute variant, built on first use
+//
+vk::Pipeline PipelineVariants::getCompute(const ShaderProgram& program, const std::vector<uint32_t>& constants)
+{
+    assert(program.stages.size() == 1 && "compute program has a single stage");
+
+    std::vector<uint32_t> key;
+    key.push_back(static_cast<uint32_t>(vk::PipelineBindPoint::eCompute));
+    pushProgram(key, program);
+    pushConstants(key, constants);
+
+    const uint64_t hash = hashBytes(key.data(), key.size() * sizeof(uint32_t));
+    if (vk::Pipeline pipeline = find(key, hash))
+        return pipeline;
+
+    std::vector<vk::SpecializationMapEntry> entries;
+    const vk::SpecializationInfo specialization = specializationInfo(constants, entries);
+
+    vk::ComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.stage = program.stages[0]->getStageInfo(constants.empty() ? nullptr : &specialization);
+    pipelineInfo.layout = program.pipelineLayout;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    vk::Pipeline pipeline;
+    try {
+        pipeline = m_device.createComputePipeline(m_pipelineCache, pipelineInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create compute pipeline variant!");
+    }
+    VkObjects.onCreate(pipeline);
+
+    const double compileMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+
+    if (m_capture)
+        m_capture->describeCompute(pipeline, program, constants);
+
+    return insert(std::move(key), hash, pipeline, compileMs);
+}
+
+//-------------------------------------------------------------------------
+// Cache lookup
+//
+vk::Pipeline PipelineVariants::find(const std::vector<uint32_t>& key, uint64_t hash)
+{
+    auto it = m_variants.find(hash);
+    if (it == m_variants.end()) {
+        m_stats.misses++;
+        return nullptr;
+    }
+
+    if (it->second.key != key)
+        throw std::runtime_error("pipeline variant hash collision!");
+
+    m_stats.hits++;
+    return it->second.pipeline;
+}
+
+//-------------------------------------------------------------------------
+// Store a new variant and its compile time
+//
+vk::Pipeline PipelineVariants::insert(std::vector<uint32_t>&& key, uint64_t hash, vk::Pipeline pipeline, double compileMs)
+{
+#if _DEBUG
+    const std::string name = "PipelineVariants::" + std::to_string(hash);
+    s_debug.setObjectName(pipeline, name.c_str());
+#endif
+
+    Variant& variant = m_variants[hash];
+    variant.key = std::move(key);
+    variant.pipeline = pipeline;
+    variant.compileMs = compileMs;
+
+    m_stats.variants++;
+    m_stats.totalCompileMs += compileMs;
+    m_stats.maxCompileMs = std::max(m_stats.maxCompileMs, compileMs);
+
+    return pipeline;
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
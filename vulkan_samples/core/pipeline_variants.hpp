@@ -0,0 +1,151 @@
+/*
+ *
+ * Andrew Frost
+ * pipeline_variants.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "pipeline_state.hpp"
+#include "shader_library.hpp"
+
+namespace vkb {
+namespace core {
+
+class FrameCapture;
+
+///////////////////////////////////////////////////////////////////////////
+// GraphicsState                                                         //
+///////////////////////////////////////////////////////////////////////////
+// Fixed function part of a graphics pipeline variant, viewport and     //
+// scissor are always dynamic. With VK_EXT_extended_dynamic_state cull, //
+// front face, depth state and topology (within its class) are dynamic  //
+// too and set through CommandState                                     //
+///////////////////////////////////////////////////////////////////////////
+
+struct GraphicsState
+{
+    vk::RenderPass          renderPass;
+    uint32_t                subpass{ 0 };
+    uint32_t                colorAttachmentCount{ 1 };
+    vk::SampleCountFlagBits samples{ vk::SampleCountFlagBits::e1 };
+
+    vk::PrimitiveTopology   topology{ vk::PrimitiveTopology::eTriangleList };
+    vk::PolygonMode         polygonMode{ vk::PolygonMode::eFill };
+    vk::CullModeFlags       cullMode{ vk::CullModeFlagBits::eBack };
+    vk::FrontFace           frontFace{ vk::FrontFace::eCounterClockwise };
+
+    bool                    depthTest{ true };
+    bool                    depthWrite{ true };
+    vk::CompareOp           depthCompare{ vk::CompareOp::eLessOrEqual };
+
+    bool                    blend{ false };
+
+    std::vector<vk::VertexInputBindingDescription>   vertexBindings;
+    std::vector<vk::VertexInputAttributeDescription> vertexAttributes;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// PipelineVariants                                                      //
+///////////////////////////////////////////////////////////////////////////
+// Pipelines keyed on program, fixed function state and specialization //
+// constant values. Feature toggles become constant_id values the       //
+// driver folds, instead of one SPIR-V file per permutation.            //
+// - constants[i] is bound to constant_id i in every stage              //
+// - missing variants are built on demand through the pipeline cache    //
+// - PipelineStateKey lookups skip key serialization, the hash of the   //
+//   description is precomputed and only the handles are mixed in.     //
+//   A colliding entry is left alone and the serialized path is taken  //
+// - with setCapture() every new variant is described to the capture    //
+///////////////////////////////////////////////////////////////////////////
+
+class PipelineVariants
+{
+public:
+    PipelineVariants(PipelineVariants const&) = delete;
+    PipelineVariants& operator=(PipelineVariants const&) = delete;
+
+    PipelineVariants() = default;
+    ~PipelineVariants() { destroy(); }
+
+    // extendedDynamicState requires the VK_EXT_extended_dynamic_state feature enabled
+    void init(vk::Instance instance, vk::Device device, vk::PipelineCache pipelineCache,
+        bool extendedDynamicState = false);
+
+    void destroy();
+
+    // Before the first variant, pipelines built earlier can not be replayed
+    void setCapture(FrameCapture* capture) { m_capture = capture; }
+
+    vk::Pipeline getGraphics(const ShaderProgram& program, const GraphicsState& state,
+        const std::vector<uint32_t>& constants = {});
+
+    // Hot path for constexpr keys, the variant is shared with the GraphicsState path
+    vk::Pipeline getGraphics(const ShaderProgram& program, const PipelineStateKey& key,
+        vk::RenderPass renderPass, uint32_t subpass = 0);
+
+    vk::Pipeline getCompute(const ShaderProgram& program, const std::vector<uint32_t>& constants = {});
+
+    // Dynamic fields are left out of the key when extendedDynamicState is set
+    static void buildGraphicsKey(const ShaderProgram& program, const GraphicsState& state,
+        const std::vector<uint32_t>& constants, std::vector<uint32_t>& key, bool extendedDynamicState = false);
+
+    // Lookup hash of the keyed getGraphics
+    static uint64_t hashGraphicsKey(const ShaderProgram& program, const PipelineStateKey& key,
+        vk::RenderPass renderPass, uint32_t subpass = 0);
+
+    struct Stats
+    {
+        uint32_t variants{ 0 };
+        uint32_t hits{ 0 };
+        uint32_t misses{ 0 };
+        double   totalCompileMs{ 0.0 };
+        double   maxCompileMs{ 0.0 };
+    };
+
+    // Getting Methods
+    const Stats& getStats()        const { return m_stats; }
+    uint32_t     getVariantCount() const { return m_stats.variants; }
+    bool         isExtendedDynamicState() const { return m_extendedDynamicState; }
+
+private:
+
+    struct Variant
+    {
+        std::vector<uint32_t> key;
+        vk::Pipeline          pipeline;
+        double                compileMs{ 0.0 };
+    };
+
+    struct KeyedVariant
+    {
+        uint64_t             programHash{ 0 };
+        vk::RenderPass       renderPass;
+        uint32_t             subpass{ 0 };
+        PipelineStateDesc    desc;
+        vk::Pipeline         pipeline;
+    };
+
+    vk::Pipeline find(const std::vector<uint32_t>& key, uint64_t hash);
+
+    vk::Pipeline insert(std::vector<uint32_t>&& key, uint64_t hash, vk::Pipeline pipeline, double compileMs);
+
+    vk::Device                                 m_device;
+    vk::PipelineCache                          m_pipelineCache;
+    bool                                       m_extendedDynamicState{ false };
+    FrameCapture*                              m_capture{ nullptr };
+
+    std::unordered_map<uint64_t, Variant>      m_variants;
+    std::unordered_map<uint64_t, KeyedVariant> m_keyedVariants;
+    Stats                                      m_stats;
+
+}; // class PipelineVariants
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,487 @@
+/*
+ *
+ * Andrew Frost
+ * post_process.cpp
+ * 2020
+ *
+ */
+
+#include <array>
+#include <cassert>
+
+#include "object_registry.hpp"
+#include "post_process.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// PostProcess                                                           //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization, targets follow with createTargets()
+//
+void PostProcess::init(vk::Device device, DeviceAllocator& allocator, SyncPool& syncPool, ShaderLibrary& shaders,
+    PipelineVariants& variants, vk::Format depthFormat, uint32_t graphicsQueueIdx, uint32_t computeQueueIdx)
+{
+    assert(!m_device && "PostProcess already initialized");
+    m_device = device;
+    m_allocator = &allocator;
+    m_syncPool = &syncPool;
+    m_graphicsQueueIdx = graphicsQueueIdx;
+    m_computeQueueIdx = computeQueueIdx == graphicsQueueIdx ? VK_QUEUE_FAMILY_IGNORED : computeQueueIdx;
+
+    m_program = &shaders.createProgram({ &shaders.loadFromFile("shaders/post_process.comp.spv") });
+    m_pipeline = variants.getCompute(*m_program);
+
+    // texelFetch only, the sampler is required by the combined descriptor
+    vk::SamplerCreateInfo samplerInfo = {};
+    samplerInfo.magFilter = vk::Filter::eNearest;
+    samplerInfo.minFilter = vk::Filter::eNearest;
+    samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+
+    try {
+        m_sampler = m_device.createSampler(samplerInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create post process sampler!");
+    }
+    VkObjects.onCreate(m_sampler, 0, "PostProcess");
+
+    createRenderPass(depthFormat);
+}
+
+//-------------------------------------------------------------------------
+// Call on exit
+//
+void PostProcess::destroy()
+{
+    if (!m_device)
+        return;
+
+    destroyTargets();
+
+    VkObjects.onDestroy(m_renderPass);
+    VkObjects.onDestroy(m_renderPassLoad);
+    VkObjects.onDestroy(m_sampler);
+    m_device.destroyRenderPass(m_renderPass);
+    m_device.destroyRenderPass(m_renderPassLoad);
+    m_device.destroySampler(m_sampler);
+    m_renderPass = nullptr;
+    m_renderPassLoad = nullptr;
+    m_sampler = nullptr;
+
+    // program and pipeline belong to the library and variant cache
+    m_program = nullptr;
+    m_pipeline = nullptr;
+    m_allocator = nullptr;
+    m_syncPool = nullptr;
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Scene pass into the HDR target, left for the dispatch to sample. The
+// previous dispatch may still read the target when it is shared. The load
+// variant picks up a scene split around compute work
+//
+void PostProcess::createRenderPass(vk::Format depthFormat)
+{
+    std::array<vk::AttachmentDescription, 2> attachments = {};
+    // HDR Attachment
+    attachments[0].format = m_targetFormat;
+    attachments[0].samples = vk::SampleCountFlagBits::e1;
+    attachments[0].loadOp = vk::AttachmentLoadOp::eClear;
+    attachments[0].storeOp = vk::AttachmentStoreOp::eStore;
+    attachments[0].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    attachments[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    attachments[0].initialLayout = vk::ImageLayout::eUndefined;
+    attachments[0].finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    // Depth Attachment
+    attachments[1].format = depthFormat;
+    attachments[1].samples = vk::SampleCountFlagBits::e1;
+    attachments[1].loadOp = vk::AttachmentLoadOp::eClear;
+    attachments[1].storeOp = vk::AttachmentStoreOp::eStore;
+    attachments[1].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    attachments[1].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    attachments[1].initialLayout = vk::ImageLayout::eUndefined;
+    attachments[1].finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+    const vk::AttachmentReference colorReference{ 0, vk::ImageLayout::eColorAttachmentOptimal };
+    const vk::AttachmentReference depthReference{ 1, vk::ImageLayout::eDepthStencilAttachmentOptimal };
+
+    vk::SubpassDescription subpass = {};
+    subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorReference;
+    subpass.pDepthStencilAttachment = &depthReference;
+
+    std::array<vk::SubpassDependency, 2> dependencies;
+
+    // write after read of the last dispatch, depth after the last scene
+    dependencies[0].srcSubpass      = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass      = 0;
+    dependencies[0].srcStageMask    = vk::PipelineStageFlagBits::eComputeShader
+                                    | vk::PipelineStageFlagBits::eLateFragmentTests;
+    dependencies[0].dstStageMask    = vk::PipelineStageFlagBits::eColorAttachmentOutput
+                                    | vk::PipelineStageFlagBits::eEarlyFragmentTests;
+    dependencies[0].srcAccessMask   = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    dependencies[0].dstAccessMask   = vk::AccessFlagBits::eColorAttachmentWrite
+                                    | vk::AccessFlagBits::eDepthStencilAttachmentRead
+                                    | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+    dependencies[1].srcSubpass      = 0;
+    dependencies[1].dstSubpass      = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask    = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    dependencies[1].dstStageMask    = vk::PipelineStageFlagBits::eComputeShader;
+    dependencies[1].srcAccessMask   = vk::AccessFlagBits::eColorAttachmentWrite;
+    dependencies[1].dstAccessMask   = vk::AccessFlagBits::eShaderRead;
+
+    vk::RenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments    = attachments.data();
+    renderPassInfo.subpassCount    = 1;
+    renderPassInfo.pSubpasses      = &subpass;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies   = dependencies.data();
+
+    try {
+        m_renderPass = m_device.createRenderPass(renderPassInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create post process render pass!");
+    }
+    VkObjects.onCreate(m_renderPass, 0, "PostProcess");
+
+    attachments[0].loadOp = vk::AttachmentLoadOp::eLoad;
+    attachments[0].initialLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    attachments[1].loadOp = vk::AttachmentLoadOp::eLoad;
+    attachments[1].initialLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+    // the first half's writes, the dispatch only reads after the second
+    dependencies[0].srcStageMask    = vk::PipelineStageFlagBits::eColorAttachmentOutput
+                                    | vk::PipelineStageFlagBits::eLateFragmentTests;
+    dependencies[0].srcAccessMask   = vk::AccessFlagBits::eColorAttachmentWrite
+                                    | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    dependencies[0].dstAccessMask   = vk::AccessFlagBits::eColorAttachmentRead
+                                    | vk::AccessFlagBits::eColorAttachmentWrite
+                                    | vk::AccessFlagBits::eDepthStencilAttachmentRead
+                                    | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+    try {
+        m_renderPassLoad = m_device.createRenderPass(renderPassInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create post process render pass!");
+    }
+    VkObjects.onCreate(m_renderPassLoad, 0, "PostProcess");
+}
+
+//-------------------------------------------------------------------------
+// Targets, framebuffers, descriptor sets and async objects for the
+// current swapchain images
+//
+void PostProcess::createTargets(const SwapChain& swapchain, vk::ImageView depthView)
+{
+    destroyTargets();
+
+    const uint32_t imageCount = swapchain.getImageCount();
+    m_extent = vk::Extent2D(swapchain.getWidth(), swapchain.getHeight());
+
+    // async scenes run ahead of the dispatch reading the previous target
+    const std::array<uint32_t, 2> queueIndices = { m_graphicsQueueIdx, m_computeQueueIdx };
+
+    vk::ImageCreateInfo imageInfo = {};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.extent = vk::Extent3D(m_extent.width, m_extent.height, 1);
+    imageInfo.format = m_targetFormat;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+    if (isAsync()) {
+        imageInfo.sharingMode = vk::SharingMode::eConcurrent;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueIndices.size());
+        imageInfo.pQueueFamilyIndices = queueIndices.data();
+    }
+
+    m_targets.resize(isAsync() ? imageCount : 1);
+    for (auto& target : m_targets) {
+        // pinned, no move callback
+        target.allocation = m_allocator->createImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal,
+            vk::ImageLayout::eShaderReadOnlyOptimal, target.image);
+
+        vk::ImageViewCreateInfo viewInfo = {};
+        viewInfo.image = target.image;
+        viewInfo.viewType = vk::ImageViewType::e2D;
+        viewInfo.format = m_targetFormat;
+        viewInfo.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+
+        try {
+            target.view = m_device.createImageView(viewInfo);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to create post process target view!");
+        }
+        VkObjects.onCreate(target.view, 0, "PostProcess");
+    }
+
+    // Framebuffers
+    std::array<vk::ImageView, 2> attachments;
+    attachments[1] = depthView;
+
+    vk::FramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.renderPass = m_renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    framebufferInfo.pAttachments = attachments.data();
+    framebufferInfo.width = m_extent.width;
+    framebufferInfo.height = m_extent.height;
+    framebufferInfo.layers = 1;
+
+    m_framebuffers.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++) {
+        attachments[0] = m_targets[targetIndex(i)].view;
+
+        try {
+            m_framebuffers[i] = m_device.createFramebuffer(framebufferInfo);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to create post process framebuffer!");
+        }
+        VkObjects.onCreate(m_framebuffers[i], 0, "PostProcess");
+    }
+
+    // One set per swapchain image, scene target and storage image
+    const std::array<vk::DescriptorPoolSize, 2> poolSizes = { {
+        { vk::DescriptorType::eCombinedImageSampler, imageCount },
+        { vk::DescriptorType::eStorageImage, imageCount },
+    } };
+
+    vk::DescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.maxSets = imageCount;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    try {
+        m_descriptorPool = m_device.createDescriptorPool(poolInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create post process descriptor pool!");
+    }
+    VkObjects.onCreate(m_descriptorPool, 0, "PostProcess");
+
+    const std::vector<vk::DescriptorSetLayout> layouts(imageCount, m_program->setLayouts[0]);
+
+    vk::DescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = imageCount;
+    allocInfo.pSetLayouts = layouts.data();
+
+    try {
+        m_descriptorSets = m_device.allocateDescriptorSets(allocInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to allocate post process descriptor sets!");
+    }
+
+    m_images.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++) {
+        m_images[i] = swapchain.getImage(i);
+
+        const vk::DescriptorImageInfo sceneInfo{ m_sampler, m_targets[targetIndex(i)].view,
+            vk::ImageLayout::eShaderReadOnlyOptimal };
+        const vk::DescriptorImageInfo outputInfo{ nullptr, swapchain.getImageView(i), vk::ImageLayout::eGeneral };
+
+        std::array<vk::WriteDescriptorSet, 2> writes = {};
+        writes[0].dstSet = m_descriptorSets[i];
+        writes[0].dstBinding = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        writes[0].pImageInfo = &sceneInfo;
+        writes[1].dstSet = m_descriptorSets[i];
+        writes[1].dstBinding = 1;
+        writes[1].descriptorCount = 1;
+        writes[1].descriptorType = vk::DescriptorType::eStorageImage;
+        writes[1].pImageInfo = &outputInfo;
+
+        m_device.updateDescriptorSets(writes, nullptr);
+    }
+
+    // Async, the compute queue records into pools of its own family
+    if (isAsync()) {
+        m_computePools.init(m_device, m_computeQueueIdx, imageCount);
+
+        for (uint32_t i = 0; i < imageCount; i++) {
+            m_sceneDone.push_back(m_syncPool->acquireSemaphore());
+            m_postDone.push_back(m_syncPool->acquireSemaphore());
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+// Device is idle, from destroy() or a swapchain rebuild
+//
+void PostProcess::destroyTargets()
+{
+    m_computePools.destroy();
+
+    // every signal was waited on
+    for (auto semaphore : m_sceneDone)
+        m_syncPool->releaseSemaphore(semaphore);
+    for (auto semaphore : m_postDone)
+        m_syncPool->releaseSemaphore(semaphore);
+    m_sceneDone.clear();
+    m_postDone.clear();
+
+    VkObjects.onDestroy(m_descriptorPool);
+    m_device.destroyDescriptorPool(m_descriptorPool);
+    m_descriptorPool = nullptr;
+    m_descriptorSets.clear();
+
+    for (auto framebuffer : m_framebuffers) {
+        VkObjects.onDestroy(framebuffer);
+        m_device.destroyFramebuffer(framebuffer);
+    }
+    m_framebuffers.clear();
+
+    for (auto& target : m_targets) {
+        VkObjects.onDestroy(target.view);
+        m_device.destroyImageView(target.view);
+        m_allocator->destroyResource(target.allocation);
+    }
+    m_targets.clear();
+    m_images.clear();
+}
+
+//-------------------------------------------------------------------------
+// Async, the compute buffers of the image completed with its fence
+//
+void PostProcess::beginFrame(uint32_t imageIndex)
+{
+    if (isAsync())
+        m_computePools.reset(imageIndex);
+}
+
+//-------------------------------------------------------------------------
+// Synchronous dispatch, the overlay or a readback may follow in the same
+// command buffer
+//
+void PostProcess::record(vk::CommandBuffer cmdBuffer, uint32_t imageIndex)
+{
+    assert(!isAsync() && "async post process is submitted on the compute queue");
+
+    dispatch(cmdBuffer, imageIndex, vk::PipelineStageFlagBits::eColorAttachmentOutput
+        | vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eColorAttachmentRead
+        | vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eTransferRead);
+}
+
+//-------------------------------------------------------------------------
+// Async dispatch on the compute queue, no fence. The frame's graphics
+// submit waits on the returned semaphore, its fence covers this submit
+//
+vk::Semaphore PostProcess::submit(vk::Queue queue, uint32_t imageIndex, vk::Semaphore imageAcquired)
+{
+    assert(isAsync() && "synchronous post process is recorded in the frame");
+
+    vk::CommandBuffer cmdBuffer = m_computePools.allocate(imageIndex);
+
+    try {
+        cmdBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+
+    // visibility to the graphics queue comes with the semaphore
+    dispatch(cmdBuffer, imageIndex, vk::PipelineStageFlagBits::eBottomOfPipe, {});
+
+    try {
+        cmdBuffer.end();
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
+    const std::array<vk::Semaphore, 2> waitSemaphores = { m_sceneDone[imageIndex], imageAcquired };
+    const std::array<vk::PipelineStageFlags, 2> waitStages = {
+        vk::PipelineStageFlags(vk::PipelineStageFlagBits::eComputeShader),
+        vk::PipelineStageFlags(vk::PipelineStageFlagBits::eComputeShader) };
+
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmdBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_postDone[imageIndex];
+
+    try {
+        queue.submit(submitInfo, nullptr);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to submit post process command buffer!");
+    }
+
+    return m_postDone[imageIndex];
+}
+
+//-------------------------------------------------------------------------
+// Swapchain image to storage, dispatch, back to present. Contents from
+// the last present are discarded, every texel is written
+//
+void PostProcess::dispatch(vk::CommandBuffer cmdBuffer, uint32_t imageIndex, vk::PipelineStageFlags dstStage,
+    vk::AccessFlags dstAccess)
+{
+    vk::ImageMemoryBarrier toGeneral = {};
+    toGeneral.srcAccessMask = {};
+    toGeneral.dstAccessMask = vk::AccessFlagBits::eShaderWrite;
+    toGeneral.oldLayout = vk::ImageLayout::eUndefined;
+    toGeneral.newLayout = vk::ImageLayout::eGeneral;
+    toGeneral.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toGeneral.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toGeneral.image = m_images[imageIndex];
+    toGeneral.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+
+    // chained to the acquire semaphore wait at the compute stage
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eComputeShader, {}, nullptr, nullptr, toGeneral);
+
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_pipeline);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_program->pipelineLayout, 0,
+        m_descriptorSets[imageIndex], nullptr);
+    cmdBuffer.pushConstants(m_program->pipelineLayout, m_program->pushConstantStages, 0,
+        sizeof(gpu::GpuPostParams), &m_params);
+    cmdBuffer.dispatch((m_extent.width + 7) / 8, (m_extent.height + 7) / 8, 1);
+
+    vk::ImageMemoryBarrier toPresent = toGeneral;
+    toPresent.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    toPresent.dstAccessMask = dstAccess;
+    toPresent.oldLayout = vk::ImageLayout::eGeneral;
+    toPresent.newLayout = vk::ImageLayout::ePresentSrcKHR;
+
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, dstStage, {},
+        nullptr, nullptr, toPresent);
+}
+
+//-------------------------------------------------------------------------
+// Storage writes to the swapchain format without a format qualifier
+//
+bool PostProcess::isSupported(vk::PhysicalDevice physicalDevice, const SwapChain& swapchain)
+{
+    if (!physicalDevice.getFeatures().shaderStorageImageWriteWithoutFormat)
+        return false;
+
+    const vk::FormatProperties properties = physicalDevice.getFormatProperties(swapchain.getFormat());
+    if (!(properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eStorageImage))
+        return false;
+
+    return static_cast<bool>(swapchain.getImageUsage() & vk::ImageUsageFlagBits::eStorage);
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
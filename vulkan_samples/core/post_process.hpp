@@ -0,0 +1,138 @@
+/*
+ *
+ * Andrew Frost
+ * post_process.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "command_pools.hpp"
+#include "device_allocator.hpp"
+#include "pipeline_variants.hpp"
+#include "shader_library.hpp"
+#include "swapchain.hpp"
+#include "sync_pool.hpp"
+#include "../common/gpu_structs.h"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// PostProcess                                                           //
+///////////////////////////////////////////////////////////////////////////
+// Tonemap, color grade and sharpen in one compute dispatch writing the //
+// swapchain image as a storage image, no full screen raster pass and  //
+// no LDR intermediate                                                  //
+// - the scene renders into an HDR target through getRenderPass(), the //
+//   dispatch samples it and neighbors never race with the writes      //
+// - synchronous: record() after the scene pass, one HDR target       //
+// - async: submit() runs the dispatch on the dedicated compute queue, //
+//   between the scene submit and the frame's graphics submit. Targets //
+//   are per swapchain image so the next scene can start right away   //
+// - isSupported() false keeps the scene on the swapchain render pass  //
+///////////////////////////////////////////////////////////////////////////
+
+class PostProcess
+{
+public:
+    PostProcess(PostProcess const&) = delete;
+    PostProcess& operator=(PostProcess const&) = delete;
+
+    PostProcess() = default;
+    ~PostProcess() { destroy(); }
+
+    // computeQueueIdx other than VK_QUEUE_FAMILY_IGNORED selects the async
+    // path, the swapchain images must then be shared with that family
+    void init(vk::Device device, DeviceAllocator& allocator, SyncPool& syncPool, ShaderLibrary& shaders,
+        PipelineVariants& variants, vk::Format depthFormat, uint32_t graphicsQueueIdx,
+        uint32_t computeQueueIdx = VK_QUEUE_FAMILY_IGNORED);
+
+    // Device must be idle
+    void destroy();
+
+    // HDR targets, framebuffers and descriptors for the swapchain images,
+    // after init and after every rebuild. depthView may be larger
+    void createTargets(const SwapChain& swapchain, vk::ImageView depthView);
+
+    // Async only, the frame's fence has signaled
+    void beginFrame(uint32_t imageIndex);
+
+    // Synchronous, after the scene pass. The image is left in ePresentSrcKHR
+    void record(vk::CommandBuffer cmdBuffer, uint32_t imageIndex);
+
+    // Async, waits for the scene semaphore and the acquired image. Returns
+    // the semaphore the frame's graphics submit waits on
+    vk::Semaphore submit(vk::Queue queue, uint32_t imageIndex, vk::Semaphore imageAcquired);
+
+    // Device has shaderStorageImageWriteWithoutFormat, the swapchain format
+    // supports storage and its images were created with it
+    static bool isSupported(vk::PhysicalDevice physicalDevice, const SwapChain& swapchain);
+
+    // Setting Methods
+    void setParams(const gpu::GpuPostParams& params) { m_params = params; }
+
+    // Getting Methods
+    vk::RenderPass            getRenderPass()                        const { return m_renderPass; }
+    vk::RenderPass            getRenderPassLoad()                    const { return m_renderPassLoad; }
+    vk::Framebuffer           getFramebuffer(uint32_t imageIndex)    const { return m_framebuffers[imageIndex]; }
+    vk::Image                 getTarget(uint32_t imageIndex)         const { return m_targets[targetIndex(imageIndex)].image; }
+    vk::Format                getTargetFormat()                      const { return m_targetFormat; }
+    vk::Semaphore             getSceneSemaphore(uint32_t imageIndex) const { return m_sceneDone[imageIndex]; }
+    const gpu::GpuPostParams& getParams()                            const { return m_params; }
+    bool                      isAsync()                              const { return m_computeQueueIdx != VK_QUEUE_FAMILY_IGNORED; }
+
+private:
+
+    struct Target
+    {
+        vk::Image                     image;
+        vk::ImageView                 view;
+        DeviceAllocator::AllocationID allocation{ 0 };
+    };
+
+    void createRenderPass(vk::Format depthFormat);
+
+    void destroyTargets();
+
+    void dispatch(vk::CommandBuffer cmdBuffer, uint32_t imageIndex, vk::PipelineStageFlags dstStage,
+        vk::AccessFlags dstAccess);
+
+    uint32_t targetIndex(uint32_t imageIndex) const { return isAsync() ? imageIndex : 0; }
+
+    vk::Device                     m_device;
+    DeviceAllocator*               m_allocator{ nullptr };
+    SyncPool*                      m_syncPool{ nullptr };
+    uint32_t                       m_graphicsQueueIdx{ VK_QUEUE_FAMILY_IGNORED };
+    uint32_t                       m_computeQueueIdx{ VK_QUEUE_FAMILY_IGNORED };
+
+    const ShaderProgram*           m_program{ nullptr };
+    vk::Pipeline                   m_pipeline;
+    vk::Sampler                    m_sampler;
+    vk::RenderPass                 m_renderPass;
+    vk::RenderPass                 m_renderPassLoad;     // continues the scene, same framebuffers
+    vk::Format                     m_targetFormat{ vk::Format::eR16G16B16A16Sfloat };
+
+    // Per swapchain image, targets only with async
+    std::vector<Target>            m_targets;
+    std::vector<vk::Framebuffer>   m_framebuffers;
+    vk::DescriptorPool             m_descriptorPool;
+    std::vector<vk::DescriptorSet> m_descriptorSets;
+    std::vector<vk::Image>         m_images;
+    vk::Extent2D                   m_extent{ 0, 0 };
+
+    // Async, compute command buffers and the semaphores around them
+    FrameCommandPools              m_computePools;
+    std::vector<vk::Semaphore>     m_sceneDone;
+    std::vector<vk::Semaphore>     m_postDone;
+
+    gpu::GpuPostParams             m_params{ gpu::vec3(1.f), 1.f, 1.f, 1.f, 0.2f };
+
+}; // class PostProcess
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
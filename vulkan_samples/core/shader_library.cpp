@@ -0,0 +1,631 @@
+/*
+ *
+ * Andrew Frost
+ * shader_library.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+
+#include "shader_library.hpp"
+#include "object_registry.hpp"
+#include "vk_utils.hpp"
+
+#ifdef _DEBUG
+#include "../helper/debug.hpp"
+static vkb::debug::DebugUtil s_debug;
+#endif // _DEBUG
+
+namespace vkb {
+namespace core {
+
+//-------------------------------------------------------------------------
+// SPIR-V enumerants used by reflection
+//
+namespace spv {
+static const uint32_t MagicNumber              = 0x07230203;
+
+static const uint32_t OpEntryPoint             = 15;
+static const uint32_t OpTypeInt                = 21;
+static const uint32_t OpTypeFloat              = 22;
+static const uint32_t OpTypeVector             = 23;
+static const uint32_t OpTypeMatrix             = 24;
+static const uint32_t OpTypeImage              = 25;
+static const uint32_t OpTypeSampler            = 26;
+static const uint32_t OpTypeSampledImage       = 27;
+static const uint32_t OpTypeArray              = 28;
+static const uint32_t OpTypeRuntimeArray       = 29;
+static const uint32_t OpTypeStruct             = 30;
+static const uint32_t OpTypePointer            = 32;
+static const uint32_t OpConstant               = 43;
+static const uint32_t OpVariable               = 59;
+static const uint32_t OpDecorate               = 71;
+static const uint32_t OpMemberDecorate         = 72;
+static const uint32_t OpTypeAccelerationStructure = 5341;
+
+static const uint32_t DecorationBlock          = 2;
+static const uint32_t DecorationBufferBlock    = 3;
+static const uint32_t DecorationArrayStride    = 6;
+static const uint32_t DecorationMatrixStride   = 7;
+static const uint32_t DecorationBinding        = 33;
+static const uint32_t DecorationDescriptorSet  = 34;
+static const uint32_t DecorationOffset         = 35;
+
+static const uint32_t StorageUniformConstant   = 0;
+static const uint32_t StorageUniform           = 2;
+static const uint32_t StoragePushConstant      = 9;
+static const uint32_t StorageStorageBuffer     = 12;
+
+static const uint32_t DimBuffer                = 5;
+static const uint32_t DimSubpassData           = 6;
+} // namespace spv
+
+//-------------------------------------------------------------------------
+// Execution model to shader stage
+//
+static vk::ShaderStageFlagBits executionModelStage(uint32_t model)
+{
+    switch (model) {
+    case 0:    return vk::ShaderStageFlagBits::eVertex;
+    case 1:    return vk::ShaderStageFlagBits::eTessellationControl;
+    case 2:    return vk::ShaderStageFlagBits::eTessellationEvaluation;
+    case 3:    return vk::ShaderStageFlagBits::eGeometry;
+    case 4:    return vk::ShaderStageFlagBits::eFragment;
+    case 5:    return vk::ShaderStageFlagBits::eCompute;
+    case 5267: return vk::ShaderStageFlagBits::eTaskNV;
+    case 5268: return vk::ShaderStageFlagBits::eMeshNV;
+    case 5313: return vk::ShaderStageFlagBits::eRaygenNV;
+    case 5314: return vk::ShaderStageFlagBits::eIntersectionNV;
+    case 5315: return vk::ShaderStageFlagBits::eAnyHitNV;
+    case 5316: return vk::ShaderStageFlagBits::eClosestHitNV;
+    case 5317: return vk::ShaderStageFlagBits::eMissNV;
+    case 5318: return vk::ShaderStageFlagBits::eCallableNV;
+    default:
+        throw std::runtime_error("unsupported SPIR-V execution model!");
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// ShaderReflection                                                      //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Parse the module, descriptors and push constant block of the first
+// entry point
+//
+ShaderReflection ShaderReflection::reflect(const uint32_t* code, size_t wordCount)
+{
+    if (wordCount < 5 || code[0] != spv::MagicNumber)
+        throw std::runtime_error("invalid SPIR-V binary!");
+
+    struct Id
+    {
+        uint32_t              opcode{ 0 };
+        std::vector<uint32_t> operands;         // words after the result id
+        uint32_t              set{ ~0u };
+        uint32_t              binding{ ~0u };
+        uint32_t              arrayStride{ 0 };
+        bool                  block{ false };
+        bool                  bufferBlock{ false };
+    };
+
+    const uint32_t bound = code[3];
+    std::vector<Id> ids(bound);
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> memberOffsets;
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> memberMatrixStrides;
+
+    ShaderReflection reflection;
+    bool hasEntryPoint = false;
+
+    auto checkId = [bound](uint32_t id) {
+        if (id >= bound)
+            throw std::runtime_error("invalid SPIR-V binary, id out of bound!");
+        return id;
+    };
+
+    size_t i = 5;
+    while (i < wordCount) {
+        const uint32_t opcode = code[i] & 0xffff;
+        const uint32_t count = code[i] >> 16;
+        if (count == 0 || i + count > wordCount)
+            throw std::runtime_error("invalid SPIR-V binary, truncated instruction!");
+
+        const uint32_t* words = &code[i];
+
+        switch (opcode) {
+        case spv::OpEntryPoint:
+            if (!hasEntryPoint) {
+                reflection.stage = executionModelStage(words[1]);
+                reflection.entryPoint = reinterpret_cast<const char*>(&words[3]);
+                hasEntryPoint = true;
+            }
+            break;
+
+        case spv::OpDecorate: {
+            Id& id = ids[checkId(words[1])];
+            switch (words[2]) {
+            case spv::DecorationDescriptorSet: id.set = words[3]; break;
+            case spv::DecorationBinding:       id.binding = words[3]; break;
+            case spv::DecorationArrayStride:   id.arrayStride = words[3]; break;
+            case spv::DecorationBlock:         id.block = true; break;
+            case spv::DecorationBufferBlock:   id.bufferBlock = true; break;
+            }
+            break;
+        }
+
+        case spv::OpMemberDecorate:
+            if (words[3] == spv::DecorationOffset)
+                memberOffsets[{ words[1], words[2] }] = words[4];
+            else if (words[3] == spv::DecorationMatrixStride)
+                memberMatrixStrides[{ words[1], words[2] }] = words[4];
+            break;
+
+        case spv::OpTypeInt:
+        case spv::OpTypeFloat:
+        case spv::OpTypeVector:
+        case spv::OpTypeMatrix:
+        case spv::OpTypeImage:
+        case spv::OpTypeSampler:
+        case spv::OpTypeSampledImage:
+        case spv::OpTypeArray:
+        case spv::OpTypeRuntimeArray:
+        case spv::OpTypeStruct:
+        case spv::OpTypePointer:
+        case spv::OpTypeAccelerationStructure: {
+            Id& id = ids[checkId(words[1])];
+            id.opcode = opcode;
+            id.operands.assign(words + 2, words + count);
+            break;
+        }
+
+        case spv::OpConstant:
+        case spv::OpVariable: {
+            // result type, result id, value or storage class
+            Id& id = ids[checkId(words[2])];
+            id.opcode = opcode;
+            id.operands.assign({ words[1], count > 3 ? words[3] : 0 });
+            break;
+        }
+        }
+
+        i += count;
+    }
+
+    if (!hasEntryPoint)
+        throw std::runtime_error("SPIR-V binary has no entry point!");
+
+    // Byte size of a type, offsets and strides from decorations
+    std::function<uint32_t(uint32_t, uint32_t)> typeSize = [&](uint32_t typeId, uint32_t matrixStride) -> uint32_t {
+        const Id& type = ids[checkId(typeId)];
+        switch (type.opcode) {
+        case spv::OpTypeInt:
+        case spv::OpTypeFloat:
+            return type.operands[0] / 8;
+        case spv::OpTypeVector:
+            return typeSize(type.operands[0], 0) * type.operands[1];
+        case spv::OpTypeMatrix:
+            return (matrixStride ? matrixStride : typeSize(type.operands[0], 0)) * type.operands[1];
+        case spv::OpTypeArray: {
+            const uint32_t length = ids[checkId(type.operands[1])].operands[1];
+            const uint32_t stride = type.arrayStride ? type.arrayStride : typeSize(type.operands[0], matrixStride);
+            return stride * length;
+        }
+        case spv::OpTypeRuntimeArray:
+            return 0;
+        case spv::OpTypeStruct: {
+            uint32_t size = 0;
+            for (uint32_t m = 0; m < type.operands.size(); m++) {
+                auto offset = memberOffsets.find({ typeId, m });
+                auto stride = memberMatrixStrides.find({ typeId, m });
+                const uint32_t memberSize = typeSize(type.operands[m],
+                    stride != memberMatrixStrides.end() ? stride->second : 0);
+                size = std::max(size, (offset != memberOffsets.end() ? offset->second : 0) + memberSize);
+            }
+            return size;
+        }
+        default:
+            return 0;
+        }
+    };
+
+    for (uint32_t id = 0; id < bound; id++) {
+        const Id& variable = ids[id];
+        if (variable.opcode != spv::OpVariable)
+            continue;
+
+        const uint32_t storage = variable.operands[1];
+        const Id& pointer = ids[checkId(variable.operands[0])];
+        uint32_t typeId = pointer.operands[1];
+
+        if (storage == spv::StoragePushConstant) {
+            reflection.pushConstantSize = std::max(reflection.pushConstantSize, typeSize(typeId, 0));
+            continue;
+        }
+
+        if (storage != spv::StorageUniformConstant && storage != spv::StorageUniform
+            && storage != spv::StorageStorageBuffer)
+            continue;
+        if (variable.set == ~0u || variable.binding == ~0u)
+            continue;
+
+        Binding binding = {};
+        binding.set = variable.set;
+        binding.binding = variable.binding;
+
+        // arrays of descriptors
+        while (ids[checkId(typeId)].opcode == spv::OpTypeArray || ids[typeId].opcode == spv::OpTypeRuntimeArray) {
+            const Id& array = ids[typeId];
+            binding.count *= array.opcode == spv::OpTypeArray ? ids[checkId(array.operands[1])].operands[1] : 0;
+            typeId = array.operands[0];
+        }
+
+        const Id& type = ids[typeId];
+        switch (type.opcode) {
+        case spv::OpTypeSampler:
+            binding.type = vk::DescriptorType::eSampler;
+            break;
+        case spv::OpTypeSampledImage: {
+            const Id& image = ids[checkId(type.operands[0])];
+            binding.type = image.operands[1] == spv::DimBuffer
+                ? vk::DescriptorType::eUniformTexelBuffer : vk::DescriptorType::eCombinedImageSampler;
+            break;
+        }
+        case spv::OpTypeImage: {
+            const uint32_t dim = type.operands[1];
+            const bool storageImage = type.operands[5] == 2;
+            if (dim == spv::DimSubpassData)
+                binding.type = vk::DescriptorType::eInputAttachment;
+            else if (dim == spv::DimBuffer)
+                binding.type = storageImage ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+            else
+                binding.type = storageImage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+            break;
+        }
+        case spv::OpTypeStruct:
+            binding.type = (storage == spv::StorageStorageBuffer || type.bufferBlock)
+                ? vk::DescriptorType::eStorageBuffer : vk::DescriptorType::eUniformBuffer;
+            break;
+        case spv::OpTypeAccelerationStructure:
+            binding.type = vk::DescriptorType::eAccelerationStructureNV;
+            break;
+        default:
+            continue;
+        }
+
+        reflection.bindings.push_back(binding);
+    }
+
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const Binding& a, const Binding& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    return reflection;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Shader                                                                //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Stage info for pipeline creation
+//
+vk::PipelineShaderStageCreateInfo Shader::getStageInfo(const vk::SpecializationInfo* specialization) const
+{
+    vk::PipelineShaderStageCreateInfo stageInfo = {};
+    stageInfo.stage = reflection.stage;
+    stageInfo.module = module;
+    stageInfo.pName = reflection.entryPoint.c_str();
+    stageInfo.pSpecializationInfo = specialization;
+    return stageInfo;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// ShaderLibrary                                                         //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization
+//
+void ShaderLibrary::init(vk::Instance instance, vk::Device device)
+{
+    assert(!m_device && "ShaderLibrary already initialized");
+    m_device = device;
+    m_moduleReuse = 0;
+
+#if _DEBUG
+    s_debug.setup(device, instance);
+#endif
+}
+
+//-------------------------------------------------------------------------
+// Destroy every module and layout
+//
+void ShaderLibrary::destroy()
+{
+    if (!m_device)
+        return;
+
+    for (auto& layout : m_pipelineLayouts) {
+        VkObjects.onDestroy(layout.second);
+        m_device.destroyPipelineLayout(layout.second);
+    }
+    for (auto& layout : m_setLayouts) {
+        VkObjects.onDestroy(layout.second.layout);
+        m_device.destroyDescriptorSetLayout(layout.second.layout);
+    }
+    for (auto& shader : m_shaders) {
+        VkObjects.onDestroy(shader.second->module);
+        m_device.destroyShaderModule(shader.second->module);
+    }
+
+    m_pipelineLayouts.clear();
+    m_setLayouts.clear();
+    m_programs.clear();
+    m_shaders.clear();
+    m_files.clear();
+
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Load SPIR-V from disk, a path is only read once
+//
+const Shader& ShaderLibrary::loadFromFile(const std::string& path)
+{
+    auto file = m_files.find(path);
+    if (file != m_files.end()) {
+        m_moduleReuse++;
+        return *m_shaders[file->second];
+    }
+
+    std::ifstream stream(path, std::ios::ate | std::ios::binary);
+    if (!stream.is_open())
+        throw std::runtime_error("failed to open shader file: " + path);
+
+    const size_t size = static_cast<size_t>(stream.tellg());
+    if (size == 0 || size % 4 != 0)
+        throw std::runtime_error("invalid SPIR-V file size: " + path);
+
+    std::vector<uint32_t> code(size / 4);
+    stream.seekg(0);
+    stream.read(reinterpret_cast<char*>(code.data()), size);
+
+    const Shader& shader = loadFromMemory(code.data(), size, path);
+    m_files[path] = shader.hash;
+
+    return shader;
+}
+
+//-------------------------------------------------------------------------
+// Load SPIR-V from memory, identical code shares a module
+//
+const Shader& ShaderLibrary::loadFromMemory(const uint32_t* code, size_t sizeInBytes, const std::string& name)
+{
+    const size_t wordCount = sizeInBytes / 4;
+    const uint64_t hash = hashCode(code, wordCount);
+
+    auto it = m_shaders.find(hash);
+    if (it != m_shaders.end()) {
+        const Shader& existing = *it->second;
+        if (existing.code.size() != wordCount || memcmp(existing.code.data(), code, sizeInBytes) != 0)
+            throw std::runtime_error("SPIR-V hash collision: " + name + " and " + existing.name);
+        m_moduleReuse++;
+        return existing;
+    }
+
+    auto shader = std::make_unique<Shader>();
+    shader->name = name;
+    shader->hash = hash;
+    shader->code.assign(code, code + wordCount);
+    shader->reflection = ShaderReflection::reflect(code, wordCount);
+
+    vk::ShaderModuleCreateInfo createInfo = {};
+    createInfo.codeSize = sizeInBytes;
+    createInfo.pCode = code;
+
+    try {
+        shader->module = m_device.createShaderModule(createInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create shader module: " + name);
+    }
+    VkObjects.onCreate(shader->module, 0, shader->name.c_str());
+
+#if _DEBUG
+    s_debug.setObjectName(shader->module, shader->name.c_str());
+#endif
+
+    return *(m_shaders[hash] = std::move(shader));
+}
+
+//-------------------------------------------------------------------------
+// Merge stage reflections into one pipeline layout
+// - a binding declared by several stages must agree on type and count
+// - push constants become a single range visible to every stage using them
+//
+const ShaderProgram& ShaderLibrary::createProgram(const std::vector<const Shader*>& stages)
+{
+    uint64_t key = hashBytes(nullptr, 0);
+    for (const Shader* shader : stages)
+        key = hashBytes(&shader->hash, sizeof(shader->hash), key);
+
+    auto it = m_programs.find(key);
+    if (it != m_programs.end())
+        return *it->second;
+
+    auto program = std::make_unique<ShaderProgram>();
+    program->hash = key;
+    program->stages = stages;
+
+    struct Merged
+    {
+        ShaderReflection::Binding binding;
+        vk::ShaderStageFlags      stages;
+        const Shader*             owner;
+    };
+    std::map<std::pair<uint32_t, uint32_t>, Merged> merged;
+
+    for (const Shader* shader : stages) {
+        const ShaderReflection& reflection = shader->reflection;
+
+        for (const auto& binding : reflection.bindings) {
+            auto result = merged.insert({ { binding.set, binding.binding }, { binding, reflection.stage, shader } });
+            Merged& entry = result.first->second;
+            if (result.second)
+                continue;
+
+            if (entry.binding.type != binding.type || entry.binding.count != binding.count) {
+                throw std::runtime_error("shader layout mismatch at set " + std::to_string(binding.set)
+                    + " binding " + std::to_string(binding.binding) + " between "
+                    + entry.owner->name + " and " + shader->name);
+            }
+            entry.stages |= reflection.stage;
+        }
+
+        if (reflection.pushConstantSize > 0) {
+            program->pushConstantSize = std::max(program->pushConstantSize, reflection.pushConstantSize);
+            program->pushConstantStages |= reflection.stage;
+        }
+    }
+
+    // One layout per set, empty sets fill the gaps
+    uint32_t setCount = 0;
+    for (const auto& entry : merged)
+        setCount = std::max(setCount, entry.first.first + 1);
+
+    // runtime sized arrays are the only partially bound bindings
+    std::vector<std::vector<vk::DescriptorSetLayoutBinding>> setBindings(setCount);
+    std::vector<std::vector<vk::DescriptorBindingFlagsEXT>>  setBindingFlags(setCount);
+    for (const auto& entry : merged) {
+        const Merged& m = entry.second;
+        vk::DescriptorSetLayoutBinding binding = {};
+        binding.binding = m.binding.binding;
+        binding.descriptorType = m.binding.type;
+        binding.descriptorCount = m.binding.count ? m.binding.count : m_runtimeArraySize;
+        binding.stageFlags = m.stages;
+        setBindings[m.binding.set].push_back(binding);
+        setBindingFlags[m.binding.set].push_back(m.binding.count
+            ? vk::DescriptorBindingFlagsEXT() : vk::DescriptorBindingFlagBitsEXT::ePartiallyBound);
+    }
+
+    uint64_t layoutKey = hashBytes(nullptr, 0);
+    for (uint32_t set = 0; set < setCount; set++) {
+        program->setLayouts.push_back(getSetLayout(setBindings[set], setBindingFlags[set]));
+        const VkDescriptorSetLayout handle = program->setLayouts.back();
+        layoutKey = hashBytes(&handle, sizeof(handle), layoutKey);
+    }
+
+    vk::PushConstantRange pushRange = {};
+    pushRange.stageFlags = program->pushConstantStages;
+    pushRange.offset = 0;
+    pushRange.size = program->pushConstantSize;
+    layoutKey = hashBytes(&pushRange, sizeof(pushRange), layoutKey);
+
+    auto layout = m_pipelineLayouts.find(layoutKey);
+    if (layout != m_pipelineLayouts.end()) {
+        program->pipelineLayout = layout->second;
+    }
+    else {
+        vk::PipelineLayoutCreateInfo layoutInfo = {};
+        layoutInfo.setLayoutCount = static_cast<uint32_t>(program->setLayouts.size());
+        layoutInfo.pSetLayouts = program->setLayouts.data();
+        layoutInfo.pushConstantRangeCount = pushRange.size > 0 ? 1 : 0;
+        layoutInfo.pPushConstantRanges = &pushRange;
+
+        try {
+            program->pipelineLayout = m_device.createPipelineLayout(layoutInfo);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+        VkObjects.onCreate(program->pipelineLayout);
+        m_pipelineLayouts[layoutKey] = program->pipelineLayout;
+    }
+
+    return *(m_programs[key] = std::move(program));
+}
+
+//-------------------------------------------------------------------------
+// Programs are stored under their hash
+//
+const ShaderProgram* ShaderLibrary::findProgram(uint64_t hash) const
+{
+    auto it = m_programs.find(hash);
+    return it != m_programs.end() ? it->second.get() : nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Hash of SPIR-V code
+//
+uint64_t ShaderLibrary::hashCode(const uint32_t* code, size_t wordCount)
+{
+    return hashBytes(code, wordCount * sizeof(uint32_t));
+}
+
+//-------------------------------------------------------------------------
+// Set layout cache key
+//
+uint64_t ShaderLibrary::hashBindings(const std::vector<vk::DescriptorSetLayoutBinding>& bindings,
+    const std::vector<vk::DescriptorBindingFlagsEXT>& bindingFlags)
+{
+    uint64_t key = hashBytes(nullptr, 0);
+    for (size_t i = 0; i < bindings.size(); i++) {
+        const vk::DescriptorSetLayoutBinding& binding = bindings[i];
+        const uint32_t fields[5] = { binding.binding, static_cast<uint32_t>(binding.descriptorType),
+            binding.descriptorCount, static_cast<uint32_t>(binding.stageFlags),
+            static_cast<uint32_t>(bindingFlags[i]) };
+        key = hashBytes(fields, sizeof(fields), key);
+    }
+    return key;
+}
+
+//-------------------------------------------------------------------------
+// Cached descriptor set layout, flags are per binding and only chained
+// when one of them is set. A hit must match the stored bindings
+//
+vk::DescriptorSetLayout ShaderLibrary::getSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings,
+    const std::vector<vk::DescriptorBindingFlagsEXT>& bindingFlags)
+{
+    const uint64_t key = hashBindings(bindings, bindingFlags);
+
+    auto it = m_setLayouts.find(key);
+    if (it != m_setLayouts.end()) {
+        if (it->second.bindings != bindings || it->second.bindingFlags != bindingFlags)
+            throw std::runtime_error("descriptor set layout hash collision!");
+        return it->second.layout;
+    }
+
+    bool partiallyBound = false;
+    for (const auto& flags : bindingFlags)
+        partiallyBound |= bool(flags);
+
+    vk::DescriptorSetLayoutBindingFlagsCreateInfoEXT flagsInfo = {};
+    flagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    flagsInfo.pBindingFlags = bindingFlags.data();
+
+    vk::DescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    layoutInfo.pNext = partiallyBound ? &flagsInfo : nullptr;
+
+    vk::DescriptorSetLayout layout;
+    try {
+        layout = m_device.createDescriptorSetLayout(layoutInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+    VkObjects.onCreate(layout);
+
+    m_setLayouts[key] = { bindings, bindingFlags, layout };
+    return layout;
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,148 @@
+/*
+ *
+ * Andrew Frost
+ * shader_library.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// ShaderReflection                                                      //
+///////////////////////////////////////////////////////////////////////////
+// Resource interface read from the SPIR-V binary                       //
+///////////////////////////////////////////////////////////////////////////
+
+struct ShaderReflection
+{
+    struct Binding
+    {
+        uint32_t           set{ 0 };
+        uint32_t           binding{ 0 };
+        vk::DescriptorType type{ vk::DescriptorType::eUniformBuffer };
+        uint32_t           count{ 1 };  // 0 for runtime sized arrays
+    };
+
+    vk::ShaderStageFlagBits stage{ vk::ShaderStageFlagBits::eVertex };
+    std::string             entryPoint;
+    std::vector<Binding>    bindings;
+    uint32_t                pushConstantSize{ 0 };
+
+    static ShaderReflection reflect(const uint32_t* code, size_t wordCount);
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Shader                                                                //
+///////////////////////////////////////////////////////////////////////////
+
+struct Shader
+{
+    std::string           name;
+    uint64_t              hash{ 0 };
+    std::vector<uint32_t> code;
+    vk::ShaderModule      module;
+    ShaderReflection      reflection;
+
+    vk::PipelineShaderStageCreateInfo getStageInfo(const vk::SpecializationInfo* specialization = nullptr) const;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// ShaderProgram                                                         //
+///////////////////////////////////////////////////////////////////////////
+// Stages linked together, with the pipeline layout built from their    //
+// merged reflection                                                     //
+///////////////////////////////////////////////////////////////////////////
+
+struct ShaderProgram
+{
+    uint64_t                             hash{ 0 };    // of the stage hashes, stable across reloads
+    std::vector<const Shader*>           stages;
+    std::vector<vk::DescriptorSetLayout> setLayouts;
+    vk::PipelineLayout                   pipelineLayout;
+    vk::ShaderStageFlags                 pushConstantStages;
+    uint32_t                             pushConstantSize{ 0 };
+};
+
+///////////////////////////////////////////////////////////////////////////
+// ShaderLibrary                                                         //
+///////////////////////////////////////////////////////////////////////////
+// - SPIR-V is hashed, identical code shares one vk::ShaderModule       //
+// - descriptor set and pipeline layouts are cached by content          //
+// - stages with conflicting bindings throw when the program is made   //
+///////////////////////////////////////////////////////////////////////////
+
+class ShaderLibrary
+{
+public:
+    ShaderLibrary(ShaderLibrary const&) = delete;
+    ShaderLibrary& operator=(ShaderLibrary const&) = delete;
+
+    ShaderLibrary() = default;
+    ~ShaderLibrary() { destroy(); }
+
+    void init(vk::Instance instance, vk::Device device);
+
+    void destroy();
+
+    // Load SPIR-V, returns the existing shader when the code was seen before
+    const Shader& loadFromFile(const std::string& path);
+    const Shader& loadFromMemory(const uint32_t* code, size_t sizeInBytes, const std::string& name);
+
+    // Link stages and build their pipeline layout, throws on layout mismatch
+    const ShaderProgram& createProgram(const std::vector<const Shader*>& stages);
+
+    // Program of a ShaderProgram::hash, nullptr when there is none
+    const ShaderProgram* findProgram(uint64_t hash) const;
+
+    // Descriptor count used for runtime sized arrays
+    void setRuntimeArraySize(uint32_t count) { m_runtimeArraySize = count; }
+
+    static uint64_t hashCode(const uint32_t* code, size_t wordCount);
+
+    // Set layout key, bindingFlags has one entry per binding
+    static uint64_t hashBindings(const std::vector<vk::DescriptorSetLayoutBinding>& bindings,
+        const std::vector<vk::DescriptorBindingFlagsEXT>& bindingFlags);
+
+    // Getting Methods
+    uint32_t getModuleCount()  const { return static_cast<uint32_t>(m_shaders.size()); }
+    uint32_t getModuleReuse()  const { return m_moduleReuse; }
+    uint32_t getProgramCount() const { return static_cast<uint32_t>(m_programs.size()); }
+
+private:
+
+    // Bindings are kept to tell hash collisions apart
+    struct SetLayout
+    {
+        std::vector<vk::DescriptorSetLayoutBinding> bindings;
+        std::vector<vk::DescriptorBindingFlagsEXT>  bindingFlags;
+        vk::DescriptorSetLayout                     layout;
+    };
+
+    vk::DescriptorSetLayout getSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings,
+        const std::vector<vk::DescriptorBindingFlagsEXT>& bindingFlags);
+
+    vk::Device                                                  m_device;
+
+    std::unordered_map<uint64_t, std::unique_ptr<Shader>>        m_shaders;
+    std::unordered_map<std::string, uint64_t>                   m_files;
+    std::unordered_map<uint64_t, std::unique_ptr<ShaderProgram>> m_programs;
+    std::unordered_map<uint64_t, SetLayout>                     m_setLayouts;
+    std::unordered_map<uint64_t, vk::PipelineLayout>            m_pipelineLayouts;
+
+    uint32_t                                                    m_runtimeArraySize{ 1024 };
+    uint32_t                                                    m_moduleReuse{ 0 };
+
+}; // class ShaderLibrary
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <algorithm>
+
 #include "swapchain.hpp"
 
 #ifdef _DEBUG
@@ -27,7 +29,7 @@ namespace core {
 //
 bool SwapChain::init(vk::Instance instance, vk::Device device, vk::PhysicalDevice physicalDevice,
     vk::Queue graphicsQueue, uint32_t graphicsQueueIdx, vk::Queue presentQueue,
-    uint32_t presentQueueIdx, vk::SurfaceKHR surface, vk::Format format)
+    uint32_t presentQueueIdx, vk::SurfaceKHR surface, SyncPool& syncPool, vk::Format format)
 {
     assert(!m_device && "VkDevice must exist for swapchain");
     m_device = device;
@@ -37,6 +39,7 @@ bool SwapChain::init(vk::Instance instance, vk::Device device, vk::PhysicalDevic
     m_presentQueue = presentQueue;
     m_presentQueueIdx = presentQueueIdx;
     m_surface = surface;
+    m_syncPool = &syncPool;
 
     m_changeID = 0;
     m_currentSemaphore = 0;
@@ -73,14 +76,16 @@ void SwapChain::deinitResources()
 
     vkDeviceWaitIdle(m_device);
 
+    // device is idle, the semaphores are free right away
     for (auto iter : m_entries) {
         m_device.destroyImageView(iter.imageView);
-        m_device.destroySemaphore(iter.readSemaphore);
-        m_device.destroySemaphore(iter.writtenSemaphore);
+        m_syncPool->recycleSemaphore(iter.readSemaphore);
+        m_syncPool->recycleSemaphore(iter.writtenSemaphore);
     }
 
     if (m_swapchain)
         m_device.destroySwapchainKHR(m_swapchain);
+    m_swapchain = nullptr;
 
     m_entries.clear();
     m_barriers.clear();
@@ -95,6 +100,7 @@ void SwapChain::destroy()
     m_physicalDevice = nullptr;
     m_device = nullptr;
     m_surface = nullptr;
+    m_syncPool = nullptr;
     m_changeID = 0;
 }
 
@@ -170,6 +176,11 @@ void SwapChain::update(uint32_t width, uint32_t height, bool vsync)
     createInfo.imageUsage = vk::ImageUsageFlagBits::eColorAttachment
         | vk::ImageUsageFlagBits::eStorage
         | vk::ImageUsageFlagBits::eTransferDst;
+
+    // frames are copied out for readback where the surface allows it
+    if (surfaceCaps.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc)
+        createInfo.imageUsage |= vk::ImageUsageFlagBits::eTransferSrc;
+    m_imageUsage = createInfo.imageUsage;
     createInfo.preTransform = preTransform;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
@@ -177,12 +188,17 @@ void SwapChain::update(uint32_t width, uint32_t height, bool vsync)
 
     createInfo.oldSwapchain = oldSwapchain;
 
-    if (m_graphicsQueueIdx != m_presentQueueIdx) {
-        uint32_t indices[] = { m_graphicsQueueIdx, m_presentQueueIdx };
+    std::vector<uint32_t> indices = { m_graphicsQueueIdx };
+    if (m_presentQueueIdx != m_graphicsQueueIdx)
+        indices.push_back(m_presentQueueIdx);
+    if (m_sharedQueueIdx != VK_QUEUE_FAMILY_IGNORED
+        && std::find(indices.begin(), indices.end(), m_sharedQueueIdx) == indices.end())
+        indices.push_back(m_sharedQueueIdx);
 
+    if (indices.size() > 1) {
         createInfo.imageSharingMode = vk::SharingMode::eConcurrent;
-        createInfo.queueFamilyIndexCount = 2;
-        createInfo.pQueueFamilyIndices = indices;
+        createInfo.queueFamilyIndexCount = static_cast<uint32_t>(indices.size());
+        createInfo.pQueueFamilyIndices = indices.data();
     }
     else {
         createInfo.imageSharingMode = vk::SharingMode::eExclusive;
@@ -203,10 +219,11 @@ void SwapChain::update(uint32_t width, uint32_t height, bool vsync)
 
     // if existing swapchain is re-created, destroy old swapchain and cleanup
     if (oldSwapchain) {
+        // idle since the start of the update, the new entries get them back
         for (auto iter : m_entries) {
             m_device.destroyImageView(iter.imageView);
-            m_device.destroySemaphore(iter.readSemaphore);
-            m_device.destroySemaphore(iter.writtenSemaphore);
+            m_syncPool->recycleSemaphore(iter.readSemaphore);
+            m_syncPool->recycleSemaphore(iter.writtenSemaphore);
         }
         m_device.destroySwapchainKHR(oldSwapchain);
     }
@@ -240,10 +257,9 @@ void SwapChain::update(uint32_t width, uint32_t height, bool vsync)
             throw std::runtime_error("failed to create image views!");
         }
 
-        // semaphore
-        vk::SemaphoreCreateInfo semCreateInfo = {};
-        entry.readSemaphore = m_device.createSemaphore(semCreateInfo);
-        entry.writtenSemaphore = m_device.createSemaphore(semCreateInfo);
+        // semaphore, recycled across updates
+        entry.readSemaphore = m_syncPool->acquireSemaphore();
+        entry.writtenSemaphore = m_syncPool->acquireSemaphore();
 
         // initial barriers
         vk::ImageSubresourceRange range = {};
@@ -273,8 +289,9 @@ void SwapChain::update(uint32_t width, uint32_t height, bool vsync)
 #endif
     }
 
-    m_width = width;
-    m_height = height;
+    // the surface decides on most platforms, not the requested size
+    m_width = swapchainExtent.width;
+    m_height = swapchainExtent.height;
     m_vsync = vsync;
 
     m_currentSemaphore = 0;
@@ -298,8 +315,10 @@ vk::Result SwapChain::acquireSemaphore(vk::Semaphore semaphore)
     const vk::Result result
         = m_device.acquireNextImageKHR(m_swapchain, UINT64_MAX, semaphore, {}, &m_currentImage);
 
-    if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
-        throw std::error_code(result);
+    // out of date is returned, the caller updates and acquires again
+    if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR
+        && result != vk::Result::eErrorOutOfDateKHR) {
+        throw std::runtime_error("failed to acquire swapchain image!");
     }
     return result;
 }
@@ -307,7 +326,7 @@ vk::Result SwapChain::acquireSemaphore(vk::Semaphore semaphore)
 //-------------------------------------------------------------------------
 // present on provided queue
 //
-void SwapChain::present(vk::Queue queue)
+vk::Result SwapChain::present(vk::Queue queue)
 {
     //vk::Semaphore& written = m_entries[(m_currentSemaphore % m_imageCount)].writtenSemaphore;
     const vk::Semaphore& written = getActiveWrittenSemaphore();
@@ -321,7 +340,12 @@ void SwapChain::present(vk::Queue queue)
 
     m_currentSemaphore++;
 
-    m_graphicsQueue.presentKHR(presentInfo);
+    try {
+        return queue.presentKHR(presentInfo);
+    }
+    catch (vk::OutOfDateKHRError err) {
+        return vk::Result::eErrorOutOfDateKHR;
+    }
 }
 
 //-------------------------------------------------------------------------
@@ -10,6 +10,8 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "sync_pool.hpp"
+
 namespace vkb {
 namespace core {
 
@@ -27,16 +29,23 @@ public:
     SwapChain() {}
     SwapChain(vk::Instance instance, vk::Device device, vk::PhysicalDevice physicalDevice,
         vk::Queue graphicsQueue, uint32_t graphicsQueueIdx, vk::Queue presentQueue,
-        uint32_t presentQueueIdx, vk::SurfaceKHR surface, vk::Format format = vk::Format::eB8G8R8A8Unorm)
+        uint32_t presentQueueIdx, vk::SurfaceKHR surface, SyncPool& syncPool,
+        vk::Format format = vk::Format::eB8G8R8A8Unorm)
     {
         init(instance, device, physicalDevice, graphicsQueue, graphicsQueueIdx,
-            presentQueue, presentQueueIdx, surface, format);
+            presentQueue, presentQueueIdx, surface, syncPool, format);
     }
     ~SwapChain() { destroy(); }
 
+    // Semaphores come from syncPool, it must outlive the swapchain
     bool init(vk::Instance instance, vk::Device device, vk::PhysicalDevice physicalDevice,
         vk::Queue graphicsQueue, uint32_t graphicsQueueIdx, vk::Queue presentQueue,
-        uint32_t presentQueueIdx, vk::SurfaceKHR surface, vk::Format format = vk::Format::eB8G8R8A8Unorm);
+        uint32_t presentQueueIdx, vk::SurfaceKHR surface, SyncPool& syncPool,
+        vk::Format format = vk::Format::eB8G8R8A8Unorm);
+
+    // Images also used from this queue family, e.g. async compute writing
+    // them. Shared images are concurrent, applied by the next update()
+    void setSharedQueueIdx(uint32_t queueIdx) { m_sharedQueueIdx = queueIdx; }
 
     // Clear swapchain
     void deinitResources();
@@ -50,9 +59,9 @@ public:
     vk::Result acquire();
     vk::Result acquireSemaphore(vk::Semaphore semaphore);
 
-    // Present 
-    void present() { present(m_graphicsQueue); }
-    void present(vk::Queue queue);
+    // Present, eSuboptimalKHR and eErrorOutOfDateKHR ask for an update
+    vk::Result present() { return present(m_graphicsQueue); }
+    vk::Result present(vk::Queue queue);
 
     // Update Barriers
     void cmdUpdateBarriers(vk::CommandBuffer cmdBuffer) const;
@@ -68,6 +77,7 @@ public:
     vk::Image        getImage(uint32_t i)     const;
     vk::ImageView    getImageView(uint32_t i) const;
     vk::Format       getFormat()              const { return m_surfaceFormat; }
+    vk::ImageUsageFlags getImageUsage()       const { return m_imageUsage; }
     uint32_t         getWidth()               const { return m_width; }
     uint32_t         getHeight()              const { return m_height; }
     bool             getVsync()               const { return m_vsync; }
@@ -92,11 +102,13 @@ private:
 
     vk::Device                          m_device;
     vk::PhysicalDevice                  m_physicalDevice;
+    SyncPool*                           m_syncPool{ nullptr };
 
     vk::Queue                           m_graphicsQueue;
     uint32_t                            m_graphicsQueueIdx{ VK_QUEUE_FAMILY_IGNORED };
     vk::Queue                           m_presentQueue;
     uint32_t                            m_presentQueueIdx{ VK_QUEUE_FAMILY_IGNORED };
+    uint32_t                            m_sharedQueueIdx{ VK_QUEUE_FAMILY_IGNORED };
 
     vk::SurfaceKHR                      m_surface;
     vk::Format                          m_surfaceFormat{};
@@ -104,6 +116,7 @@ private:
 
     vk::SwapchainKHR                    m_swapchain;
     uint32_t                            m_imageCount{ 0 };
+    vk::ImageUsageFlags                 m_imageUsage;
 
     std::vector<Entry>                  m_entries;
     std::vector<vk::ImageMemoryBarrier> m_barriers;
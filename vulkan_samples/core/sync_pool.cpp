@@ -0,0 +1,333 @@
+/*
+ *
+ * Andrew Frost
+ * sync_pool.cpp
+ * 2020
+ *
+ */
+
+#include <cassert>
+
+#include "object_registry.hpp"
+#include "sync_pool.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// SyncPool                                                              //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization, objects are created on demand
+//
+void SyncPool::init(vk::Device device, uint32_t framesInFlight)
+{
+    assert(!m_device && "SyncPool already initialized");
+    m_device = device;
+    m_framesInFlight = framesInFlight;
+    m_frame = 0;
+    m_created = 0;
+    m_recycled = 0;
+}
+
+//-------------------------------------------------------------------------
+// Call on exit, every object must have been released
+//
+void SyncPool::destroy()
+{
+    if (!m_device)
+        return;
+
+    retireAll();
+
+    for (auto fence : m_freeFences) {
+        VkObjects.onDestroy(fence);
+        m_device.destroyFence(fence);
+    }
+    for (auto fence : m_signaledFences) {
+        VkObjects.onDestroy(fence);
+        m_device.destroyFence(fence);
+    }
+    for (auto semaphore : m_freeSemaphores) {
+        VkObjects.onDestroy(semaphore);
+        m_device.destroySemaphore(semaphore);
+    }
+    for (auto event : m_freeEvents) {
+        VkObjects.onDestroy(event);
+        m_device.destroyEvent(event);
+    }
+    for (auto& pools : m_freeQueryPools) {
+        for (auto pool : pools.second) {
+            VkObjects.onDestroy(pool);
+            m_device.destroyQueryPool(pool);
+        }
+    }
+
+    m_freeFences.clear();
+    m_signaledFences.clear();
+    m_freeSemaphores.clear();
+    m_freeEvents.clear();
+    m_freeQueryPools.clear();
+
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Fence, a signaled one can only come from a signaled release
+//
+vk::Fence SyncPool::acquireFence(bool signaled)
+{
+    std::vector<vk::Fence>& preferred = signaled ? m_signaledFences : m_freeFences;
+    if (!preferred.empty()) {
+        const vk::Fence fence = preferred.back();
+        preferred.pop_back();
+        m_recycled++;
+        return fence;
+    }
+
+    // signaled fences reset on demand
+    if (!signaled && !m_signaledFences.empty()) {
+        const vk::Fence fence = m_signaledFences.back();
+        m_signaledFences.pop_back();
+        m_device.resetFences(fence);
+        m_recycled++;
+        return fence;
+    }
+
+    vk::FenceCreateInfo fenceInfo = {};
+    if (signaled)
+        fenceInfo.flags = vk::FenceCreateFlagBits::eSignaled;
+
+    vk::Fence fence;
+    try {
+        fence = m_device.createFence(fenceInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create pooled fence!");
+    }
+
+    m_created++;
+    VkObjects.onCreate(fence);
+    return fence;
+}
+
+//-------------------------------------------------------------------------
+// Binary semaphore
+//
+vk::Semaphore SyncPool::acquireSemaphore()
+{
+    if (!m_freeSemaphores.empty()) {
+        const vk::Semaphore semaphore = m_freeSemaphores.back();
+        m_freeSemaphores.pop_back();
+        m_recycled++;
+        return semaphore;
+    }
+
+    vk::Semaphore semaphore;
+    try {
+        semaphore = m_device.createSemaphore({});
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create pooled semaphore!");
+    }
+
+    m_created++;
+    VkObjects.onCreate(semaphore);
+    return semaphore;
+}
+
+//-------------------------------------------------------------------------
+// Event, always unset
+//
+vk::Event SyncPool::acquireEvent()
+{
+    if (!m_freeEvents.empty()) {
+        const vk::Event event = m_freeEvents.back();
+        m_freeEvents.pop_back();
+        m_recycled++;
+        return event;
+    }
+
+    vk::Event event;
+    try {
+        event = m_device.createEvent({});
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create pooled event!");
+    }
+
+    m_created++;
+    VkObjects.onCreate(event);
+    return event;
+}
+
+//-------------------------------------------------------------------------
+// Query pool of exactly count queries
+//
+vk::QueryPool SyncPool::acquireQueryPool(vk::QueryType type, uint32_t count,
+    vk::QueryPipelineStatisticFlags statistics)
+{
+    auto it = m_freeQueryPools.find({ type, count, statistics });
+    if (it != m_freeQueryPools.end() && !it->second.empty()) {
+        const vk::QueryPool pool = it->second.back();
+        it->second.pop_back();
+        m_recycled++;
+        return pool;
+    }
+
+    vk::QueryPoolCreateInfo poolInfo = {};
+    poolInfo.queryType = type;
+    poolInfo.queryCount = count;
+    poolInfo.pipelineStatistics = statistics;
+
+    vk::QueryPool pool;
+    try {
+        pool = m_device.createQueryPool(poolInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create pooled query pool!");
+    }
+
+    m_created++;
+    VkObjects.onCreate(pool);
+    return pool;
+}
+
+//-------------------------------------------------------------------------
+// Releases, reusable after framesInFlight more frames
+//
+void SyncPool::releaseFence(vk::Fence fence)
+{
+    Released released;
+    released.kind = Kind::eFence;
+    released.fence = fence;
+    if (fence)
+        release(released);
+}
+
+void SyncPool::releaseSemaphore(vk::Semaphore semaphore)
+{
+    Released released;
+    released.kind = Kind::eSemaphore;
+    released.semaphore = semaphore;
+    if (semaphore)
+        release(released);
+}
+
+void SyncPool::releaseEvent(vk::Event event)
+{
+    Released released;
+    released.kind = Kind::eEvent;
+    released.event = event;
+    if (event)
+        release(released);
+}
+
+void SyncPool::releaseQueryPool(vk::QueryPool pool, vk::QueryType type, uint32_t count,
+    vk::QueryPipelineStatisticFlags statistics)
+{
+    Released released;
+    released.kind = Kind::eQueryPool;
+    released.queryPool = pool;
+    released.queryKey = { type, count, statistics };
+    if (pool)
+        release(released);
+}
+
+//-------------------------------------------------------------------------
+// No deferral, the caller waited for the work that used the semaphore
+//
+void SyncPool::recycleSemaphore(vk::Semaphore semaphore)
+{
+    Released released;
+    released.kind = Kind::eSemaphore;
+    released.semaphore = semaphore;
+    if (semaphore)
+        recycle(released);
+}
+
+void SyncPool::release(Released released)
+{
+    released.frame = m_frame;
+    m_released.push_back(released);
+}
+
+//-------------------------------------------------------------------------
+// Releases older than framesInFlight frames go back to the free lists
+//
+void SyncPool::update()
+{
+    m_frame++;
+
+    size_t retired = 0;
+    while (retired < m_released.size() && m_released[retired].frame + m_framesInFlight < m_frame)
+        recycle(m_released[retired++]);
+    m_released.erase(m_released.begin(), m_released.begin() + retired);
+}
+
+//-------------------------------------------------------------------------
+// Device idle, every release at once. Shared by every user of the pool,
+// a caller that only waited for its own work must not use it
+//
+void SyncPool::retireAll()
+{
+    for (const auto& released : m_released)
+        recycle(released);
+    m_released.clear();
+}
+
+//-------------------------------------------------------------------------
+// Back to its free list, fences are sorted by state and events reset
+//
+void SyncPool::recycle(const Released& released)
+{
+    switch (released.kind) {
+    case Kind::eFence:
+        if (m_device.getFenceStatus(released.fence) == vk::Result::eSuccess)
+            m_signaledFences.push_back(released.fence);
+        else
+            m_freeFences.push_back(released.fence);
+        break;
+    case Kind::eSemaphore:
+        m_freeSemaphores.push_back(released.semaphore);
+        break;
+    case Kind::eEvent:
+        m_device.resetEvent(released.event);
+        m_freeEvents.push_back(released.event);
+        break;
+    case Kind::eQueryPool:
+        m_freeQueryPools[released.queryKey].push_back(released.queryPool);
+        break;
+    }
+}
+
+//-------------------------------------------------------------------------
+// Type and count fill 64 bits, extension types keep all of theirs. The
+// statistics are multiplied in, equality decides the rest
+//
+size_t SyncPool::QueryKeyHash::operator()(const QueryKey& key) const
+{
+    uint64_t hash = (uint64_t(static_cast<uint32_t>(key.type)) << 32) | key.count;
+    hash ^= uint64_t(static_cast<VkQueryPipelineStatisticFlags>(key.statistics)) * 0x9e3779b97f4a7c15ull;
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+//-------------------------------------------------------------------------
+// Counters for the HUD
+//
+SyncPool::Stats SyncPool::getStats() const
+{
+    Stats stats;
+    stats.created = m_created;
+    stats.recycled = m_recycled;
+    stats.pending = static_cast<uint32_t>(m_released.size());
+    stats.free = static_cast<uint32_t>(m_freeFences.size() + m_signaledFences.size() + m_freeSemaphores.size()
+        + m_freeEvents.size());
+    for (const auto& pools : m_freeQueryPools)
+        stats.free += static_cast<uint32_t>(pools.second.size());
+    return stats;
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,144 @@
+/*
+ *
+ * Andrew Frost
+ * sync_pool.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// SyncPool                                                              //
+///////////////////////////////////////////////////////////////////////////
+// Recycles fences, binary semaphores, events and query pools instead   //
+// of creating and destroying them with every swapchain rebuild or     //
+// per frame job                                                        //
+// - release*() defers reuse by framesInFlight update() calls, the GPU  //
+//   may still reference the object until then                         //
+// - retireAll() when the device is idle makes every release reusable, //
+//   including those of other users. recycleSemaphore() only returns   //
+//   the caller's own semaphores, after it waited for their work       //
+// - released semaphores must be unsignaled, any signal was waited on   //
+// - query pools are keyed on type, count and statistics, users reset  //
+//   the queries before use as usual                                   //
+///////////////////////////////////////////////////////////////////////////
+
+class SyncPool
+{
+public:
+    SyncPool(SyncPool const&) = delete;
+    SyncPool& operator=(SyncPool const&) = delete;
+
+    SyncPool() = default;
+    ~SyncPool() { destroy(); }
+
+    void init(vk::Device device, uint32_t framesInFlight);
+
+    // Device must be idle
+    void destroy();
+
+    // A recycled fence may be returned unsignaled after a reset, never the other way
+    vk::Fence     acquireFence(bool signaled = false);
+    vk::Semaphore acquireSemaphore();
+    vk::Event     acquireEvent();
+    vk::QueryPool acquireQueryPool(vk::QueryType type, uint32_t count,
+        vk::QueryPipelineStatisticFlags statistics = {});
+
+    void releaseFence(vk::Fence fence);
+    void releaseSemaphore(vk::Semaphore semaphore);
+    void releaseEvent(vk::Event event);
+    void releaseQueryPool(vk::QueryPool pool, vk::QueryType type, uint32_t count,
+        vk::QueryPipelineStatisticFlags statistics = {});
+
+    // Reusable right away, nothing pending on the semaphore anymore
+    void recycleSemaphore(vk::Semaphore semaphore);
+
+    // Once per frame, after the frame fence wait
+    void update();
+
+    // Swapchain image count is only known after the pool handed out its semaphores
+    void setFramesInFlight(uint32_t framesInFlight) { m_framesInFlight = framesInFlight; }
+
+    // Device must be idle, pending releases of every user are recycled
+    void retireAll();
+
+    struct Stats
+    {
+        uint32_t created{ 0 };
+        uint32_t recycled{ 0 };
+        uint32_t free{ 0 };
+        uint32_t pending{ 0 };
+    };
+
+    // Getting Methods
+    Stats getStats() const;
+
+private:
+
+    enum class Kind : uint32_t
+    {
+        eFence,
+        eSemaphore,
+        eEvent,
+        eQueryPool,
+    };
+
+    // Query pools are only interchangeable with the same layout
+    struct QueryKey
+    {
+        vk::QueryType                   type{ vk::QueryType::eOcclusion };
+        uint32_t                        count{ 0 };
+        vk::QueryPipelineStatisticFlags statistics;
+
+        bool operator==(const QueryKey& other) const
+        {
+            return type == other.type && count == other.count && statistics == other.statistics;
+        }
+    };
+
+    struct QueryKeyHash
+    {
+        size_t operator()(const QueryKey& key) const;
+    };
+
+    struct Released
+    {
+        Kind          kind{ Kind::eFence };
+        vk::Fence     fence;
+        vk::Semaphore semaphore;
+        vk::Event     event;
+        vk::QueryPool queryPool;
+        QueryKey      queryKey;
+        uint64_t      frame{ 0 };
+    };
+
+    void release(Released released);
+
+    void recycle(const Released& released);
+
+    vk::Device                                          m_device;
+    uint32_t                                            m_framesInFlight{ 2 };
+    uint64_t                                            m_frame{ 0 };
+
+    std::vector<vk::Fence>                              m_freeFences;       // unsignaled
+    std::vector<vk::Fence>                              m_signaledFences;
+    std::vector<vk::Semaphore>                          m_freeSemaphores;
+    std::vector<vk::Event>                              m_freeEvents;       // reset
+    std::unordered_map<QueryKey, std::vector<vk::QueryPool>, QueryKeyHash> m_freeQueryPools;
+    std::vector<Released>                               m_released;         // release order
+
+    uint32_t                                            m_created{ 0 };
+    uint32_t                                            m_recycled{ 0 };
+
+}; // class SyncPool
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,880 @@
+/*
+ *
+ * Andrew Frost
+ * texture_streamer.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "texture_streamer.hpp"
+#include "object_registry.hpp"
+#include "vk_utils.hpp"
+
+namespace vkb {
+namespace core {
+
+//-------------------------------------------------------------------------
+// Downsample RGBA8 level with a 2x2 box filter, odd edges are clamped
+//
+static void downsample(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight,
+    uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight)
+{
+    for (uint32_t y = 0; y < dstHeight; y++) {
+        const uint32_t y0 = std::min(y * 2, srcHeight - 1);
+        const uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            const uint32_t x0 = std::min(x * 2, srcWidth - 1);
+            const uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+            for (uint32_t c = 0; c < 4; c++) {
+                const uint32_t sum = src[(y0 * srcWidth + x0) * 4 + c] + src[(y0 * srcWidth + x1) * 4 + c]
+                    + src[(y1 * srcWidth + x0) * 4 + c] + src[(y1 * srcWidth + x1) * 4 + c];
+                dst[(y * dstWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// TextureStreamer                                                       //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Initialization of staging resources, sampler and worker threads
+//
+void TextureStreamer::init(DeviceAllocator& allocator, vk::Device device, vk::PhysicalDevice physicalDevice,
+    vk::Queue queue, uint32_t queueIdx, uint32_t framesInFlight, vk::DeviceSize budget)
+{
+    assert(!m_device && "TextureStreamer already initialized");
+    m_allocator = &allocator;
+    m_device = device;
+    m_physicalDevice = physicalDevice;
+    m_queue = queue;
+    m_queueIdx = queueIdx;
+    m_framesInFlight = framesInFlight;
+    m_budget = budget;
+    m_quit = false;
+
+    // Staging buffer, persistently mapped
+    createBuffer(m_device, m_physicalDevice, m_stagingSize, vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+        m_stagingBuffer, m_stagingMemory);
+    VkObjects.onCreate(m_stagingBuffer, m_stagingSize, "TextureStreamer staging");
+    VkObjects.onCreate(m_stagingMemory, m_stagingSize, "TextureStreamer staging");
+    m_stagingData = static_cast<uint8_t*>(m_device.mapMemory(m_stagingMemory, 0, m_stagingSize));
+
+    // Command Buffer
+    vk::CommandPoolCreateInfo poolInfo = {};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer
+        | vk::CommandPoolCreateFlagBits::eTransient;
+    poolInfo.queueFamilyIndex = m_queueIdx;
+
+    try {
+        m_commandPool = m_device.createCommandPool(poolInfo);
+        m_commandBuffer = m_device.allocateCommandBuffers(
+            { m_commandPool, vk::CommandBufferLevel::ePrimary, 1 })[0];
+        m_fence = m_device.createFence({});
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create texture streaming command objects!");
+    }
+    VkObjects.onCreate(m_commandPool, 0, "TextureStreamer");
+    VkObjects.onCreate(m_fence, 0, "TextureStreamer");
+
+    // Sampler, resident levels are always the whole image view
+    vk::SamplerCreateInfo samplerInfo = {};
+    samplerInfo.magFilter = vk::Filter::eLinear;
+    samplerInfo.minFilter = vk::Filter::eLinear;
+    samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+    samplerInfo.addressModeU = vk::SamplerAddressMode::eRepeat;
+    samplerInfo.addressModeV = vk::SamplerAddressMode::eRepeat;
+    samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
+    samplerInfo.anisotropyEnable = VK_TRUE;
+    samplerInfo.maxAnisotropy = 16.f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    try {
+        m_sampler = m_device.createSampler(samplerInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create texture sampler!");
+    }
+    VkObjects.onCreate(m_sampler, 0, "TextureStreamer");
+
+    createPlaceholder();
+
+    // Worker threads decode and downsample
+    const uint32_t workerCount = std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+    for (uint32_t i = 0; i < workerCount; i++)
+        m_workers.emplace_back(&TextureStreamer::workerLoop, this);
+}
+
+//-------------------------------------------------------------------------
+// Stop workers and release every texture
+//
+void TextureStreamer::destroy()
+{
+    if (!m_device)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_quit = true;
+        m_jobs.clear();
+    }
+    m_jobCondition.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+    m_results.clear();
+
+    if (m_batchInFlight)
+        while (m_device.waitForFences(m_fence, VK_TRUE, 10000) == vk::Result::eTimeout) {}
+    m_device.waitIdle();
+
+    for (auto& swap : m_batchSwaps)
+        m_retired.push_back({ swap.allocation, swap.view, 0 });
+    m_batchSwaps.clear();
+    releaseRetired(true);
+
+    for (auto& texture : m_textures) {
+        VkObjects.onDestroy(texture.view);
+        m_device.destroyImageView(texture.view);
+        if (texture.image)
+            m_allocator->destroyResource(texture.allocation);
+    }
+    m_textures.clear();
+
+    VkObjects.onDestroy(m_placeholderView);
+    m_device.destroyImageView(m_placeholderView);
+    VkObjects.onDestroy(m_placeholderImage);
+    m_device.destroyImage(m_placeholderImage);
+    VkObjects.onDestroy(m_placeholderMemory);
+    m_device.freeMemory(m_placeholderMemory);
+
+    VkObjects.onDestroy(m_sampler);
+    m_device.destroySampler(m_sampler);
+    VkObjects.onDestroy(m_fence);
+    m_device.destroyFence(m_fence);
+    m_device.freeCommandBuffers(m_commandPool, m_commandBuffer);
+    VkObjects.onDestroy(m_commandPool);
+    m_device.destroyCommandPool(m_commandPool);
+
+    m_device.unmapMemory(m_stagingMemory);
+    VkObjects.onDestroy(m_stagingBuffer);
+    m_device.destroyBuffer(m_stagingBuffer);
+    VkObjects.onDestroy(m_stagingMemory);
+    m_device.freeMemory(m_stagingMemory);
+
+    m_stagingData = nullptr;
+    m_stagingOffset = 0;
+    m_residentBytes = 0;
+    m_pressureLimit = ~0ull;
+    m_recording = false;
+    m_batchInFlight = false;
+    m_allocator = nullptr;
+    m_device = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Register a texture, only the header is read here. The mip tail is
+// decoded on a worker and uploaded by a later update()
+//
+TextureStreamer::TextureID TextureStreamer::addTexture(const std::string& path, bool srgb)
+{
+    int width, height, channels;
+    if (!stbi_info(path.c_str(), &width, &height, &channels)) {
+        throw std::runtime_error("failed to load texture image: " + path);
+    }
+
+    Texture texture = {};
+    texture.path = path;
+    texture.format = srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+    texture.width = static_cast<uint32_t>(width);
+    texture.height = static_cast<uint32_t>(height);
+    texture.mipCount = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+    texture.tailMip = texture.mipCount - 1;
+    for (uint32_t i = 0; i < texture.mipCount; i++) {
+        if (std::max(texture.width >> i, texture.height >> i) <= m_tailSize) {
+            texture.tailMip = i;
+            break;
+        }
+    }
+
+    texture.pending = true;
+
+    const TextureID id = static_cast<TextureID>(m_textures.size());
+    m_textures.push_back(texture);
+
+    pushJob({ id, path, texture.tailMip, texture.mipCount });
+
+    return id;
+}
+
+//-------------------------------------------------------------------------
+// World space bounds, used to get projected size from the camera
+//
+void TextureStreamer::setBounds(TextureID id, const glm::vec3& center, float radius)
+{
+    Texture& texture = m_textures[id];
+    texture.center = center;
+    texture.radius = radius;
+    texture.hasBounds = true;
+}
+
+//-------------------------------------------------------------------------
+// Per frame streaming
+// - retire the previous batch once its fence is signaled
+// - evaluate desired mip of every texture from its screen size
+// - upload decoded mips and evict under budget in one batch
+//
+void TextureStreamer::update(const tools::Camera& camera)
+{
+    m_frame++;
+
+    if (m_batchInFlight) {
+        if (m_device.getFenceStatus(m_fence) != vk::Result::eSuccess) {
+            releaseRetired(false);
+            return;
+        }
+        finishBatch();
+    }
+
+    // Desired residency
+    for (auto& texture : m_textures) {
+        if (!texture.hasBounds) {
+            // unbounded textures are treated as covering the screen
+            texture.screenSize = static_cast<float>(std::max(texture.width, texture.height));
+            texture.desiredMip = 0;
+            continue;
+        }
+
+        texture.screenSize = camera.getProjectedSize(texture.center, texture.radius);
+        const float ratio = static_cast<float>(std::max(texture.width, texture.height))
+            / std::max(texture.screenSize, 1.f);
+        const uint32_t mip = static_cast<uint32_t>(std::max(0.f, std::floor(std::log2(ratio))));
+        texture.desiredMip = std::min(mip, texture.tailMip);
+    }
+
+    collectResults();
+    enforceBudget();
+    scheduleStreaming();
+
+    // pressure limit grows back by 1/64 of the budget per frame
+    if (m_pressureLimit != ~0ull) {
+        m_pressureLimit += m_budget / 64;
+        if (m_pressureLimit >= m_budget)
+            m_pressureLimit = ~0ull;
+    }
+
+    if (m_recording) {
+        m_commandBuffer.end();
+
+        vk::SubmitInfo submitInfo = {};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_commandBuffer;
+
+        try {
+            m_queue.submit(submitInfo, m_fence);
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to submit texture upload command buffer!");
+        }
+
+        m_recording = false;
+        m_batchInFlight = true;
+    }
+
+    releaseRetired(false);
+}
+
+//-------------------------------------------------------------------------
+// Lower the budget under what is resident, only mips above the tail can go
+//
+vk::DeviceSize TextureStreamer::trim(vk::DeviceSize bytes)
+{
+    vk::DeviceSize evictable = 0;
+    for (const auto& texture : m_textures) {
+        if (!texture.pending && !texture.failed && texture.image && texture.residentMip < texture.tailMip)
+            evictable += mipBytes(texture.width, texture.height, texture.residentMip, texture.tailMip);
+    }
+
+    const vk::DeviceSize released = std::min(bytes, evictable);
+    if (released)
+        m_pressureLimit = std::min(m_pressureLimit, m_residentBytes - released);
+
+    return released;
+}
+
+//-------------------------------------------------------------------------
+// Get Methods
+//
+vk::ImageView TextureStreamer::getImageView(TextureID id) const
+{
+    const vk::ImageView view = m_textures[id].view;
+    return view ? view : m_placeholderView;
+}
+
+uint32_t TextureStreamer::getResidentMip(TextureID id) const
+{
+    return m_textures[id].residentMip;
+}
+
+//-------------------------------------------------------------------------
+// Worker, decodes the file and keeps the requested levels
+//
+void TextureStreamer::workerLoop()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+            m_jobCondition.wait(lock, [this] { return m_quit || !m_jobs.empty(); });
+            if (m_quit)
+                return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load(job.path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        // the texture is no longer pending, it stays as it is
+        if (!pixels) {
+            std::cerr << "failed to decode texture image: " << job.path << std::endl;
+
+            JobResult result = {};
+            result.id = job.id;
+            result.firstMip = job.firstMip;
+            result.failed = true;
+
+            std::lock_guard<std::mutex> lock(m_resultMutex);
+            m_results.push_back(std::move(result));
+            continue;
+        }
+
+        JobResult result = {};
+        result.id = job.id;
+        result.width = static_cast<uint32_t>(width);
+        result.height = static_cast<uint32_t>(height);
+        result.firstMip = job.firstMip;
+
+        MipLevel level = {};
+        level.width = result.width;
+        level.height = result.height;
+        level.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+
+        for (uint32_t mip = 0; mip < job.lastMip; mip++) {
+            if (mip > 0) {
+                MipLevel next = {};
+                next.width = std::max(level.width >> 1, 1u);
+                next.height = std::max(level.height >> 1, 1u);
+                next.pixels.resize(static_cast<size_t>(next.width) * next.height * 4);
+                downsample(level.pixels.data(), level.width, level.height,
+                    next.pixels.data(), next.width, next.height);
+                level = std::move(next);
+            }
+            if (mip >= job.firstMip)
+                result.mips.push_back(level);
+        }
+
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        m_results.push_back(std::move(result));
+    }
+}
+
+//-------------------------------------------------------------------------
+// Queue a decode job
+//
+void TextureStreamer::pushJob(const Job& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_jobs.push_back(job);
+    }
+    m_jobCondition.notify_one();
+}
+
+//-------------------------------------------------------------------------
+// Record uploads of decoded levels, as many as fit in staging
+//
+void TextureStreamer::collectResults()
+{
+    std::vector<JobResult> results;
+    {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        results.swap(m_results);
+    }
+
+    std::vector<JobResult> deferred;
+    for (auto& result : results) {
+        Texture& texture = m_textures[result.id];
+
+        if (result.failed) {
+            texture.pending = false;
+            texture.failed = true;
+            continue;
+        }
+
+        // Drop top levels that could never fit the staging buffer
+        uint32_t firstMip = result.firstMip;
+        const uint32_t lastMip = result.firstMip + static_cast<uint32_t>(result.mips.size());
+        while (firstMip + 1 < lastMip && mipBytes(texture.width, texture.height, firstMip, lastMip) > m_stagingSize)
+            firstMip++;
+
+        // failed image creation drops the levels, anything else waits for room
+        if (!recordResidencyChange(texture, firstMip, &result.mips, result.firstMip) && texture.pending)
+            deferred.push_back(std::move(result));
+    }
+
+    if (!deferred.empty()) {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        for (auto& result : deferred)
+            m_results.push_back(std::move(result));
+    }
+}
+
+//-------------------------------------------------------------------------
+// Batch has completed, swap in the new images
+//
+void TextureStreamer::finishBatch()
+{
+    for (auto& swap : m_batchSwaps) {
+        Texture& texture = m_textures[swap.id];
+        if (texture.image)
+            m_retired.push_back({ texture.allocation, texture.view, m_frame });
+
+        m_residentBytes = m_residentBytes - texture.bytes + swap.bytes;
+
+        texture.image = swap.image;
+        texture.allocation = swap.allocation;
+        texture.view = swap.view;
+        texture.bytes = swap.bytes;
+        texture.residentMip = swap.residentMip;
+        texture.pending = false;
+
+        // contents are final, the allocator may relocate it from now on
+        const TextureID id = swap.id;
+        m_allocator->setMoveCallback(texture.allocation, [this, id](AllocationID) { onImageMoved(id); });
+    }
+
+    if (!m_batchSwaps.empty())
+        m_changeID++;
+
+    m_batchSwaps.clear();
+    m_stagingOffset = 0;
+    m_batchInFlight = false;
+    m_device.resetFences(m_fence);
+}
+
+//-------------------------------------------------------------------------
+// Request decode of higher levels for textures below their desired
+// residency, largest on screen first, while the budget allows it
+//
+void TextureStreamer::scheduleStreaming()
+{
+    std::vector<TextureID> candidates;
+    for (TextureID i = 0; i < static_cast<TextureID>(m_textures.size()); i++) {
+        const Texture& texture = m_textures[i];
+        if (!texture.pending && !texture.failed && texture.image && texture.desiredMip < texture.residentMip)
+            candidates.push_back(i);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this](TextureID a, TextureID b) {
+        return m_textures[a].screenSize > m_textures[b].screenSize;
+    });
+
+    vk::DeviceSize projected = m_residentBytes;
+    for (auto& swap : m_batchSwaps)
+        projected = projected - m_textures[swap.id].bytes + swap.bytes;
+
+    const vk::DeviceSize budget = getEffectiveBudget();
+    for (TextureID id : candidates) {
+        Texture& texture = m_textures[id];
+
+        // Step towards the desired level while staying in budget
+        uint32_t firstMip = texture.residentMip;
+        while (firstMip > texture.desiredMip
+            && projected + mipBytes(texture.width, texture.height, firstMip - 1, texture.residentMip) <= budget)
+            firstMip--;
+
+        if (firstMip == texture.residentMip)
+            continue;
+
+        projected += mipBytes(texture.width, texture.height, firstMip, texture.residentMip);
+        texture.pending = true;
+        pushJob({ id, texture.path, firstMip, texture.residentMip });
+    }
+}
+
+//-------------------------------------------------------------------------
+// Drop top levels, textures more resident than desired first, then the
+// smallest on screen, until the resident size is within budget
+//
+void TextureStreamer::enforceBudget()
+{
+    vk::DeviceSize projected = m_residentBytes;
+    for (auto& swap : m_batchSwaps)
+        projected = projected - m_textures[swap.id].bytes + swap.bytes;
+
+    const vk::DeviceSize budget = getEffectiveBudget();
+    if (projected <= budget)
+        return;
+
+    std::vector<TextureID> candidates;
+    for (TextureID i = 0; i < static_cast<TextureID>(m_textures.size()); i++) {
+        const Texture& texture = m_textures[i];
+        if (!texture.pending && !texture.failed && texture.image && texture.residentMip < texture.tailMip)
+            candidates.push_back(i);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this](TextureID a, TextureID b) {
+        const Texture& ta = m_textures[a];
+        const Texture& tb = m_textures[b];
+        const bool overA = ta.residentMip < ta.desiredMip;
+        const bool overB = tb.residentMip < tb.desiredMip;
+        if (overA != overB)
+            return overA;
+        return ta.screenSize < tb.screenSize;
+    });
+
+    for (TextureID id : candidates) {
+        if (projected <= budget)
+            break;
+
+        Texture& texture = m_textures[id];
+
+        uint32_t newMip = texture.residentMip;
+        vk::DeviceSize freed = 0;
+        while (newMip < texture.tailMip && projected - freed > budget) {
+            freed += mipBytes(texture.width, texture.height, newMip, newMip + 1);
+            newMip++;
+        }
+
+        if (recordResidencyChange(texture, newMip, nullptr, 0))
+            projected -= freed;
+    }
+}
+
+//-------------------------------------------------------------------------
+// Destroy images no longer referenced by frames in flight
+//
+void TextureStreamer::releaseRetired(bool all)
+{
+    auto it = m_retired.begin();
+    while (it != m_retired.end()) {
+        if (all || it->frame + m_framesInFlight < m_frame) {
+            VkObjects.onDestroy(it->view);
+            m_device.destroyImageView(it->view);
+            if (it->allocation != ~0u)
+                m_allocator->destroyResource(it->allocation);
+            it = m_retired.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+// Record creation of an image holding levels [newMip, mipCount)
+// - levels already resident are copied from the current image
+// - missing levels are uploaded from mips, starting at level mipsFirst
+// Returns false if the change does not fit this batch, or if the image
+// can not be created. The change is then dropped, a texture without an
+// image is marked failed and one with an image keeps its levels and may
+// be streamed or evicted again
+//
+bool TextureStreamer::recordResidencyChange(Texture& texture, uint32_t newMip,
+    const std::vector<MipLevel>* mips, uint32_t mipsFirst)
+{
+    if (m_batchInFlight)
+        return false;
+
+    // current image is copied from below, wait for a relocation to finish
+    if (texture.image && m_allocator->isMoving(texture.allocation))
+        return false;
+
+    const uint32_t oldMip = texture.image ? texture.residentMip : texture.mipCount;
+    const uint32_t uploadEnd = std::min(oldMip, texture.mipCount);
+
+    // Levels to upload must all come from mips
+    vk::DeviceSize uploadBytes = 0;
+    if (newMip < uploadEnd) {
+        if (!mips || newMip < mipsFirst || uploadEnd > mipsFirst + mips->size())
+            return false;
+        for (uint32_t mip = newMip; mip < uploadEnd; mip++)
+            uploadBytes += ((*mips)[mip - mipsFirst].pixels.size() + 15) & ~vk::DeviceSize(15);
+    }
+
+    if (m_stagingOffset + uploadBytes > m_stagingSize)
+        return false;
+
+    // New image
+    const uint32_t levelCount = texture.mipCount - newMip;
+    const uint32_t width = std::max(texture.width >> newMip, 1u);
+    const uint32_t height = std::max(texture.height >> newMip, 1u);
+
+    vk::ImageCreateInfo imageInfo = {};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.extent = vk::Extent3D(width, height, 1);
+    imageInfo.format = texture.format;
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.usage = vk::ImageUsageFlagBits::eSampled
+        | vk::ImageUsageFlagBits::eTransferDst
+        | vk::ImageUsageFlagBits::eTransferSrc;
+
+    Swap swap = {};
+    swap.id = static_cast<TextureID>(&texture - m_textures.data());
+    swap.residentMip = newMip;
+
+    try {
+        swap.allocation = m_allocator->createImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal,
+            vk::ImageLayout::eShaderReadOnlyOptimal, swap.image);
+        swap.bytes = m_allocator->getSize(swap.allocation);
+    }
+    catch (const std::runtime_error&) {
+        std::cerr << "failed to allocate streamed texture image: " << texture.path << std::endl;
+        texture.pending = false;
+        texture.failed = !texture.image;
+        return false;
+    }
+
+    try {
+        vk::ImageViewCreateInfo viewInfo = {};
+        viewInfo.image = swap.image;
+        viewInfo.viewType = vk::ImageViewType::e2D;
+        viewInfo.format = texture.format;
+        viewInfo.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, 1 };
+        swap.view = m_device.createImageView(viewInfo);
+    }
+    catch (vk::SystemError err) {
+        m_allocator->destroyResource(swap.allocation);
+        std::cerr << "failed to create streamed texture image: " << texture.path << std::endl;
+        texture.pending = false;
+        texture.failed = !texture.image;
+        return false;
+    }
+    VkObjects.onCreate(swap.view, 0, texture.path.c_str());
+
+    if (!m_recording) {
+        m_commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+        m_recording = true;
+    }
+
+    vk::ImageMemoryBarrier barrier = {};
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+    // new image to transfer dst
+    barrier.image = swap.image;
+    barrier.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, 1 };
+    barrier.oldLayout = vk::ImageLayout::eUndefined;
+    barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.srcAccessMask = {};
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    m_commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+        vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, barrier);
+
+    // Copy overlapping levels from the current image
+    const uint32_t copyFirst = std::max(newMip, oldMip);
+    if (texture.image && copyFirst < texture.mipCount) {
+        vk::ImageMemoryBarrier oldBarrier = {};
+        oldBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        oldBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        oldBarrier.image = texture.image;
+        oldBarrier.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, texture.mipCount - oldMip, 0, 1 };
+        oldBarrier.oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        oldBarrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+        oldBarrier.srcAccessMask = vk::AccessFlagBits::eShaderRead;
+        oldBarrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+        m_commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+            vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, oldBarrier);
+
+        std::vector<vk::ImageCopy> regions;
+        for (uint32_t mip = copyFirst; mip < texture.mipCount; mip++) {
+            vk::ImageCopy region = {};
+            region.srcSubresource = { vk::ImageAspectFlagBits::eColor, mip - oldMip, 0, 1 };
+            region.dstSubresource = { vk::ImageAspectFlagBits::eColor, mip - newMip, 0, 1 };
+            region.extent = vk::Extent3D(std::max(texture.width >> mip, 1u), std::max(texture.height >> mip, 1u), 1);
+            regions.push_back(region);
+        }
+        m_commandBuffer.copyImage(texture.image, vk::ImageLayout::eTransferSrcOptimal,
+            swap.image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+        oldBarrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+        oldBarrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        oldBarrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+        oldBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        m_commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eAllCommands, {}, nullptr, nullptr, oldBarrier);
+    }
+
+    // Upload missing levels through staging
+    std::vector<vk::BufferImageCopy> uploads;
+    for (uint32_t mip = newMip; mip < uploadEnd; mip++) {
+        const MipLevel& level = (*mips)[mip - mipsFirst];
+        memcpy(m_stagingData + m_stagingOffset, level.pixels.data(), level.pixels.size());
+
+        vk::BufferImageCopy region = {};
+        region.bufferOffset = m_stagingOffset;
+        region.imageSubresource = { vk::ImageAspectFlagBits::eColor, mip - newMip, 0, 1 };
+        region.imageExtent = vk::Extent3D(level.width, level.height, 1);
+        uploads.push_back(region);
+
+        m_stagingOffset += (level.pixels.size() + 15) & ~vk::DeviceSize(15);
+    }
+    if (!uploads.empty()) {
+        m_commandBuffer.copyBufferToImage(m_stagingBuffer, swap.image,
+            vk::ImageLayout::eTransferDstOptimal, uploads);
+    }
+
+    // new image ready for sampling
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    m_commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eAllCommands, {}, nullptr, nullptr, barrier);
+
+    // the batch reads the current image, it stays where it is until then
+    if (texture.image)
+        m_allocator->setMoveCallback(texture.allocation, nullptr);
+
+    texture.pending = true;
+    m_batchSwaps.push_back(swap);
+
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// New image holds the same levels, only the view has to follow. The old
+// view stays alive for the frames still using it
+//
+void TextureStreamer::onImageMoved(TextureID id)
+{
+    Texture& texture = m_textures[id];
+    texture.image = m_allocator->getImage(texture.allocation);
+
+    vk::ImageViewCreateInfo viewInfo = {};
+    viewInfo.image = texture.image;
+    viewInfo.viewType = vk::ImageViewType::e2D;
+    viewInfo.format = texture.format;
+    viewInfo.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, texture.mipCount - texture.residentMip, 0, 1 };
+
+    m_retired.push_back({ ~0u, texture.view, m_frame });
+
+    try {
+        texture.view = m_device.createImageView(viewInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create streamed texture image view!");
+    }
+    VkObjects.onCreate(texture.view, 0, texture.path.c_str());
+
+    m_changeID++;
+}
+
+//-------------------------------------------------------------------------
+// Size of RGBA8 levels [first, last)
+//
+vk::DeviceSize TextureStreamer::mipBytes(uint32_t width, uint32_t height, uint32_t first, uint32_t last)
+{
+    vk::DeviceSize bytes = 0;
+    for (uint32_t mip = first; mip < last; mip++)
+        bytes += vk::DeviceSize(std::max(width >> mip, 1u)) * std::max(height >> mip, 1u) * 4;
+    return bytes;
+}
+
+//-------------------------------------------------------------------------
+// 1x1 white image returned until a texture tail is resident
+//
+void TextureStreamer::createPlaceholder()
+{
+    vk::ImageCreateInfo imageInfo = {};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.extent = vk::Extent3D(1, 1, 1);
+    imageInfo.format = vk::Format::eR8G8B8A8Unorm;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+
+    try {
+        m_placeholderImage = m_device.createImage(imageInfo);
+
+        const vk::MemoryRequirements memReqs = m_device.getImageMemoryRequirements(m_placeholderImage);
+        vk::MemoryAllocateInfo memAllocInfo = {};
+        memAllocInfo.allocationSize = memReqs.size;
+        memAllocInfo.memoryTypeIndex = findMemoryType(m_physicalDevice, memReqs.memoryTypeBits,
+            vk::MemoryPropertyFlagBits::eDeviceLocal);
+        m_placeholderMemory = m_device.allocateMemory(memAllocInfo);
+        m_device.bindImageMemory(m_placeholderImage, m_placeholderMemory, 0);
+        VkObjects.onCreate(m_placeholderImage, memReqs.size, "placeholder");
+        VkObjects.onCreate(m_placeholderMemory, memAllocInfo.allocationSize, "placeholder");
+
+        vk::ImageViewCreateInfo viewInfo = {};
+        viewInfo.image = m_placeholderImage;
+        viewInfo.viewType = vk::ImageViewType::e2D;
+        viewInfo.format = vk::Format::eR8G8B8A8Unorm;
+        viewInfo.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+        m_placeholderView = m_device.createImageView(viewInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create placeholder texture!");
+    }
+    VkObjects.onCreate(m_placeholderView, 0, "placeholder");
+
+    const uint32_t white = 0xffffffff;
+    memcpy(m_stagingData, &white, sizeof(white));
+
+    m_commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+    vk::ImageMemoryBarrier barrier = {};
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_placeholderImage;
+    barrier.subresourceRange = { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+    barrier.oldLayout = vk::ImageLayout::eUndefined;
+    barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    m_commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+        vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, barrier);
+
+    vk::BufferImageCopy region = {};
+    region.imageSubresource = { vk::ImageAspectFlagBits::eColor, 0, 0, 1 };
+    region.imageExtent = vk::Extent3D(1, 1, 1);
+    m_commandBuffer.copyBufferToImage(m_stagingBuffer, m_placeholderImage,
+        vk::ImageLayout::eTransferDstOptimal, region);
+
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    m_commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eAllCommands, {}, nullptr, nullptr, barrier);
+
+    m_commandBuffer.end();
+
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_commandBuffer;
+    m_queue.submit(submitInfo, m_fence);
+
+    // Let finishBatch() recycle the fence and staging on the first update
+    m_batchInFlight = true;
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
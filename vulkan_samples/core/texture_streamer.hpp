@@ -0,0 +1,224 @@
+/*
+ *
+ * Andrew Frost
+ * texture_streamer.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "../helper/camera.hpp"
+#include "device_allocator.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// TextureStreamer                                                       //
+///////////////////////////////////////////////////////////////////////////
+// Keeps the low mip tail of every texture resident and streams the     //
+// higher mips in and out based on their projected size on screen      //
+// - files are decoded and downsampled on worker threads               //
+// - uploads go through a staging buffer, bounded per batch            //
+// - resident mips are evicted when over the memory budget             //
+// - images live in the device allocator and may be moved by it once   //
+//   no streaming change is pending on them                            //
+// - a texture that fails to decode or to get its first image keeps    //
+//   the placeholder and is not streamed again. A later image that     //
+//   can not be created only drops that change                         //
+///////////////////////////////////////////////////////////////////////////
+
+class TextureStreamer
+{
+public:
+    using TextureID = uint32_t;
+
+    TextureStreamer(TextureStreamer const&) = delete;
+    TextureStreamer& operator=(TextureStreamer const&) = delete;
+
+    TextureStreamer() = default;
+    ~TextureStreamer() { destroy(); }
+
+    void init(DeviceAllocator& allocator, vk::Device device, vk::PhysicalDevice physicalDevice, vk::Queue queue,
+        uint32_t queueIdx, uint32_t framesInFlight, vk::DeviceSize budget = 256ull << 20);
+
+    void destroy();
+
+    // Register a texture, returns immediately, tail is uploaded once decoded
+    TextureID addTexture(const std::string& path, bool srgb = true);
+
+    // World space bounds of where the texture is used
+    void setBounds(TextureID id, const glm::vec3& center, float radius);
+
+    // Call once per frame, schedules decodes, uploads and evictions
+    void update(const tools::Camera& camera);
+
+    // Swapchain rebuilt with another image count, retired images wait for it
+    void setFramesInFlight(uint32_t framesInFlight) { m_framesInFlight = framesInFlight; }
+
+    // Memory budget of resident mips, in bytes
+    void          setBudget(vk::DeviceSize budget) { m_budget = budget; }
+    vk::DeviceSize getBudget()        const { return m_budget; }
+    vk::DeviceSize getResidentBytes() const { return m_residentBytes; }
+
+    // Memory pressure, evict about bytes of streamed mips on the next update.
+    // Returns what will be released, the limit relaxes over the next frames
+    vk::DeviceSize trim(vk::DeviceSize bytes);
+
+    // Getting Methods
+    vk::ImageView getImageView(TextureID id) const;
+    vk::Sampler   getSampler()              const { return m_sampler; }
+    uint32_t      getResidentMip(TextureID id) const;
+    uint32_t      getTextureCount()         const { return static_cast<uint32_t>(m_textures.size()); }
+    // Incremented whenever an image view changes, descriptors must be rewritten
+    uint32_t      getChangeID()             const { return m_changeID; }
+
+private:
+    using AllocationID = DeviceAllocator::AllocationID;
+
+    struct MipLevel
+    {
+        uint32_t             width{ 0 };
+        uint32_t             height{ 0 };
+        std::vector<uint8_t> pixels; // RGBA8
+    };
+
+    struct Texture
+    {
+        std::string      path;
+        vk::Format       format{ vk::Format::eR8G8B8A8Unorm };
+        uint32_t         width{ 0 };
+        uint32_t         height{ 0 };
+        uint32_t         mipCount{ 0 };
+        uint32_t         tailMip{ 0 };        // first level of the always resident tail
+
+        vk::Image        image;
+        AllocationID     allocation{ ~0u };
+        vk::ImageView    view;
+        vk::DeviceSize   bytes{ 0 };
+        uint32_t         residentMip{ ~0u };  // first level resident on the device
+
+        uint32_t         desiredMip{ ~0u };
+        float            screenSize{ 0.f };
+        glm::vec3        center{ 0.f };
+        float            radius{ 0.f };
+        bool             hasBounds{ false };
+        bool             pending{ false };    // decode or upload in flight
+        bool             failed{ false };     // decode or first image creation failed, keeps the placeholder
+    };
+
+    struct Job
+    {
+        TextureID   id;
+        std::string path;
+        uint32_t    firstMip;
+        uint32_t    lastMip;                  // exclusive
+    };
+
+    struct JobResult
+    {
+        TextureID             id;
+        uint32_t              width;
+        uint32_t              height;
+        uint32_t              firstMip;
+        std::vector<MipLevel> mips;
+        bool                  failed;         // no mips, the file could not be decoded
+    };
+
+    struct Retired
+    {
+        AllocationID     allocation;          // ~0u for a view only
+        vk::ImageView    view;
+        uint64_t         frame;
+    };
+
+    struct Swap
+    {
+        TextureID        id;
+        vk::Image        image;
+        AllocationID     allocation;
+        vk::ImageView    view;
+        vk::DeviceSize   bytes;
+        uint32_t         residentMip;
+    };
+
+    void workerLoop();
+    void pushJob(const Job& job);
+
+    void collectResults();
+    void finishBatch();
+    void scheduleStreaming();
+    void enforceBudget();
+    vk::DeviceSize getEffectiveBudget() const { return std::min(m_budget, m_pressureLimit); }
+    void releaseRetired(bool all);
+
+    bool recordResidencyChange(Texture& texture, uint32_t newMip, const std::vector<MipLevel>* mips,
+        uint32_t mipsFirst);
+
+    static vk::DeviceSize mipBytes(uint32_t width, uint32_t height, uint32_t first, uint32_t last);
+
+    // Allocator relocated the image, the view is recreated
+    void onImageMoved(TextureID id);
+
+    void createPlaceholder();
+
+    DeviceAllocator*           m_allocator{ nullptr };
+    vk::Device                 m_device;
+    vk::PhysicalDevice         m_physicalDevice;
+    vk::Queue                  m_queue;
+    uint32_t                   m_queueIdx{ VK_QUEUE_FAMILY_IGNORED };
+    uint32_t                   m_framesInFlight{ 2 };
+
+    std::vector<Texture>       m_textures;
+
+    // Staging
+    vk::Buffer                 m_stagingBuffer;
+    vk::DeviceMemory           m_stagingMemory;
+    uint8_t*                   m_stagingData{ nullptr };
+    vk::DeviceSize             m_stagingSize{ 32ull << 20 };
+    vk::DeviceSize             m_stagingOffset{ 0 };
+
+    vk::CommandPool            m_commandPool;
+    vk::CommandBuffer          m_commandBuffer;
+    vk::Fence                  m_fence;
+    bool                       m_recording{ false };
+    bool                       m_batchInFlight{ false };
+    std::vector<Swap>          m_batchSwaps;
+
+    std::vector<Retired>       m_retired;
+
+    vk::Sampler                m_sampler;
+    vk::Image                  m_placeholderImage;
+    vk::DeviceMemory           m_placeholderMemory;
+    vk::ImageView              m_placeholderView;
+
+    // Worker threads
+    std::vector<std::thread>   m_workers;
+    std::deque<Job>            m_jobs;
+    std::vector<JobResult>     m_results;
+    std::mutex                 m_jobMutex;
+    std::mutex                 m_resultMutex;
+    std::condition_variable    m_jobCondition;
+    bool                       m_quit{ false };
+
+    vk::DeviceSize             m_budget{ 256ull << 20 };
+    vk::DeviceSize             m_pressureLimit{ ~0ull };  // lowered by trim
+    vk::DeviceSize             m_residentBytes{ 0 };
+    uint64_t                   m_frame{ 0 };
+    uint32_t                   m_changeID{ 0 };
+    uint32_t                   m_tailSize{ 64 };      // max dimension of mips in the tail
+
+}; // class TextureStreamer
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,358 @@
+/*
+ *
+ * Andrew Frost
+ * validation_sink.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "validation_sink.hpp"
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// ValidationSink                                                        //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Ring and ID table, then the messenger and its logger thread
+//
+void ValidationSink::init(vk::Instance instance, vk::DebugUtilsMessageSeverityFlagsEXT severity,
+    vk::DebugUtilsMessageTypeFlagsEXT types)
+{
+    assert(!m_messenger && "ValidationSink already initialized");
+    m_instance = instance;
+
+    m_ring.reset(new Slot[RING_SIZE]);
+    for (uint32_t i = 0; i < RING_SIZE; i++)
+        m_ring[i].sequence.store(i, std::memory_order_relaxed);
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail = 0;
+
+    m_table.reset(new IdEntry[TABLE_SIZE]);
+
+    m_received = 0;
+    m_logged = 0;
+    m_suppressed = 0;
+    m_dropped = 0;
+    m_performance = 0;
+
+    // not exported by the loader
+    auto createMessenger = reinterpret_cast<PFN_vkCreateDebugUtilsMessengerEXT>(
+        vkGetInstanceProcAddr(m_instance, "vkCreateDebugUtilsMessengerEXT"));
+    m_destroyMessenger = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(
+        vkGetInstanceProcAddr(m_instance, "vkDestroyDebugUtilsMessengerEXT"));
+    if (!createMessenger || !m_destroyMessenger)
+        throw std::runtime_error("failed to set up debug messenger!");
+
+    vk::DebugUtilsMessengerCreateInfoEXT debugInfo = {};
+    debugInfo.messageSeverity = severity;
+    debugInfo.messageType = types;
+    debugInfo.pfnUserCallback = callback;
+    debugInfo.pUserData = this;
+
+    const VkDebugUtilsMessengerCreateInfoEXT& createInfo = debugInfo;
+    if (createMessenger(m_instance, &createInfo, nullptr, &m_messenger) != VK_SUCCESS) {
+        m_messenger = VK_NULL_HANDLE;
+        throw std::runtime_error("failed to set up debug messenger!");
+    }
+
+    // messages before the thread runs wait in the ring
+    m_quit.store(false);
+    m_logger = std::thread(&ValidationSink::loggerLoop, this);
+}
+
+//-------------------------------------------------------------------------
+// No callback can run after the messenger is gone, the logger then
+// drains the ring and reports the remaining repeats
+//
+void ValidationSink::destroy()
+{
+    if (!m_messenger)
+        return;
+
+    m_destroyMessenger(m_instance, m_messenger, nullptr);
+    m_messenger = VK_NULL_HANDLE;
+
+    m_quit.store(true, std::memory_order_release);
+    if (m_logger.joinable())
+        m_logger.join();
+
+    m_instance = nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Rate limit, a repeat within the window past perId is only counted
+//
+void ValidationSink::setRateLimit(uint32_t perId, double windowMs)
+{
+    m_rateLimit.store(perId, std::memory_order_relaxed);
+    m_window.store(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(windowMs)).count(), std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------
+// Driver thread, returns without touching the stream
+//
+VKAPI_ATTR VkBool32 VKAPI_CALL ValidationSink::callback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+    VkDebugUtilsMessageTypeFlagsEXT messageType,
+    const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
+    void* pUserData)
+{
+    static_cast<ValidationSink*>(pUserData)->receive(messageSeverity, messageType, *pCallbackData);
+    return VK_FALSE;
+}
+
+//-------------------------------------------------------------------------
+// Count, rate limit on the message ID, then queue for the logger
+//
+void ValidationSink::receive(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type,
+    const VkDebugUtilsMessengerCallbackDataEXT& data)
+{
+    m_received.fetch_add(1, std::memory_order_relaxed);
+
+    const bool performance = (type & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) != 0;
+    if (performance)
+        m_performance.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t repeats = 0;
+    IdEntry* entry = findEntry(data.messageIdNumber);
+
+    // a full table only loses the rate limit
+    if (entry) {
+        const uint32_t count = entry->count.fetch_add(1, std::memory_order_relaxed);
+
+        // performance IDs log once, the count is the metric
+        if (performance) {
+            entry->performance.store(true, std::memory_order_relaxed);
+            if (count > 0) {
+                m_suppressed.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        else {
+            const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+            int64_t start = entry->windowStart.load(std::memory_order_relaxed);
+            if (now - start >= m_window.load(std::memory_order_relaxed)
+                && entry->windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+                entry->windowCount.store(0, std::memory_order_relaxed);
+
+            if (entry->windowCount.fetch_add(1, std::memory_order_relaxed) >= m_rateLimit.load(std::memory_order_relaxed)) {
+                entry->suppressed.fetch_add(1, std::memory_order_relaxed);
+                m_suppressed.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        repeats = entry->suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+    if (!push(severity, type, data.messageIdNumber, repeats, data.pMessage ? data.pMessage : ""))
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------
+// Entry of the ID, claimed on first sight
+//
+ValidationSink::IdEntry* ValidationSink::findEntry(int32_t id)
+{
+    const int64_t key = static_cast<int64_t>(id) + (int64_t(1) << 32);
+    const uint32_t home = (static_cast<uint32_t>(id) * 2654435761u) & (TABLE_SIZE - 1);
+
+    for (uint32_t probe = 0; probe < TABLE_SIZE; probe++) {
+        IdEntry& entry = m_table[(home + probe) & (TABLE_SIZE - 1)];
+
+        int64_t current = entry.key.load(std::memory_order_acquire);
+        if (current == 0 && entry.key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+            return &entry;
+        if (current == key)
+            return &entry;
+    }
+
+    return nullptr;
+}
+
+//-------------------------------------------------------------------------
+// Bounded multi producer queue, each slot carries the position it is
+// free for, false when the ring is full
+//
+bool ValidationSink::push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type,
+    int32_t id, uint32_t repeats, const char* text)
+{
+    uint64_t pos = m_head.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+
+    while (true) {
+        slot = &m_ring[pos & (RING_SIZE - 1)];
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+
+        if (diff == 0) {
+            if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0) {
+            return false;
+        }
+        else {
+            pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->severity = severity;
+    slot->type = type;
+    slot->id = id;
+    slot->repeats = repeats;
+
+    const size_t length = std::min<size_t>(strlen(text), TEXT_SIZE - 1);
+    memcpy(slot->text, text, length);
+    slot->text[length] = '\0';
+
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// Drain until asked to quit, repeat summaries once a second
+//
+void ValidationSink::loggerLoop()
+{
+    auto lastReport = std::chrono::steady_clock::now();
+
+    while (true) {
+        // read before draining, nothing is pushed once quit is set
+        const bool quit = m_quit.load(std::memory_order_acquire);
+        const bool logged = drain();
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= std::chrono::seconds(1)) {
+            reportSuppressed();
+            lastReport = now;
+        }
+
+        if (quit)
+            break;
+        if (!logged)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    reportSuppressed();
+}
+
+//-------------------------------------------------------------------------
+// Everything queued, one write to the stream
+//
+bool ValidationSink::drain()
+{
+    std::string out;
+
+    while (true) {
+        Slot& slot = m_ring[m_tail & (RING_SIZE - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != m_tail + 1)
+            break;
+
+        const char* label = "info";
+        if (slot.type & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT)
+            label = "performance";
+        else if (slot.severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+            label = "error";
+        else if (slot.severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+            label = "warning";
+
+        out += "validation layer [";
+        out += label;
+        out += "]: ";
+        out += slot.text;
+        if (slot.repeats > 0)
+            out += " (" + std::to_string(slot.repeats) + " repeats suppressed)";
+        out += '\n';
+
+        slot.sequence.store(m_tail + RING_SIZE, std::memory_order_release);
+        m_tail++;
+        m_logged.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (out.empty())
+        return false;
+
+    std::cerr << out;
+    std::cerr.flush();
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// Repeats of IDs that went quiet, performance IDs stay metrics
+//
+void ValidationSink::reportSuppressed()
+{
+    std::string out;
+
+    for (uint32_t i = 0; i < TABLE_SIZE; i++) {
+        IdEntry& entry = m_table[i];
+        if (entry.key.load(std::memory_order_acquire) == 0 || entry.performance.load(std::memory_order_relaxed))
+            continue;
+
+        const uint32_t suppressed = entry.suppressed.exchange(0, std::memory_order_relaxed);
+        if (suppressed == 0)
+            continue;
+
+        char line[96];
+        snprintf(line, sizeof(line), "validation layer: message 0x%08x repeated %u more times\n",
+            static_cast<uint32_t>(entry.key.load(std::memory_order_relaxed) - (int64_t(1) << 32)), suppressed);
+        out += line;
+    }
+
+    if (!out.empty()) {
+        std::cerr << out;
+        std::cerr.flush();
+    }
+}
+
+//-------------------------------------------------------------------------
+// Counters, safe from any thread
+//
+ValidationSink::Stats ValidationSink::getStats() const
+{
+    Stats stats;
+    stats.received = m_received.load(std::memory_order_relaxed);
+    stats.logged = m_logged.load(std::memory_order_relaxed);
+    stats.suppressed = m_suppressed.load(std::memory_order_relaxed);
+    stats.dropped = m_dropped.load(std::memory_order_relaxed);
+    stats.performance = m_performance.load(std::memory_order_relaxed);
+    return stats;
+}
+
+//-------------------------------------------------------------------------
+// Occurrences of each performance message ID, most frequent first
+//
+std::vector<ValidationSink::IdCount> ValidationSink::getPerformanceCounts() const
+{
+    std::vector<IdCount> counts;
+    if (!m_table)
+        return counts;
+
+    for (uint32_t i = 0; i < TABLE_SIZE; i++) {
+        const IdEntry& entry = m_table[i];
+        if (entry.key.load(std::memory_order_acquire) == 0 || !entry.performance.load(std::memory_order_relaxed))
+            continue;
+
+        IdCount count;
+        count.id = static_cast<int32_t>(entry.key.load(std::memory_order_relaxed) - (int64_t(1) << 32));
+        count.count = entry.count.load(std::memory_order_relaxed);
+        counts.push_back(count);
+    }
+
+    std::sort(counts.begin(), counts.end(), [](const IdCount& a, const IdCount& b) { return a.count > b.count; });
+    return counts;
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
@@ -0,0 +1,150 @@
+/*
+ *
+ * Andrew Frost
+ * validation_sink.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// ValidationSink                                                        //
+///////////////////////////////////////////////////////////////////////////
+// Debug messenger whose callback never blocks the driver call, messages //
+// go through a lock-free ring to a background logger thread           //
+// - messages are deduplicated on messageIdNumber, each ID logs at most //
+//   rateLimit messages per window, the rest are only counted and the  //
+//   count is reported with the next message or summary of that ID     //
+// - performance messages are logged once per ID and counted as metrics //
+// - a full ring drops the message and counts it, nothing waits         //
+// - owns the VkDebugUtilsMessengerEXT, loaded through                   //
+//   vkGetInstanceProcAddr so statically dispatched users work as well  //
+///////////////////////////////////////////////////////////////////////////
+
+class ValidationSink
+{
+public:
+    ValidationSink(ValidationSink const&) = delete;
+    ValidationSink& operator=(ValidationSink const&) = delete;
+
+    ValidationSink() = default;
+    ~ValidationSink() { destroy(); }
+
+    // Instance needs VK_EXT_debug_utils
+    void init(vk::Instance instance,
+        vk::DebugUtilsMessageSeverityFlagsEXT severity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eError
+            | vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning,
+        vk::DebugUtilsMessageTypeFlagsEXT types = vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral
+            | vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation
+            | vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance);
+
+    // Destroys the messenger, then logs what is left in the ring
+    void destroy();
+
+    // Messages per ID and window before repeats are only counted. Any time
+    // and thread, the callback picks up the new values with its next message
+    void setRateLimit(uint32_t perId, double windowMs);
+
+    struct Stats
+    {
+        uint64_t received{ 0 };
+        uint64_t logged{ 0 };
+        uint64_t suppressed{ 0 };     // rate limited repeats
+        uint64_t dropped{ 0 };        // ring was full
+        uint64_t performance{ 0 };    // ePerformance messages, logged or not
+    };
+
+    struct IdCount
+    {
+        int32_t  id{ 0 };
+        uint32_t count{ 0 };
+    };
+
+    // Getting Methods
+    Stats                getStats() const;
+    std::vector<IdCount> getPerformanceCounts() const;
+    bool                 isActive() const { return m_messenger != VK_NULL_HANDLE; }
+
+private:
+
+    static const uint32_t RING_SIZE = 256;     // power of two
+    static const uint32_t TABLE_SIZE = 1024;   // power of two
+    static const uint32_t TEXT_SIZE = 1024;
+
+    struct Slot
+    {
+        std::atomic<uint64_t>                  sequence{ 0 };
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity{};
+        VkDebugUtilsMessageTypeFlagsEXT        type{ 0 };
+        int32_t                                id{ 0 };
+        uint32_t                               repeats{ 0 };
+        char                                   text[TEXT_SIZE];
+    };
+
+    // Open addressing, entries are claimed once and never removed
+    struct IdEntry
+    {
+        std::atomic<int64_t>  key{ 0 };            // messageIdNumber + 2^32, 0 is empty
+        std::atomic<uint32_t> count{ 0 };
+        std::atomic<uint32_t> windowCount{ 0 };
+        std::atomic<int64_t>  windowStart{ 0 };    // steady clock ticks
+        std::atomic<uint32_t> suppressed{ 0 };     // since last reported
+        std::atomic<bool>     performance{ false };
+    };
+
+    static VKAPI_ATTR VkBool32 VKAPI_CALL callback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+        VkDebugUtilsMessageTypeFlagsEXT messageType,
+        const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
+        void* pUserData);
+
+    void receive(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type,
+        const VkDebugUtilsMessengerCallbackDataEXT& data);
+
+    IdEntry* findEntry(int32_t id);
+
+    // Producer side, any thread
+    bool push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type,
+        int32_t id, uint32_t repeats, const char* text);
+
+    // Consumer side, logger thread only
+    void loggerLoop();
+    bool drain();
+    void reportSuppressed();
+
+    vk::Instance                             m_instance;
+    VkDebugUtilsMessengerEXT                 m_messenger{ VK_NULL_HANDLE };
+    PFN_vkDestroyDebugUtilsMessengerEXT      m_destroyMessenger{ nullptr };
+
+    std::unique_ptr<Slot[]>                  m_ring;
+    std::atomic<uint64_t>                    m_head{ 0 };
+    uint64_t                                 m_tail{ 0 };
+    std::unique_ptr<IdEntry[]>               m_table;
+
+    // written by setRateLimit(), read by the callback on the driver thread
+    std::atomic<uint32_t>                    m_rateLimit{ 5 };
+    std::atomic<int64_t>                     m_window{ std::chrono::steady_clock::duration(std::chrono::seconds(1)).count() };
+
+    std::thread                              m_logger;
+    std::atomic<bool>                        m_quit{ false };
+
+    std::atomic<uint64_t>                    m_received{ 0 };
+    std::atomic<uint64_t>                    m_logged{ 0 };
+    std::atomic<uint64_t>                    m_suppressed{ 0 };
+    std::atomic<uint64_t>                    m_dropped{ 0 };
+    std::atomic<uint64_t>                    m_performance{ 0 };
+
+}; // class ValidationSink
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
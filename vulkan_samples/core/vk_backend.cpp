@@ -6,6 +6,9 @@
  *
  */
 #define VK_NO_PROTOTYPES
+#include <algorithm>
+#include <cstring>
+
 #include "vk_backend.hpp"
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE;
 
@@ -55,28 +58,40 @@ void VkBackend::destroy()
 {
     m_device.waitIdle();
 
+    // pending setup work may reference what follows
+    m_oneShot.destroy();
+
+    VkObjects.onDestroy(m_renderPass);
     m_device.destroyRenderPass(m_renderPass);
+    VkObjects.onDestroy(m_renderPassLoad);
+    m_device.destroyRenderPass(m_renderPassLoad);
 
-    m_device.destroyImageView(m_depthView);
-    m_device.destroyImage(m_depthImage);
-    m_device.freeMemory(m_depthMemory);
+    destroyDepthBuffer();
 
+    VkObjects.onDestroy(m_pipelineCache);
     m_device.destroyPipelineCache(m_pipelineCache);
 
     for (uint32_t i = 0; i < m_swapchain.getImageCount(); i++) {
+        VkObjects.onDestroy(m_framebuffers[i]);
         m_device.destroyFramebuffer(m_framebuffers[i]);
-        m_device.destroyFence(m_fences[i]);
-        m_device.freeCommandBuffers(m_commandPool, m_commandBuffers[i]);
+        m_syncPool.releaseFence(m_fences[i]);
     }
+    m_fences.clear();
 
     m_swapchain.destroy();
 
-    m_device.destroyCommandPool(m_commandPool);
+    m_framePools.destroy();
+    m_commandBuffers.clear();
+
+    // after everything that released into it
+    m_syncPool.destroy();
+
+    // whatever is still tracked outlives its owner
+    VkObjects.reportLeaks(std::cerr);
 
     m_device.destroy();
 
-    if (m_debugMessenger)
-        m_instance.destroyDebugUtilsMessengerEXT(m_debugMessenger);
+    m_validationSink.destroy();
 
     m_instance.destroySurfaceKHR(m_surface);
     m_instance.destroy();
@@ -211,8 +226,22 @@ void VkBackend::createLogicalDeviceAndQueues(const ContextCreateInfo& info)
 {
     auto queueFamilyProperties = m_physicalDevice.getQueueFamilyProperties();
 
+    // a compute family without graphics runs next to the graphics queue
+    if (info.asyncCompute) {
+        for (uint32_t i = 0; i < queueFamilyProperties.size(); i++) {
+            const vk::QueueFlags flags = queueFamilyProperties[i].queueFlags;
+            if (i != m_graphicsQueueIdx && queueFamilyProperties[i].queueCount > 0
+                && (flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics)) {
+                m_computeQueueIdx = i;
+                break;
+            }
+        }
+    }
+
     std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = { m_graphicsQueueIdx,  m_presentQueueIdx };
+    if (hasAsyncCompute())
+        uniqueQueueFamilies.insert(m_computeQueueIdx);
 
     const float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -223,11 +252,32 @@ void VkBackend::createLogicalDeviceAndQueues(const ContextCreateInfo& info)
 
         queueCreateInfos.push_back(queueInfo);
     }
+    // Optional extensions the device supports
+    std::vector<const char*> deviceExtensions = info.deviceExtensions;
+    const auto extensionProperties = m_physicalDevice.enumerateDeviceExtensionProperties();
+    for (const char* name : info.optionalDeviceExtensions) {
+        for (const auto& extension : extensionProperties) {
+            if (strcmp(extension.extensionName, name) == 0) {
+                deviceExtensions.push_back(name);
+                break;
+            }
+        }
+    }
+    m_deviceExtensions.assign(deviceExtensions.begin(), deviceExtensions.end());
+
     vk::PhysicalDeviceDescriptorIndexingFeaturesEXT indexFeature = {};
 
     vk::PhysicalDeviceScalarBlockLayoutFeaturesEXT  scalarFeature = {};
     scalarFeature.pNext = &indexFeature;
 
+    // Only chained when the extension is enabled, headers older than
+    // 1.2.145 do not declare it and keep the baked pipeline state
+#ifdef VK_EXT_extended_dynamic_state
+    vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT dynamicStateFeature = {};
+    if (isDeviceExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME))
+        indexFeature.pNext = &dynamicStateFeature;
+#endif
+
     // Vulkan >= 1.1 uses pNext to enable features, and not pEnabledFeatures
     vk::PhysicalDeviceFeatures2 enabledFeatures2 = {};
     enabledFeatures2.features = m_physicalDevice.getFeatures();
@@ -235,11 +285,15 @@ void VkBackend::createLogicalDeviceAndQueues(const ContextCreateInfo& info)
     enabledFeatures2.pNext = &scalarFeature;
     m_physicalDevice.getFeatures2(&enabledFeatures2);
 
+#ifdef VK_EXT_extended_dynamic_state
+    m_extendedDynamicState = dynamicStateFeature.extendedDynamicState == VK_TRUE;
+#endif
+
     vk::DeviceCreateInfo deviceCreateInfo = {};
     deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
-    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(info.deviceExtensions.size());
-    deviceCreateInfo.ppEnabledExtensionNames = info.deviceExtensions.data();
+    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+    deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
     deviceCreateInfo.pEnabledFeatures = nullptr;
     deviceCreateInfo.pNext = &enabledFeatures2;
 
@@ -261,6 +315,8 @@ void VkBackend::createLogicalDeviceAndQueues(const ContextCreateInfo& info)
     // Initialize default queues
     m_graphicsQueue = m_device.getQueue(m_graphicsQueueIdx, 0);
     m_presentQueue = m_device.getQueue(m_presentQueueIdx, 0);
+    if (hasAsyncCompute())
+        m_computeQueue = m_device.getQueue(m_computeQueueIdx, 0);
 
     // Initialize debugging tool for queue object names
 #if _DEBUG
@@ -269,6 +325,10 @@ void VkBackend::createLogicalDeviceAndQueues(const ContextCreateInfo& info)
 
     m_device.setDebugUtilsObjectNameEXT(
         { vk::ObjectType::eQueue, (uint64_t)(VkQueue)m_presentQueue, "presentQueue" });
+
+    if (hasAsyncCompute())
+        m_device.setDebugUtilsObjectNameEXT(
+            { vk::ObjectType::eQueue, (uint64_t)(VkQueue)m_computeQueue, "computeQueue" });
 #endif
 }
 
@@ -277,49 +337,37 @@ void VkBackend::createLogicalDeviceAndQueues(const ContextCreateInfo& info)
 //
 void VkBackend::createSwapChain()
 {
+    m_syncPool.init(m_device, 2);
+
     m_swapchain.init(m_instance, m_device, m_physicalDevice, m_graphicsQueue, m_graphicsQueueIdx,
-        m_presentQueue, m_presentQueueIdx, m_surface, vk::Format::eB8G8R8A8Unorm);
+        m_presentQueue, m_presentQueueIdx, m_surface, m_syncPool, vk::Format::eB8G8R8A8Unorm);
+    m_swapchain.setSharedQueueIdx(m_computeQueueIdx);
 
     m_swapchain.update(m_size.width, m_size.height, false);
+    m_syncPool.setFramesInFlight(m_swapchain.getImageCount());
 
+    m_size = vk::Extent2D(m_swapchain.getWidth(), m_swapchain.getHeight());
     m_colorFormat = m_swapchain.getFormat();
 }
 
 //-------------------------------------------------------------------------
-// Create CommandPool
+// Create CommandPool, one transient pool per swapchain image and the
+// one shot submitter for setup work
 //
 void VkBackend::createCommandPool()
 {
-    vk::CommandPoolCreateInfo poolInfo = {};
-    poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
-    poolInfo.queueFamilyIndex = m_graphicsQueueIdx;
-
-    try {
-        m_commandPool = m_device.createCommandPool(poolInfo);
-    }
-    catch (vk::SystemError err) {
-        throw std::runtime_error("failed to create command pool!");
-    }
+    m_framePools.init(m_device, m_graphicsQueueIdx, m_swapchain.getImageCount());
+    m_oneShot.init(m_device, m_graphicsQueue, m_graphicsQueueIdx);
 }
 
 //-------------------------------------------------------------------------
-// Create CommandBuffer
+// Create CommandBuffer, the first primary of each frame pool
 //
 void VkBackend::createCommandBuffer()
 {
     m_commandBuffers.resize(m_swapchain.getImageCount());
-
-    vk::CommandBufferAllocateInfo cmdBufferAllocInfo = {};
-    cmdBufferAllocInfo.commandPool = m_commandPool;
-    cmdBufferAllocInfo.level = vk::CommandBufferLevel::ePrimary;
-    cmdBufferAllocInfo.commandBufferCount = m_swapchain.getImageCount();
-
-    try {
-        m_commandBuffers = m_device.allocateCommandBuffers(cmdBufferAllocInfo);
-    }
-    catch (vk::SystemError err) {
-        throw std::runtime_error("failed to allocate command buffers!");
-    }
+    for (uint32_t i = 0; i < m_swapchain.getImageCount(); i++)
+        m_commandBuffers[i] = m_framePools.allocate(i);
 
 #if _DEBUG
     for (size_t i = 0; i < m_commandBuffers.size(); i++) {
@@ -332,20 +380,35 @@ void VkBackend::createCommandBuffer()
 }
 
 //-------------------------------------------------------------------------
-// Create Depth Buffer
+// Depth attachments are allocated in steps of 256 pixels, framebuffers
+// may use attachments larger than themselves
+//
+static uint32_t sizeClass(uint32_t size)
+{
+    return (size + 255u) & ~255u;
+}
+
+//-------------------------------------------------------------------------
+// Create Depth Buffer, rounded up to its size class
 //
 void VkBackend::createDepthBuffer()
 {
+    m_depthExtent = vk::Extent2D(sizeClass(m_size.width), sizeClass(m_size.height));
+
     // Depth Info
     vk::ImageCreateInfo depthStencilCreateInfo = {};
     depthStencilCreateInfo.imageType = vk::ImageType::e2D;
-    depthStencilCreateInfo.extent = vk::Extent3D(m_size.width, m_size.height, 1);
+    depthStencilCreateInfo.extent = vk::Extent3D(m_depthExtent.width, m_depthExtent.height, 1);
     depthStencilCreateInfo.format = m_depthFormat;
     depthStencilCreateInfo.mipLevels = 1;
     depthStencilCreateInfo.arrayLayers = 1;
     depthStencilCreateInfo.samples = vk::SampleCountFlagBits::e1;
-    depthStencilCreateInfo.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment
-        | vk::ImageUsageFlagBits::eTransferSrc;
+    // sampled for the Hi-Z pyramid where the format supports it
+    m_depthUsage = vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+    if (m_physicalDevice.getFormatProperties(m_depthFormat).optimalTilingFeatures
+        & vk::FormatFeatureFlagBits::eSampledImage)
+        m_depthUsage |= vk::ImageUsageFlagBits::eSampled;
+    depthStencilCreateInfo.usage = m_depthUsage;
 
     try {
         m_depthImage = m_device.createImage(depthStencilCreateInfo);
@@ -356,6 +419,7 @@ void VkBackend::createDepthBuffer()
 
     // find memory requirements
     const vk::MemoryRequirements memReqs = m_device.getImageMemoryRequirements(m_depthImage);
+    VkObjects.onCreate(m_depthImage, memReqs.size, "depthImage");
     uint32_t memoryTypeIdx = -1;
     {
         auto deviceMemoryProperties = m_physicalDevice.getMemoryProperties();
@@ -381,19 +445,33 @@ void VkBackend::createDepthBuffer()
     catch (vk::SystemError err) {
         throw std::runtime_error("failed to allocate depth image memory!");
     }
+    VkObjects.onCreate(m_depthMemory, memAllocInfo.allocationSize, "depthMemory");
 
     // Bind image & memory
     m_device.bindImageMemory(m_depthImage, m_depthMemory, 0);
 
-    // Create an image barrier to change the layout from
-    // undefined to DepthStencilAttachmentOptimal
-
-    // barrier on top, barrier inside set up cmdbuffer
-
     // Depth Info
     const vk::ImageAspectFlags aspect =
         vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
 
+    // Layout from undefined to DepthStencilAttachmentOptimal, goes out
+    // with the other setup work ahead of the next frame
+    const vk::Image depthImage = m_depthImage;
+    m_oneShot.submitOneShot([depthImage, aspect](vk::CommandBuffer cmdBuffer) {
+        vk::ImageMemoryBarrier barrier = {};
+        barrier.oldLayout = vk::ImageLayout::eUndefined;
+        barrier.newLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+        barrier.dstAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentRead
+            | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = depthImage;
+        barrier.subresourceRange = { aspect, 0, 1, 0, 1 };
+        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+            vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+            {}, nullptr, nullptr, barrier);
+    });
+
     // Setting up the view
     vk::ImageViewCreateInfo depthStencilView = {};
     depthStencilView.viewType = vk::ImageViewType::e2D;
@@ -406,6 +484,36 @@ void VkBackend::createDepthBuffer()
     catch (vk::SystemError err) {
         throw std::runtime_error("failed to create depth image view!");
     }
+    VkObjects.onCreate(m_depthView, 0, "depthView");
+}
+
+//-------------------------------------------------------------------------
+// Destroy Depth Buffer
+//
+void VkBackend::destroyDepthBuffer()
+{
+    VkObjects.onDestroy(m_depthView);
+    VkObjects.onDestroy(m_depthImage);
+    VkObjects.onDestroy(m_depthMemory);
+    m_device.destroyImageView(m_depthView);
+    m_device.destroyImage(m_depthImage);
+    m_device.freeMemory(m_depthMemory);
+    m_depthView = nullptr;
+    m_depthImage = nullptr;
+    m_depthMemory = nullptr;
+    m_depthExtent = vk::Extent2D(0, 0);
+}
+
+//-------------------------------------------------------------------------
+// Kept while it covers size and is at most one class above the class of
+// size, so a drag back and forth over a class boundary does not
+// reallocate every time
+//
+bool VkBackend::isDepthBufferReusable(vk::Extent2D size) const
+{
+    return m_depthExtent.width >= size.width && m_depthExtent.height >= size.height
+        && m_depthExtent.width <= sizeClass(size.width) + 256u
+        && m_depthExtent.height <= sizeClass(size.height) + 256u;
 }
 
 //-------------------------------------------------------------------------
@@ -476,10 +584,40 @@ void VkBackend::createRenderPass()
     catch (vk::SystemError err) {
         throw std::runtime_error("failed to create render pass!");
     }
+    VkObjects.onCreate(m_renderPass, 0, "renderPassBackend");
+
+    // Same pass continuing the frame drawn so far, e.g. after a compute
+    // pass between two halves of the scene. Load ops and layouts do not
+    // affect compatibility, it uses the framebuffers of m_renderPass
+    attachments[0].loadOp = vk::AttachmentLoadOp::eLoad;
+    attachments[0].initialLayout = vk::ImageLayout::ePresentSrcKHR;
+    attachments[1].loadOp = vk::AttachmentLoadOp::eLoad;
+    attachments[1].initialLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+    dependencies[0].srcStageMask    = vk::PipelineStageFlagBits::eColorAttachmentOutput
+                                    | vk::PipelineStageFlagBits::eLateFragmentTests;
+    dependencies[0].dstStageMask    = vk::PipelineStageFlagBits::eColorAttachmentOutput
+                                    | vk::PipelineStageFlagBits::eEarlyFragmentTests;
+    dependencies[0].srcAccessMask   = vk::AccessFlagBits::eColorAttachmentWrite
+                                    | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    dependencies[0].dstAccessMask   = vk::AccessFlagBits::eColorAttachmentRead
+                                    | vk::AccessFlagBits::eColorAttachmentWrite
+                                    | vk::AccessFlagBits::eDepthStencilAttachmentRead
+                                    | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+    try {
+        m_renderPassLoad = m_device.createRenderPass(renderPassInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create render pass!");
+    }
+    VkObjects.onCreate(m_renderPassLoad, 0, "renderPassBackendLoad");
 
 #ifdef _DEBUG
     m_device.setDebugUtilsObjectNameEXT(
         { vk::ObjectType::eRenderPass, reinterpret_cast<const uint64_t&>(m_renderPass), "renderPassBackend" });
+    m_device.setDebugUtilsObjectNameEXT(
+        { vk::ObjectType::eRenderPass, reinterpret_cast<const uint64_t&>(m_renderPassLoad), "renderPassBackendLoad" });
 #endif  
 
 }
@@ -495,6 +633,7 @@ void VkBackend::createPipelineCache()
     catch (vk::SystemError err) {
         throw std::runtime_error("failed to create pipeline cache!");
     }
+    VkObjects.onCreate(m_pipelineCache, 0, "pipelineCacheBackend");
 }
 
 //-------------------------------------------------------------------------
@@ -503,8 +642,10 @@ void VkBackend::createPipelineCache()
 void VkBackend::createFrameBuffers()
 {
     // recreate frame buffers
-    for (auto framebuffer : m_framebuffers)
+    for (auto framebuffer : m_framebuffers) {
+        VkObjects.onDestroy(framebuffer);
         m_device.destroyFramebuffer(framebuffer);
+    }
     m_framebuffers.resize(m_swapchain.getImageCount());
 
     std::array<vk::ImageView, 2> attachments;
@@ -528,6 +669,7 @@ void VkBackend::createFrameBuffers()
         catch (vk::SystemError err) {
             throw std::runtime_error("failed to create framebuffer!");
         }
+        VkObjects.onCreate(m_framebuffers[i], 0, "frameBufBack");
     }
 
 #ifdef _DEBUG
@@ -540,31 +682,59 @@ void VkBackend::createFrameBuffers()
 }
 
 //-------------------------------------------------------------------------
-// Create SynchObjects
+// Create SynchObjects, signaled so the first wait of each image returns
 //
 void VkBackend::createSyncObjects()
 {
     m_fences.resize(m_swapchain.getImageCount());
 
-    try {
-        for (uint32_t i = 0; i < m_swapchain.getImageCount(); ++i) {
-            m_fences[i] = m_device.createFence({ vk::FenceCreateFlagBits::eSignaled });
-        }
-    }
-    catch (vk::SystemError err) {
-        throw std::runtime_error("failed to create synchronization objects for a frame!");
-    }
+    for (uint32_t i = 0; i < m_swapchain.getImageCount(); ++i)
+        m_fences[i] = m_syncPool.acquireFence(true);
+}
+
+//-------------------------------------------------------------------------
+// Recreate the per image objects, the device is idle. Fences go back to
+// the pool and the frame pools are rebuilt with the new count
+//
+void VkBackend::recreateFrameObjects()
+{
+    for (auto fence : m_fences)
+        m_syncPool.releaseFence(fence);
+    m_fences.clear();
+
+    m_framePools.destroy();
+    m_commandBuffers.clear();
+
+    m_framePools.init(m_device, m_graphicsQueueIdx, m_swapchain.getImageCount());
+    createCommandBuffer();
+    createSyncObjects();
+
+    m_syncPool.setFramesInFlight(m_swapchain.getImageCount());
 }
 
 //-------------------------------------------------------------------------
 // function to call before rendering
 //
 void VkBackend::prepareFrame()
-{// Acquire the next image from the swap chain
+{
+    // Resize requests that have settled
+    if (m_resizePending && std::chrono::steady_clock::now() - m_resizeTime >= m_resizeDelay)
+        onWindowResize(m_resizeSize.width, m_resizeSize.height);
+
+    // Acquire the next image from the swap chain
     auto result = m_swapchain.acquire();
-    // Recreate the swapchain if it's no longer compatible with the surface
-    if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR) {
-        onWindowResize(m_size.width, m_size.height);
+
+    // Out of date can not be presented, rebuild now and acquire again
+    if (result == vk::Result::eErrorOutOfDateKHR) {
+        const vk::Extent2D size = m_resizePending ? m_resizeSize : m_size;
+        onWindowResize(size.width, size.height);
+        result = m_swapchain.acquire();
+    }
+
+    // Suboptimal still presents, it waits for the coalesced rebuild
+    if (result == vk::Result::eSuboptimalKHR) {
+        if (!m_resizePending)
+            requestResize(m_size.width, m_size.height);
     }
     else if (result != vk::Result::eSuccess) {
         throw std::runtime_error("failed to acquire image from swapchain!");
@@ -573,21 +743,29 @@ void VkBackend::prepareFrame()
     // fence until cmd buffer has finished executing before using again
     uint32_t imageIndex = m_swapchain.getActiveImageIndex();
     while (m_device.waitForFences(m_fences[imageIndex], VK_TRUE, 10000) == vk::Result::eTimeout) {}
+
+    // every buffer of the frame at once, the frame buffer is handed out again
+    m_framePools.reset(imageIndex);
+    m_commandBuffers[imageIndex] = m_framePools.allocate(imageIndex);
+
+    m_oneShot.update();
+    m_syncPool.update();
+    VkObjects.nextFrame();
 }
 
 //-------------------------------------------------------------------------
 // function to call for submitting the rendering command
 //
-void VkBackend::submitFrame()
+void VkBackend::submitFrame(vk::Semaphore waitSemaphore, vk::PipelineStageFlags waitStage)
 {
     uint32_t imageIndex = m_swapchain.getActiveImageIndex();
     m_device.resetFences(m_fences[imageIndex]);
 
-    vk::Semaphore semaphoreRead = m_swapchain.getActiveReadSemaphore();
+    vk::Semaphore semaphoreRead = waitSemaphore ? waitSemaphore : vk::Semaphore(m_swapchain.getActiveReadSemaphore());
     vk::Semaphore semaphoreWrite = m_swapchain.getActiveWrittenSemaphore();
 
     // Pipeline stage at which the queue submission will wait (via pWaitSemaphores)
-    const vk::PipelineStageFlags waitStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    const vk::PipelineStageFlags waitStageMask = waitStage;
 
     vk::SubmitInfo submitInfo = {};
     submitInfo.waitSemaphoreCount = 1;                              // One wait semaphore
@@ -598,6 +776,9 @@ void VkBackend::submitFrame()
     submitInfo.signalSemaphoreCount = 1;                              // One signal Semaphore
     submitInfo.pSignalSemaphores = &semaphoreWrite;                // Semaphore(s) to be signaled when command buffers have completed
 
+    // setup work recorded since the last frame goes first on the same queue
+    m_oneShot.flush();
+
     // Submit to the graphics queue passing a wait fence
     try {
         m_graphicsQueue.submit(submitInfo, m_fences[imageIndex]);
@@ -606,15 +787,56 @@ void VkBackend::submitFrame()
         throw std::runtime_error("failed to submit draw command buffer!");
     }
 
-    m_swapchain.present(m_graphicsQueue);
+    // out of date is rebuilt by the next acquire
+    if (m_swapchain.present(m_graphicsQueue) == vk::Result::eSuboptimalKHR && !m_resizePending)
+        requestResize(m_size.width, m_size.height);
+}
+
+//-------------------------------------------------------------------------
+// Window size events come in bursts while dragging, only the last one
+// is rebuilt once none came for the resize delay
+//
+void VkBackend::requestResize(uint32_t width, uint32_t height)
+{
+    // minimized, the restore sends its own event
+    if (width == 0 || height == 0)
+        return;
+
+    m_resizePending = true;
+    m_resizeSize = vk::Extent2D(width, height);
+    m_resizeTime = std::chrono::steady_clock::now();
 }
 
 //-------------------------------------------------------------------------
 // On Window Size Callback
-// - Destroy allocated frames, then rebuild with new size
+// - Rebuild the swapchain and framebuffers with the new size, the depth
+//   buffer is only reallocated when its size class no longer fits
+// - render pass and pipelines do not depend on the size and are kept,
+//   fences, frame pools and command buffers unless the image count changed
 //
 void VkBackend::onWindowResize(uint32_t width, uint32_t height)
 {
+    m_resizePending = false;
+    if (width == 0 || height == 0)
+        return;
+
+    // a pending depth transition must not outlive its image
+    m_oneShot.flush();
+    m_device.waitIdle();
+
+    m_swapchain.update(width, height);
+    m_size = vk::Extent2D(m_swapchain.getWidth(), m_swapchain.getHeight());
+
+    // the surface may hand out another number of images after a rebuild
+    if (m_swapchain.getImageCount() != m_fences.size())
+        recreateFrameObjects();
+
+    if (!isDepthBufferReusable(m_size)) {
+        destroyDepthBuffer();
+        createDepthBuffer();
+    }
+
+    createFrameBuffers();
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -622,40 +844,18 @@ void VkBackend::onWindowResize(uint32_t width, uint32_t height)
 ///////////////////////////////////////////////////////////////////////////
 
 //-------------------------------------------------------------------------
-// 
-//
-static VKAPI_ATTR VkBool32 VKAPI_CALL
-debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-    VkDebugUtilsMessageTypeFlagsEXT messageType,
-    const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
-    void* pUserData)
-{
-    std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
-    return VK_FALSE;
-}
-
-//-------------------------------------------------------------------------
-// Set up Debug Messenger
+// Set up Debug Messenger, messages are logged off the driver thread,
+// deduplicated and rate limited per message ID
 //
 void VkBackend::setupDebugMessenger(bool enableValidationLayers)
 {
     if (!enableValidationLayers) return;
 
-    vk::DebugUtilsMessengerCreateInfoEXT debugInfo = {};
-    debugInfo.messageSeverity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eError
-        | vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose
-        | vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning;
-    debugInfo.messageType = vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral
+    m_validationSink.init(m_instance,
+        vk::DebugUtilsMessageSeverityFlagBitsEXT::eError | vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning,
+        vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral
         | vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation
-        | vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance;
-    debugInfo.pfnUserCallback = debugCallback;
-
-    try {
-        m_debugMessenger = m_instance.createDebugUtilsMessengerEXT(debugInfo);
-    }
-    catch (vk::SystemError err) {
-        throw std::runtime_error("failed to set up debug messenger!");
-    }
+        | vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance);
 }
 
 //-------------------------------------------------------------------------
@@ -699,6 +899,14 @@ bool VkBackend::checkDeviceExtensionSupport(const ContextCreateInfo& info, std::
     return requiredExtensions.empty();
 }
 
+//-------------------------------------------------------------------------
+// Enabled on the logical device, required or optional
+//
+bool VkBackend::isDeviceExtensionEnabled(const char* name) const
+{
+    return std::find(m_deviceExtensions.begin(), m_deviceExtensions.end(), name) != m_deviceExtensions.end();
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // ContextCreateInfo                                                     //
 ///////////////////////////////////////////////////////////////////////////
@@ -727,6 +935,14 @@ void ContextCreateInfo::addDeviceExtension(const char* name)
     deviceExtensions.emplace_back(name);
 }
 
+//-------------------------------------------------------------------------
+// 
+//
+void ContextCreateInfo::addOptionalDeviceExtension(const char* name)
+{
+    optionalDeviceExtensions.emplace_back(name);
+}
+
 
 //-------------------------------------------------------------------------
 // 
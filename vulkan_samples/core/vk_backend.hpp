@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <set>
 #include <iostream>
 #include <vulkan/vulkan.hpp>
@@ -15,7 +16,11 @@
 #include "GLFW/glfw3.h"
 #include "GLFW/glfw3native.h"
 
+#include "command_pools.hpp"
+#include "object_registry.hpp"
 #include "swapchain.hpp"
+#include "sync_pool.hpp"
+#include "validation_sink.hpp"
 
 namespace vkb {
 namespace core {
@@ -33,6 +38,9 @@ struct ContextCreateInfo
 
     void addDeviceExtension(const char* name);
 
+    // Enabled only when the device supports it
+    void addOptionalDeviceExtension(const char* name);
+
     void addInstanceExtension(const char* name);
 
     void addValidationLayer(const char* name);
@@ -45,10 +53,16 @@ struct ContextCreateInfo
 
     std::vector<const char*> deviceExtensions;
 
+    std::vector<const char*> optionalDeviceExtensions;
+
     std::vector<const char*> validationLayers;
 
     std::vector<const char*> instanceExtensions;
 
+    // Dedicated compute queue when the device has one, swapchain images
+    // are then shared with its family
+    bool asyncCompute = false;
+
     const char* appEngine = "No Engine";
     const char* appTitle = "Application";
 };
@@ -67,7 +81,7 @@ public:
 
     virtual void setupVulkan(const ContextCreateInfo& info, GLFWwindow* window);
 
-    void destroy();
+    virtual void destroy();
 
     void initInstance(const ContextCreateInfo& info);
 
@@ -93,10 +107,23 @@ public:
 
     void createSyncObjects();
 
+    // Fences, frame pools and their command buffers for a new image count
+    void recreateFrameObjects();
+
     void prepareFrame();
 
-    void submitFrame();
+    // waitSemaphore replaces the acquire semaphore when work of the frame
+    // went ahead in its own submit, waitStage is the first stage touching
+    // the swapchain image
+    void submitFrame(vk::Semaphore waitSemaphore = nullptr,
+        vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eColorAttachmentOutput);
+
+    // Coalesced, prepareFrame rebuilds once no request came for the resize delay
+    void requestResize(uint32_t width, uint32_t height);
+
+    void setResizeDelay(double ms) { m_resizeDelay = std::chrono::duration<double, std::milli>(ms); }
 
+    // Rebuild of the size dependent resources, overrides call it first
     virtual void onWindowResize(uint32_t width, uint32_t height);
 
     ///////////////////////////////////////////////////////////////////////////
@@ -109,7 +136,9 @@ public:
 
     bool checkDeviceExtensionSupport(const ContextCreateInfo& info, std::vector<vk::ExtensionProperties>& extensionProperties);
 
-    VkDebugUtilsMessengerEXT m_debugMessenger = nullptr;
+    bool isDeviceExtensionEnabled(const char* name) const;
+
+    ValidationSink m_validationSink;
 
     //-------------------------------------------------------------------------
     // Collection of Getter Methods
@@ -122,21 +151,33 @@ public:
     uint32_t                              getGraphicsQueueIdx() { return m_graphicsQueueIdx; }
     vk::Queue                             getPresentQueue() { return m_presentQueue; }
     uint32_t                              getPresentQueueIdx() { return m_presentQueueIdx; }
+    vk::Queue                             getComputeQueue() { return m_computeQueue; }
+    uint32_t                              getComputeQueueIdx() { return m_computeQueueIdx; }
+    bool                                  hasAsyncCompute() const { return m_computeQueueIdx != VK_QUEUE_FAMILY_IGNORED; }
     vk::Extent2D                          getSize() { return m_size; }
     vk::RenderPass                        getRenderPass() { return m_renderPass; }
+    vk::RenderPass                        getRenderPassLoad() { return m_renderPassLoad; }
     vk::PipelineCache                     getPipelineCache() { return m_pipelineCache; }
     const std::vector<vk::Framebuffer>&   getFramebuffers() { return m_framebuffers; }
     const std::vector<vk::CommandBuffer>& getCommandBuffers() { return m_commandBuffers; }
+    FrameCommandPools&                    getFramePools() { return m_framePools; }
+    OneShotSubmitter&                     getOneShot() { return m_oneShot; }
+    SyncPool&                             getSyncPool() { return m_syncPool; }
+    const ValidationSink&                 getValidationSink() const { return m_validationSink; }
     uint32_t                              getCurrentFrame() const { return m_swapchain.getActiveImageIndex(); }
     vk::Format                            getColorFormat()  const { return m_colorFormat; }
     vk::Format                            getDepthFormat()  const { return m_depthFormat; }
+    vk::ImageUsageFlags                   getDepthUsage()   const { return m_depthUsage; }
     vk::SampleCountFlagBits               getSampleCount()  const { return m_sampleCount; }
+    bool                                  hasExtendedDynamicState() const { return m_extendedDynamicState; }
 
 protected:
 
     vk::Instance                   m_instance;
     vk::PhysicalDevice             m_physicalDevice;
     vk::Device                     m_device;
+    std::vector<std::string>       m_deviceExtensions;   // required and supported optional
+    bool                           m_extendedDynamicState{ false };
 
     vk::SurfaceKHR                 m_surface;
 
@@ -144,18 +185,25 @@ protected:
     vk::Queue                      m_presentQueue;
     uint32_t                       m_graphicsQueueIdx{ VK_QUEUE_FAMILY_IGNORED };
     uint32_t                       m_presentQueueIdx{ VK_QUEUE_FAMILY_IGNORED };
+    vk::Queue                      m_computeQueue;       // dedicated family, only with asyncCompute
+    uint32_t                       m_computeQueueIdx{ VK_QUEUE_FAMILY_IGNORED };
 
+    SyncPool                       m_syncPool;           // recycled fences and semaphores, outlives the swapchain
     vkb::core::SwapChain           m_swapchain;
     std::vector<vk::Framebuffer>   m_framebuffers;
     std::vector<vk::CommandBuffer> m_commandBuffers;
 
-    vk::CommandPool                m_commandPool;
+    FrameCommandPools              m_framePools;         // per swapchain image, reset with its fence
+    OneShotSubmitter               m_oneShot;            // setup work, submitted ahead of the frame
 
     vk::Image                      m_depthImage;
     vk::DeviceMemory               m_depthMemory;
     vk::ImageView                  m_depthView;
+    vk::Extent2D                   m_depthExtent{ 0, 0 };   // allocated, rounded up to a size class
+    vk::ImageUsageFlags            m_depthUsage;            // sampled when the format allows it
 
     vk::RenderPass                 m_renderPass;
+    vk::RenderPass                 m_renderPassLoad;     // continues a frame, same framebuffers
     vk::PipelineCache              m_pipelineCache;
 
     std::vector<vk::Fence>         m_fences;
@@ -166,6 +214,18 @@ protected:
     vk::Format                     m_colorFormat{ vk::Format::eUndefined };
     vk::SampleCountFlagBits        m_sampleCount{ vk::SampleCountFlagBits::e1 };
 
+    // Resize
+    bool                                      m_resizePending{ false };
+    vk::Extent2D                              m_resizeSize{ 0, 0 };
+    std::chrono::steady_clock::time_point     m_resizeTime;
+    std::chrono::duration<double, std::milli> m_resizeDelay{ 100.0 };
+
+private:
+
+    void destroyDepthBuffer();
+
+    bool isDepthBufferReusable(vk::Extent2D size) const;
+
 }; // classVkBackend
 
 } // namespace core 
@@ -0,0 +1,97 @@
+/*
+ *
+ * Andrew Frost
+ * vk_utils.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <stdexcept>
+#include <vulkan/vulkan.hpp>
+
+namespace vkb {
+namespace core {
+
+///////////////////////////////////////////////////////////////////////////
+// Vulkan Utilities                                                      //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// 64 bit FNV-1a, chain calls through seed
+//
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        seed ^= bytes[i];
+        seed *= 1099511628211ull;
+    }
+    return seed;
+}
+
+//-------------------------------------------------------------------------
+// 64 bit value of a vulkan.hpp handle through its C type, dispatchable
+// handles are pointers and the others are not on every platform
+//
+template <typename T>
+inline uint64_t handleOf(const T& object)
+{
+    return uint64_t(static_cast<typename T::CType>(object));
+}
+
+//-------------------------------------------------------------------------
+// Find a memory type index matching typeBits with all requested properties
+//
+inline uint32_t findMemoryType(vk::PhysicalDevice physicalDevice, uint32_t typeBits,
+    vk::MemoryPropertyFlags properties)
+{
+    const vk::PhysicalDeviceMemoryProperties memProperties = physicalDevice.getMemoryProperties();
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeBits & (1 << i))
+            && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+//-------------------------------------------------------------------------
+// Create a buffer and bind it to its own allocation
+//
+inline void createBuffer(vk::Device device, vk::PhysicalDevice physicalDevice, vk::DeviceSize size,
+    vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+    vk::Buffer& buffer, vk::DeviceMemory& memory)
+{
+    vk::BufferCreateInfo bufferInfo = {};
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+    try {
+        buffer = device.createBuffer(bufferInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to create buffer!");
+    }
+
+    const vk::MemoryRequirements memReqs = device.getBufferMemoryRequirements(buffer);
+
+    vk::MemoryAllocateInfo memAllocInfo = {};
+    memAllocInfo.allocationSize = memReqs.size;
+    memAllocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memReqs.memoryTypeBits, properties);
+
+    try {
+        memory = device.allocateMemory(memAllocInfo);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to allocate buffer memory!");
+    }
+
+    device.bindBufferMemory(buffer, memory, 0);
+}
+
+} // namespace core
+} // namespace vkb
\ No newline at end of file
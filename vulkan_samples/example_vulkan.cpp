@@ -6,7 +6,10 @@
  *
  */
 
+#include <string>
+
 #include "example_vulkan.hpp"
+#include "helper/mesh_optimizer.hpp"
 
 namespace vkb {
 
@@ -22,12 +25,86 @@ void VkExample::setupVulkan(const core::ContextCreateInfo& info, GLFWwindow* win
     // Vk Backend
     core::VkBackend::setupVulkan(info, window);
 
+    m_window = window;
+
     // Setup Camera
     int width, height;
     glfwGetWindowSize(window, &width, &height);
     CameraView.setWindowSize(width, height);
     CameraView.setLookAt(glm::vec3(1.f, 1.f, 1.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
 
+    // Shader modules and layouts shared by every pipeline. With extended
+    // dynamic state, cull, depth and topology no longer multiply variants
+    m_shaderLibrary.init(m_instance, m_device);
+    m_pipelineVariants.init(m_instance, m_device, m_pipelineCache, m_extendedDynamicState);
+    m_commandState.init(m_device, m_extendedDynamicState);
+
+    // Pipelines are described from creation on, a capture may come later
+    m_frameCapture.setShaderLibrary(&m_shaderLibrary);
+    m_pipelineVariants.setCapture(&m_frameCapture);
+    m_commandState.setCapture(&m_frameCapture);
+
+    // Sub-allocated device memory, compacted in the background. Copies go on
+    // the graphics queue, moved images are still sampled by frames in flight
+    m_deviceAllocator.init(m_device, m_physicalDevice, m_graphicsQueue, m_graphicsQueueIdx,
+        m_swapchain.getImageCount());
+
+    // Light lists per froxel cluster, forward shading cost follows the
+    // local light density
+    m_clusteredLighting.init(m_device, m_physicalDevice, m_shaderLibrary, m_pipelineVariants,
+        m_swapchain.getImageCount());
+
+    // Occlusion culling against a depth pyramid, instances hidden last
+    // frame are only drawn if this frame's early depth shows them
+    m_occlusionEnabled = core::OcclusionCuller::isSupported(m_physicalDevice, m_depthUsage);
+    if (m_occlusionEnabled) {
+        m_occlusionCuller.init(m_device, m_physicalDevice, m_deviceAllocator, m_shaderLibrary, m_pipelineVariants,
+            m_swapchain.getImageCount());
+        m_occlusionCuller.createTargets(m_depthImage, m_depthFormat, m_size);
+    }
+    else {
+        m_hud.log("occlusion culling unavailable, the depth buffer can not be sampled");
+    }
+
+    // Post processing, tonemap, grade and sharpen dispatched into the
+    // swapchain images. On the compute queue when the device has one
+    m_postEnabled = core::PostProcess::isSupported(m_physicalDevice, m_swapchain);
+    if (m_postEnabled) {
+        m_postProcess.init(m_device, m_deviceAllocator, m_syncPool, m_shaderLibrary, m_pipelineVariants,
+            m_depthFormat, m_graphicsQueueIdx, m_computeQueueIdx);
+        m_postProcess.createTargets(m_swapchain, m_depthView);
+    }
+    else {
+        m_hud.log("post processing unavailable, no storage writes to the swapchain images");
+    }
+
+    // Vertices and indices of every mesh in two shared buffers
+    m_geometryPool.init(m_deviceAllocator, m_device, m_physicalDevice, m_graphicsQueue, m_graphicsQueueIdx);
+
+    // Texture streaming, tails upload as soon as decoded
+    m_textureStreamer.init(m_deviceAllocator, m_device, m_physicalDevice, m_graphicsQueue, m_graphicsQueueIdx,
+        m_swapchain.getImageCount());
+
+    // Heap budgets, streamed mips are given back under memory pressure
+    m_memoryGovernor.init(m_instance, m_physicalDevice, isDeviceExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME),
+        m_swapchain.getImageCount());
+    m_memoryGovernor.addClient("Streamed textures", m_memoryGovernor.getDeviceLocalHeap(), 10,
+        [this]() { return m_textureStreamer.getResidentBytes(); },
+        [this](vk::DeviceSize bytes) { return m_textureStreamer.trim(bytes); });
+    m_deviceAllocator.setMemoryGovernor(&m_memoryGovernor);
+
+    // Performance HUD
+    m_overlay.init(window, m_instance, m_physicalDevice, m_device, m_graphicsQueue, m_graphicsQueueIdx,
+        m_pipelineCache, m_swapchain, m_oneShot);
+    m_gpuProfiler.init(m_device, m_physicalDevice, m_graphicsQueueIdx, m_swapchain.getImageCount());
+
+    // Readback ring, frames in flight plus two for a sink running behind
+    m_readback.init(m_device, m_physicalDevice, m_swapchain.getImageCount() + 2);
+
+    // Import time mesh passes, ahead of upload
+    optimizeMeshes();
+    uploadMeshes();
+
     //loadAssets()
 
     //prepareInstanceData()
@@ -46,10 +123,448 @@ void VkExample::setupVulkan(const core::ContextCreateInfo& info, GLFWwindow* win
 }
 
 //-------------------------------------------------------------------------
-// Called on window resize
+// Reorder imported meshes for vertex cache, overdraw and fetch locality,
+// split them into meshlets and append their LOD chain
+//
+void VkExample::optimizeMeshes()
+{
+    for (auto& mesh : m_meshes) {
+        tools::optimizeMesh(mesh);
+        tools::generateLodChain(mesh);
+    }
+}
+
+//-------------------------------------------------------------------------
+// Meshes go to the geometry pool, the LOD selector addresses them by
+// firstIndex / vertexOffset so every draw shares one bind
+//
+void VkExample::uploadMeshes()
+{
+    for (const auto& mesh : m_meshes) {
+        const core::GeometryPool::Range& range = m_geometryPool.getRange(m_geometryPool.addMesh(mesh));
+        m_lodSelector.addMesh(mesh, range.firstIndex, range.vertexOffset);
+    }
+    m_geometryPool.flush();
+}
+
+//-------------------------------------------------------------------------
+// Call on exit
+//
+void VkExample::destroy()
+{
+    m_readback.destroy();
+    m_postProcess.destroy();
+    m_occlusionCuller.destroy();
+    m_clusteredLighting.destroy();
+    m_overlay.destroy();
+    m_gpuProfiler.destroy();
+    m_deviceAllocator.setMemoryGovernor(nullptr);
+    m_memoryGovernor.destroy();
+    m_textureStreamer.destroy();
+    m_geometryPool.destroy();
+    m_deviceAllocator.destroy();
+    m_commandState.destroy();
+    m_pipelineVariants.destroy();
+    m_pipelineVariants.setCapture(nullptr);
+    m_commandState.setCapture(nullptr);
+    m_shaderLibrary.destroy();
+
+    core::VkBackend::destroy();
+}
+
+//-------------------------------------------------------------------------
+// Start timing the frame, the ImGui frame only runs while the HUD shows
+//
+void VkExample::beginFrame()
+{
+    m_cpuProfiler.beginFrame();
+
+    const bool keyDown = glfwGetKey(m_window, GLFW_KEY_F1) == GLFW_PRESS;
+    if (keyDown && !m_hudKeyDown)
+        m_hud.toggle();
+    m_hudKeyDown = keyDown;
+
+    const bool captureKeyDown = glfwGetKey(m_window, GLFW_KEY_F12) == GLFW_PRESS;
+    if (captureKeyDown && !m_captureKeyDown && !m_frameCapture.isRequested())
+        m_frameCapture.request("frame_" + std::to_string(m_cpuProfiler.getFrameIndex()) + ".vkfc");
+    m_captureKeyDown = captureKeyDown;
+
+    const bool recordKeyDown = glfwGetKey(m_window, GLFW_KEY_F11) == GLFW_PRESS;
+    if (recordKeyDown && !m_recordKeyDown)
+        toggleRecording();
+    m_recordKeyDown = recordKeyDown;
+    m_frameCapture.beginFrame();
+
+    if (m_hud.isVisible()) {
+        tools::CpuProfiler::Scope phase(m_cpuProfiler, "ImGui frame");
+        m_overlay.newFrame();
+    }
+}
+
+//-------------------------------------------------------------------------
+// Per frame update, before rendering
+//
+void VkExample::update()
+{
+    tools::CpuProfiler::Scope phase(m_cpuProfiler, "Update");
+
+    m_lodSelector.select(CameraView);
+
+    // evictions requested here are applied by the streamer update
+    m_memoryGovernor.update();
+
+    m_deviceAllocator.update();
+
+    m_textureStreamer.update(CameraView);
+}
+
+//-------------------------------------------------------------------------
+// Submit UI windows
+//
+void VkExample::drawUI()
+{
+    if (!m_overlay.isInFrame())
+        return;
+
+    tools::CpuProfiler::Scope phase(m_cpuProfiler, "ImGui draw");
+
+    gatherHudStats();
+    m_hud.draw(m_cpuProfiler, m_hudStats);
+
+    m_overlay.endFrame();
+}
+
+//-------------------------------------------------------------------------
+// Acquire the next image and record its command buffer
+//
+void VkExample::render()
+{
+    {
+        tools::CpuProfiler::Scope phase(m_cpuProfiler, "Acquire");
+        prepareFrame();
+    }
+
+    tools::CpuProfiler::Scope phase(m_cpuProfiler, "Record");
+
+    // the image's fence was waited on, its readback is complete
+    const uint32_t imageIndex = getCurrentFrame();
+    try {
+        m_readback.frameComplete(imageIndex);
+    }
+    catch (const std::exception& e) {
+        m_hud.log(std::string("recording stopped, ") + e.what());
+    }
+
+    if (m_postEnabled)
+        m_postProcess.beginFrame(imageIndex);
+
+    m_clusteredLighting.update(imageIndex, CameraView, m_lights);
+
+    m_occlusionActive = m_occlusionEnabled && m_occlusionCuller.update(imageIndex, CameraView, m_lodSelector);
+
+    recordFrame(m_commandBuffers[imageIndex], imageIndex);
+}
+
+//-------------------------------------------------------------------------
+// Submit for display
+//
+void VkExample::submit()
+{
+    tools::CpuProfiler::Scope phase(m_cpuProfiler, "Submit");
+
+    // the dispatch is the first to touch the swapchain image
+    if (m_postEnabled && m_postProcess.isAsync()) {
+        submitScene(getCurrentFrame());
+        const vk::Semaphore postDone = m_postProcess.submit(m_computeQueue, getCurrentFrame(),
+            vk::Semaphore(m_swapchain.getActiveReadSemaphore()));
+        submitFrame(postDone, vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eTransfer);
+    }
+    else if (m_postEnabled) {
+        submitFrame(nullptr, vk::PipelineStageFlagBits::eComputeShader);
+    }
+    else {
+        submitFrame();
+    }
+
+    // a capture that can not be written is not worth the session
+    try {
+        if (m_frameCapture.endFrame())
+            m_hud.log("captured " + m_frameCapture.getLastPath() + " ("
+                + std::to_string(m_frameCapture.getStats().commands) + " commands, "
+                + std::to_string(m_frameCapture.getStats().skipped) + " skipped)");
+    }
+    catch (const std::exception& e) {
+        m_hud.log(e.what());
+    }
+}
+
+//-------------------------------------------------------------------------
+// Async post processing, the scene goes out on its own without waiting
+// for the image, the dispatch waits for both
+//
+void VkExample::submitScene(uint32_t imageIndex)
+{
+    const vk::Semaphore sceneDone = m_postProcess.getSceneSemaphore(imageIndex);
+
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_sceneBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &sceneDone;
+
+    // setup work recorded since the last frame goes first on the same queue
+    m_oneShot.flush();
+
+    try {
+        m_graphicsQueue.submit(submitInfo, nullptr);
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to submit scene command buffer!");
+    }
+}
+
+//-------------------------------------------------------------------------
+// Scene pass, post processing into the swapchain image, then the overlay
+// pass on top when the HUD shows. Async post processing records the
+// scene into a command buffer of its own. With occlusion culling the
+// scene is drawn in two passes around the depth pyramid build
+//
+void VkExample::recordFrame(vk::CommandBuffer cmdBuffer, uint32_t imageIndex)
+{
+    const bool asyncPost = m_postEnabled && m_postProcess.isAsync();
+    const vk::CommandBuffer sceneBuffer = asyncPost ? m_framePools.allocate(imageIndex) : cmdBuffer;
+    m_sceneBuffer = asyncPost ? sceneBuffer : vk::CommandBuffer();
+
+    try {
+        cmdBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+        if (asyncPost)
+            sceneBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+
+    m_gpuProfiler.beginFrame(sceneBuffer, imageIndex);
+    m_commandState.begin(sceneBuffer);
+
+    m_gpuProfiler.beginSection(sceneBuffer, "Light clusters");
+    m_clusteredLighting.record(sceneBuffer, imageIndex);
+    m_gpuProfiler.endSection(sceneBuffer);
+
+    if (m_occlusionActive) {
+        m_gpuProfiler.beginSection(sceneBuffer, "Occlusion early");
+        m_occlusionCuller.recordEarly(sceneBuffer, imageIndex);
+        m_gpuProfiler.endSection(sceneBuffer);
+    }
+
+    std::array<vk::ClearValue, 2> clearValues;
+    clearValues[0].color = vk::ClearColorValue(std::array<float, 4>{ 0.1f, 0.1f, 0.1f, 1.f });
+    clearValues[1].depthStencil = vk::ClearDepthStencilValue(1.f, 0);
+
+    vk::RenderPassBeginInfo beginInfo = {};
+    beginInfo.renderPass = m_postEnabled ? m_postProcess.getRenderPass() : m_renderPass;
+    beginInfo.framebuffer = m_postEnabled ? m_postProcess.getFramebuffer(imageIndex) : m_framebuffers[imageIndex];
+    beginInfo.renderArea = vk::Rect2D({ 0, 0 }, m_size);
+    beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    beginInfo.pClearValues = clearValues.data();
+
+    // the overlay draws through ImGui's own pipelines, the post process and
+    // culling dispatches bypass the command state, none of them is captured
+    if (m_frameCapture.isCapturing()) {
+        const vk::Image colorImage = m_postEnabled ? m_postProcess.getTarget(imageIndex)
+                                                   : m_swapchain.getImage(imageIndex);
+        m_frameCapture.declareImage(colorImage, m_size, m_postEnabled ? m_postProcess.getTargetFormat() : m_colorFormat,
+            vk::ImageUsageFlagBits::eColorAttachment);
+        m_frameCapture.declareImage(m_depthImage, m_depthExtent, m_depthFormat,
+            vk::ImageUsageFlagBits::eDepthStencilAttachment);
+        m_frameCapture.beginPass({ colorImage }, m_depthImage, vk::AttachmentLoadOp::eClear, beginInfo.renderArea);
+    }
+
+    m_gpuProfiler.beginSection(sceneBuffer, "Scene");
+    sceneBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
+    m_commandState.setViewport(vk::Viewport(0.f, 0.f, static_cast<float>(m_size.width),
+        static_cast<float>(m_size.height), 0.f, 1.f));
+    m_commandState.setScissor(beginInfo.renderArea);
+    sceneBuffer.endRenderPass();
+    m_gpuProfiler.endSection(sceneBuffer);
+    m_frameCapture.endPass();
+
+    // Instances rejected early against last frame's pyramid, tested again
+    // against this frame's and drawn on top of the first pass
+    if (m_occlusionActive) {
+        m_gpuProfiler.beginSection(sceneBuffer, "Occlusion late");
+        m_occlusionCuller.recordLate(sceneBuffer, imageIndex);
+        m_gpuProfiler.endSection(sceneBuffer);
+
+        beginInfo.renderPass = m_postEnabled ? m_postProcess.getRenderPassLoad() : m_renderPassLoad;
+        beginInfo.clearValueCount = 0;
+        beginInfo.pClearValues = nullptr;
+
+        if (m_frameCapture.isCapturing()) {
+            const vk::Image colorImage = m_postEnabled ? m_postProcess.getTarget(imageIndex)
+                                                       : m_swapchain.getImage(imageIndex);
+            m_frameCapture.beginPass({ colorImage }, m_depthImage, vk::AttachmentLoadOp::eLoad, beginInfo.renderArea);
+        }
+
+        m_gpuProfiler.beginSection(sceneBuffer, "Scene late");
+        sceneBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
+        m_commandState.setViewport(vk::Viewport(0.f, 0.f, static_cast<float>(m_size.width),
+            static_cast<float>(m_size.height), 0.f, 1.f));
+        m_commandState.setScissor(beginInfo.renderArea);
+        sceneBuffer.endRenderPass();
+        m_gpuProfiler.endSection(sceneBuffer);
+        m_frameCapture.endPass();
+    }
+
+    // async dispatches are on the compute queue, outside the profiler
+    if (asyncPost) {
+        try {
+            sceneBuffer.end();
+        }
+        catch (vk::SystemError err) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+    }
+    else if (m_postEnabled) {
+        m_gpuProfiler.beginSection(cmdBuffer, "Post");
+        m_postProcess.record(cmdBuffer, imageIndex);
+        m_gpuProfiler.endSection(cmdBuffer);
+    }
+
+    if (m_overlay.isFrameReady()) {
+        m_gpuProfiler.beginSection(cmdBuffer, "Overlay");
+        m_overlay.render(cmdBuffer, imageIndex);
+        m_commandState.invalidate();
+        m_gpuProfiler.endSection(cmdBuffer);
+    }
+
+    // after the overlay, the recording shows what was presented
+    m_readback.record(cmdBuffer, imageIndex, m_swapchain.getImage(imageIndex), vk::ImageLayout::ePresentSrcKHR,
+        { m_swapchain.getWidth(), m_swapchain.getHeight() }, m_swapchain.getFormat());
+
+    try {
+        cmdBuffer.end();
+    }
+    catch (vk::SystemError err) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+}
+
+//-------------------------------------------------------------------------
+// Start or stop recording presented frames, frames still in flight are
+// written before the file closes
+//
+void VkExample::toggleRecording()
+{
+    if (m_readback.isRecording()) {
+        m_readback.setSink(nullptr);
+
+        const core::FrameReadback::Stats stats = m_readback.getStats();
+        m_hud.log("recording stopped, " + std::to_string(stats.recorded) + " frames recorded, "
+            + std::to_string(stats.dropped) + " dropped");
+        return;
+    }
+
+    if (!(m_swapchain.getImageUsage() & vk::ImageUsageFlagBits::eTransferSrc)) {
+        m_hud.log("recording unavailable, swapchain images can not be copied");
+        return;
+    }
+
+    const std::string path = "recording_" + std::to_string(m_cpuProfiler.getFrameIndex()) + ".raw";
+    const vk::Extent2D extent = { m_swapchain.getWidth(), m_swapchain.getHeight() };
+    try {
+        m_readback.setSink(core::rawFileSink(path, extent, m_swapchain.getFormat()));
+        m_hud.log("recording " + std::to_string(extent.width) + "x" + std::to_string(extent.height) + " "
+            + vk::to_string(m_swapchain.getFormat()) + " raw frames to " + path);
+    }
+    catch (const std::exception& e) {
+        m_hud.log(e.what());
+    }
+}
+
+//-------------------------------------------------------------------------
+// Collect HUD numbers, only while it shows
+//
+void VkExample::gatherHudStats()
+{
+    m_hudStats.clear();
+
+    for (const auto& section : m_gpuProfiler.getSections())
+        m_hudStats.gpuTimings.push_back({ section.name, section.ms, section.avgMs, section.depth });
+    m_hudStats.gpuFrameMs = m_gpuProfiler.getFrameMs();
+
+    // Driver budget and usage, or client estimates without VK_EXT_memory_budget
+    for (const auto& heap : m_memoryGovernor.getHeaps())
+        m_hudStats.heaps.push_back({ heap.size, heap.usage, heap.budget, heap.deviceLocal });
+
+    const core::DeviceAllocator::Stats blocks = m_deviceAllocator.getStats();
+    const core::DeviceAllocator::DefragReport& defrag = m_deviceAllocator.getDefragReport();
+    m_hudStats.blockCount = blocks.blockCount;
+    m_hudStats.blockBytes = blocks.reservedBytes;
+    m_hudStats.blockUsage = blocks.usedBytes;
+    m_hudStats.fragmentation = blocks.fragmentation;
+    m_hudStats.defragBefore = defrag.before.fragmentation;
+    m_hudStats.defragAfter = defrag.after.fragmentation;
+    m_hudStats.defragMoved = defrag.movedBytes;
+
+    for (const auto& draw : m_lodSelector.getDraws()) {
+        m_hudStats.drawCount++;
+        m_hudStats.triangleCount += static_cast<uint64_t>(draw.indexCount / 3) * draw.instanceCount;
+    }
+    m_hudStats.instanceCount = m_lodSelector.getInstanceCount();
+    m_hudStats.visibleCount = m_lodSelector.getVisibleCount();
+
+    for (const auto& type : VkObjects.getTypeStats())
+        m_hudStats.objects.push_back({ core::ObjectRegistry::typeName(type.type), type.live, type.created, type.bytes });
+}
+
+//-------------------------------------------------------------------------
+// Called on window resize, once a burst of events has settled
 //
 void VkExample::onWindowResize(uint32_t width, uint32_t height)
 {
+    const uint32_t imageCount = m_swapchain.getImageCount();
+
+    core::VkBackend::onWindowResize(width, height);
+
+    // idle after the rebuild, image indices may not come back
+    m_readback.flush();
+
+    // per frame rings are indexed by image, they follow a new image count
+    if (m_swapchain.getImageCount() != imageCount) {
+        const uint32_t frameCount = m_swapchain.getImageCount();
+
+        m_clusteredLighting.destroy();
+        m_clusteredLighting.init(m_device, m_physicalDevice, m_shaderLibrary, m_pipelineVariants, frameCount);
+
+        if (m_occlusionEnabled) {
+            m_occlusionCuller.destroy();
+            m_occlusionCuller.init(m_device, m_physicalDevice, m_deviceAllocator, m_shaderLibrary, m_pipelineVariants,
+                frameCount);
+        }
+
+        m_gpuProfiler.destroy();
+        m_gpuProfiler.init(m_device, m_physicalDevice, m_graphicsQueueIdx, frameCount);
+
+        // secondaries and ImGui buffers of frames in flight
+        m_overlay.setImageCount(frameCount, m_oneShot);
+
+        m_deviceAllocator.setFramesInFlight(frameCount);
+        m_textureStreamer.setFramesInFlight(frameCount);
+        m_memoryGovernor.setFramesInFlight(frameCount);
+    }
+
+    // a minimized window keeps the swapchain and its targets
+    if (m_postEnabled && width > 0 && height > 0)
+        m_postProcess.createTargets(m_swapchain, m_depthView);
+
+    // the depth buffer may be new, last frame's pyramid no longer fits
+    if (m_occlusionEnabled && width > 0 && height > 0)
+        m_occlusionCuller.createTargets(m_depthImage, m_depthFormat, m_size);
+
+    // overlay targets the swapchain images directly
+    m_overlay.createFramebuffers(m_swapchain);
+    CameraView.setWindowSize(m_size.width, m_size.height);
 }
 
 } // namespace app
\ No newline at end of file
@@ -10,8 +10,26 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "core/clustered_lighting.hpp"
+#include "core/command_state.hpp"
+#include "core/device_allocator.hpp"
+#include "core/frame_capture.hpp"
+#include "core/frame_readback.hpp"
+#include "core/geometry_pool.hpp"
+#include "core/gpu_profiler.hpp"
+#include "core/imgui_overlay.hpp"
+#include "core/memory_governor.hpp"
+#include "core/occlusion_culler.hpp"
+#include "core/pipeline_variants.hpp"
+#include "core/post_process.hpp"
+#include "core/shader_library.hpp"
+#include "core/texture_streamer.hpp"
 #include "core/vk_backend.hpp"
 #include "helper/camera.hpp"
+#include "helper/mesh.hpp"
+#include "helper/mesh_lod.hpp"
+#include "helper/perf_hud.hpp"
+#include "helper/profiler.hpp"
 
 namespace vkb {
 
@@ -28,11 +46,82 @@ public:
     virtual ~VkExample() = default;
 
     virtual void setupVulkan(const core::ContextCreateInfo& info, GLFWwindow* window) override;
+
+    virtual void destroy() override;
+
+    // Frame, in order
+    void beginFrame();
+
+    void update();
+
+    void drawUI();
+
+    void render();
+
+    void submit();
         
     virtual void onWindowResize(uint32_t width, uint32_t height) override;
     
 protected:
 
+    void optimizeMeshes();
+
+    void uploadMeshes();
+
+    void recordFrame(vk::CommandBuffer cmdBuffer, uint32_t imageIndex);
+
+    // Async post processing, scene submit ahead of the dispatch
+    void submitScene(uint32_t imageIndex);
+
+    void gatherHudStats();
+
+    void toggleRecording();
+
+    GLFWwindow*              m_window{ nullptr };
+
+    core::ShaderLibrary      m_shaderLibrary;
+    core::PipelineVariants   m_pipelineVariants;
+    core::CommandState       m_commandState;
+    core::DeviceAllocator    m_deviceAllocator;
+    core::GeometryPool       m_geometryPool;
+    core::TextureStreamer    m_textureStreamer;
+    core::MemoryGovernor     m_memoryGovernor;
+
+    // Compute post processing into the swapchain images, the scene goes
+    // to an HDR target. Off without storage image support
+    core::PostProcess        m_postProcess;
+    bool                     m_postEnabled{ false };
+    vk::CommandBuffer        m_sceneBuffer;           // async only, this frame's scene
+
+    // Lights binned into view space clusters before the scene pass
+    core::ClusteredLighting  m_clusteredLighting;
+    std::vector<gpu::GpuLight> m_lights;
+
+    // Hi-Z occlusion culling of the selected instances, the scene pass is
+    // split around the pyramid build. Off without a sampled depth buffer
+    core::OcclusionCuller    m_occlusionCuller;
+    bool                     m_occlusionEnabled{ false };
+    bool                     m_occlusionActive{ false };  // this frame's candidates fit
+
+    std::vector<tools::Mesh> m_meshes;
+    tools::LodSelector       m_lodSelector;
+
+    // Performance HUD, F1 toggles
+    core::ImGuiOverlay       m_overlay;
+    core::GpuProfiler        m_gpuProfiler;
+    tools::CpuProfiler       m_cpuProfiler;
+    tools::PerfHud           m_hud;
+    tools::HudStats          m_hudStats;
+    bool                     m_hudKeyDown{ false };
+
+    // Frame capture, F12 writes the next frame for replay
+    core::FrameCapture       m_frameCapture;
+    bool                     m_captureKeyDown{ false };
+
+    // Frame recording, F11 toggles presented frames to a raw file
+    core::FrameReadback      m_readback;
+    bool                     m_recordKeyDown{ false };
+
 }; // Class VkExample
 
 }  // namespace app
\ No newline at end of file
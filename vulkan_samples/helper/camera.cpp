@@ -6,6 +6,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "camera.hpp"
 
 namespace tools {
@@ -40,6 +42,7 @@ inline float sign(float s)
 Camera::Camera()
 {
     update();
+    updateProjection();
 }
 
 //-------------------------------------------------------------------------
@@ -53,6 +56,8 @@ void Camera::update()
         glm::mat4 rotate = glm::rotate(m_roll, glm::vec3(0.f, 0.f, 1.f));
         m_matrix = m_matrix * rotate;
     }
+
+    updateFrustum();
 }
 
 //-------------------------------------------------------------------------
@@ -92,6 +97,118 @@ void Camera::setWindowSize(uint32_t w, uint32_t h)
 {
     m_width = w;
     m_height = h;
+    updateProjection();
+}
+
+//-------------------------------------------------------------------------
+// Retreive window size last set on the camera
+//
+void Camera::getWindowSize(uint32_t& w, uint32_t& h) const
+{
+    w = m_width;
+    h = m_height;
+}
+
+//-------------------------------------------------------------------------
+// Set vertical field of view in degrees
+//
+void Camera::setFov(float fov)
+{
+    m_fov = fov;
+    updateProjection();
+}
+
+//-------------------------------------------------------------------------
+// Set near and far clipping planes
+//
+void Camera::setClipPlanes(float nearPlane, float farPlane)
+{
+    m_near = nearPlane;
+    m_far = farPlane;
+    updateProjection();
+}
+
+//-------------------------------------------------------------------------
+// Retreive projection matrix of camera
+//
+const glm::mat4& Camera::getProjectionMatrix() const
+{
+    return m_projection;
+}
+
+//-------------------------------------------------------------------------
+// Projected diameter in pixels of a world space sphere
+// - returns the window height when the camera is inside the sphere
+//
+float Camera::getProjectedSize(const glm::vec3& center, float radius) const
+{
+    const float dist2 = glm::dot(center - m_pos, center - m_pos);
+    const float r2 = radius * radius;
+    if (dist2 <= r2)
+        return static_cast<float>(m_height);
+
+    const float cotHalfFov = 1.f / tanf(glm::radians(m_fov) * 0.5f);
+    const float size = radius / sqrtf(dist2 - r2) * cotHalfFov * static_cast<float>(m_height);
+
+    return std::min(size, static_cast<float>(m_height));
+}
+
+//-------------------------------------------------------------------------
+// update projection matrix, Vulkan clip space has Y pointing down
+//
+void Camera::updateProjection()
+{
+    const float aspect = static_cast<float>(m_width) / static_cast<float>(std::max(m_height, 1u));
+    m_projection = glm::perspective(glm::radians(m_fov), aspect, m_near, m_far);
+    m_projection[1][1] *= -1.f;
+
+    updateFrustum();
+}
+
+//-------------------------------------------------------------------------
+// Extract frustum planes from the view projection matrix, depth is 0..1
+//
+void Camera::updateFrustum()
+{
+    const glm::mat4 m = m_projection * m_matrix;
+
+    for (int i = 0; i < 4; i++) {
+        m_frustum[0][i] = m[i][3] + m[i][0]; // left
+        m_frustum[1][i] = m[i][3] - m[i][0]; // right
+        m_frustum[2][i] = m[i][3] + m[i][1]; // bottom
+        m_frustum[3][i] = m[i][3] - m[i][1]; // top
+        m_frustum[4][i] = m[i][2];           // near
+        m_frustum[5][i] = m[i][3] - m[i][2]; // far
+    }
+
+    for (auto& plane : m_frustum) {
+        const float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        plane = plane / length;
+    }
+}
+
+//-------------------------------------------------------------------------
+// Retreive world space frustum planes
+//
+void Camera::getFrustumPlanes(glm::vec4 planes[6]) const
+{
+    for (int i = 0; i < 6; i++)
+        planes[i] = m_frustum[i];
+}
+
+//-------------------------------------------------------------------------
+// Scalar layout camera block
+//
+void Camera::getGpuCamera(gpu::GpuCamera& camera) const
+{
+    camera.view = m_matrix;
+    camera.proj = m_projection;
+    camera.viewProj = m_projection * m_matrix;
+    getFrustumPlanes(camera.frustumPlanes);
+    camera.position = m_pos;
+    camera.nearPlane = m_near;
+    camera.viewportSize = glm::vec2(static_cast<float>(m_width), static_cast<float>(m_height));
+    camera.farPlane = m_far;
 }
 
 
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "../common/glm_common.h"
+#include "../common/gpu_structs.h"
 
 namespace tools {
 
@@ -37,8 +38,23 @@ public:
 
     const glm::mat4& getMatrix() const;
 
+    const glm::mat4& getProjectionMatrix() const;
+
     void setWindowSize(uint32_t w, uint32_t h);
 
+    void getWindowSize(uint32_t& w, uint32_t& h) const;
+
+    void setFov(float fov);
+
+    void setClipPlanes(float nearPlane, float farPlane);
+
+    float getProjectedSize(const glm::vec3& center, float radius) const;
+
+    void getFrustumPlanes(glm::vec4 planes[6]) const;
+
+    // Matrices, planes and viewport for shaders, frameIndex and lightCount are left as is
+    void getGpuCamera(gpu::GpuCamera& camera) const;
+
 private:
     // Camera Position
     glm::vec3 m_pos    = glm::vec3(1.f, 1.f, 1.f);
@@ -47,10 +63,23 @@ private:
     glm::mat4 m_matrix = glm::mat4(1.f);
     float     m_roll   = 0.f; // Rotation around Z axis
 
+    // Projection
+    glm::mat4 m_projection = glm::mat4(1.f);
+    float     m_fov        = 60.f; // Vertical, in degrees
+    float     m_near       = 0.1f;
+    float     m_far        = 1000.f;
+
     // Screen 
     uint32_t m_width  = 1;
     uint32_t m_height = 1;
 
+    // World space frustum planes, xyz inward normal, w distance
+    glm::vec4 m_frustum[6];
+
+    void updateProjection();
+
+    void updateFrustum();
+
 }; // ! class Camera
 
 } // ! namespace tools
@@ -0,0 +1,81 @@
+/*
+ *
+ * Andrew Frost
+ * mesh.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "../common/glm_common.h"
+
+namespace tools {
+
+///////////////////////////////////////////////////////////////////////////
+// Vertex                                                                //
+///////////////////////////////////////////////////////////////////////////
+
+struct Vertex
+{
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Meshlet                                                               //
+///////////////////////////////////////////////////////////////////////////
+// Small cluster of triangles with local vertex indices                 //
+// - bounding sphere for frustum / occlusion culling                     //
+// - normal cone for backface culling of the whole cluster               //
+///////////////////////////////////////////////////////////////////////////
+
+struct Meshlet
+{
+    uint32_t  vertexOffset{ 0 };   // into Mesh::meshletVertices
+    uint32_t  triangleOffset{ 0 }; // into Mesh::meshletTriangles, 3 bytes per triangle
+    uint32_t  vertexCount{ 0 };
+    uint32_t  triangleCount{ 0 };
+
+    glm::vec3 center;
+    float     radius{ 0.f };
+
+    // cluster is backfacing if dot(normalize(coneApex - eye), coneAxis) >= coneCutoff
+    glm::vec3 coneApex;
+    glm::vec3 coneAxis;
+    float     coneCutoff{ 1.f };
+};
+
+///////////////////////////////////////////////////////////////////////////
+// MeshLod                                                               //
+///////////////////////////////////////////////////////////////////////////
+// Range of Mesh::indices, every LOD shares the vertex buffer           //
+///////////////////////////////////////////////////////////////////////////
+
+struct MeshLod
+{
+    uint32_t indexOffset{ 0 };
+    uint32_t indexCount{ 0 };
+    float    error{ 0.f };        // object space deviation from LOD 0
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Mesh                                                                  //
+///////////////////////////////////////////////////////////////////////////
+
+struct Mesh
+{
+    std::vector<Vertex>   vertices;
+    std::vector<uint32_t> indices;
+
+    std::vector<MeshLod>  lods;             // empty, or lods[0] is the full mesh
+
+    std::vector<Meshlet>  meshlets;
+    std::vector<uint32_t> meshletVertices;  // indices into vertices
+    std::vector<uint8_t>  meshletTriangles; // indices into meshlet vertices
+};
+
+} // ! namespace tools
\ No newline at end of file
@@ -0,0 +1,492 @@
+/*
+ *
+ * Andrew Frost
+ * mesh_lod.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "mesh_lod.hpp"
+#include "mesh_optimizer.hpp"
+
+namespace tools {
+
+//-------------------------------------------------------------------------
+// Symmetric 4x4 plane quadric, accumulated with area weights
+//
+struct Quadric
+{
+    double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2, w;
+};
+
+static void quadricAdd(Quadric& q, const Quadric& o)
+{
+    q.a2 += o.a2; q.b2 += o.b2; q.c2 += o.c2;
+    q.ab += o.ab; q.ac += o.ac; q.bc += o.bc;
+    q.ad += o.ad; q.bd += o.bd; q.cd += o.cd;
+    q.d2 += o.d2; q.w += o.w;
+}
+
+static Quadric quadricFromTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+    glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+    const double area = glm::length(n);
+    if (area > 0.0)
+        n /= static_cast<float>(area);
+
+    const double a = n.x, b = n.y, c = n.z;
+    const double d = -glm::dot(n, p0);
+
+    Quadric q;
+    q.a2 = a * a * area; q.b2 = b * b * area; q.c2 = c * c * area;
+    q.ab = a * b * area; q.ac = a * c * area; q.bc = b * c * area;
+    q.ad = a * d * area; q.bd = b * d * area; q.cd = c * d * area;
+    q.d2 = d * d * area; q.w = area;
+    return q;
+}
+
+// Area weighted mean squared distance to the accumulated planes
+static double quadricError(const Quadric& q, const glm::vec3& p)
+{
+    const double x = p.x, y = p.y, z = p.z;
+    const double r = q.a2 * x * x + q.b2 * y * y + q.c2 * z * z
+        + 2.0 * (q.ab * x * y + q.ac * x * z + q.bc * y * z)
+        + 2.0 * (q.ad * x + q.bd * y + q.cd * z) + q.d2;
+    return fabs(r) / std::max(q.w, 1e-12);
+}
+
+//-------------------------------------------------------------------------
+// Position key, vertices sharing a position form one topological vertex
+//
+struct PositionKey
+{
+    uint32_t x, y, z;
+    bool operator==(const PositionKey& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+struct PositionHash
+{
+    size_t operator()(const PositionKey& k) const
+    {
+        return (k.x * 73856093u) ^ (k.y * 19349663u) ^ (k.z * 83492791u);
+    }
+};
+
+static uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+    return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// LOD Generation                                                        //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Edge collapse simplification, in passes
+// - every edge is costed, cheapest collapses are applied first
+// - an endpoint takes part in at most one collapse per pass
+// - collapses that flip a triangle are rejected
+//
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+    size_t targetIndexCount, float targetError, float* resultError)
+{
+    std::vector<uint32_t> result = indices;
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+    // topological vertex of every vertex, and wedge count for seams
+    std::vector<uint32_t> canonical(vertexCount);
+    std::vector<uint32_t> wedges(vertexCount, 0);
+    {
+        std::unordered_map<PositionKey, uint32_t, PositionHash> positions;
+        positions.reserve(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            PositionKey key;
+            memcpy(&key, &vertices[v].pos, sizeof(key));
+            canonical[v] = positions.emplace(key, v).first->second;
+        }
+        std::vector<bool> used(vertexCount, false);
+        for (uint32_t index : indices)
+            used[index] = true;
+        for (uint32_t v = 0; v < vertexCount; v++)
+            if (used[v])
+                wedges[canonical[v]]++;
+    }
+
+    // lock attribute seams and open borders
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::unordered_map<uint64_t, uint32_t> directed;
+        for (size_t t = 0; t + 2 < result.size(); t += 3) {
+            for (uint32_t k = 0; k < 3; k++) {
+                const uint32_t a = canonical[result[t + k]];
+                const uint32_t b = canonical[result[t + (k + 1) % 3]];
+                directed[(static_cast<uint64_t>(a) << 32) | b]++;
+            }
+        }
+        for (const auto& edge : directed) {
+            const uint32_t a = static_cast<uint32_t>(edge.first >> 32);
+            const uint32_t b = static_cast<uint32_t>(edge.first & 0xffffffff);
+            if (directed.find((static_cast<uint64_t>(b) << 32) | a) == directed.end())
+                locked[a] = locked[b] = true;
+        }
+        for (uint32_t v = 0; v < vertexCount; v++)
+            if (wedges[v] > 1)
+                locked[v] = true;
+    }
+
+    // quadrics
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (size_t t = 0; t + 2 < result.size(); t += 3) {
+        const uint32_t a = canonical[result[t]];
+        const uint32_t b = canonical[result[t + 1]];
+        const uint32_t c = canonical[result[t + 2]];
+        const Quadric q = quadricFromTriangle(vertices[a].pos, vertices[b].pos, vertices[c].pos);
+        quadricAdd(quadrics[a], q);
+        quadricAdd(quadrics[b], q);
+        quadricAdd(quadrics[c], q);
+    }
+
+    struct Collapse
+    {
+        uint32_t src;   // vertex removed
+        uint32_t dst;   // vertex it collapses onto, wedge on the source side
+        double   error;
+    };
+
+    const double maxError = static_cast<double>(targetError) * targetError;
+    double       worstError = 0.0;
+
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool>     touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+
+    while (result.size() > targetIndexCount) {
+        // candidate collapses, one per edge
+        collapses.clear();
+        std::unordered_map<uint64_t, bool> seen;
+        seen.reserve(result.size());
+        for (size_t t = 0; t + 2 < result.size(); t += 3) {
+            for (uint32_t k = 0; k < 3; k++) {
+                const uint32_t va = result[t + k];
+                const uint32_t vb = result[t + (k + 1) % 3];
+                const uint32_t a = canonical[va];
+                const uint32_t b = canonical[vb];
+                if (!seen.emplace(edgeKey(a, b), true).second)
+                    continue;
+
+                Quadric q = quadrics[a];
+                quadricAdd(q, quadrics[b]);
+
+                const double costAB = locked[a] ? DBL_MAX : quadricError(q, vertices[b].pos);
+                const double costBA = locked[b] ? DBL_MAX : quadricError(q, vertices[a].pos);
+                if (costAB == DBL_MAX && costBA == DBL_MAX)
+                    continue;
+
+                if (costAB <= costBA)
+                    collapses.push_back({ va, vb, costAB });
+                else
+                    collapses.push_back({ vb, va, costBA });
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        // triangle adjacency of topological vertices
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : result)
+            adjacencyOffsets[canonical[index] + 1]++;
+        for (uint32_t v = 0; v < vertexCount; v++)
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++)
+                adjacency[fill[canonical[result[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // would moving src onto dst flip any remaining triangle
+        auto flips = [&](uint32_t src, uint32_t dst) {
+            const glm::vec3& target = vertices[dst].pos;
+            for (uint32_t i = adjacencyOffsets[src]; i < adjacencyOffsets[src + 1]; i++) {
+                const uint32_t* tri = &result[adjacency[i] * 3];
+                glm::vec3 p[3];
+                bool shared = false;
+                for (uint32_t k = 0; k < 3; k++) {
+                    const uint32_t c = canonical[tri[k]];
+                    shared |= (c == dst);
+                    p[k] = vertices[c].pos;
+                }
+                if (shared)
+                    continue;
+
+                const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (uint32_t k = 0; k < 3; k++)
+                    if (canonical[tri[k]] == src)
+                        p[k] = target;
+                const glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+                if (glm::dot(before, after) <= 0.f)
+                    return true;
+            }
+            return false;
+        };
+
+        for (uint32_t v = 0; v < vertexCount; v++)
+            remap[v] = v;
+        std::fill(touched.begin(), touched.end(), false);
+
+        // every collapse removes about two triangles
+        const size_t wanted = (result.size() - targetIndexCount) / 6 + 1;
+        size_t applied = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (collapse.error > maxError || applied >= wanted)
+                break;
+
+            const uint32_t src = canonical[collapse.src];
+            const uint32_t dst = canonical[collapse.dst];
+            if (touched[src] || touched[dst] || flips(src, dst))
+                continue;
+
+            touched[src] = touched[dst] = true;
+            remap[collapse.src] = collapse.dst;
+            quadricAdd(quadrics[dst], quadrics[src]);
+            worstError = std::max(worstError, collapse.error);
+            applied++;
+        }
+
+        if (applied == 0)
+            break;
+
+        // apply and drop degenerate triangles
+        size_t write = 0;
+        for (size_t t = 0; t + 2 < result.size(); t += 3) {
+            const uint32_t a = remap[result[t]];
+            const uint32_t b = remap[result[t + 1]];
+            const uint32_t c = remap[result[t + 2]];
+            if (canonical[a] == canonical[b] || canonical[b] == canonical[c] || canonical[a] == canonical[c])
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    if (resultError)
+        *resultError = static_cast<float>(sqrt(worstError));
+
+    return result;
+}
+
+//-------------------------------------------------------------------------
+// Simplify LOD after LOD, each reordered for the vertex cache. Stops
+// once a level no longer removes enough triangles
+//
+void generateLodChain(Mesh& mesh, uint32_t maxLods, float reduction)
+{
+    if (mesh.indices.empty())
+        return;
+
+    if (mesh.lods.empty())
+        mesh.lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.f });
+
+    std::vector<uint32_t> previous(mesh.indices.begin() + mesh.lods.back().indexOffset,
+        mesh.indices.begin() + mesh.lods.back().indexOffset + mesh.lods.back().indexCount);
+
+    while (mesh.lods.size() < maxLods) {
+        const size_t target = static_cast<size_t>(previous.size() / 3 * reduction) * 3;
+
+        float error = 0.f;
+        std::vector<uint32_t> lod = simplifyMesh(mesh.vertices, previous, target, FLT_MAX, &error);
+        if (lod.empty() || lod.size() > previous.size() * 0.9f)
+            break;
+
+        optimizeVertexCache(lod, static_cast<uint32_t>(mesh.vertices.size()));
+
+        MeshLod meshLod = {};
+        meshLod.indexOffset = static_cast<uint32_t>(mesh.indices.size());
+        meshLod.indexCount = static_cast<uint32_t>(lod.size());
+        meshLod.error = mesh.lods.back().error + error;
+
+        mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+        mesh.lods.push_back(meshLod);
+
+        previous.swap(lod);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// LodSelector                                                           //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Remove all meshes and instances
+//
+void LodSelector::clear()
+{
+    m_meshes.clear();
+    m_lods.clear();
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_radius.clear();
+    m_meshID.clear();
+    m_draws.clear();
+    m_instanceIndices.clear();
+}
+
+//-------------------------------------------------------------------------
+// Register the LODs of a mesh, meshes without LODs draw all indices
+//
+uint32_t LodSelector::addMesh(const Mesh& mesh, uint32_t firstIndex, int32_t vertexOffset)
+{
+    MeshEntry entry = {};
+    entry.firstIndex = firstIndex;
+    entry.vertexOffset = vertexOffset;
+    entry.lodOffset = static_cast<uint32_t>(m_lods.size());
+
+    if (mesh.lods.empty())
+        m_lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.f });
+    else
+        m_lods.insert(m_lods.end(), mesh.lods.begin(), mesh.lods.end());
+
+    entry.lodCount = static_cast<uint32_t>(m_lods.size()) - entry.lodOffset;
+    m_meshes.push_back(entry);
+
+    return static_cast<uint32_t>(m_meshes.size() - 1);
+}
+
+//-------------------------------------------------------------------------
+// Add an instance with its world space bounding sphere
+//
+uint32_t LodSelector::addInstance(uint32_t meshID, const glm::vec3& center, float radius)
+{
+    m_centerX.push_back(center.x);
+    m_centerY.push_back(center.y);
+    m_centerZ.push_back(center.z);
+    m_radius.push_back(radius);
+    m_meshID.push_back(meshID);
+
+    return static_cast<uint32_t>(m_meshID.size() - 1);
+}
+
+//-------------------------------------------------------------------------
+// Update bounds of a moving instance
+//
+void LodSelector::setInstanceBounds(uint32_t instanceID, const glm::vec3& center, float radius)
+{
+    m_centerX[instanceID] = center.x;
+    m_centerY[instanceID] = center.y;
+    m_centerZ[instanceID] = center.z;
+    m_radius[instanceID] = radius;
+}
+
+//-------------------------------------------------------------------------
+// Cull and select LODs of all instances, then build the draw list
+//
+void LodSelector::select(const Camera& camera)
+{
+    const uint32_t instanceCount = static_cast<uint32_t>(m_meshID.size());
+
+    glm::vec3 eye, center, up;
+    camera.getLookAt(eye, center, up);
+
+    glm::vec4 planes[6];
+    camera.getFrustumPlanes(planes);
+
+    uint32_t width, height;
+    camera.getWindowSize(width, height);
+
+    // error of e at distance d covers e * projScale / d pixels
+    const float projScale = fabsf(camera.getProjectionMatrix()[1][1]) * height * 0.5f;
+    const float errorScale = m_threshold / projScale;
+
+    m_maxError.resize(instanceCount);
+    m_visible.resize(instanceCount);
+
+    // Distance and frustum kernel, branch free over the arrays
+    {
+        const float* cx = m_centerX.data();
+        const float* cy = m_centerY.data();
+        const float* cz = m_centerZ.data();
+        const float* r = m_radius.data();
+        float*       maxError = m_maxError.data();
+        uint32_t*    visible = m_visible.data();
+
+        const float ex = eye.x, ey = eye.y, ez = eye.z;
+        const glm::vec4 p0 = planes[0], p1 = planes[1], p2 = planes[2];
+        const glm::vec4 p3 = planes[3], p4 = planes[4], p5 = planes[5];
+
+        for (uint32_t i = 0; i < instanceCount; i++) {
+            const float dx = cx[i] - ex;
+            const float dy = cy[i] - ey;
+            const float dz = cz[i] - ez;
+            const float dist = sqrtf(dx * dx + dy * dy + dz * dz);
+            maxError[i] = std::max(dist - r[i], 1e-3f) * errorScale;
+
+            const float nr = -r[i];
+            uint32_t inside = (p0.x * cx[i] + p0.y * cy[i] + p0.z * cz[i] + p0.w >= nr);
+            inside &= (p1.x * cx[i] + p1.y * cy[i] + p1.z * cz[i] + p1.w >= nr);
+            inside &= (p2.x * cx[i] + p2.y * cy[i] + p2.z * cz[i] + p2.w >= nr);
+            inside &= (p3.x * cx[i] + p3.y * cy[i] + p3.z * cz[i] + p3.w >= nr);
+            inside &= (p4.x * cx[i] + p4.y * cy[i] + p4.z * cz[i] + p4.w >= nr);
+            inside &= (p5.x * cx[i] + p5.y * cy[i] + p5.z * cz[i] + p5.w >= nr);
+            visible[i] = inside;
+        }
+    }
+
+    // Coarsest LOD within the error, counted per mesh LOD
+    m_drawKey.resize(instanceCount);
+    m_drawCount.assign(m_lods.size() + 1, 0);
+
+    for (uint32_t i = 0; i < instanceCount; i++) {
+        if (!m_visible[i])
+            continue;
+
+        const MeshEntry& mesh = m_meshes[m_meshID[i]];
+        uint32_t lod = mesh.lodCount - 1;
+        while (lod > 0 && m_lods[mesh.lodOffset + lod].error > m_maxError[i])
+            lod--;
+
+        m_drawKey[i] = mesh.lodOffset + lod;
+        m_drawCount[m_drawKey[i] + 1]++;
+    }
+
+    // Draws, firstInstance indexes the compacted instance list
+    m_draws.clear();
+    for (const MeshEntry& mesh : m_meshes) {
+        for (uint32_t lod = 0; lod < mesh.lodCount; lod++) {
+            const uint32_t key = mesh.lodOffset + lod;
+            const uint32_t count = m_drawCount[key + 1];
+            m_drawCount[key + 1] += m_drawCount[key];
+            if (count == 0)
+                continue;
+
+            DrawIndexedIndirect draw = {};
+            draw.indexCount = m_lods[key].indexCount;
+            draw.instanceCount = count;
+            draw.firstIndex = mesh.firstIndex + m_lods[key].indexOffset;
+            draw.vertexOffset = mesh.vertexOffset;
+            draw.firstInstance = m_drawCount[key];
+            m_draws.push_back(draw);
+        }
+    }
+
+    m_instanceIndices.resize(m_drawCount.back());
+    for (uint32_t i = 0; i < instanceCount; i++) {
+        if (m_visible[i])
+            m_instanceIndices[m_drawCount[m_drawKey[i]]++] = i;
+    }
+}
+
+} // ! namespace tools
\ No newline at end of file
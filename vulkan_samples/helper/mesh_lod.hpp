@@ -0,0 +1,123 @@
+/*
+ *
+ * Andrew Frost
+ * mesh_lod.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include "camera.hpp"
+#include "mesh.hpp"
+
+namespace tools {
+
+///////////////////////////////////////////////////////////////////////////
+// LOD Generation                                                        //
+///////////////////////////////////////////////////////////////////////////
+// Quadric error edge collapse, vertices collapse onto an edge endpoint //
+// so attributes are kept. Border and attribute seam vertices are       //
+// locked to avoid cracks                                                //
+///////////////////////////////////////////////////////////////////////////
+
+// Simplify towards targetIndexCount, stops early once an edge would exceed targetError
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+    size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+// Append LODs to mesh.indices, each with about reduction times the triangles of the previous
+void generateLodChain(Mesh& mesh, uint32_t maxLods = 6, float reduction = 0.5f);
+
+///////////////////////////////////////////////////////////////////////////
+// DrawIndexedIndirect                                                   //
+///////////////////////////////////////////////////////////////////////////
+// Same layout as VkDrawIndexedIndirectCommand                          //
+///////////////////////////////////////////////////////////////////////////
+
+struct DrawIndexedIndirect
+{
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t  vertexOffset;
+    uint32_t firstInstance;
+};
+
+static_assert(sizeof(DrawIndexedIndirect) == 20, "must match VkDrawIndexedIndirectCommand");
+
+///////////////////////////////////////////////////////////////////////////
+// LodSelector                                                           //
+///////////////////////////////////////////////////////////////////////////
+// Per frame frustum culling and LOD selection of every instance        //
+// - instances are stored as structure of arrays, the distance and      //
+//   culling kernels are plain loops the compiler vectorizes            //
+// - the coarsest LOD with projected error under the threshold is used //
+// - visible instances are grouped into one indirect draw per mesh LOD, //
+//   instanceIndices maps gl_InstanceIndex to the registered instance   //
+///////////////////////////////////////////////////////////////////////////
+
+class LodSelector
+{
+public:
+    LodSelector() = default;
+    ~LodSelector() = default;
+
+    void clear();
+
+    // firstIndex and vertexOffset locate the mesh in the bound index/vertex buffers
+    uint32_t addMesh(const Mesh& mesh, uint32_t firstIndex, int32_t vertexOffset);
+
+    uint32_t addInstance(uint32_t meshID, const glm::vec3& center, float radius);
+
+    void setInstanceBounds(uint32_t instanceID, const glm::vec3& center, float radius);
+
+    // Maximum projected error in pixels
+    void  setErrorThreshold(float pixels) { m_threshold = pixels; }
+    float getErrorThreshold() const       { return m_threshold; }
+
+    void select(const Camera& camera);
+
+    // Getting Methods
+    const std::vector<DrawIndexedIndirect>& getDraws()           const { return m_draws; }
+    const std::vector<uint32_t>&            getInstanceIndices() const { return m_instanceIndices; }
+    uint32_t                                getVisibleCount()    const { return static_cast<uint32_t>(m_instanceIndices.size()); }
+    uint32_t                                getInstanceCount()   const { return static_cast<uint32_t>(m_meshID.size()); }
+    glm::vec4                               getInstanceBounds(uint32_t instanceID) const
+    {
+        return glm::vec4(m_centerX[instanceID], m_centerY[instanceID], m_centerZ[instanceID], m_radius[instanceID]);
+    }
+
+private:
+
+    struct MeshEntry
+    {
+        uint32_t firstIndex;
+        int32_t  vertexOffset;
+        uint32_t lodOffset;   // into m_lods
+        uint32_t lodCount;
+    };
+
+    std::vector<MeshEntry>           m_meshes;
+    std::vector<MeshLod>             m_lods;
+
+    // Instances, structure of arrays
+    std::vector<float>               m_centerX;
+    std::vector<float>               m_centerY;
+    std::vector<float>               m_centerZ;
+    std::vector<float>               m_radius;
+    std::vector<uint32_t>            m_meshID;
+
+    // Per frame scratch
+    std::vector<float>               m_maxError;
+    std::vector<uint32_t>            m_visible;
+    std::vector<uint32_t>            m_drawKey;
+    std::vector<uint32_t>            m_drawCount;
+
+    std::vector<DrawIndexedIndirect> m_draws;
+    std::vector<uint32_t>            m_instanceIndices;
+
+    float                            m_threshold{ 1.f };
+
+}; // class LodSelector
+
+} // ! namespace tools
\ No newline at end of file
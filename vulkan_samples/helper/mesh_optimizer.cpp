@@ -0,0 +1,449 @@
+/*
+ *
+ * Andrew Frost
+ * mesh_optimizer.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+#include "mesh_optimizer.hpp"
+
+namespace tools {
+
+//-------------------------------------------------------------------------
+// Forsyth scoring, cache size of the simulated LRU
+//
+static const uint32_t kCacheSize = 32;
+
+static float vertexScore(int cachePosition, uint32_t remaining)
+{
+    if (remaining == 0)
+        return -1.f;
+
+    float score = 0.f;
+    if (cachePosition >= 0) {
+        // triangle just emitted, fixed score to avoid the same strip direction
+        if (cachePosition < 3)
+            score = 0.75f;
+        else
+            score = powf(1.f - (cachePosition - 3) / static_cast<float>(kCacheSize - 3), 1.5f);
+    }
+
+    // boost vertices with few remaining triangles, to avoid leaving them behind
+    return score + 2.f * powf(static_cast<float>(remaining), -0.5f);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Mesh Optimizer                                                        //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Reorder triangles for post transform vertex cache efficiency
+// - greedy, emits the best scoring triangle adjacent to the cache
+//
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount)
+{
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount == 0)
+        return;
+
+    // vertex -> triangle adjacency
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t index : indices)
+        remaining[index]++;
+
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (uint32_t t = 0; t < triangleCount; t++)
+            for (uint32_t k = 0; k < 3; k++)
+                adjacency[fill[indices[t * 3 + k]]++] = t;
+    }
+
+    // initial scores
+    std::vector<int>   cachePosition(vertexCount, -1);
+    std::vector<float> vScore(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++)
+        vScore[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<float> tScore(triangleCount);
+    std::vector<bool>  emitted(triangleCount, false);
+    for (uint32_t t = 0; t < triangleCount; t++)
+        tScore[t] = vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] + vScore[indices[t * 3 + 2]];
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(kCacheSize + 3);
+    newCache.reserve(kCacheSize + 3);
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t cursor = 0;
+    int64_t  best = -1;
+
+    while (result.size() < indices.size()) {
+        // nothing adjacent to the cache, restart from the next unemitted triangle
+        if (best < 0) {
+            while (emitted[cursor])
+                cursor++;
+            best = cursor;
+        }
+
+        const uint32_t tri = static_cast<uint32_t>(best);
+        const uint32_t* triIndices = &indices[tri * 3];
+        emitted[tri] = true;
+
+        for (uint32_t k = 0; k < 3; k++) {
+            const uint32_t v = triIndices[k];
+            result.push_back(v);
+
+            // remove triangle from the vertex adjacency
+            uint32_t* begin = &adjacency[offsets[v]];
+            uint32_t* end = begin + remaining[v];
+            uint32_t* it = std::find(begin, end, tri);
+            assert(it != end);
+            std::swap(*it, *(end - 1));
+            remaining[v]--;
+        }
+
+        // new cache, emitted vertices at the front
+        newCache.clear();
+        newCache.insert(newCache.end(), triIndices, triIndices + 3);
+        for (uint32_t v : cache) {
+            if (v != triIndices[0] && v != triIndices[1] && v != triIndices[2])
+                newCache.push_back(v);
+        }
+
+        // vertices pushed out of the cache
+        for (size_t i = kCacheSize; i < newCache.size(); i++)
+            cachePosition[newCache[i]] = -1;
+        if (newCache.size() > kCacheSize)
+            newCache.resize(kCacheSize);
+
+        // update scores of cached vertices and their triangles
+        auto rescore = [&](uint32_t v, int position) {
+            cachePosition[v] = position;
+            const float score = vertexScore(position, remaining[v]);
+            const float delta = score - vScore[v];
+            vScore[v] = score;
+            for (uint32_t i = offsets[v]; i < offsets[v] + remaining[v]; i++)
+                tScore[adjacency[i]] += delta;
+        };
+
+        for (uint32_t v : cache) {
+            if (cachePosition[v] == -1)
+                rescore(v, -1);
+        }
+        for (size_t i = 0; i < newCache.size(); i++)
+            rescore(newCache[i], static_cast<int>(i));
+
+        // best triangle adjacent to the cache
+        best = -1;
+        float bestScore = -1.f;
+        for (uint32_t v : newCache) {
+            for (uint32_t i = offsets[v]; i < offsets[v] + remaining[v]; i++) {
+                const uint32_t t = adjacency[i];
+                if (tScore[t] > bestScore) {
+                    bestScore = tScore[t];
+                    best = t;
+                }
+            }
+        }
+
+        cache.swap(newCache);
+    }
+
+    indices.swap(result);
+}
+
+//-------------------------------------------------------------------------
+// Reorder clusters of triangles to reduce overdraw
+// - clusters start where the FIFO cache misses all three vertices, so
+//   cache efficiency inside a cluster is kept
+// - clusters facing away from the mesh center are drawn first, they are
+//   most likely to occlude the rest
+//
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices)
+{
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount == 0)
+        return;
+
+    const uint32_t fifoSize = 16;
+    std::vector<uint32_t> timestamps(vertices.size(), 0);
+    uint32_t timestamp = fifoSize + 1;
+
+    std::vector<uint32_t> clusterStarts;
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        uint32_t misses = 0;
+        for (uint32_t k = 0; k < 3; k++) {
+            const uint32_t v = indices[t * 3 + k];
+            if (timestamp - timestamps[v] > fifoSize) {
+                timestamps[v] = timestamp++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3)
+            clusterStarts.push_back(t);
+    }
+    clusterStarts.push_back(triangleCount);
+
+    const uint32_t clusterCount = static_cast<uint32_t>(clusterStarts.size() - 1);
+    if (clusterCount < 2)
+        return;
+
+    // area weighted centroids and normals
+    std::vector<glm::vec3> clusterCentroid(clusterCount, glm::vec3(0.f));
+    std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0.f));
+    glm::vec3 meshCentroid(0.f);
+    float     meshArea = 0.f;
+
+    for (uint32_t c = 0; c < clusterCount; c++) {
+        float clusterArea = 0.f;
+        for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].pos;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float area = glm::length(normal);
+            const glm::vec3 centroid = (p0 + p1 + p2) / 3.f;
+
+            clusterCentroid[c] += centroid * area;
+            clusterNormal[c] += normal;
+            clusterArea += area;
+        }
+
+        meshCentroid += clusterCentroid[c];
+        meshArea += clusterArea;
+
+        if (clusterArea > 0.f)
+            clusterCentroid[c] /= clusterArea;
+    }
+    if (meshArea > 0.f)
+        meshCentroid /= meshArea;
+
+    std::vector<float> sortKey(clusterCount);
+    for (uint32_t c = 0; c < clusterCount; c++) {
+        const float length = glm::length(clusterNormal[c]);
+        const glm::vec3 normal = length > 0.f ? clusterNormal[c] / length : glm::vec3(0.f);
+        sortKey[c] = glm::dot(clusterCentroid[c] - meshCentroid, normal);
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return sortKey[a] > sortKey[b];
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (uint32_t c : order) {
+        result.insert(result.end(), indices.begin() + clusterStarts[c] * 3,
+            indices.begin() + clusterStarts[c + 1] * 3);
+    }
+
+    indices.swap(result);
+}
+
+//-------------------------------------------------------------------------
+// Reorder vertices in order of first use, unused vertices are removed
+//
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertices.size(), unused);
+
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = static_cast<uint32_t>(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(result);
+}
+
+//-------------------------------------------------------------------------
+// Sphere and normal cone of a meshlet
+//
+static void computeMeshletBounds(const Mesh& mesh, Meshlet& meshlet)
+{
+    const uint32_t* localVertices = &mesh.meshletVertices[meshlet.vertexOffset];
+    const uint8_t*  localTriangles = &mesh.meshletTriangles[meshlet.triangleOffset];
+
+    // sphere around the bounding box
+    glm::vec3 bbMin(FLT_MAX);
+    glm::vec3 bbMax(-FLT_MAX);
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+        bbMin = glm::min(bbMin, mesh.vertices[localVertices[i]].pos);
+        bbMax = glm::max(bbMax, mesh.vertices[localVertices[i]].pos);
+    }
+    meshlet.center = (bbMin + bbMax) * 0.5f;
+    meshlet.radius = 0.f;
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+        meshlet.radius = std::max(meshlet.radius, glm::distance(meshlet.center, mesh.vertices[localVertices[i]].pos));
+
+    // triangle normals, degenerate triangles are skipped
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> corners;
+    normals.reserve(meshlet.triangleCount);
+    corners.reserve(meshlet.triangleCount);
+
+    glm::vec3 axis(0.f);
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+        const glm::vec3& p0 = mesh.vertices[localVertices[localTriangles[t * 3 + 0]]].pos;
+        const glm::vec3& p1 = mesh.vertices[localVertices[localTriangles[t * 3 + 1]]].pos;
+        const glm::vec3& p2 = mesh.vertices[localVertices[localTriangles[t * 3 + 2]]].pos;
+
+        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const float area = glm::length(normal);
+        if (area == 0.f)
+            continue;
+
+        normals.push_back(normal / area);
+        corners.push_back(p0);
+        axis += normal / area;
+    }
+
+    meshlet.coneApex = meshlet.center;
+    meshlet.coneAxis = glm::vec3(0.f, 0.f, 1.f);
+    meshlet.coneCutoff = 1.f;
+
+    const float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength == 0.f)
+        return;
+    axis /= axisLength;
+
+    float minDot = 1.f;
+    for (const auto& normal : normals)
+        minDot = std::min(minDot, glm::dot(normal, axis));
+
+    // cone wider than a hemisphere, cluster can never be fully backfacing
+    if (minDot <= 0.f)
+        return;
+
+    // apex far enough back along the axis for every triangle plane
+    float maxT = 0.f;
+    for (size_t i = 0; i < normals.size(); i++) {
+        const float dc = glm::dot(meshlet.center - corners[i], normals[i]);
+        const float dn = glm::dot(axis, normals[i]);
+        maxT = std::max(maxT, dc / dn);
+    }
+
+    meshlet.coneApex = meshlet.center - axis * maxT;
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = sqrtf(1.f - minDot * minDot);
+}
+
+//-------------------------------------------------------------------------
+// Split the index buffer into meshlets, in index order so the cache
+// ordering carries over to meshlet locality
+//
+void buildMeshlets(Mesh& mesh, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    assert(maxVertices <= 256 && "meshlet local indices are 8 bit");
+
+    mesh.meshlets.clear();
+    mesh.meshletVertices.clear();
+    mesh.meshletTriangles.clear();
+
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> localIndex(mesh.vertices.size(), unused);
+
+    Meshlet meshlet = {};
+
+    auto flush = [&]() {
+        if (meshlet.triangleCount == 0)
+            return;
+        for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+            localIndex[mesh.meshletVertices[meshlet.vertexOffset + i]] = unused;
+
+        computeMeshletBounds(mesh, meshlet);
+        mesh.meshlets.push_back(meshlet);
+
+        meshlet = {};
+        meshlet.vertexOffset = static_cast<uint32_t>(mesh.meshletVertices.size());
+        meshlet.triangleOffset = static_cast<uint32_t>(mesh.meshletTriangles.size());
+    };
+
+    // meshlets only cover LOD 0
+    const size_t indexCount = mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        const uint32_t a = mesh.indices[t + 0];
+        const uint32_t b = mesh.indices[t + 1];
+        const uint32_t c = mesh.indices[t + 2];
+
+        auto isNew = [&](uint32_t v) { return localIndex[v] == unused; };
+        const uint32_t newVertices = isNew(a) + (isNew(b) && b != a) + (isNew(c) && c != a && c != b);
+
+        if (meshlet.vertexCount + newVertices > maxVertices || meshlet.triangleCount + 1 > maxTriangles)
+            flush();
+
+        for (uint32_t v : { a, b, c }) {
+            if (isNew(v)) {
+                localIndex[v] = meshlet.vertexCount++;
+                mesh.meshletVertices.push_back(v);
+            }
+            mesh.meshletTriangles.push_back(static_cast<uint8_t>(localIndex[v]));
+        }
+        meshlet.triangleCount++;
+    }
+
+    flush();
+}
+
+//-------------------------------------------------------------------------
+// Run every pass, order matters, run before generating LODs
+//
+void optimizeMesh(Mesh& mesh)
+{
+    assert(mesh.lods.empty() && "optimize meshes before generating LODs");
+    if (mesh.indices.empty())
+        return;
+
+    optimizeVertexCache(mesh.indices, static_cast<uint32_t>(mesh.vertices.size()));
+    optimizeOverdraw(mesh.indices, mesh.vertices);
+    optimizeVertexFetch(mesh.vertices, mesh.indices);
+    buildMeshlets(mesh);
+}
+
+//-------------------------------------------------------------------------
+// Average cache miss ratio of a FIFO cache
+//
+float computeACMR(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+    if (indices.empty())
+        return 0.f;
+
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t misses = 0;
+
+    for (uint32_t index : indices) {
+        if (timestamp - timestamps[index] > cacheSize) {
+            timestamps[index] = timestamp++;
+            misses++;
+        }
+    }
+
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+} // ! namespace tools
\ No newline at end of file
@@ -0,0 +1,38 @@
+/*
+ *
+ * Andrew Frost
+ * mesh_optimizer.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include "mesh.hpp"
+
+namespace tools {
+
+///////////////////////////////////////////////////////////////////////////
+// Mesh Optimizer                                                        //
+///////////////////////////////////////////////////////////////////////////
+// Import time passes, run in order by optimizeMesh()                   //
+// - post transform vertex cache ordering (Forsyth)                     //
+// - overdraw ordering of cache clusters, outer facing first            //
+// - vertex fetch ordering, vertices in order of first use              //
+// - meshlet split with bounding spheres and normal cones               //
+///////////////////////////////////////////////////////////////////////////
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices);
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+void buildMeshlets(Mesh& mesh, uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
+
+void optimizeMesh(Mesh& mesh);
+
+// Average cache miss ratio, transformed vertices per triangle with a FIFO cache
+float computeACMR(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+} // ! namespace tools
\ No newline at end of file
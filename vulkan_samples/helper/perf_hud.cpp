@@ -0,0 +1,229 @@
+/*
+ *
+ * Andrew Frost
+ * perf_hud.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+
+#include "perf_hud.hpp"
+
+#include "../external/imgui/imgui.h"
+
+namespace tools {
+
+//-------------------------------------------------------------------------
+// Keep capacity between frames
+//
+void HudStats::clear()
+{
+    gpuTimings.clear();
+    heaps.clear();
+    objects.clear();
+    gpuFrameMs = 0.f;
+    blockCount = 0;
+    blockBytes = 0;
+    blockUsage = 0;
+    fragmentation = 0.f;
+    defragBefore = 0.f;
+    defragAfter = 0.f;
+    defragMoved = 0;
+    drawCount = 0;
+    triangleCount = 0;
+    instanceCount = 0;
+    visibleCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// PerfHud                                                               //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Submit the window
+//
+void PerfHud::draw(const CpuProfiler& cpu, const HudStats& stats)
+{
+    if (!m_visible)
+        return;
+
+    ImGui::SetNextWindowPos(ImVec2(10.f, 10.f), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowBgAlpha(0.7f);
+
+    const ImGuiWindowFlags flags = ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing
+        | ImGuiWindowFlags_NoSavedSettings;
+
+    if (ImGui::Begin("Performance", &m_visible, flags)) {
+        drawFrameTimes(cpu);
+
+        if (ImGui::CollapsingHeader("Timings", ImGuiTreeNodeFlags_DefaultOpen))
+            drawTimings(cpu, stats);
+        if (ImGui::CollapsingHeader("Memory", ImGuiTreeNodeFlags_DefaultOpen))
+            drawMemory(stats);
+        if (ImGui::CollapsingHeader("Scene", ImGuiTreeNodeFlags_DefaultOpen))
+            drawCounters(stats);
+        if (!stats.objects.empty() && ImGui::CollapsingHeader("Objects"))
+            drawObjects(stats);
+        if (!m_messages.empty() && ImGui::CollapsingHeader("Messages", ImGuiTreeNodeFlags_DefaultOpen))
+            drawMessages();
+    }
+    ImGui::End();
+}
+
+//-------------------------------------------------------------------------
+// Keep the last messages, they are shown once the HUD is
+//
+void PerfHud::log(const std::string& message)
+{
+    if (m_messages.size() == MESSAGE_COUNT)
+        m_messages.pop_front();
+    m_messages.push_back(message);
+}
+
+//-------------------------------------------------------------------------
+// Frame time graph and histogram
+//
+void PerfHud::drawFrameTimes(const CpuProfiler& cpu)
+{
+    const float avgMs = cpu.getAverageMs();
+    ImGui::Text("%.2f ms  %.0f fps", avgMs, avgMs > 0.f ? 1000.f / avgMs : 0.f);
+    ImGui::Text("p50 %.2f ms  p99 %.2f ms", cpu.getPercentile(0.5f), cpu.getPercentile(0.99f));
+
+    const uint32_t count = cpu.getHistoryCount();
+    if (count == 0)
+        return;
+
+    const float* history = cpu.getFrameHistory();
+    float maxMs = 0.f;
+    for (uint32_t i = 0; i < count; i++)
+        maxMs = std::max(maxMs, history[i]);
+
+    // the ring is only in order once it has wrapped
+    const int offset = count == CpuProfiler::HISTORY_SIZE ? static_cast<int>(cpu.getHistoryOffset()) : 0;
+    ImGui::PlotLines("##frametime", history, static_cast<int>(count), offset, "frame time",
+        0.f, std::max(maxMs, 2.f * avgMs), ImVec2(300.f, 60.f));
+
+    // Buckets span twice the average frame time
+    m_histogram.fill(0.f);
+    const float bucketMs = std::max(2.f * avgMs, 1.f) / HISTOGRAM_BUCKETS;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t bucket = std::min(static_cast<uint32_t>(history[i] / bucketMs), HISTOGRAM_BUCKETS - 1);
+        m_histogram[bucket] += 1.f;
+    }
+
+    char overlay[32];
+    snprintf(overlay, sizeof(overlay), "0 - %.1f ms", bucketMs * HISTOGRAM_BUCKETS);
+    ImGui::PlotHistogram("##histogram", m_histogram.data(), HISTOGRAM_BUCKETS, 0, overlay,
+        0.f, FLT_MAX, ImVec2(300.f, 60.f));
+}
+
+//-------------------------------------------------------------------------
+// CPU phases and GPU passes
+//
+void PerfHud::drawTimings(const CpuProfiler& cpu, const HudStats& stats)
+{
+    ImGui::Columns(3, "timings", false);
+    ImGui::SetColumnWidth(0, 140.f);
+
+    ImGui::TextDisabled("CPU"); ImGui::NextColumn();
+    ImGui::TextDisabled("ms");  ImGui::NextColumn();
+    ImGui::TextDisabled("avg"); ImGui::NextColumn();
+
+    for (const auto& phase : cpu.getPhases()) {
+        ImGui::TextUnformatted(phase.name); ImGui::NextColumn();
+        ImGui::Text("%.3f", phase.ms);       ImGui::NextColumn();
+        ImGui::Text("%.3f", phase.avgMs);    ImGui::NextColumn();
+    }
+
+    ImGui::Separator();
+    ImGui::TextDisabled("GPU"); ImGui::NextColumn();
+    ImGui::Text("%.3f", stats.gpuFrameMs); ImGui::NextColumn();
+    ImGui::NextColumn();
+
+    for (const auto& timing : stats.gpuTimings) {
+        ImGui::Indent(10.f * (timing.depth + 1));
+        ImGui::TextUnformatted(timing.name);
+        ImGui::Unindent(10.f * (timing.depth + 1));
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", timing.ms);    ImGui::NextColumn();
+        ImGui::Text("%.3f", timing.avgMs); ImGui::NextColumn();
+    }
+
+    ImGui::Columns(1);
+}
+
+//-------------------------------------------------------------------------
+// Memory heaps, usage against budget
+//
+void PerfHud::drawMemory(const HudStats& stats)
+{
+    const float MB = 1.f / (1024.f * 1024.f);
+
+    for (size_t i = 0; i < stats.heaps.size(); i++) {
+        const HudStats::Heap& heap = stats.heaps[i];
+        const uint64_t budget = heap.budget ? heap.budget : heap.size;
+
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%.0f / %.0f MB", heap.usage * MB, budget * MB);
+
+        ImGui::Text("Heap %u %s", static_cast<uint32_t>(i), heap.deviceLocal ? "device" : "host");
+        ImGui::ProgressBar(budget ? static_cast<float>(heap.usage) / budget : 0.f, ImVec2(300.f, 0.f), overlay);
+    }
+
+    if (stats.blockCount) {
+        ImGui::Text("blocks     %u, %.0f / %.0f MB", stats.blockCount, stats.blockUsage * MB, stats.blockBytes * MB);
+        ImGui::Text("fragmented %.0f%%", stats.fragmentation * 100.f);
+        ImGui::Text("defrag     %.0f%% -> %.0f%%, %.1f MB moved", stats.defragBefore * 100.f,
+            stats.defragAfter * 100.f, stats.defragMoved * MB);
+    }
+}
+
+//-------------------------------------------------------------------------
+// Draw and triangle counts
+//
+void PerfHud::drawCounters(const HudStats& stats)
+{
+    ImGui::Text("draws      %u", stats.drawCount);
+    ImGui::Text("triangles  %llu", static_cast<unsigned long long>(stats.triangleCount));
+    ImGui::Text("instances  %u visible of %u", stats.visibleCount, stats.instanceCount);
+}
+
+//-------------------------------------------------------------------------
+// Live objects and bytes per type, created counts show churn
+//
+void PerfHud::drawObjects(const HudStats& stats)
+{
+    const float MB = 1.f / (1024.f * 1024.f);
+
+    ImGui::Columns(4, "objects", false);
+    ImGui::SetColumnWidth(0, 140.f);
+
+    ImGui::TextDisabled("type");    ImGui::NextColumn();
+    ImGui::TextDisabled("live");    ImGui::NextColumn();
+    ImGui::TextDisabled("created"); ImGui::NextColumn();
+    ImGui::TextDisabled("MB");      ImGui::NextColumn();
+
+    for (const auto& objects : stats.objects) {
+        ImGui::TextUnformatted(objects.type);                                      ImGui::NextColumn();
+        ImGui::Text("%u", objects.live);                                           ImGui::NextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(objects.created));     ImGui::NextColumn();
+        if (objects.bytes)
+            ImGui::Text("%.1f", objects.bytes * MB);
+        ImGui::NextColumn();
+    }
+
+    ImGui::Columns(1);
+}
+
+//-------------------------------------------------------------------------
+// Oldest first
+//
+void PerfHud::drawMessages()
+{
+    for (const auto& message : m_messages)
+        ImGui::TextUnformatted(message.c_str());
+}
+
+} // ! namespace tools
\ No newline at end of file
@@ -0,0 +1,118 @@
+/*
+ *
+ * Andrew Frost
+ * perf_hud.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "profiler.hpp"
+
+namespace tools {
+
+///////////////////////////////////////////////////////////////////////////
+// PerfHud                                                               //
+///////////////////////////////////////////////////////////////////////////
+// ImGui performance window                                             //
+// - CPU phases and GPU passes with moving averages                     //
+// - frame time graph and histogram                                     //
+// - memory heaps and draw counters                                     //
+// - live objects per type                                              //
+// - the last status messages of the app, kept while hidden             //
+// The caller skips filling HudStats, and the whole ImGui frame, while  //
+// the HUD is hidden                                                     //
+///////////////////////////////////////////////////////////////////////////
+
+struct HudStats
+{
+    struct Timing
+    {
+        const char* name;
+        float       ms;
+        float       avgMs;
+        uint32_t    depth;
+    };
+
+    struct Heap
+    {
+        uint64_t size;
+        uint64_t usage;
+        uint64_t budget;
+        bool     deviceLocal;
+    };
+
+    // Live Vulkan objects of one type, from the object registry
+    struct Objects
+    {
+        const char* type;
+        uint32_t    live;
+        uint64_t    created;
+        uint64_t    bytes;
+    };
+
+    std::vector<Timing> gpuTimings;
+    float               gpuFrameMs{ 0.f };
+    std::vector<Heap>   heaps;
+
+    // Device allocator blocks, fragmentation before and after the last
+    // defragmentation pass
+    uint32_t            blockCount{ 0 };
+    uint64_t            blockBytes{ 0 };
+    uint64_t            blockUsage{ 0 };
+    float               fragmentation{ 0.f };
+    float               defragBefore{ 0.f };
+    float               defragAfter{ 0.f };
+    uint64_t            defragMoved{ 0 };
+
+    uint32_t            drawCount{ 0 };
+    uint64_t            triangleCount{ 0 };
+    uint32_t            instanceCount{ 0 };
+    uint32_t            visibleCount{ 0 };
+
+    std::vector<Objects> objects;
+
+    void clear();
+};
+
+class PerfHud
+{
+public:
+    static constexpr uint32_t HISTOGRAM_BUCKETS = 40;
+    static constexpr uint32_t MESSAGE_COUNT = 8;
+
+    PerfHud() = default;
+    ~PerfHud() = default;
+
+    void setVisible(bool visible) { m_visible = visible; }
+    void toggle()                 { m_visible = !m_visible; }
+    bool isVisible()        const { return m_visible; }
+
+    // Submit the window, between ImGui::NewFrame and ImGui::Render
+    void draw(const CpuProfiler& cpu, const HudStats& stats);
+
+    // Status line, the oldest is dropped after MESSAGE_COUNT
+    void log(const std::string& message);
+
+private:
+
+    void drawFrameTimes(const CpuProfiler& cpu);
+    void drawTimings(const CpuProfiler& cpu, const HudStats& stats);
+    void drawMemory(const HudStats& stats);
+    void drawCounters(const HudStats& stats);
+    void drawObjects(const HudStats& stats);
+    void drawMessages();
+
+    std::array<float, HISTOGRAM_BUCKETS> m_histogram;
+    std::deque<std::string>              m_messages;
+    bool                                 m_visible{ false };
+
+}; // class PerfHud
+
+} // ! namespace tools
\ No newline at end of file
@@ -0,0 +1,111 @@
+/*
+ *
+ * Andrew Frost
+ * profiler.cpp
+ * 2020
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "profiler.hpp"
+
+namespace tools {
+
+static const float AVERAGE_WEIGHT = 0.05f;
+
+///////////////////////////////////////////////////////////////////////////
+// CpuProfiler                                                           //
+///////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------
+// Constructor
+//
+CpuProfiler::CpuProfiler()
+{
+    m_history.fill(0.f);
+    m_phases.reserve(16);
+    m_stack.reserve(8);
+    m_stackStart.reserve(8);
+    m_frameStart = Clock::now();
+}
+
+//-------------------------------------------------------------------------
+// Close the previous frame and start timing the next
+//
+void CpuProfiler::beginFrame()
+{
+    assert(m_stack.empty() && "phase still open at frame end");
+
+    const Clock::time_point now = Clock::now();
+
+    if (m_frameIndex > 0) {
+        m_frameMs = std::chrono::duration<float, std::milli>(now - m_frameStart).count();
+        m_avgMs = m_frameIndex == 1 ? m_frameMs : m_avgMs + (m_frameMs - m_avgMs) * AVERAGE_WEIGHT;
+
+        m_history[m_historyOffset] = m_frameMs;
+        m_historyOffset = (m_historyOffset + 1) % HISTORY_SIZE;
+        m_historyCount = std::min(m_historyCount + 1, HISTORY_SIZE);
+
+        for (auto& phase : m_phases) {
+            phase.ms = static_cast<float>(phase.accumMs);
+            phase.avgMs += (phase.ms - phase.avgMs) * AVERAGE_WEIGHT;
+            phase.accumMs = 0.0;
+        }
+    }
+
+    m_frameStart = now;
+    m_frameIndex++;
+}
+
+//-------------------------------------------------------------------------
+// Start a named phase, may nest
+//
+void CpuProfiler::beginPhase(const char* name)
+{
+    uint32_t index = 0;
+    while (index < m_phases.size() && m_phases[index].name != name)
+        index++;
+
+    if (index == m_phases.size()) {
+        Phase phase;
+        phase.name = name;
+        m_phases.push_back(phase);
+    }
+
+    m_stack.push_back(index);
+    m_stackStart.push_back(Clock::now());
+}
+
+//-------------------------------------------------------------------------
+// End the innermost phase
+//
+void CpuProfiler::endPhase()
+{
+    assert(!m_stack.empty() && "endPhase without beginPhase");
+
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - m_stackStart.back()).count();
+    m_phases[m_stack.back()].accumMs += ms;
+
+    m_stack.pop_back();
+    m_stackStart.pop_back();
+}
+
+//-------------------------------------------------------------------------
+// Frame time under which the given fraction of the history lies
+//
+float CpuProfiler::getPercentile(float fraction) const
+{
+    if (m_historyCount == 0)
+        return 0.f;
+
+    std::array<float, HISTORY_SIZE> sorted;
+    std::copy(m_history.begin(), m_history.begin() + m_historyCount, sorted.begin());
+
+    const uint32_t n = std::min(static_cast<uint32_t>(fraction * m_historyCount), m_historyCount - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + n, sorted.begin() + m_historyCount);
+    return sorted[n];
+}
+
+} // ! namespace tools
\ No newline at end of file
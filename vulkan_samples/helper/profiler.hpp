@@ -0,0 +1,91 @@
+/*
+ *
+ * Andrew Frost
+ * profiler.hpp
+ * 2020
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+namespace tools {
+
+///////////////////////////////////////////////////////////////////////////
+// CpuProfiler                                                           //
+///////////////////////////////////////////////////////////////////////////
+// Named CPU phases per frame and a ring of frame times                 //
+// - phase names are string literals, compared by pointer               //
+// - a phase may run several times per frame, its times add up          //
+///////////////////////////////////////////////////////////////////////////
+
+class CpuProfiler
+{
+public:
+    static constexpr uint32_t HISTORY_SIZE = 256;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Phase
+    {
+        const char* name{ nullptr };
+        float       ms{ 0.f };      // last completed frame
+        float       avgMs{ 0.f };   // exponential moving average
+        double      accumMs{ 0.0 }; // frame in progress
+    };
+
+    //-------------------------------------------------------------------------
+    // RAII phase, ends when leaving scope
+    //
+    class Scope
+    {
+    public:
+        Scope(CpuProfiler& profiler, const char* name) : m_profiler(profiler) { m_profiler.beginPhase(name); }
+        ~Scope() { m_profiler.endPhase(); }
+
+    private:
+        CpuProfiler& m_profiler;
+    };
+
+    CpuProfiler();
+    ~CpuProfiler() = default;
+
+    // Close the previous frame and start timing the next
+    void beginFrame();
+
+    void beginPhase(const char* name);
+    void endPhase();
+
+    // Frame time under which the given fraction of the history lies
+    float getPercentile(float fraction) const;
+
+    // Getting Methods
+    const std::vector<Phase>& getPhases()        const { return m_phases; }
+    const float*              getFrameHistory()  const { return m_history.data(); }
+    uint32_t                  getHistoryOffset() const { return m_historyOffset; }
+    uint32_t                  getHistoryCount()  const { return m_historyCount; }
+    float                     getFrameMs()       const { return m_frameMs; }
+    float                     getAverageMs()     const { return m_avgMs; }
+    uint64_t                  getFrameIndex()    const { return m_frameIndex; }
+
+private:
+
+    std::vector<Phase>                 m_phases;
+    std::vector<uint32_t>              m_stack;        // open phase indices
+    std::vector<Clock::time_point>     m_stackStart;
+
+    std::array<float, HISTORY_SIZE>    m_history;
+    uint32_t                           m_historyOffset{ 0 };
+    uint32_t                           m_historyCount{ 0 };
+
+    Clock::time_point                  m_frameStart;
+    float                              m_frameMs{ 0.f };
+    float                              m_avgMs{ 0.f };
+    uint64_t                           m_frameIndex{ 0 };
+
+}; // class CpuProfiler
+
+} // ! namespace tools
\ No newline at end of file
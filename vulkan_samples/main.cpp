@@ -28,6 +28,16 @@ static void onErrorCallback(int error, const char* description)
     std::cerr << "GLFW Error " << error << ": " << description << std::endl;
 }
 
+//-------------------------------------------------------------------------
+// GLFW on Framebuffer Size Callback, the rebuild happens in prepareFrame
+//
+static void onFramebufferSizeCallback(GLFWwindow* window, int width, int height)
+{
+    auto example = static_cast<vkb::VkExample*>(glfwGetWindowUserPointer(window));
+    if (example)
+        example->requestResize(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Application                                                           //
 ///////////////////////////////////////////////////////////////////////////
@@ -59,27 +69,48 @@ void run()
     contextInfo.addDeviceExtension(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
     contextInfo.addDeviceExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
     contextInfo.addDeviceExtension(VK_EXT_SCALAR_BLOCK_LAYOUT_EXTENSION_NAME);
+    contextInfo.addOptionalDeviceExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+#ifdef VK_EXT_extended_dynamic_state
+    contextInfo.addOptionalDeviceExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+#endif
+    contextInfo.asyncCompute = true;
 
     // Vulkan
     vkb::VkExample vkExample;
     vkExample.setupVulkan(contextInfo, window);
 
-    // ImGui
+    glfwSetWindowUserPointer(window, &vkExample);
+    glfwSetFramebufferSizeCallback(window, onFramebufferSizeCallback);
+
+    // ImGui overlay is set up by the example, F1 shows the performance HUD
 
     // Main Loop
     while (!glfwWindowShouldClose(window)) 
     {
         glfwPollEvents();
 
+        // nothing to present while minimized
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        if (width == 0 || height == 0) {
+            glfwWaitEvents();
+            continue;
+        }
+
         // Start ImGui frame
+        vkExample.beginFrame();
 
         // update camera buffer
+        vkExample.update();
 
         // show UI window
+        vkExample.drawUI();
 
         // start rendering the scene
+        vkExample.render();
 
         // submit for display
+        vkExample.submit();
     }
     // cleanup
     vkExample.getDevice().waitIdle();
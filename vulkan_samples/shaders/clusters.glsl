@@ -0,0 +1,20 @@
+// Froxel cluster addressing, shared by the light binning pass and the
+// shaders reading its lists. Requires gpu_structs.h
+
+// View space distance of the near side of slice
+float clusterSliceDepth(uint slice, float nearPlane, float farPlane)
+{
+    return nearPlane * pow(farPlane / nearPlane, float(slice) / float(GPU_CLUSTER_Z));
+}
+
+// Cluster of a fragment, viewDepth is the positive view space distance
+uint clusterIndex(vec2 fragCoord, float viewDepth, vec2 viewportSize, float nearPlane, float farPlane)
+{
+    uvec2 tile = uvec2(fragCoord * vec2(GPU_CLUSTER_X, GPU_CLUSTER_Y) / viewportSize);
+    tile = min(tile, uvec2(GPU_CLUSTER_X - 1u, GPU_CLUSTER_Y - 1u));
+
+    float slice = log(max(viewDepth, nearPlane) / nearPlane) * float(GPU_CLUSTER_Z) / log(farPlane / nearPlane);
+    uint z = min(uint(slice), GPU_CLUSTER_Z - 1u);
+
+    return tile.x + GPU_CLUSTER_X * (tile.y + GPU_CLUSTER_Y * z);
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#version 450
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_nonuniform_qualifier : require
+#extension GL_GOOGLE_include_directive : require
+
+// Scene fragment shader, materials and lights from the scalar layout
+// buffers of common/gpu_structs.h. Lights come from the list of the
+// fragment's cluster, built by light_cluster.comp
+
+#include "gpu_structs.h"
+#include "clusters.glsl"
+
+layout(set = 0, binding = 0, scalar) uniform CameraBlock
+{
+    GpuCamera camera;
+};
+
+layout(set = 0, binding = 3, scalar) readonly buffer MaterialBlock
+{
+    GpuMaterial materials[];
+};
+
+layout(set = 0, binding = 4, scalar) readonly buffer LightBlock
+{
+    GpuLight lights[];
+};
+
+layout(set = 0, binding = 5, scalar) readonly buffer ClusterBlock
+{
+    GpuCluster clusters[];
+};
+
+layout(set = 0, binding = 6, scalar) readonly buffer LightIndexBlock
+{
+    uint lightIndexCount;
+    uint lightIndices[];
+};
+
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(location = 0) in vec3 inWorldPos;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUV;
+layout(location = 3) flat in uint inMaterial;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    GpuMaterial material = materials[inMaterial];
+
+    vec4 base = material.baseColor;
+    if (material.baseColorTexture != GPU_NO_TEXTURE)
+        base *= texture(textures[nonuniformEXT(material.baseColorTexture)], inUV);
+
+    vec3 normal = normalize(inNormal);
+    vec3 lighting = vec3(0.03);
+
+    float viewDepth = -(camera.view * vec4(inWorldPos, 1.0)).z;
+    GpuCluster cluster = clusters[clusterIndex(gl_FragCoord.xy, viewDepth, camera.viewportSize,
+        camera.nearPlane, camera.farPlane)];
+
+    for (uint i = 0u; i < cluster.count; i++) {
+        GpuLight light = lights[lightIndices[cluster.offset + i]];
+
+        vec3 toLight = -light.direction;
+        float attenuation = 1.0;
+        if (light.type != GPU_LIGHT_DIRECTIONAL) {
+            toLight = light.position - inWorldPos;
+            float dist = length(toLight);
+            toLight /= max(dist, 1e-4);
+            attenuation = clamp(1.0 - dist / light.range, 0.0, 1.0);
+            attenuation *= attenuation;
+        }
+        if (light.type == GPU_LIGHT_SPOT)
+            attenuation *= smoothstep(light.spotCos, mix(light.spotCos, 1.0, 0.1), dot(-toLight, light.direction));
+
+        lighting += light.color * light.intensity * attenuation * max(dot(normal, toLight), 0.0);
+    }
+
+    outColor = vec4(base.rgb * lighting + material.emissive, base.a);
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#version 450
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_GOOGLE_include_directive : require
+
+// Scene vertex shader, geometry pool vertices and per instance data from
+// the scalar layout buffers of common/gpu_structs.h
+
+#include "gpu_structs.h"
+
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUV;
+
+layout(set = 0, binding = 0, scalar) uniform CameraBlock
+{
+    GpuCamera camera;
+};
+
+layout(set = 0, binding = 1, scalar) readonly buffer InstanceBlock
+{
+    GpuInstance instances[];
+};
+
+// gl_InstanceIndex to registered instance, filled by the LOD selector
+layout(set = 0, binding = 2, scalar) readonly buffer InstanceIndexBlock
+{
+    uint instanceIndices[];
+};
+
+layout(location = 0) out vec3 outWorldPos;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec2 outUV;
+layout(location = 3) flat out uint outMaterial;
+
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main()
+{
+    GpuInstance instance = instances[instanceIndices[gl_InstanceIndex]];
+
+    outWorldPos = rotate(instance.rotation, inPos * instance.scale) + instance.position;
+    outNormal = rotate(instance.rotation, inNormal);
+    outUV = inUV;
+    outMaterial = instance.materialIndex;
+
+    gl_Position = camera.viewProj * vec4(outWorldPos, 1.0);
+}
\ No newline at end of file